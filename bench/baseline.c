@@ -0,0 +1,384 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * Baseline files are small JSON documents written by baseline_write():
+ *
+ *	{
+ *		"format": 1,
+ *		"version": "<libelec version>",
+ *		"network": "<network file name>",
+ *		"conf_crc": "<CRC64 of the network definition in hex>",
+ *		"phases": [
+ *			{ "name": "<phase>", "median_ns": 123.4,
+ *			    "mad_ns": 1.2, "runs_ns": [ 122.1, 123.4, ... ] },
+ *			...
+ *		]
+ *	}
+ *
+ * Every phase is kept on a single line, which lets baseline_read() get
+ * by with a simple line-oriented parser instead of a full JSON parser.
+ * It only understands files in the exact layout written by us. The
+ * median and MAD are informational, they are recomputed from the runs.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/math.h>
+#include <acfutils/safe_alloc.h>
+
+#include "baseline.h"
+
+/* Scales the MAD to a standard deviation estimate for normal data */
+#define	MAD2SIGMA	1.4826
+/* Ratio of the standard error of the median to that of the mean */
+#define	MEDIAN_SE	1.2533
+
+static int
+dbl_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+double
+baseline_median(const double *x, unsigned n)
+{
+	double *tmp, med;
+
+	ASSERT(x != NULL || n == 0);
+	if (n == 0)
+		return (NAN);
+	tmp = safe_malloc(n * sizeof (*tmp));
+	memcpy(tmp, x, n * sizeof (*tmp));
+	qsort(tmp, n, sizeof (*tmp), dbl_cmp);
+	if (n % 2 == 0)
+		med = (tmp[n / 2 - 1] + tmp[n / 2]) / 2;
+	else
+		med = tmp[n / 2];
+	free(tmp);
+
+	return (med);
+}
+
+/*
+ * Median absolute deviation of `x' from its median.
+ */
+double
+baseline_mad(const double *x, unsigned n)
+{
+	double *dev, med, mad;
+
+	ASSERT(x != NULL || n == 0);
+	if (n == 0)
+		return (NAN);
+	med = baseline_median(x, n);
+	dev = safe_malloc(n * sizeof (*dev));
+	for (unsigned i = 0; i < n; i++)
+		dev[i] = fabs(x[i] - med);
+	mad = baseline_median(dev, n);
+	free(dev);
+
+	return (mad);
+}
+
+baseline_phase_t *
+baseline_phase_add(baseline_t *bl, const char *name)
+{
+	baseline_phase_t *ph;
+
+	ASSERT(bl != NULL);
+	ASSERT(name != NULL);
+	ph = (baseline_phase_t *)baseline_phase_find(bl, name);
+	if (ph != NULL)
+		return (ph);
+	VERIFY3U(bl->n_phases, <, BASELINE_MAX_PHASES);
+	ph = &bl->phases[bl->n_phases++];
+	memset(ph, 0, sizeof (*ph));
+	strlcpy(ph->name, name, sizeof (ph->name));
+
+	return (ph);
+}
+
+const baseline_phase_t *
+baseline_phase_find(const baseline_t *bl, const char *name)
+{
+	ASSERT(bl != NULL);
+	ASSERT(name != NULL);
+	for (unsigned i = 0; i < bl->n_phases; i++) {
+		if (strcmp(bl->phases[i].name, name) == 0)
+			return (&bl->phases[i]);
+	}
+	return (NULL);
+}
+
+/*
+ * Returns the path of the baseline file of the network with definition
+ * CRC `conf_crc' in the baseline store directory `dir'. The caller is
+ * responsible for freeing the returned string.
+ */
+char *
+baseline_path(const char *dir, uint64_t conf_crc)
+{
+	char name[32];
+
+	ASSERT(dir != NULL);
+	snprintf(name, sizeof (name), "%016llx.json",
+	    (unsigned long long)conf_crc);
+	return (mkpathname(dir, name, NULL));
+}
+
+/*
+ * Copies `src' into `dst', replacing characters which would need to be
+ * escaped in a JSON string, so baseline_read() can read it back as-is.
+ */
+static void
+json_sanitize(char *dst, const char *src, size_t cap)
+{
+	strlcpy(dst, src, cap);
+	for (char *c = dst; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20)
+			*c = '_';
+	}
+}
+
+bool
+baseline_write(const char *filename, const baseline_t *bl)
+{
+	char version[BASELINE_NAME_LEN], network[BASELINE_NAME_LEN];
+	FILE *fp;
+	bool ok;
+
+	ASSERT(filename != NULL);
+	ASSERT(bl != NULL);
+
+	fp = fopen(filename, "w");
+	if (fp == NULL) {
+		logMsg("Can't open %s for writing: %s", filename,
+		    strerror(errno));
+		return (false);
+	}
+	json_sanitize(version, bl->version, sizeof (version));
+	json_sanitize(network, bl->network, sizeof (network));
+	fprintf(fp, "{\n"
+	    "\t\"format\": %d,\n"
+	    "\t\"version\": \"%s\",\n"
+	    "\t\"network\": \"%s\",\n"
+	    "\t\"conf_crc\": \"%016llx\",\n"
+	    "\t\"phases\": [\n", BASELINE_FORMAT, version, network,
+	    (unsigned long long)bl->conf_crc);
+	for (unsigned i = 0; i < bl->n_phases; i++) {
+		const baseline_phase_t *ph = &bl->phases[i];
+
+		fprintf(fp, "\t\t{ \"name\": \"%s\", \"median_ns\": %.1f, "
+		    "\"mad_ns\": %.1f, \"runs_ns\": [", ph->name,
+		    baseline_median(ph->runs_ns, ph->n_runs),
+		    baseline_mad(ph->runs_ns, ph->n_runs));
+		for (unsigned j = 0; j < ph->n_runs; j++) {
+			fprintf(fp, "%s %.1f", j == 0 ? "" : ",",
+			    ph->runs_ns[j]);
+		}
+		fprintf(fp, " ] }%s\n", i + 1 < bl->n_phases ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+	ok = (ferror(fp) == 0);
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok)
+		logMsg("Error writing %s", filename);
+
+	return (ok);
+}
+
+static bool
+read_phase(const char *line, baseline_phase_t *ph)
+{
+	const char *p;
+
+	if (sscanf(line, " { \"name\": \"%63[^\"]\"", ph->name) != 1)
+		return (false);
+	p = strstr(line, "\"runs_ns\": [");
+	if (p == NULL)
+		return (false);
+	p += strlen("\"runs_ns\": [");
+	ph->n_runs = 0;
+	for (;;) {
+		char *end;
+		double ns;
+
+		while (*p == ' ' || *p == ',')
+			p++;
+		if (*p == ']')
+			return (true);
+		ns = strtod(p, &end);
+		if (end == p || ph->n_runs == BASELINE_MAX_RUNS)
+			return (false);
+		ph->runs_ns[ph->n_runs++] = ns;
+		p = end;
+	}
+}
+
+bool
+baseline_read(const char *filename, baseline_t *bl)
+{
+	char *line = NULL;
+	size_t cap = 0;
+	int format = -1;
+	unsigned long long crc;
+	bool have_crc = false, ok = true;
+	FILE *fp;
+
+	ASSERT(filename != NULL);
+	ASSERT(bl != NULL);
+
+	fp = fopen(filename, "r");
+	if (fp == NULL) {
+		logMsg("Can't open %s for reading: %s", filename,
+		    strerror(errno));
+		return (false);
+	}
+	memset(bl, 0, sizeof (*bl));
+	for (unsigned line_num = 1; ok && lacf_getline(&line, &cap, fp) > 0;
+	    line_num++) {
+		if (sscanf(line, " \"format\": %d", &format) == 1 ||
+		    sscanf(line, " \"version\": \"%63[^\"]\"",
+		    bl->version) == 1 ||
+		    sscanf(line, " \"network\": \"%63[^\"]\"",
+		    bl->network) == 1) {
+			continue;
+		}
+		if (sscanf(line, " \"conf_crc\": \"%llx\"", &crc) == 1) {
+			bl->conf_crc = crc;
+			have_crc = true;
+		} else if (strstr(line, "\"name\":") != NULL) {
+			if (bl->n_phases == BASELINE_MAX_PHASES ||
+			    !read_phase(line, &bl->phases[bl->n_phases])) {
+				logMsg("%s:%d: malformed phase", filename,
+				    line_num);
+				ok = false;
+			} else {
+				bl->n_phases++;
+			}
+		}
+	}
+	free(line);
+	fclose(fp);
+	if (ok && format != BASELINE_FORMAT) {
+		logMsg("%s: unsupported baseline format %d (expected %d)",
+		    filename, format, BASELINE_FORMAT);
+		ok = false;
+	}
+	if (ok && !have_crc) {
+		logMsg("%s: missing conf_crc", filename);
+		ok = false;
+	}
+
+	return (ok);
+}
+
+/*
+ * Compares the runs of a phase against its baseline. `delta_rel' is
+ * filled with the relative change of the median duration.
+ */
+baseline_signif_t
+baseline_phase_cmp(const baseline_phase_t *base, const baseline_phase_t *cur,
+    double *delta_rel)
+{
+	double med_base, med_cur, se_base, se_cur, delta, se;
+
+	ASSERT(base != NULL);
+	ASSERT(cur != NULL);
+	ASSERT(delta_rel != NULL);
+
+	med_base = baseline_median(base->runs_ns, base->n_runs);
+	med_cur = baseline_median(cur->runs_ns, cur->n_runs);
+	delta = med_cur - med_base;
+	*delta_rel = (med_base > 0 ? delta / med_base : NAN);
+	if (base->n_runs < BASELINE_SIGNIF_MIN_RUNS ||
+	    cur->n_runs < BASELINE_SIGNIF_MIN_RUNS || med_base <= 0)
+		return (BASELINE_UNKNOWN);
+	/*
+	 * Robust standard errors of the medians, derived from the MADs,
+	 * so a few runs disturbed by other system activity can't skew
+	 * the result.
+	 */
+	se_base = MEDIAN_SE * MAD2SIGMA *
+	    baseline_mad(base->runs_ns, base->n_runs) / sqrt(base->n_runs);
+	se_cur = MEDIAN_SE * MAD2SIGMA *
+	    baseline_mad(cur->runs_ns, cur->n_runs) / sqrt(cur->n_runs);
+	se = sqrt(POW2(se_base) + POW2(se_cur));
+	if (fabs(delta) < BASELINE_SIGNIF_Z * se ||
+	    fabs(*delta_rel) < BASELINE_SIGNIF_REL)
+		return (BASELINE_SAME);
+
+	return (delta > 0 ? BASELINE_SLOWER : BASELINE_FASTER);
+}
+
+/*
+ * Prints a per-phase comparison of `cur' against the baseline `base'.
+ * Returns true if no phase got significantly slower.
+ */
+bool
+baseline_print_cmp(FILE *fp, const baseline_t *base, const baseline_t *cur)
+{
+	static const char *signif_names[] = {
+	    [BASELINE_SAME] = "same",
+	    [BASELINE_FASTER] = "FASTER",
+	    [BASELINE_SLOWER] = "SLOWER",
+	    [BASELINE_UNKNOWN] = "?"
+	};
+	bool ok = true;
+
+	ASSERT(fp != NULL);
+	ASSERT(base != NULL);
+	ASSERT(cur != NULL);
+
+	fprintf(fp, "Baseline: libelec %s, %s\n\n", base->version,
+	    base->network);
+	fprintf(fp, "PHASE                       BASE_us    MAD_us"
+	    "    CUR_us    MAD_us    DELTA  RESULT\n"
+	    "------------------------  ---------  --------"
+	    "  ---------  --------  -------  ------\n");
+	for (unsigned i = 0; i < cur->n_phases; i++) {
+		const baseline_phase_t *ph_cur = &cur->phases[i];
+		const baseline_phase_t *ph_base =
+		    baseline_phase_find(base, ph_cur->name);
+		baseline_signif_t signif;
+		double delta_rel;
+
+		if (ph_base == NULL) {
+			fprintf(fp, "%-24s  %9s  %8s  %9.2f  %8.2f  %7s  "
+			    "%s\n", ph_cur->name, "-", "-",
+			    baseline_median(ph_cur->runs_ns,
+			    ph_cur->n_runs) / 1000,
+			    baseline_mad(ph_cur->runs_ns,
+			    ph_cur->n_runs) / 1000, "-", "new");
+			continue;
+		}
+		signif = baseline_phase_cmp(ph_base, ph_cur, &delta_rel);
+		if (signif == BASELINE_SLOWER)
+			ok = false;
+		fprintf(fp, "%-24s  %9.2f  %8.2f  %9.2f  %8.2f  %+6.1f%%  "
+		    "%s\n", ph_cur->name,
+		    baseline_median(ph_base->runs_ns, ph_base->n_runs) / 1000,
+		    baseline_mad(ph_base->runs_ns, ph_base->n_runs) / 1000,
+		    baseline_median(ph_cur->runs_ns, ph_cur->n_runs) / 1000,
+		    baseline_mad(ph_cur->runs_ns, ph_cur->n_runs) / 1000,
+		    delta_rel * 100, signif_names[signif]);
+	}
+
+	return (ok);
+}
@@ -0,0 +1,91 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	__LIBELEC_BENCH_BASELINE_H__
+#define	__LIBELEC_BENCH_BASELINE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Version of the baseline file format. Bump this whenever the meaning
+ * of the stored numbers changes, older baselines are then rejected.
+ */
+#define	BASELINE_FORMAT		1
+#define	BASELINE_MAX_RUNS	100
+#define	BASELINE_MAX_PHASES	32
+#define	BASELINE_NAME_LEN	64
+
+/*
+ * Samples of a single benchmarked phase. Each run of the benchmark
+ * contributes the average duration of one call in that run.
+ */
+typedef struct {
+	char		name[BASELINE_NAME_LEN];
+	unsigned	n_runs;
+	double		runs_ns[BASELINE_MAX_RUNS];
+} baseline_phase_t;
+
+/*
+ * Benchmark results of one network, as stored in a baseline file. The
+ * network is identified by the CRC64 of its definition (the same one
+ * libelec uses to validate its definition image caches), so renaming
+ * the file doesn't invalidate the baseline, but editing it does.
+ */
+typedef struct {
+	uint64_t		conf_crc;
+	char			version[BASELINE_NAME_LEN];
+	char			network[BASELINE_NAME_LEN];
+	unsigned		n_phases;
+	baseline_phase_t	phases[BASELINE_MAX_PHASES];
+} baseline_t;
+
+/*
+ * Results of comparing a phase against its baseline. A difference is
+ * only deemed significant if it's at least `SIGNIF_Z' robust standard
+ * errors of the difference of the medians and `SIGNIF_REL' of the
+ * baseline median.
+ */
+#define	BASELINE_SIGNIF_Z	3.0
+#define	BASELINE_SIGNIF_REL	0.05
+#define	BASELINE_SIGNIF_MIN_RUNS	3
+
+typedef enum {
+	BASELINE_SAME,		/* no significant difference */
+	BASELINE_FASTER,
+	BASELINE_SLOWER,
+	BASELINE_UNKNOWN	/* too few runs to tell */
+} baseline_signif_t;
+
+double baseline_median(const double *x, unsigned n);
+double baseline_mad(const double *x, unsigned n);
+
+baseline_phase_t *baseline_phase_add(baseline_t *bl, const char *name);
+const baseline_phase_t *baseline_phase_find(const baseline_t *bl,
+    const char *name);
+
+char *baseline_path(const char *dir, uint64_t conf_crc);
+bool baseline_write(const char *filename, const baseline_t *bl);
+bool baseline_read(const char *filename, baseline_t *bl);
+
+baseline_signif_t baseline_phase_cmp(const baseline_phase_t *base,
+    const baseline_phase_t *cur, double *delta_rel);
+bool baseline_print_cmp(FILE *fp, const baseline_t *base,
+    const baseline_t *cur);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __LIBELEC_BENCH_BASELINE_H__ */
@@ -0,0 +1,2609 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * libelec_bench: solver throughput measurement tool. It can either
+ * generate synthetic networks of a configurable size and shape ("gen"),
+ * or load a network and time libelec_new(), each phase of the network
+ * worker and the (de)serialization paths ("run"). The public API hot
+ * paths, such as the state getters under contention from concurrent
+ * readers and the network worker, can be timed using "api". It can also
+ * generate a specialized solver for a network, to be compiled into
+ * libelec using the LIBELEC_SPEC_SOLVER macro ("cgen"), time the
+ * drawing of the network's schematic into offscreen images ("draw"),
+ * re-execute an input capture made using libelec_capture_start() with
+ * the solver profile enabled ("replay"), or report how expensive a
+ * network's topology is to traverse, before it ever gets run
+ * ("analyze"). Finally, it can run a network for hours with random
+ * inputs, failures and reconnects, watching for memory growth and
+ * slowing passes ("soak").
+ *
+ * To be able to time the individual worker phases, which are private
+ * to libelec.c, the runner pulls libelec.c directly into its own
+ * translation unit. Before doing so, we reroute the allocator calls made
+ * by libelec (including the inline libacfutils safe_* wrappers) through
+ * counting wrappers. Allocations done inside of the compiled libacfutils
+ * library (e.g. by the conf parser) are not included in the counts.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t n_allocs = 0;
+
+static void *
+bench_malloc(size_t size)
+{
+	n_allocs++;
+	return (malloc(size));
+}
+
+static void *
+bench_calloc(size_t nmemb, size_t size)
+{
+	n_allocs++;
+	return (calloc(nmemb, size));
+}
+
+static void *
+bench_realloc(void *oldptr, size_t size)
+{
+	n_allocs++;
+	return (realloc(oldptr, size));
+}
+
+#define	malloc(size)		bench_malloc(size)
+#define	calloc(nmemb, size)	bench_calloc(nmemb, size)
+#define	realloc(oldptr, size)	bench_realloc(oldptr, size)
+
+#include "../src/libelec.c"
+
+#undef	malloc
+#undef	calloc
+#undef	realloc
+
+#define	NUM_COMP_TYPES	(ELEC_LABEL_BOX + 1)
+
+/*
+ * Time spent drawing each type of component, accounted by the probes
+ * in libelec_drawing.c while `draw_probe_on' is set. The probes are
+ * only enabled for separate passes, so that the overhead of reading
+ * the clock doesn't skew the frame rate measurements.
+ */
+static bool draw_probe_on = false;
+static uint64_t draw_probe_ns[NUM_COMP_TYPES];
+static uint64_t bench_ns(void);
+
+#define	DRAW_PROBE(type, expr) \
+	do { \
+		if (draw_probe_on) { \
+			uint64_t __t0 = bench_ns(); \
+			expr; \
+			draw_probe_ns[(type)] += bench_ns() - __t0; \
+		} else { \
+			expr; \
+		} \
+	} while (0)
+
+#include "../src/libelec_drawing.c"
+
+#include <acfutils/conf.h>
+
+#include "baseline.h"
+#include "netgen.h"
+
+#define	BENCH_PREFIX	"bench"
+/* Exit status of "run" when a phase got slower than its baseline */
+#define	BENCH_EXIT_SLOWER	2
+
+#ifndef	LIBELEC_VERSION
+#define	LIBELEC_VERSION	"unknown"
+#endif
+/*
+ * Past a few hundred steps, the unrolled code of a plan no longer fits
+ * into the instruction cache & ends up slower than the generic solver.
+ */
+#define	CGEN_MAX_STEPS_DFL	256
+/* Maximum number of image sizes & zoom levels for "draw" */
+#define	DRAW_MAX_CONFS		8
+/* Default number of slowest passes & busiest components for "replay" */
+#define	REPLAY_TOP_DFL		10
+/* Default number of random tie & breaker configurations for "analyze" */
+#define	ANALYZE_SAMPLES_DFL	1000
+/* Exit status of "analyze" when the network exceeds the -V limit */
+#define	ANALYZE_EXIT_LIMIT	2
+/* Default duration & report interval of "soak" in seconds */
+#define	SOAK_DURATION_DFL	60
+#define	SOAK_INTERVAL_DFL	10
+/* Default random failures per 1000 ticks of "soak" */
+#define	SOAK_FAIL_RATE_DFL	5
+/* Default ticks between reconnects & serializations of "soak" */
+#define	SOAK_CONN_EVERY_DFL	100
+#define	SOAK_SER_EVERY_DFL	1000
+/* Default growth over the first interval flagged by "soak" in percent */
+#define	SOAK_GROWTH_DFL		25
+/* Exit status of "soak" when the last interval drifted */
+#define	SOAK_EXIT_DRIFT		2
+
+enum {
+	PHASE_NEW,
+	PHASE_DESTROY,
+	PHASE_RESET,
+	PHASE_CLEAR,
+	PHASE_SRCS_UPDATE,
+	PHASE_LOADS_RANDOMIZE,
+	PHASE_PAINT,
+	PHASE_LOAD_INTEGRATE,
+	PHASE_NODAL_SOLVE,
+	PHASE_LOADS_UPDATE,
+	PHASE_TIES_UPDATE,
+	PHASE_STATE_XFER,
+	PHASE_PASS,
+	PHASE_SERIALIZE,
+	PHASE_DESERIALIZE,
+	NUM_PHASES
+};
+
+typedef struct {
+	const char	*name;
+	uint64_t	calls;
+	uint64_t	ns;
+	uint64_t	allocs;
+} phase_t;
+
+static phase_t phases[NUM_PHASES] = {
+    [PHASE_NEW] = { .name = "libelec_new" },
+    [PHASE_DESTROY] = { .name = "libelec_destroy" },
+    [PHASE_RESET] = { .name = "network_reset" },
+    [PHASE_CLEAR] = { .name = "network_clear" },
+    [PHASE_SRCS_UPDATE] = { .name = "network_srcs_update" },
+    [PHASE_LOADS_RANDOMIZE] = { .name = "network_loads_randomize" },
+    [PHASE_PAINT] = { .name = "network_paint" },
+    [PHASE_LOAD_INTEGRATE] = { .name = "network_load_integrate" },
+    [PHASE_NODAL_SOLVE] = { .name = "network_nodal_solve" },
+    [PHASE_LOADS_UPDATE] = { .name = "network_loads_update" },
+    [PHASE_TIES_UPDATE] = { .name = "network_ties_update" },
+    [PHASE_STATE_XFER] = { .name = "network_state_xfer" },
+    [PHASE_PASS] = { .name = "(full worker pass)" },
+    [PHASE_SERIALIZE] = { .name = "libelec_serialize" },
+    [PHASE_DESERIALIZE] = { .name = "libelec_deserialize" }
+};
+
+static uint64_t
+bench_ns(void)
+{
+	struct timespec ts;
+
+	VERIFY0(clock_gettime(CLOCK_MONOTONIC, &ts));
+	return ((uint64_t)ts.tv_sec * 1000000000llu + ts.tv_nsec);
+}
+
+/*
+ * Evaluates `expr' and accounts its run time and the number of
+ * allocations it performed to phase `phase'.
+ */
+#define	TIME_PHASE(phase, expr) \
+	do { \
+		uint64_t __t0 = bench_ns(), __a0 = n_allocs; \
+		expr; \
+		phases[(phase)].ns += bench_ns() - __t0; \
+		phases[(phase)].allocs += n_allocs - __a0; \
+		phases[(phase)].calls++; \
+	} while (0)
+
+/*
+ * Set by "analyze" while it flips breakers at random, which would
+ * otherwise log every breaker it opens as having popped.
+ */
+static bool debug_quiet = false;
+
+static void
+debug_print(const char *str)
+{
+	if (!debug_quiet)
+		fputs(str, stderr);
+}
+
+static void
+print_usage(FILE *fp, const char *progname)
+{
+	fprintf(fp, "Usage: %s gen [-h] [-g <gens>] [-b <batts>] "
+	    "[-m <buses>] [-l <loads>]\n"
+	    "           [-t <fanout>] [-i <chain_len>] [-N] "
+	    "[-o <elec_file>]\n"
+	    "       %s run [-h] [-T] [-n <steps>] [-w <warmup>] "
+	    "[-d <d_t>] [-s <substep>]\n"
+	    "           [-r <repeats>] [-E <solver>] [-R <runs>] "
+	    "[-B <store_dir> [-u]]\n"
+	    "           <elec_file>\n"
+	    "       %s api [-h] [-n <sweeps>] [-i <iters>] [-j <threads>] "
+	    "[-d <d_t>]\n"
+	    "           <elec_file>\n"
+	    "       %s cgen [-h] [-m <max_steps>] [-o <c_file>] <elec_file>\n"
+	    "       %s draw [-h] [-n <frames>] [-i <iters>] [-s <W>x<H>] "
+	    "[-z <zoom>]\n"
+	    "           [-p <scale>] [-f <font_sz>] <elec_file>\n"
+	    "       %s replay [-h] [-t <top>] <elec_file> <capture_file>\n"
+	    "       %s analyze [-h] [-s <samples>] [-t <top>] "
+	    "[-V <max_visits>]\n"
+	    "           <elec_file>\n"
+	    "       %s soak [-h] [-D <secs>] [-I <secs>] [-d <d_t>] "
+	    "[-f <fails>] [-c <ticks>]\n"
+	    "           [-S <ticks>] [-G <growth>] <elec_file>\n"
+	    "\n"
+	    "gen: writes a synthetic network definition to stdout.\n"
+	    "  -g <gens> : Number of generators, each with its own "
+	    "channel (default: %u).\n"
+	    "  -b <batts> : Number of batteries (default: %u).\n"
+	    "  -m <buses> : DC buses per channel, joined by CBs "
+	    "(default: %u).\n"
+	    "  -l <loads> : Loads per bus (default: %u).\n"
+	    "  -t <fanout> : Channels joined by each tie, 0 for no ties "
+	    "(default: %u).\n"
+	    "  -i <chain_len> : TRU/inverter pairs per channel "
+	    "(default: %u).\n"
+	    "  -N : Attach loads directly to buses, without a LOADCB.\n"
+	    "  -o <elec_file> : Write the network to <elec_file> instead "
+	    "of stdout.\n"
+	    "\n"
+	    "run: loads a network and times the network worker phases.\n"
+	    "  -T : Close all ties before running.\n"
+	    "  -n <steps> : Number of timed worker passes (default: 1000).\n"
+	    "  -w <warmup> : Number of untimed worker passes run first "
+	    "(default: 100).\n"
+	    "  -d <d_t> : Simulation time step in seconds "
+	    "(default: %g).\n"
+	    "  -s <substep> : Maximum sub-step size of the stiff "
+	    "integrations in\n"
+	    "       seconds, 0 to disable sub-stepping (default: 0).\n"
+	    "  -r <repeats> : Number of libelec_new and (de)serialize "
+	    "repetitions\n"
+	    "       (default: 10).\n"
+	    "  -E <solver> : Network solver to use, \"paint\" or "
+	    "\"nodal\"\n"
+	    "       (default: paint).\n"
+	    "  -R <runs> : Number of repeated benchmark runs, the results "
+	    "are the\n"
+	    "       medians of all runs (default: 1, max: %u).\n"
+	    "  -B <store_dir> : Compare the results against the baseline of "
+	    "the\n"
+	    "       network in <store_dir>.\n"
+	    "  -u : Save the results as the new baseline of the network in "
+	    "<store_dir>.\n"
+	    "\n"
+	    "api: times public API calls, with & without a running "
+	    "worker.\n"
+	    "  -n <sweeps> : Getter sweeps over all components per reader "
+	    "thread\n"
+	    "       (default: 1000).\n"
+	    "  -i <iters> : Iterations of the other API benchmarks "
+	    "(default: 100).\n"
+	    "  -j <threads> : Maximum number of reader threads "
+	    "(default: 16).\n"
+	    "  -d <d_t> : Worker interval in seconds (default: %g).\n"
+	    "\n"
+	    "cgen: writes a solver specialized for a network to stdout.\n"
+	    "  -m <max_steps> : Leave sources with larger plans to the "
+	    "generic solver\n"
+	    "       (default: %u).\n"
+	    "  -o <c_file> : Write the solver to <c_file> instead of "
+	    "stdout.\n"
+	    "\n"
+	    "draw: times the drawing of the network layout & info "
+	    "overlays.\n"
+	    "  -n <frames> : Number of timed frames per image size & zoom "
+	    "level\n"
+	    "       (default: 20).\n"
+	    "  -i <iters> : Info overlay drawings per component "
+	    "(default: 10).\n"
+	    "  -s <W>x<H> : Image size, may be given up to %u times\n"
+	    "       (default: 1024x768 and 2048x2048).\n"
+	    "  -z <zoom> : Zoom level, may be given up to %u times\n"
+	    "       (default: 0.05, 0.15, 0.5, 1 and 2).\n"
+	    "  -p <scale> : Layout position scale (default: 16).\n"
+	    "  -f <font_sz> : Font size (default: 14).\n"
+	    "\n"
+	    "replay: re-executes an input capture of the network and "
+	    "profiles it.\n"
+	    "  -t <top> : Number of slowest passes and busiest components "
+	    "to list\n"
+	    "       (default: %u).\n"
+	    "\n"
+	    "analyze: reports the traversal cost, source fan-in and memory "
+	    "footprint\n"
+	    "       of a network.\n"
+	    "  -s <samples> : Number of random tie & breaker configurations "
+	    "to run\n"
+	    "       (default: %u).\n"
+	    "  -t <top> : Number of sources and components to list "
+	    "(default: %u).\n"
+	    "  -V <max_visits> : Exit with status %d if the worst-case "
+	    "number of\n"
+	    "       component visits per pass exceeds <max_visits>.\n",
+	    progname, progname, progname, progname, progname, progname,
+	    progname, progname,
+	    NETGEN_PARAMS_DFL.n_gens, NETGEN_PARAMS_DFL.n_batts,
+	    NETGEN_PARAMS_DFL.n_buses, NETGEN_PARAMS_DFL.n_loads,
+	    NETGEN_PARAMS_DFL.tie_fanout, NETGEN_PARAMS_DFL.chain_len,
+	    USEC2SEC(EXEC_INTVAL), BASELINE_MAX_RUNS, USEC2SEC(EXEC_INTVAL),
+	    CGEN_MAX_STEPS_DFL, DRAW_MAX_CONFS, DRAW_MAX_CONFS,
+	    REPLAY_TOP_DFL, ANALYZE_SAMPLES_DFL, REPLAY_TOP_DFL,
+	    ANALYZE_EXIT_LIMIT);
+	fprintf(fp, "\n"
+	    "soak: runs the network with random inputs & failures, "
+	    "tracking memory\n"
+	    "       growth & tick time drift.\n"
+	    "  -D <secs> : Duration of the run (default: %u).\n"
+	    "  -I <secs> : Report interval (default: %u).\n"
+	    "  -d <d_t> : Simulation time step in seconds "
+	    "(default: %g).\n"
+	    "  -f <fails> : Random failures per 1000 ticks "
+	    "(default: %u).\n"
+	    "  -c <ticks> : Ticks between netlink reconnects, 0 to "
+	    "disable\n"
+	    "       (default: %u, needs LIBELEC_WITH_NETLINK).\n"
+	    "  -S <ticks> : Ticks between serialize/deserialize cycles, "
+	    "0 to disable\n"
+	    "       (default: %u).\n"
+	    "  -G <growth> : Exit with status %d if the last interval "
+	    "grew by more\n"
+	    "       than <growth> percent over the first one "
+	    "(default: %u).\n",
+	    SOAK_DURATION_DFL, SOAK_INTERVAL_DFL, USEC2SEC(EXEC_INTVAL),
+	    SOAK_FAIL_RATE_DFL, SOAK_CONN_EVERY_DFL, SOAK_SER_EVERY_DFL,
+	    SOAK_EXIT_DRIFT, SOAK_GROWTH_DFL);
+}
+
+static int
+gen_main(int argc, char **argv, const char *progname)
+{
+	netgen_params_t params = NETGEN_PARAMS_DFL;
+	const char *out_filename = NULL;
+	FILE *fp = stdout;
+	int opt;
+	bool ok;
+
+	while ((opt = getopt(argc, argv, "hg:b:m:l:t:i:No:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 'g':
+			params.n_gens = atoi(optarg);
+			break;
+		case 'b':
+			params.n_batts = atoi(optarg);
+			break;
+		case 'm':
+			params.n_buses = atoi(optarg);
+			break;
+		case 'l':
+			params.n_loads = atoi(optarg);
+			break;
+		case 't':
+			params.tie_fanout = atoi(optarg);
+			break;
+		case 'i':
+			params.chain_len = atoi(optarg);
+			break;
+		case 'N':
+			params.load_cbs = false;
+			break;
+		case 'o':
+			out_filename = optarg;
+			break;
+		default: /* '?' */
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (out_filename != NULL) {
+		fp = fopen(out_filename, "w");
+		if (fp == NULL) {
+			fprintf(stderr, "Can't open %s for writing: %s\n",
+			    out_filename, strerror(errno));
+			return (EXIT_FAILURE);
+		}
+	}
+	ok = netgen_write(fp, &params);
+	if (fp != stdout)
+		fclose(fp);
+
+	return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*
+ * Performs one worker pass the same way network_solve does it with
+ * incremental evaluation and the parallel solver disabled, but timing
+ * each phase separately.
+ */
+static void
+bench_pass(elec_sys_t *sys, double d_t)
+{
+	uint64_t t0, a0;
+
+	ASSERT(sys != NULL);
+
+	t0 = bench_ns();
+	a0 = n_allocs;
+	mutex_enter(&sys->worker_interlock);
+	TIME_PHASE(PHASE_RESET, network_reset(sys, d_t));
+	TIME_PHASE(PHASE_CLEAR, network_clear(sys, false));
+	TIME_PHASE(PHASE_SRCS_UPDATE, network_srcs_update(sys, d_t));
+	TIME_PHASE(PHASE_LOADS_RANDOMIZE, network_loads_randomize(sys, d_t));
+	if (sys->solver == ELEC_SOLVER_NODAL) {
+		TIME_PHASE(PHASE_NODAL_SOLVE, network_nodal_solve(sys, d_t));
+	} else {
+		TIME_PHASE(PHASE_PAINT, network_paint(sys));
+		TIME_PHASE(PHASE_LOAD_INTEGRATE,
+		    network_load_integrate(sys, d_t));
+	}
+	TIME_PHASE(PHASE_LOADS_UPDATE, network_loads_update(sys, d_t));
+	TIME_PHASE(PHASE_TIES_UPDATE, network_ties_update(sys));
+	TIME_PHASE(PHASE_STATE_XFER, network_state_xfer(sys, d_t));
+	mutex_exit(&sys->worker_interlock);
+	phases[PHASE_PASS].ns += bench_ns() - t0;
+	phases[PHASE_PASS].allocs += n_allocs - a0;
+	phases[PHASE_PASS].calls++;
+}
+
+static void
+sys_prep(elec_sys_t *sys, bool close_ties)
+{
+	ASSERT(sys != NULL);
+
+	for (elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		if (comp->info->type == ELEC_GEN) {
+			libelec_gen_set_rpm(comp, AVG(comp->info->gen.min_rpm,
+			    comp->info->gen.max_rpm));
+		} else if (comp->info->type == ELEC_TIE && close_ties) {
+			libelec_tie_set_all(comp, true);
+		}
+	}
+}
+
+/*
+ * Records the average call duration of every phase measured during a
+ * benchmark run into `bl' and resets the phase counters for the next
+ * run. The call and allocation totals are kept in `totals'.
+ */
+static void
+run_record(baseline_t *bl, phase_t totals[NUM_PHASES])
+{
+	for (int i = 0; i < NUM_PHASES; i++) {
+		phase_t *ph = &phases[i];
+		baseline_phase_t *bl_ph;
+
+		if (ph->calls == 0)
+			continue;
+		bl_ph = baseline_phase_add(bl, ph->name);
+		VERIFY3U(bl_ph->n_runs, <, BASELINE_MAX_RUNS);
+		bl_ph->runs_ns[bl_ph->n_runs++] = (double)ph->ns / ph->calls;
+		totals[i].calls += ph->calls;
+		totals[i].ns += ph->ns;
+		totals[i].allocs += ph->allocs;
+		ph->calls = 0;
+		ph->ns = 0;
+		ph->allocs = 0;
+	}
+}
+
+/*
+ * Prints the results of all runs. The average call duration is the
+ * median of the per-run averages, its spread is given as the median
+ * absolute deviation (MAD) of the per-run averages.
+ */
+static void
+print_results(const baseline_t *bl, const phase_t totals[NUM_PHASES],
+    size_t n_comps)
+{
+	printf("PHASE                        CALLS     AVG_us    MAD_us"
+	    "   ns/COMP   ALLOCS/CALL\n"
+	    "------------------------  ---------  ---------  --------"
+	    "  --------  ------------\n");
+	for (int i = 0; i < NUM_PHASES; i++) {
+		const phase_t *ph = &totals[i];
+		const baseline_phase_t *bl_ph;
+		double avg_ns, mad_ns;
+
+		if (ph->calls == 0)
+			continue;
+		bl_ph = baseline_phase_find(bl, phases[i].name);
+		ASSERT(bl_ph != NULL);
+		avg_ns = baseline_median(bl_ph->runs_ns, bl_ph->n_runs);
+		mad_ns = baseline_mad(bl_ph->runs_ns, bl_ph->n_runs);
+		printf("%-24s  %9llu  %9.2f  %8.2f  %8.1f  %12.1f\n",
+		    phases[i].name, (unsigned long long)ph->calls,
+		    avg_ns / 1000, mad_ns / 1000, avg_ns / n_comps,
+		    (double)ph->allocs / ph->calls);
+	}
+}
+
+typedef struct {
+	unsigned	n_steps;
+	unsigned	n_warmup;
+	unsigned	n_repeats;
+	double		d_t;
+	double		substep;
+	bool		close_ties;
+	elec_solver_t	solver;
+} run_params_t;
+
+/*
+ * Performs a single benchmark run, accumulating the results in
+ * `phases'. Returns the number of components in the network and the
+ * CRC of its definition in `n_comps' and `conf_crc'.
+ */
+static bool
+run_once(const char *filename, const run_params_t *params,
+    size_t *n_comps, uint64_t *conf_crc)
+{
+	elec_sys_t *sys;
+	conf_t *ser;
+
+	/*
+	 * The final repetition of libelec_new() gives us the network we
+	 * then run all the other measurements on.
+	 */
+	for (unsigned i = 0;; i++) {
+		TIME_PHASE(PHASE_NEW, sys = libelec_new(filename));
+		if (sys == NULL)
+			return (false);
+		if (i + 1 == params->n_repeats)
+			break;
+		TIME_PHASE(PHASE_DESTROY, libelec_destroy(sys));
+	}
+	*n_comps = list_count(&sys->comps);
+	*conf_crc = sys->conf_crc;
+	sys_prep(sys, params->close_ties);
+	libelec_sys_set_substep(sys, params->substep);
+	libelec_sys_set_solver(sys, params->solver);
+
+	for (unsigned i = 0; i < params->n_warmup; i++)
+		elec_sys_pass(sys, params->d_t, 0);
+	for (unsigned i = 0; i < params->n_steps; i++)
+		bench_pass(sys, params->d_t);
+
+	ser = conf_create_empty();
+	for (unsigned i = 0; i < params->n_repeats; i++) {
+		TIME_PHASE(PHASE_SERIALIZE,
+		    libelec_serialize(sys, ser, BENCH_PREFIX));
+	}
+	for (unsigned i = 0; i < params->n_repeats; i++) {
+		bool ok;
+
+		TIME_PHASE(PHASE_DESERIALIZE,
+		    ok = libelec_deserialize(sys, ser, BENCH_PREFIX));
+		VERIFY(ok);
+	}
+	conf_free(ser);
+
+	TIME_PHASE(PHASE_DESTROY, libelec_destroy(sys));
+
+	return (true);
+}
+
+/*
+ * Compares the results against the stored baseline of the network in
+ * the baseline store `store_dir' (if there is one) and optionally
+ * replaces the baseline with the results. Returns the exit status of
+ * the "run" sub-command.
+ */
+static int
+run_baseline(const char *store_dir, bool update, const baseline_t *bl)
+{
+	char *path = baseline_path(store_dir, bl->conf_crc);
+	baseline_t *base = safe_calloc(1, sizeof (*base));
+	int status = EXIT_SUCCESS;
+
+	if (file_exists(path, NULL)) {
+		if (baseline_read(path, base) &&
+		    base->conf_crc == bl->conf_crc) {
+			printf("\n");
+			if (!baseline_print_cmp(stdout, base, bl))
+				status = BENCH_EXIT_SLOWER;
+		} else {
+			fprintf(stderr, "Can't use baseline %s\n", path);
+			status = EXIT_FAILURE;
+		}
+	} else if (!update) {
+		printf("\nNo baseline for this network in %s, use -u to "
+		    "create one.\n", store_dir);
+	}
+	if (update) {
+		if (baseline_write(path, bl))
+			printf("\nBaseline saved to %s\n", path);
+		else
+			status = EXIT_FAILURE;
+	}
+	free(path);
+	free(base);
+
+	return (status);
+}
+
+static int
+run_main(int argc, char **argv, const char *progname)
+{
+	const char *filename, *store_dir = NULL;
+	run_params_t params = {
+	    .n_steps = 1000, .n_warmup = 100, .n_repeats = 10,
+	    .d_t = USEC2SEC(EXEC_INTVAL), .solver = ELEC_SOLVER_PAINT
+	};
+	unsigned n_runs = 1;
+	bool update = false;
+	int status = EXIT_SUCCESS;
+	phase_t totals[NUM_PHASES] = {};
+	baseline_t *bl;
+	size_t n_comps = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hTn:w:d:s:r:E:R:B:u")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 'T':
+			params.close_ties = true;
+			break;
+		case 'n':
+			params.n_steps = atoi(optarg);
+			break;
+		case 'w':
+			params.n_warmup = atoi(optarg);
+			break;
+		case 'd':
+			params.d_t = atof(optarg);
+			break;
+		case 's':
+			params.substep = atof(optarg);
+			break;
+		case 'r':
+			params.n_repeats = MAX(atoi(optarg), 1);
+			break;
+		case 'E':
+			if (strcmp(optarg, "paint") == 0) {
+				params.solver = ELEC_SOLVER_PAINT;
+			} else if (strcmp(optarg, "nodal") == 0) {
+				params.solver = ELEC_SOLVER_NODAL;
+			} else {
+				print_usage(stderr, progname);
+				return (EXIT_FAILURE);
+			}
+			break;
+		case 'R':
+			n_runs = clamp(atoi(optarg), 1, BASELINE_MAX_RUNS);
+			break;
+		case 'B':
+			store_dir = optarg;
+			break;
+		case 'u':
+			update = true;
+			break;
+		default: /* '?' */
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 1 != argc || params.d_t <= 0 || params.substep < 0 ||
+	    (update && store_dir == NULL)) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	filename = argv[optind];
+
+	bl = safe_calloc(1, sizeof (*bl));
+	strlcpy(bl->version, LIBELEC_VERSION, sizeof (bl->version));
+	strlcpy(bl->network, lacf_basename(filename), sizeof (bl->network));
+	for (unsigned run = 0; run < n_runs; run++) {
+		if (!run_once(filename, &params, &n_comps, &bl->conf_crc)) {
+			free(bl);
+			return (EXIT_FAILURE);
+		}
+		run_record(bl, totals);
+	}
+
+	printf("%s: %llu components, %u steps of %gs (%u warmup), "
+	    "%u run%s\n\n", filename, (unsigned long long)n_comps,
+	    params.n_steps, params.d_t, params.n_warmup, n_runs,
+	    n_runs == 1 ? "" : "s");
+	print_results(bl, totals, n_comps);
+	if (store_dir != NULL)
+		status = run_baseline(store_dir, update, bl);
+	free(bl);
+
+	return (status);
+}
+
+/*
+ * Reader thread of the API getter benchmark. All threads sweep over all
+ * components, calling the electrical state getters on each one.
+ */
+typedef struct {
+	elec_comp_t	**comps;
+	size_t		n_comps;
+	unsigned	n_sweeps;
+	atomic32_t	*ready;
+	atomic32_t	*go;
+	double		sum;
+} api_reader_t;
+
+#define	API_GETTERS_PER_COMP	6
+
+static void
+api_reader(void *arg)
+{
+	api_reader_t *rdr = arg;
+	double sum = 0;
+
+	ASSERT(rdr != NULL);
+	atomic_inc_32(rdr->ready);
+	while (atomic_add_32(rdr->go, 0) == 0)
+		;
+	for (unsigned i = 0; i < rdr->n_sweeps; i++) {
+		for (size_t j = 0; j < rdr->n_comps; j++) {
+			const elec_comp_t *comp = rdr->comps[j];
+
+			sum += libelec_comp_get_in_volts(comp);
+			sum += libelec_comp_get_out_volts(comp);
+			sum += libelec_comp_get_in_amps(comp);
+			sum += libelec_comp_get_out_amps(comp);
+			sum += libelec_comp_get_in_pwr(comp);
+			sum += libelec_comp_get_out_pwr(comp);
+		}
+	}
+	/* Keeps the compiler from optimizing the getter calls away */
+	rdr->sum = sum;
+}
+
+/*
+ * Runs the getter benchmark with `n_threads' concurrent readers and
+ * prints its results. Returns the aggregate throughput in calls/sec.
+ */
+static double
+api_getters(elec_comp_t **comps, size_t n_comps, unsigned n_sweeps,
+    unsigned n_threads, const char *worker)
+{
+	thread_t *threads = safe_calloc(n_threads, sizeof (*threads));
+	api_reader_t *rdrs = safe_calloc(n_threads, sizeof (*rdrs));
+	atomic32_t ready = 0, go = 0;
+	uint64_t t0, ns, calls;
+	double tput;
+
+	for (unsigned i = 0; i < n_threads; i++) {
+		rdrs[i].comps = comps;
+		rdrs[i].n_comps = n_comps;
+		rdrs[i].n_sweeps = n_sweeps;
+		rdrs[i].ready = &ready;
+		rdrs[i].go = &go;
+		VERIFY(thread_create(&threads[i], api_reader, &rdrs[i]));
+	}
+	/* Releases all readers at once, after they've all started */
+	while (atomic_add_32(&ready, 0) != (int32_t)n_threads)
+		;
+	t0 = bench_ns();
+	atomic_set_32(&go, 1);
+	for (unsigned i = 0; i < n_threads; i++)
+		thread_join(&threads[i]);
+	ns = MAX(bench_ns() - t0, 1);
+	calls = (uint64_t)n_threads * n_sweeps * n_comps *
+	    API_GETTERS_PER_COMP;
+	tput = calls / NSEC2SEC((double)ns);
+	printf("%-24s  %7u  %-7s  %11llu  %11.1f  %12.1f\n",
+	    "libelec_comp_get_*", n_threads, worker,
+	    (unsigned long long)calls, (double)ns * n_threads / calls, tput);
+	free(threads);
+	free(rdrs);
+
+	return (tput);
+}
+
+/*
+ * Prints one line of single-threaded API benchmark results. `calls'
+ * calls took a total of `ns' nanoseconds.
+ */
+static void
+api_print(const char *name, const char *worker, uint64_t calls,
+    uint64_t ns)
+{
+	ns = MAX(ns, 1);
+	printf("%-24s  %7u  %-7s  %11llu  %11.1f  %12.1f\n", name, 1,
+	    worker, (unsigned long long)calls, (double)ns / calls,
+	    calls / NSEC2SEC((double)ns));
+}
+
+static void
+api_walk_cb(elec_comp_t *comp, void *userinfo)
+{
+	size_t *n = userinfo;
+
+	UNUSED(comp);
+	(*n)++;
+}
+
+/*
+ * Runs the single-threaded API benchmarks: setters, component lookups,
+ * component walks and serialization round-trips.
+ */
+static void
+api_single(elec_sys_t *sys, elec_comp_t **comps, size_t n_comps,
+    unsigned n_iters, const char *worker)
+{
+	elec_comp_t **cbs = safe_calloc(n_comps, sizeof (*cbs));
+	elec_comp_t **ties = safe_calloc(n_comps, sizeof (*ties));
+	elec_comp_t **buses = safe_calloc(n_comps, sizeof (*buses));
+	size_t n_cbs = 0, n_ties = 0, n_walked = 0;
+	uint64_t t0, calls;
+	conf_t *ser;
+
+	for (size_t i = 0; i < n_comps; i++) {
+		if (libelec_comp_get_type(comps[i]) == ELEC_CB)
+			cbs[n_cbs++] = comps[i];
+		else if (libelec_comp_get_type(comps[i]) == ELEC_TIE)
+			ties[n_ties++] = comps[i];
+	}
+	t0 = bench_ns();
+	for (unsigned i = 0; i < n_iters; i++) {
+		for (size_t j = 0; j < n_comps; j++) {
+			VERIFY(libelec_comp_find(sys,
+			    libelec_comp_get_name(comps[j])) == comps[j]);
+		}
+	}
+	api_print("libelec_comp_find", worker, (uint64_t)n_iters * n_comps,
+	    bench_ns() - t0);
+
+	if (n_cbs != 0) {
+		t0 = bench_ns();
+		for (unsigned i = 0; i < n_iters; i++) {
+			for (size_t j = 0; j < n_cbs; j++)
+				libelec_cb_set(cbs[j], (i & 1) != 0);
+		}
+		api_print("libelec_cb_set", worker,
+		    (uint64_t)n_iters * n_cbs, bench_ns() - t0);
+		for (size_t j = 0; j < n_cbs; j++)
+			libelec_cb_set(cbs[j], true);
+	}
+	calls = 0;
+	t0 = bench_ns();
+	for (unsigned i = 0; i < n_iters; i++) {
+		for (size_t j = 0; j < n_ties; j++) {
+			size_t n_buses = libelec_tie_get_num_buses(ties[j]);
+
+			/* Alternates between all buses tied & none tied */
+			for (size_t k = 0; k < n_buses; k++) {
+				buses[k] = libelec_comp_get_conn(ties[j],
+				    k);
+			}
+			libelec_tie_set_list(ties[j], (i & 1) ? n_buses : 0,
+			    buses);
+			calls++;
+		}
+	}
+	if (calls != 0) {
+		api_print("libelec_tie_set_list", worker, calls,
+		    bench_ns() - t0);
+	}
+
+	t0 = bench_ns();
+	for (unsigned i = 0; i < n_iters; i++)
+		libelec_walk_comps(sys, api_walk_cb, &n_walked);
+	VERIFY3U(n_walked, ==, (size_t)n_iters * n_comps);
+	api_print("libelec_walk_comps", worker, n_iters, bench_ns() - t0);
+
+	ser = conf_create_empty();
+	t0 = bench_ns();
+	for (unsigned i = 0; i < n_iters; i++) {
+		libelec_serialize(sys, ser, BENCH_PREFIX);
+		VERIFY(libelec_deserialize(sys, ser, BENCH_PREFIX));
+	}
+	api_print("serialize round-trip", worker, n_iters, bench_ns() - t0);
+	conf_free(ser);
+
+	free(cbs);
+	free(ties);
+	free(buses);
+}
+
+static int
+api_main(int argc, char **argv, const char *progname)
+{
+	const char *filename;
+	unsigned n_sweeps = 1000, n_iters = 100, max_threads = 16;
+	double d_t = USEC2SEC(EXEC_INTVAL);
+	elec_comp_t **comps;
+	elec_sys_t *sys;
+	size_t n_comps;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hn:i:j:d:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 'n':
+			n_sweeps = MAX(atoi(optarg), 1);
+			break;
+		case 'i':
+			n_iters = MAX(atoi(optarg), 1);
+			break;
+		case 'j':
+			max_threads = MAX(atoi(optarg), 1);
+			break;
+		case 'd':
+			d_t = atof(optarg);
+			break;
+		default: /* '?' */
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 1 != argc || d_t <= 0) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	filename = argv[optind];
+	sys = libelec_new(filename);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	sys_prep(sys, false);
+	libelec_sys_set_exec_intval(sys, d_t);
+	n_comps = libelec_get_num_comps(sys);
+	comps = safe_calloc(n_comps, sizeof (*comps));
+	for (size_t i = 0; i < n_comps; i++)
+		comps[i] = libelec_get_comp(sys, i);
+	/* Gets the network into a steady, powered state first */
+	for (unsigned i = 0; i < 100; i++)
+		libelec_sys_step(sys, d_t);
+
+	printf("%s: %llu components, worker interval %gs\n\n", filename,
+	    (unsigned long long)n_comps, d_t);
+	printf("BENCHMARK                 THREADS  WORKER         CALLS"
+	    "      ns/CALL       CALLS/s\n"
+	    "------------------------  -------  -------  -----------"
+	    "  -----------  ------------\n");
+	/*
+	 * Each benchmark is run twice, first with the network idle and
+	 * then with the worker thread running passes concurrently.
+	 */
+	for (int ticking = 0; ticking < 2; ticking++) {
+		const char *worker = (ticking ? "ticking" : "idle");
+
+		if (ticking)
+			VERIFY(libelec_sys_start(sys));
+		for (unsigned n = 1;; n = MIN(n * 2, max_threads)) {
+			api_getters(comps, n_comps, n_sweeps, n, worker);
+			if (n == max_threads)
+				break;
+		}
+		api_single(sys, comps, n_comps, n_iters, worker);
+		if (ticking)
+			libelec_sys_stop(sys);
+	}
+
+	free(comps);
+	libelec_destroy(sys);
+
+	return (EXIT_SUCCESS);
+}
+
+/*
+ * Name of the network_paint_src_* function painting components of
+ * `type', or NULL for components which never pass power on.
+ */
+static const char *
+cgen_paint_func(elec_comp_type_t type)
+{
+	switch (type) {
+	case ELEC_BUS:
+		return ("network_paint_src_bus");
+	case ELEC_TRU:
+	case ELEC_INV:
+		return ("network_paint_src_tru_inv");
+	case ELEC_XFRMR:
+		return ("network_paint_src_xfrmr");
+	case ELEC_CB:
+	case ELEC_SHUNT:
+		return ("network_paint_src_scb");
+	case ELEC_TIE:
+		return ("network_paint_src_tie");
+	case ELEC_DIODE:
+		return ("network_paint_src_diode");
+	default:
+		return (NULL);
+	}
+}
+
+/*
+ * Writes out the specialized version of network_paint_plan() for
+ * `plan'. This is the pre-order walk of plan_paint_generic(), unrolled
+ * into straight-line code. Skipping a subtree becomes a jump to the
+ * label in front of the first step past it.
+ */
+static void
+cgen_paint(FILE *fp, const elec_plan_t *plan, unsigned plan_i)
+{
+	bool *target = safe_calloc(plan->n_steps + 1, sizeof (*target));
+
+	fprintf(fp, "static unsigned\nspec_paint_%u(elec_plan_t *plan)\n{\n",
+	    plan_i);
+	if (plan->n_steps == 1) {
+		fprintf(fp, "\tUNUSED(plan);\n\treturn (0);\n}\n\n");
+		free(target);
+		return;
+	}
+	fprintf(fp, "\tconst elec_plan_step_t *s = plan->steps;\n"
+	    "\tunsigned visits = 0;\n\n");
+	for (unsigned i = 1; i < plan->n_steps; i++)
+		target[plan->steps[i].skip] = true;
+	for (unsigned i = 1; i < plan->n_steps; i++) {
+		const elec_plan_step_t *step = &plan->steps[i];
+		const elec_comp_t *upstream = plan->steps[step->parent].comp;
+		elec_comp_type_t type = step->comp->info->type;
+		const char *func = cgen_paint_func(type);
+
+		if (target[i])
+			fprintf(fp, "at_%u:\n", i);
+		fprintf(fp, "\t/* %u: %s %s */\n", i, comp_type2str(type),
+		    step->comp->info->name);
+		if (upstream->info->type == ELEC_TIE) {
+			fprintf(fp, "\tSPEC_PAINT_TIE(%u, %u);\n", i,
+			    step->skip);
+		}
+		fprintf(fp, "\tSPEC_PAINT_VISIT(%u, %u);\n", i, step->skip);
+		if (func != NULL && step->skip != i + 1) {
+			fprintf(fp, "\tif (!%s(&s[%u]))\n\t\tgoto at_%u;\n",
+			    func, i, step->skip);
+			continue;
+		}
+		if (func != NULL) {
+			fprintf(fp, "\t(void)%s(&s[%u]);\n", func, i);
+			continue;
+		}
+		if (type == ELEC_BATT)
+			fprintf(fp, "\tnetwork_paint_batt(&s[%u]);\n", i);
+		else if (type == ELEC_LOAD)
+			fprintf(fp, "\tnetwork_paint_load(&s[%u]);\n", i);
+		if (step->skip != i + 1)
+			fprintf(fp, "\tgoto at_%u;\n", step->skip);
+	}
+	if (target[plan->n_steps])
+		fprintf(fp, "at_%u:\n", plan->n_steps);
+	fprintf(fp, "\treturn (visits);\n}\n\n");
+	free(target);
+}
+
+/*
+ * Writes the expression integrating step `i' of `plan', with all of
+ * the step's constants folded in (see network_load_integrate_step()).
+ */
+static void
+cgen_integ_expr(FILE *fp, const elec_plan_t *plan, unsigned i)
+{
+	const elec_plan_step_t *step = &plan->steps[i];
+
+	switch (step->comp->info->type) {
+	case ELEC_BATT:
+		fprintf(fp, "network_load_integrate_batt(s[%u].src, "
+		    "s[%u].comp, %u, amps[%u])", i, i, step->depth, i);
+		break;
+	case ELEC_GEN:
+		/* Generators downstream of a source don't draw power */
+		if (step->depth == 0) {
+			fprintf(fp, "network_load_integrate_gen(s[%u].comp, "
+			    "0, amps[%u])", i, i);
+		} else {
+			fprintf(fp, "0");
+		}
+		break;
+	case ELEC_TRU:
+	case ELEC_INV:
+		fprintf(fp, "network_load_integrate_tru_inv(s[%u].comp, %u, "
+		    "amps[%u])", i, step->up_link, i);
+		break;
+	case ELEC_XFRMR:
+		fprintf(fp, "network_load_integrate_xfrmr(s[%u].comp, %u, "
+		    "amps[%u])", i, step->up_link, i);
+		break;
+	case ELEC_LOAD:
+		fprintf(fp, "network_load_integrate_load(s[%u].src, "
+		    "s[%u].comp, %u, d_t)", i, i, step->up_slot);
+		break;
+	case ELEC_BUS:
+		fprintf(fp, "network_load_integrate_bus(s[%u].src, "
+		    "s[%u].comp, amps[%u])", i, i, i);
+		break;
+	case ELEC_CB:
+	case ELEC_SHUNT:
+		fprintf(fp, "network_load_integrate_scb(s[%u].comp, "
+		    "amps[%u])", i, i);
+		break;
+	case ELEC_TIE:
+		fprintf(fp, "amps[%u]", i);
+		break;
+	case ELEC_DIODE:
+		fprintf(fp, "network_load_integrate_diode(s[%u].comp, %u, "
+		    "amps[%u])", i, step->up_link, i);
+		break;
+	default:
+		VERIFY_FAIL();
+	}
+}
+
+/*
+ * Writes out the integration of step `i' of `plan' & of the subtree
+ * below it. The subtree goes in front of the step itself to keep the
+ * post-order of plan_integrate_generic(), but as nothing below an
+ * unpowered step can have been reached, a single check in front of the
+ * subtree jumps over all of it.
+ */
+static void
+cgen_integ_step(FILE *fp, const elec_plan_t *plan, unsigned i)
+{
+	const elec_plan_step_t *step = &plan->steps[i];
+	const elec_comp_t *upstream = plan->steps[step->parent].comp;
+	bool store;
+
+	switch (upstream->info->type) {
+	case ELEC_BUS:
+	case ELEC_TIE:
+	case ELEC_CB:
+	case ELEC_SHUNT:
+	case ELEC_DIODE:
+		store = true;
+		break;
+	default:
+		store = false;
+		break;
+	}
+	fprintf(fp, "\t/* %u: %s %s */\n"
+	    "\tif (st[%u] != PLAN_STEP_POWERED)\n\t\tgoto off_%u;\n", i,
+	    comp_type2str(step->comp->info->type), step->comp->info->name,
+	    i, i);
+	for (unsigned c = i + 1; c < step->skip; c = plan->steps[c].skip)
+		cgen_integ_step(fp, plan, c);
+	fprintf(fp, "\tSPEC_INTEG_STEP(%u, %u,\n\t    ", i, step->parent);
+	cgen_integ_expr(fp, plan, i);
+	fprintf(fp, ");\n\tgoto %s_%u;\noff_%u:\n", store ? "out" : "end",
+	    i, i);
+	if (store) {
+		fprintf(fp, "\tif (st[%u] == PLAN_STEP_SKIPPED)\n"
+		    "\t\tgoto end_%u;\n"
+		    "\tSPEC_INTEG_OFF(%u, %u);\n"
+		    "out_%u:\n"
+		    "\ts[%u].comp->links[%u].out_amps[%u] = a;\n", i, i, i,
+		    step->parent, i, step->parent, step->down_link,
+		    step->down_slot);
+	} else {
+		fprintf(fp, "\tif (st[%u] == PLAN_STEP_UNPOWERED)\n"
+		    "\t\tSPEC_INTEG_OFF(%u, %u);\n", i, i, step->parent);
+	}
+	fprintf(fp, "end_%u:\n", i);
+}
+
+/*
+ * Writes out the specialized version of plan_integrate_generic() for
+ * `plan'. Rather than going through the list of reached steps, this
+ * walks the plan's tree & checks the step states (see cgen_integ_step).
+ */
+static void
+cgen_integ(FILE *fp, const elec_plan_t *plan, unsigned plan_i)
+{
+	bool has_loads = false;
+
+	for (unsigned i = 0; i < plan->n_steps; i++) {
+		if (plan->steps[i].comp->info->type == ELEC_LOAD)
+			has_loads = true;
+	}
+	fprintf(fp, "static unsigned\nspec_integ_%u(elec_plan_t *plan, "
+	    "const uint8_t *st, double d_t)\n{\n"
+	    "\tconst elec_plan_step_t *s = plan->steps;\n"
+	    "\telec_sys_t *sys = s[0].comp->sys;\n"
+	    "\tdouble *amps = plan->amps;\n"
+	    "\tunsigned visits = 0;\n"
+	    "\tdouble a;\n\n", plan_i);
+	if (plan->n_steps == 1)
+		fprintf(fp, "\tUNUSED(st);\n");
+	if (!has_loads)
+		fprintf(fp, "\tUNUSED(d_t);\n");
+	if (plan->n_steps == 1 || !has_loads)
+		fprintf(fp, "\n");
+	for (unsigned c = 1; c < plan->n_steps; c = plan->steps[c].skip)
+		cgen_integ_step(fp, plan, c);
+	fprintf(fp, "\t/* 0: %s %s */\n\ta = ",
+	    comp_type2str(plan->steps[0].comp->info->type),
+	    plan->steps[0].comp->info->name);
+	cgen_integ_expr(fp, plan, 0);
+	fprintf(fp, ";\n\tamps[0] = 0;\n\tvisits++;\n"
+	    "\tif (sys->prof.enabled)\n"
+	    "\t\tsys->prof.comps[s[0].comp->comp_idx].integ_visits++;\n"
+	    "\tRW(s[0].comp, out_amps) = a;\n"
+	    "\treturn (visits);\n}\n\n");
+}
+
+static int
+cgen_main(int argc, char **argv, const char *progname)
+{
+	const char *out_filename = NULL;
+	FILE *fp = stdout;
+	elec_sys_t *sys;
+	unsigned max_steps = CGEN_MAX_STEPS_DFL;
+	unsigned plan_i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hm:o:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 'm':
+			max_steps = atoi(optarg);
+			break;
+		case 'o':
+			out_filename = optarg;
+			break;
+		default: /* '?' */
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 1 != argc) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	sys = libelec_new(argv[optind]);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	if (list_head(&sys->gens_batts) == NULL) {
+		fprintf(stderr, "%s: network has no batteries or generators\n",
+		    argv[optind]);
+		libelec_destroy(sys);
+		return (EXIT_FAILURE);
+	}
+	if (out_filename != NULL) {
+		fp = fopen(out_filename, "w");
+		if (fp == NULL) {
+			fprintf(stderr, "Can't open %s for writing: %s\n",
+			    out_filename, strerror(errno));
+			libelec_destroy(sys);
+			return (EXIT_FAILURE);
+		}
+	}
+	fprintf(fp, "/*\n"
+	    " * Specialized solver for %s, generated by libelec_bench "
+	    "cgen.\n"
+	    " * Compile libelec with -DLIBELEC_SPEC_SOLVER='\"<this file>"
+	    "\"' to use it.\n"
+	    " * Do not edit, regenerate it whenever the network changes.\n"
+	    " */\n\n", argv[optind]);
+	plan_i = 0;
+	for (const elec_comp_t *root = list_head(&sys->gens_batts);
+	    root != NULL; root = list_next(&sys->gens_batts, root)) {
+		if (root->plan->n_steps > max_steps)
+			continue;
+		fprintf(fp, "/* %s %s: %u steps */\n\n",
+		    comp_type2str(root->info->type), root->info->name,
+		    root->plan->n_steps);
+		cgen_paint(fp, root->plan, plan_i);
+		cgen_integ(fp, root->plan, plan_i);
+		plan_i++;
+	}
+	fprintf(fp, "static const elec_spec_plan_t spec_plans[] = {\n");
+	plan_i = 0;
+	for (const elec_comp_t *root = list_head(&sys->gens_batts);
+	    root != NULL; root = list_next(&sys->gens_batts, root)) {
+		unsigned long long sig = plan_sig(root->plan);
+
+		if (root->plan->n_steps > max_steps) {
+			fprintf(fp, "    { \"%s\", 0x%016llxull, NULL, "
+			    "NULL },\n", root->info->name, sig);
+			continue;
+		}
+		fprintf(fp, "    { \"%s\", 0x%016llxull, spec_paint_%u, "
+		    "spec_integ_%u },\n", root->info->name, sig, plan_i,
+		    plan_i);
+		plan_i++;
+	}
+	fprintf(fp, "};\n");
+	if (fp != stdout)
+		fclose(fp);
+	libelec_destroy(sys);
+
+	return (EXIT_SUCCESS);
+}
+
+typedef struct {
+	unsigned	w, h;
+} draw_size_t;
+
+/*
+ * Sets up `cr' the same way the visualizer does, with the middle of the
+ * layout (`ctr', in pixels at zoom level 1) in the middle of the image.
+ */
+static void
+draw_setup(cairo_t *cr, unsigned w, unsigned h, double zoom, vect2_t ctr)
+{
+	cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL,
+	    CAIRO_FONT_WEIGHT_NORMAL);
+	cairo_translate(cr, w / 2.0, h / 2.0);
+	cairo_scale(cr, zoom, zoom);
+	cairo_translate(cr, -ctr.x, -ctr.y);
+}
+
+static void
+draw_frame(const elec_sys_t *sys, cairo_t *cr, double pos_scale,
+    double font_sz)
+{
+	cairo_save(cr);
+	cairo_identity_matrix(cr);
+	cairo_set_source_rgb(cr, 1, 1, 1);
+	cairo_paint(cr);
+	cairo_restore(cr);
+	libelec_draw_layout(sys, cr, pos_scale, font_sz);
+}
+
+static const char *
+lod2str(draw_lod_t lod)
+{
+	switch (lod) {
+	case LOD_FULL:
+		return ("full");
+	case LOD_SIMPLE:
+		return ("simple");
+	default:
+		return ("block");
+	}
+}
+
+/*
+ * Works out the middle of the layout in pixels at zoom level 1.
+ * Returns false if none of the components have a GUI_POS.
+ */
+static bool
+draw_layout_ctr(const elec_sys_t *sys, double pos_scale, vect2_t *ctr)
+{
+	vect2_t min = VECT2(INFINITY, INFINITY);
+	vect2_t max = VECT2(-INFINITY, -INFINITY);
+
+	for (size_t i = 0; i < sys->num_infos; i++) {
+		vect2_t pos = sys->comp_infos[i].gui.pos;
+
+		if (IS_NULL_VECT(pos))
+			continue;
+		min = VECT2(MIN(min.x, pos.x), MIN(min.y, pos.y));
+		max = VECT2(MAX(max.x, pos.x), MAX(max.y, pos.y));
+	}
+	if (min.x > max.x)
+		return (false);
+	*ctr = vect2_scmul(vect2_add(min, max), pos_scale / 2);
+	return (true);
+}
+
+/*
+ * Times libelec_draw_comp_info() for every component, drawn on top of
+ * the network at zoom level 1. The totals per component type are added
+ * to `info_ns'.
+ */
+static bool
+draw_infos(const elec_sys_t *sys, const draw_size_t *sz, double pos_scale,
+    double font_sz, vect2_t ctr, unsigned n_iters,
+    uint64_t info_ns[NUM_COMP_TYPES])
+{
+	cairo_surface_t *surf;
+	cairo_t *cr;
+	vect2_t pos = vect2_scmul(ctr, 1 / pos_scale);
+
+	surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, sz->w, sz->h);
+	if (cairo_surface_status(surf) != CAIRO_STATUS_SUCCESS) {
+		fprintf(stderr, "Can't create %ux%u image: %s\n", sz->w, sz->h,
+		    cairo_status_to_string(cairo_surface_status(surf)));
+		cairo_surface_destroy(surf);
+		return (false);
+	}
+	cr = cairo_create(surf);
+	draw_setup(cr, sz->w, sz->h, 1, ctr);
+	draw_frame(sys, cr, pos_scale, font_sz);
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		uint64_t t0;
+
+		/* The first drawing fills the text cache */
+		libelec_draw_comp_info(comp, cr, pos_scale, font_sz, pos);
+		t0 = bench_ns();
+		for (unsigned i = 0; i < n_iters; i++) {
+			libelec_draw_comp_info(comp, cr, pos_scale, font_sz,
+			    pos);
+		}
+		info_ns[comp->info->type] += bench_ns() - t0;
+	}
+	cairo_destroy(cr);
+	cairo_surface_destroy(surf);
+
+	return (true);
+}
+
+/*
+ * Renders `n_frames' frames of the whole network image at each of the
+ * `n_zooms' zoom levels into an image of size `sz' and prints the
+ * resulting frame rates. Then renders the same frames again with the
+ * per-component probes enabled (see DRAW_PROBE), adding the time spent
+ * drawing each component type at each zoom level to `type_ns'.
+ */
+static bool
+draw_size(const elec_sys_t *sys, const draw_size_t *sz,
+    const double *zooms, unsigned n_zooms, double pos_scale, double font_sz,
+    vect2_t ctr, unsigned n_frames,
+    uint64_t type_ns[DRAW_MAX_CONFS][NUM_COMP_TYPES])
+{
+	cairo_surface_t *surf;
+
+	surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, sz->w, sz->h);
+	if (cairo_surface_status(surf) != CAIRO_STATUS_SUCCESS) {
+		fprintf(stderr, "Can't create %ux%u image: %s\n", sz->w, sz->h,
+		    cairo_status_to_string(cairo_surface_status(surf)));
+		cairo_surface_destroy(surf);
+		return (false);
+	}
+	for (unsigned z = 0; z < n_zooms; z++) {
+		cairo_t *cr = cairo_create(surf);
+		char size_str[32];
+		draw_lod_t lod;
+		uint64_t t0, ns;
+
+		draw_setup(cr, sz->w, sz->h, zooms[z], ctr);
+		lod = draw_get_lod(cr, pos_scale, font_sz);
+		/*
+		 * Same as the visualizer, we keep drawing into the same
+		 * cairo_t, so the first frame fills the text & bus
+		 * geometry caches attached to it.
+		 */
+		draw_frame(sys, cr, pos_scale, font_sz);
+		t0 = bench_ns();
+		for (unsigned i = 0; i < n_frames; i++)
+			draw_frame(sys, cr, pos_scale, font_sz);
+		ns = MAX(bench_ns() - t0, 1);
+		snprintf(size_str, sizeof (size_str), "%ux%u", sz->w, sz->h);
+		printf("%-11s  %6g  %-6s  %6u  %9.2f  %8.1f\n", size_str,
+		    zooms[z], lod2str(lod), n_frames,
+		    NSEC2SEC((double)ns) * 1000 / n_frames,
+		    n_frames / NSEC2SEC((double)ns));
+
+		memset(draw_probe_ns, 0, sizeof (draw_probe_ns));
+		draw_probe_on = true;
+		for (unsigned i = 0; i < n_frames; i++)
+			draw_frame(sys, cr, pos_scale, font_sz);
+		draw_probe_on = false;
+		for (int t = 0; t < NUM_COMP_TYPES; t++)
+			type_ns[z][t] += draw_probe_ns[t];
+		cairo_destroy(cr);
+	}
+	cairo_surface_destroy(surf);
+
+	return (true);
+}
+
+static int
+draw_main(int argc, char **argv, const char *progname)
+{
+	draw_size_t sizes[DRAW_MAX_CONFS];
+	double zooms[DRAW_MAX_CONFS];
+	unsigned n_sizes = 0, n_zooms = 0, n_frames = 20, n_iters = 10;
+	double pos_scale = 16, font_sz = 14;
+	uint64_t type_ns[DRAW_MAX_CONFS][NUM_COMP_TYPES] = {{ 0 }};
+	uint64_t info_ns[NUM_COMP_TYPES] = { 0 };
+	unsigned n_comps[NUM_COMP_TYPES] = { 0 };
+	const char *filename;
+	elec_sys_t *sys;
+	vect2_t ctr;
+	bool ok = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hn:i:s:z:p:f:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 'n':
+			n_frames = MAX(atoi(optarg), 1);
+			break;
+		case 'i':
+			n_iters = MAX(atoi(optarg), 1);
+			break;
+		case 's':
+			if (n_sizes == DRAW_MAX_CONFS ||
+			    sscanf(optarg, "%ux%u", &sizes[n_sizes].w,
+			    &sizes[n_sizes].h) != 2 ||
+			    sizes[n_sizes].w == 0 || sizes[n_sizes].h == 0) {
+				print_usage(stderr, progname);
+				return (EXIT_FAILURE);
+			}
+			n_sizes++;
+			break;
+		case 'z':
+			if (n_zooms == DRAW_MAX_CONFS ||
+			    (zooms[n_zooms] = atof(optarg)) <= 0) {
+				print_usage(stderr, progname);
+				return (EXIT_FAILURE);
+			}
+			n_zooms++;
+			break;
+		case 'p':
+			pos_scale = atof(optarg);
+			break;
+		case 'f':
+			font_sz = atof(optarg);
+			break;
+		default: /* '?' */
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 1 != argc || pos_scale <= 0 || font_sz <= 0) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	if (n_sizes == 0) {
+		sizes[n_sizes++] = (draw_size_t){ 1024, 768 };
+		sizes[n_sizes++] = (draw_size_t){ 2048, 2048 };
+	}
+	if (n_zooms == 0) {
+		/* Covers all of the levels of detail at the default scale */
+		zooms[n_zooms++] = 0.05;
+		zooms[n_zooms++] = 0.15;
+		zooms[n_zooms++] = 0.5;
+		zooms[n_zooms++] = 1;
+		zooms[n_zooms++] = 2;
+	}
+	filename = argv[optind];
+	sys = libelec_new(filename);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	libelec_sys_load_gui(sys);
+	if (!draw_layout_ctr(sys, pos_scale, &ctr)) {
+		fprintf(stderr, "%s: network has no GUI_POS stanzas, nothing "
+		    "to draw\n", filename);
+		libelec_destroy(sys);
+		return (EXIT_FAILURE);
+	}
+	/* Gets the network into a steady, powered state first */
+	sys_prep(sys, false);
+	for (unsigned i = 0; i < 100; i++)
+		libelec_sys_step(sys, USEC2SEC(EXEC_INTVAL));
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		n_comps[comp->info->type]++;
+	}
+	for (size_t i = 0; i < sys->num_infos; i++) {
+		if (sys->comp_infos[i].type == ELEC_LABEL_BOX)
+			n_comps[ELEC_LABEL_BOX]++;
+	}
+
+	printf("%s: %llu components, scale %g, font size %g\n\n", filename,
+	    (unsigned long long)libelec_get_num_comps(sys), pos_scale,
+	    font_sz);
+	printf("SIZE           ZOOM  LOD     FRAMES   ms/FRAME       FPS\n"
+	    "-----------  ------  ------  ------  ---------  --------\n");
+	for (unsigned s = 0; ok && s < n_sizes; s++) {
+		ok = draw_size(sys, &sizes[s], zooms, n_zooms, pos_scale,
+		    font_sz, ctr, n_frames, type_ns);
+	}
+	if (ok) {
+		ok = draw_infos(sys, &sizes[0], pos_scale, font_sz, ctr,
+		    n_iters, info_ns);
+	}
+	if (!ok) {
+		libelec_destroy(sys);
+		return (EXIT_FAILURE);
+	}
+
+	printf("\n%30sns/COMP/FRAME at ZOOM\nTYPE       COMPS    INFO_us", "");
+	for (unsigned z = 0; z < n_zooms; z++)
+		printf("  %8g", zooms[z]);
+	printf("\n---------  -----  ---------");
+	for (unsigned z = 0; z < n_zooms; z++)
+		printf("  --------");
+	printf("\n");
+	for (int t = 0; t < NUM_COMP_TYPES; t++) {
+		uint64_t n_draws = (uint64_t)n_comps[t] * n_frames * n_sizes;
+
+		if (n_comps[t] == 0)
+			continue;
+		/* Label boxes don't have info overlays */
+		if (t == ELEC_LABEL_BOX) {
+			printf("%-9s  %5u  %9s", "LABEL_BOX", n_comps[t], "-");
+		} else {
+			printf("%-9s  %5u  %9.2f", comp_type2str(t),
+			    n_comps[t], (double)info_ns[t] / 1000 /
+			    ((uint64_t)n_comps[t] * n_iters));
+		}
+		for (unsigned z = 0; z < n_zooms; z++)
+			printf("  %8.1f", (double)type_ns[z][t] / n_draws);
+		printf("\n");
+	}
+	libelec_destroy(sys);
+
+	return (EXIT_SUCCESS);
+}
+
+typedef struct {
+	uint32_t	tick;
+	uint64_t	ns;
+} replay_pass_t;
+
+static int
+replay_pass_cmp(const void *a, const void *b)
+{
+	const replay_pass_t *pa = a, *pb = b;
+
+	if (pa->ns != pb->ns)
+		return (pa->ns > pb->ns ? -1 : 1);
+	return (pa->tick < pb->tick ? -1 : (pa->tick > pb->tick ? 1 : 0));
+}
+
+static void
+replay_print_phases(const elec_stats_t *st)
+{
+	printf("PHASE                      PASSES     AVG_us     MAX_us\n"
+	    "------------------------  --------  ---------  ---------\n");
+	for (int i = 0; i < ELEC_NUM_PHASES; i++) {
+		const elec_timing_t *t = &st->phases[i];
+
+		if (t->n == 0)
+			continue;
+		printf("%-24s  %8llu  %9.2f  %9.2f\n", trace_phase_names[i],
+		    (unsigned long long)t->n, t->avg * 1e6, t->max * 1e6);
+	}
+	printf("%-24s  %8llu  %9.2f  %9.2f\n", "(full worker pass)",
+	    (unsigned long long)st->pass.n, st->pass.avg * 1e6,
+	    st->pass.max * 1e6);
+}
+
+static void
+replay_print_comps(elec_sys_t *sys, unsigned n_top)
+{
+	elec_comp_prof_t *top = safe_calloc(n_top, sizeof (*top));
+	size_t n = libelec_sys_get_profile_top(sys, ELEC_PROF_INTEG_VISITS,
+	    top, n_top);
+
+	printf("COMPONENT                 TYPE   PAINT/PASS  INTEG/PASS  "
+	    "DEPTH  SRCS\n"
+	    "------------------------  -----  ----------  ----------  "
+	    "-----  ----\n");
+	for (size_t i = 0; i < n; i++) {
+		const elec_comp_prof_t *p = &top[i];
+		double n_passes = MAX(p->n_passes, 1);
+
+		printf("%-24s  %-5s  %10.2f  %10.2f  %5u  %4u\n",
+		    libelec_comp_get_name(p->comp),
+		    comp_type2str(libelec_comp_get_type(p->comp)),
+		    p->paint_visits / n_passes, p->integ_visits / n_passes,
+		    p->max_depth, p->max_srcs);
+	}
+	free(top);
+}
+
+/*
+ * Re-executes an input capture with the worker statistics and the
+ * solver profile enabled. Every pass is timed individually, so that the
+ * slowest passes of the capture can be pointed out by their number.
+ */
+static int
+replay_main(int argc, char **argv, const char *progname)
+{
+	unsigned n_top = REPLAY_TOP_DFL;
+	const char *filename, *cap_filename;
+	replay_pass_t *passes = NULL;
+	size_t n_passes = 0, cap_passes = 0, n_diverged;
+	uint64_t total_ns = 0;
+	elec_replay_t *rp;
+	elec_sys_t *sys;
+	elec_stats_t st;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ht:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 't':
+			n_top = MAX(atoi(optarg), 1);
+			break;
+		default:
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 2 != argc) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	filename = argv[optind];
+	cap_filename = argv[optind + 1];
+
+	sys = libelec_new(filename);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	rp = libelec_replay_open(sys, cap_filename);
+	if (rp == NULL) {
+		libelec_destroy(sys);
+		return (EXIT_FAILURE);
+	}
+	libelec_sys_set_stats_enabled(sys, true);
+	libelec_sys_set_profiling(sys, true);
+	for (;;) {
+		uint64_t t0 = bench_ns(), ns;
+
+		if (!libelec_replay_step(rp))
+			break;
+		ns = bench_ns() - t0;
+		if (n_passes == cap_passes) {
+			cap_passes = MAX(2 * cap_passes, 1024);
+			passes = safe_realloc(passes, cap_passes *
+			    sizeof (*passes));
+		}
+		passes[n_passes].tick = n_passes;
+		passes[n_passes].ns = ns;
+		n_passes++;
+		total_ns += ns;
+	}
+	libelec_replay_get_stats(rp, NULL, &n_diverged);
+	libelec_sys_get_stats(sys, &st);
+
+	printf("%s: %llu components, %llu passes replayed from %s "
+	    "in %.1f ms\n", filename,
+	    (unsigned long long)libelec_get_num_comps(sys),
+	    (unsigned long long)n_passes, cap_filename, total_ns / 1e6);
+	if (n_diverged != 0) {
+		printf("WARNING: replay diverged from the captured run in %llu "
+		    "state checks,\n"
+		    "the results don't reflect the captured run faithfully\n",
+		    (unsigned long long)n_diverged);
+	}
+	if (n_passes != 0) {
+		qsort(passes, n_passes, sizeof (*passes), replay_pass_cmp);
+		printf("\n   AVG_us     P50_us     P99_us     MAX_us\n"
+		    "---------  ---------  ---------  ---------\n"
+		    "%9.2f  %9.2f  %9.2f  %9.2f\n",
+		    total_ns / 1e3 / n_passes,
+		    passes[n_passes / 2].ns / 1e3,
+		    passes[n_passes / 100].ns / 1e3, passes[0].ns / 1e3);
+		printf("\nSLOWEST PASS    PASS_us\n"
+		    "------------  ---------\n");
+		for (size_t i = 0; i < MIN(n_top, n_passes); i++) {
+			printf("%12u  %9.2f\n", (unsigned)passes[i].tick,
+			    passes[i].ns / 1e3);
+		}
+		printf("\n");
+		replay_print_phases(&st);
+		printf("\n");
+		replay_print_comps(sys, n_top);
+	}
+	free(passes);
+	libelec_replay_close(rp);
+	libelec_destroy(sys);
+
+	return (n_diverged != 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+typedef struct {
+	const elec_comp_t	*comp;
+	unsigned		n_srcs;		/* distinct sources */
+	unsigned		link_srcs;	/* most on a single link */
+	unsigned		paints;		/* plan steps visiting it */
+} analyze_fanin_t;
+
+static int
+analyze_root_cmp(const void *a, const void *b)
+{
+	const elec_comp_t *ca = *(const elec_comp_t **)a;
+	const elec_comp_t *cb = *(const elec_comp_t **)b;
+
+	if (ca->plan->n_steps != cb->plan->n_steps)
+		return (ca->plan->n_steps > cb->plan->n_steps ? -1 : 1);
+	return (strcmp(ca->info->name, cb->info->name));
+}
+
+static int
+analyze_fanin_cmp(const void *a, const void *b)
+{
+	const analyze_fanin_t *fa = a, *fb = b;
+
+	if (fa->n_srcs != fb->n_srcs)
+		return (fa->n_srcs > fb->n_srcs ? -1 : 1);
+	if (fa->paints != fb->paints)
+		return (fa->paints > fb->paints ? -1 : 1);
+	return (strcmp(fa->comp->info->name, fb->comp->info->name));
+}
+
+/*
+ * Lists the batteries & generators with the largest traversal plans.
+ * A plan covers every path along which its root could deliver power,
+ * so its size bounds what painting & integrating the root can cost in
+ * any configuration of the ties & breakers. Returns the bound summed
+ * over all plans and both passes.
+ */
+static uint64_t
+analyze_roots(elec_sys_t *sys, unsigned n_top)
+{
+	size_t n_roots = list_count(&sys->gens_batts), i = 0;
+	const elec_comp_t **roots = safe_calloc(MAX(n_roots, 1),
+	    sizeof (*roots));
+	uint64_t total = 0;
+	unsigned max_depth = 0;
+
+	for (const elec_comp_t *root = list_head(&sys->gens_batts);
+	    root != NULL; root = list_next(&sys->gens_batts, root)) {
+		roots[i++] = root;
+		total += root->plan->n_steps;
+		max_depth = MAX(max_depth, root->plan->max_depth);
+	}
+	qsort(roots, n_roots, sizeof (*roots), analyze_root_cmp);
+
+	printf("SOURCE                    TYPE   STEPS  DEPTH\n"
+	    "------------------------  -----  -----  -----\n");
+	for (i = 0; i < MIN(n_roots, n_top); i++) {
+		printf("%-24s  %-5s  %5u  %5u\n", roots[i]->info->name,
+		    comp_type2str(roots[i]->info->type),
+		    roots[i]->plan->n_steps, roots[i]->plan->max_depth);
+	}
+	if (n_roots > n_top)
+		printf("(%llu more)\n", (unsigned long long)(n_roots - n_top));
+	printf("\nWorst case: %llu component visits per pass (%llu painting "
+	    "+ %llu\nintegration), maximum depth %u\n",
+	    (unsigned long long)(2 * total), (unsigned long long)total,
+	    (unsigned long long)total, max_depth);
+	free(roots);
+
+	return (2 * total);
+}
+
+/*
+ * Runs one pass of the network in each of `n_samples' random tie &
+ * breaker configurations and reports how many plan steps the painting
+ * & integration passes actually visited. The first sample is always
+ * the configuration with everything closed.
+ */
+static void
+analyze_sample(elec_sys_t *sys, unsigned n_samples)
+{
+	elec_comp_t **list = NULL;
+	size_t list_cap = 0;
+	uint64_t sum = 0;
+	unsigned min_v = UINT_MAX, max_v = 0;
+
+	libelec_sys_set_stats_enabled(sys, true);
+	debug_quiet = true;
+	for (unsigned s = 0; s < n_samples; s++) {
+		elec_stats_t st;
+		unsigned v;
+
+		for (elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+		    comp = list_next(&sys->comps, comp)) {
+			if (comp->info->type == ELEC_CB) {
+				libelec_cb_set(comp, s == 0 ||
+				    (crc64_rand() & 1) != 0);
+			} else if (comp->info->type == ELEC_TIE) {
+				size_t n = 0;
+
+				if (comp->n_links > list_cap) {
+					list_cap = comp->n_links;
+					list = safe_realloc(list, list_cap *
+					    sizeof (*list));
+				}
+				for (unsigned i = 0; i < comp->n_links; i++) {
+					if (s == 0 || (crc64_rand() & 1) != 0)
+						list[n++] = comp->adj[i];
+				}
+				libelec_tie_set_list(comp, n, list);
+			}
+		}
+		libelec_sys_step(sys, USEC2SEC(EXEC_INTVAL));
+		libelec_sys_get_stats(sys, &st);
+		v = st.paint_visits + st.integ_visits;
+		if (s == 0) {
+			printf("\nAll ties & breakers closed: %u painting + %u "
+			    "integration visits\n", st.paint_visits,
+			    st.integ_visits);
+		}
+		sum += v;
+		min_v = MIN(min_v, v);
+		max_v = MAX(max_v, v);
+	}
+	debug_quiet = false;
+	free(list);
+	printf("Sampled over %u configurations: %.1f avg, %u min, "
+	    "%u max visits\n", n_samples,
+	    (double)sum / n_samples, min_v, max_v);
+}
+
+/*
+ * Lists the components reachable by the most sources. Every link keeps
+ * a slot for each source which can reach it, and each plan step
+ * reaching a component can add a source to it in every pass. Anything
+ * past ELEC_MAX_SRCS sources isn't reported by libelec_comp_get_srcs().
+ * Returns the number of components over that limit.
+ */
+static unsigned
+analyze_fanin(elec_sys_t *sys, unsigned n_top)
+{
+	size_t n_comps = list_count(&sys->comps), n = 0;
+	analyze_fanin_t *fi = safe_calloc(MAX(n_comps, 1), sizeof (*fi));
+	unsigned *seen = safe_calloc(MAX(sys->num_srcs, 1), sizeof (*seen));
+	unsigned n_over = 0;
+
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		analyze_fanin_t *f = &fi[n++];
+
+		f->comp = comp;
+		f->paints = comp->max_srcs;
+		for (unsigned i = 0; i < comp->n_links; i++) {
+			const elec_link_t *link = &comp->links[i];
+
+			f->link_srcs = MAX(f->link_srcs, link->n_slots);
+			for (unsigned j = 0; j < link->n_slots; j++) {
+				unsigned idx = link->slot_srcs[j]->src_idx;
+
+				/* comp_idx + 1, so zero means "not seen" */
+				if (seen[idx] != comp->comp_idx + 1) {
+					seen[idx] = comp->comp_idx + 1;
+					f->n_srcs++;
+				}
+			}
+		}
+		if (f->n_srcs > ELEC_MAX_SRCS)
+			n_over++;
+	}
+	qsort(fi, n, sizeof (*fi), analyze_fanin_cmp);
+
+	printf("\nCOMPONENT                 TYPE   SRCS  LINK_SRCS  PAINTS\n"
+	    "------------------------  -----  ----  ---------  ------\n");
+	for (size_t i = 0; i < MIN(n, n_top); i++) {
+		printf("%-24s  %-5s  %4u  %9u  %6u%s\n",
+		    fi[i].comp->info->name,
+		    comp_type2str(fi[i].comp->info->type), fi[i].n_srcs,
+		    fi[i].link_srcs, fi[i].paints,
+		    fi[i].n_srcs > ELEC_MAX_SRCS ? "  (!)" : "");
+	}
+	if (n_over != 0) {
+		printf("WARNING: %u components can be fed by more than %d "
+		    "sources,\nlibelec_comp_get_srcs() only reports the "
+		    "first %d of them\n", n_over, ELEC_MAX_SRCS,
+		    ELEC_MAX_SRCS);
+	}
+	free(seen);
+	free(fi);
+
+	return (n_over);
+}
+
+static void
+analyze_mem(elec_sys_t *sys)
+{
+	elec_mem_stats_t ms;
+
+	libelec_sys_get_mem_stats(sys, &ms);
+	printf("\nMEMORY          BYTES\n"
+	    "----------  ----------\n"
+	    "comps_hot   %10llu\n"
+	    "comps_cold  %10llu\n"
+	    "links       %10llu\n"
+	    "plans       %10llu\n"
+	    "state       %10llu\n"
+	    "defs        %10llu\n"
+	    "total       %10llu\n",
+	    (unsigned long long)ms.comps_hot,
+	    (unsigned long long)ms.comps_cold,
+	    (unsigned long long)ms.links, (unsigned long long)ms.plans,
+	    (unsigned long long)ms.state, (unsigned long long)ms.defs,
+	    (unsigned long long)ms.total);
+}
+
+/*
+ * Static analysis of a network definition. Everything but the sampled
+ * visit counts comes straight from the traversal plans and links set
+ * up by libelec_new(), so it doesn't depend on any particular state of
+ * the network.
+ */
+static int
+analyze_main(int argc, char **argv, const char *progname)
+{
+	unsigned n_samples = ANALYZE_SAMPLES_DFL, n_top = REPLAY_TOP_DFL;
+	uint64_t max_visits = 0, worst;
+	const char *filename;
+	elec_sys_t *sys;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hs:t:V:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 's':
+			n_samples = MAX(atoi(optarg), 1);
+			break;
+		case 't':
+			n_top = MAX(atoi(optarg), 1);
+			break;
+		case 'V':
+			max_visits = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 1 != argc) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	filename = argv[optind];
+
+	sys = libelec_new(filename);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	printf("%s: %llu components, %llu batteries & generators\n\n",
+	    filename, (unsigned long long)libelec_get_num_comps(sys),
+	    (unsigned long long)list_count(&sys->gens_batts));
+	worst = analyze_roots(sys, n_top);
+	sys_prep(sys, false);
+	analyze_sample(sys, n_samples);
+	analyze_fanin(sys, n_top);
+	analyze_mem(sys);
+	libelec_destroy(sys);
+
+	if (max_visits != 0 && worst > max_visits) {
+		printf("\n%s: worst case of %llu visits per pass exceeds the "
+		    "limit of %llu\n", filename, (unsigned long long)worst,
+		    (unsigned long long)max_visits);
+		return (ANALYZE_EXIT_LIMIT);
+	}
+	return (EXIT_SUCCESS);
+}
+
+/* Maximum number of concurrent random failures injected by "soak" */
+#define	SOAK_MAX_FAILS		16
+/* Number of ticks a random failure injected by "soak" lasts */
+#define	SOAK_FAIL_TICKS		200
+/* Number of fake netlink connections kept open by "soak" */
+#define	SOAK_MAX_CONNS		4
+
+typedef struct {
+	elec_comp_t	*comp;
+	uint64_t	until;		/* tick at which it gets repaired */
+	bool		shorted;
+} soak_fail_t;
+
+typedef struct {
+	unsigned	duration;	/* seconds */
+	unsigned	interval;	/* seconds */
+	double		d_t;
+	unsigned	fail_rate;	/* failures per 1000 ticks */
+	unsigned	conn_every;	/* ticks, 0 to disable */
+	unsigned	ser_every;	/* ticks, 0 to disable */
+	unsigned	growth;		/* percent */
+} soak_params_t;
+
+typedef struct {
+	elec_sys_t	*sys;
+	const soak_params_t *params;
+	uint64_t	tick;
+	elec_comp_t	**comps;
+	size_t		n_comps;
+	elec_comp_t	**cbs;
+	size_t		n_cbs;
+	elec_comp_t	**ties;
+	size_t		n_ties;
+	elec_comp_t	**gens;
+	size_t		n_gens;
+	soak_fail_t	fails[SOAK_MAX_FAILS];
+#ifdef	LIBELEC_WITH_NETLINK
+	netlink_conn_id_t conns[SOAK_MAX_CONNS];
+	unsigned	n_conns;
+	netlink_conn_id_t next_conn_id;
+#endif
+	uint64_t	n_reconns;
+	uint64_t	n_sers;
+	uint64_t	ser_ns;
+	/* per-interval tick durations */
+	uint64_t	*ticks_ns;
+	size_t		n_ticks;
+	size_t		cap_ticks;
+} soak_t;
+
+/*
+ * Measurements of one "soak" report interval. The first interval is
+ * the reference the later ones are checked against.
+ */
+typedef struct {
+	uint64_t	p50_ns;
+	uint64_t	p99_ns;
+	uint64_t	max_ns;
+	uint64_t	rss;
+	uint64_t	heap;
+} soak_sample_t;
+
+static inline size_t
+soak_rand(size_t n)
+{
+	ASSERT(n != 0);
+	return (crc64_rand() % n);
+}
+
+/*
+ * Returns the resident set size of the process in bytes, or 0 on
+ * platforms where we can't cheaply get at it.
+ */
+static uint64_t
+soak_rss(void)
+{
+#if	LIN
+	unsigned long long size, rss;
+	FILE *fp = fopen("/proc/self/statm", "r");
+	bool ok;
+
+	if (fp == NULL)
+		return (0);
+	ok = (fscanf(fp, "%llu %llu", &size, &rss) == 2);
+	fclose(fp);
+	return (ok ? rss * (uint64_t)sysconf(_SC_PAGESIZE) : 0);
+#else	/* !LIN */
+	return (0);
+#endif	/* !LIN */
+}
+
+static int
+soak_ns_cmp(const void *a, const void *b)
+{
+	uint64_t ta = *(const uint64_t *)a, tb = *(const uint64_t *)b;
+
+	if (ta != tb)
+		return (ta < tb ? -1 : 1);
+	return (0);
+}
+
+static void
+soak_setup(soak_t *sk, elec_sys_t *sys, const soak_params_t *params)
+{
+	size_t n = list_count(&sys->comps);
+
+	ASSERT(sk != NULL);
+	ASSERT(sys != NULL);
+	ASSERT(params != NULL);
+
+	memset(sk, 0, sizeof (*sk));
+	sk->sys = sys;
+	sk->params = params;
+	sk->comps = safe_calloc(MAX(n, 1), sizeof (*sk->comps));
+	sk->cbs = safe_calloc(MAX(n, 1), sizeof (*sk->cbs));
+	sk->ties = safe_calloc(MAX(n, 1), sizeof (*sk->ties));
+	sk->gens = safe_calloc(MAX(n, 1), sizeof (*sk->gens));
+	for (elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		sk->comps[sk->n_comps++] = comp;
+		if (comp->info->type == ELEC_CB)
+			sk->cbs[sk->n_cbs++] = comp;
+		else if (comp->info->type == ELEC_TIE)
+			sk->ties[sk->n_ties++] = comp;
+		else if (comp->info->type == ELEC_GEN)
+			sk->gens[sk->n_gens++] = comp;
+	}
+#ifdef	LIBELEC_WITH_NETLINK
+	sk->next_conn_id = 1;
+#endif
+}
+
+static void
+soak_teardown(soak_t *sk)
+{
+	ASSERT(sk != NULL);
+	free(sk->comps);
+	free(sk->cbs);
+	free(sk->ties);
+	free(sk->gens);
+	free(sk->ticks_ns);
+}
+
+/*
+ * Randomizes the inputs of the network. Breakers & ties are left
+ * closed more often than not, so that most of the network stays
+ * powered and every pass has a realistic amount of work to do.
+ * Failures & short circuits are repaired after SOAK_FAIL_TICKS.
+ */
+static void
+soak_inputs(soak_t *sk)
+{
+	ASSERT(sk != NULL);
+
+	if (sk->n_cbs != 0 && soak_rand(20) == 0) {
+		libelec_cb_set(sk->cbs[soak_rand(sk->n_cbs)],
+		    soak_rand(4) != 0);
+	}
+	if (sk->n_ties != 0 && soak_rand(50) == 0) {
+		libelec_tie_set_all(sk->ties[soak_rand(sk->n_ties)],
+		    soak_rand(4) != 0);
+	}
+	if (sk->n_gens != 0 && soak_rand(10) == 0) {
+		elec_comp_t *gen = sk->gens[soak_rand(sk->n_gens)];
+
+		libelec_gen_set_rpm(gen, wavg(gen->info->gen.min_rpm,
+		    gen->info->gen.max_rpm, soak_rand(1001) / 1000.0));
+	}
+	for (unsigned i = 0; i < SOAK_MAX_FAILS; i++) {
+		soak_fail_t *fail = &sk->fails[i];
+
+		if (fail->comp != NULL && sk->tick >= fail->until) {
+			if (fail->shorted)
+				libelec_comp_set_shorted(fail->comp, false);
+			else
+				libelec_comp_set_failed(fail->comp, false);
+			fail->comp = NULL;
+		}
+	}
+	if (sk->params->fail_rate != 0 &&
+	    soak_rand(1000) < sk->params->fail_rate) {
+		elec_comp_t *comp = sk->comps[soak_rand(sk->n_comps)];
+
+		for (unsigned i = 0; i < SOAK_MAX_FAILS; i++) {
+			soak_fail_t *fail = &sk->fails[i];
+
+			if (fail->comp == comp)
+				break;
+			if (fail->comp != NULL)
+				continue;
+			fail->comp = comp;
+			fail->until = sk->tick + SOAK_FAIL_TICKS;
+			fail->shorted = (soak_rand(2) != 0);
+			if (fail->shorted)
+				libelec_comp_set_shorted(comp, true);
+			else
+				libelec_comp_set_failed(comp, true);
+			break;
+		}
+	}
+}
+
+#ifdef	LIBELEC_WITH_NETLINK
+
+/*
+ * Drops the oldest fake receiver connection and connects a new one
+ * with a random subscription, the same as a receiver would over
+ * netlink. The sender's frames to these connections go nowhere.
+ */
+static void
+soak_reconnect(soak_t *sk)
+{
+	elec_sys_t *sys;
+	net_req_map_t *req;
+	netlink_conn_id_t conn_id;
+
+	ASSERT(sk != NULL);
+	sys = sk->sys;
+
+	if (sk->n_conns == SOAK_MAX_CONNS) {
+		/* The event type is ignored by conn_rem_notif */
+		conn_rem_notif(sk->conns[0], (netlink_conn_ev_t)0, sys);
+		memmove(&sk->conns[0], &sk->conns[1],
+		    (SOAK_MAX_CONNS - 1) * sizeof (*sk->conns));
+		sk->n_conns--;
+	}
+	conn_id = sk->next_conn_id++;
+	req = safe_calloc(1, NETMAPSZ_REQ(sys));
+	req->version = LIBELEC_NET_VERSION;
+	req->req = NET_REQ_MAP;
+	req->conf_crc = sys->conf_crc;
+	for (size_t i = 0; i < sk->n_comps; i++) {
+		if (soak_rand(4) == 0)
+			NETMAPSET(req->map, i);
+	}
+	conn_add_notif(conn_id, (netlink_conn_ev_t)0, sys);
+	netlink_send_msg_notif(conn_id, req, NETMAPSZ_REQ(sys), sys);
+	free(req);
+	sk->conns[sk->n_conns++] = conn_id;
+	sk->n_reconns++;
+}
+
+#endif	/* LIBELEC_WITH_NETLINK */
+
+static void
+soak_serialize(soak_t *sk)
+{
+	conf_t *ser = conf_create_empty();
+	uint64_t t0 = bench_ns();
+
+	ASSERT(sk != NULL);
+	libelec_serialize(sk->sys, ser, BENCH_PREFIX);
+	VERIFY(libelec_deserialize(sk->sys, ser, BENCH_PREFIX));
+	sk->ser_ns += bench_ns() - t0;
+	sk->n_sers++;
+	conf_free(ser);
+}
+
+static void
+soak_tick(soak_t *sk)
+{
+	const soak_params_t *params;
+	uint64_t t0;
+
+	ASSERT(sk != NULL);
+	params = sk->params;
+
+	soak_inputs(sk);
+	t0 = bench_ns();
+	elec_sys_pass(sk->sys, params->d_t, 0);
+	if (sk->n_ticks == sk->cap_ticks) {
+		sk->cap_ticks = MAX(2 * sk->cap_ticks, 65536);
+		sk->ticks_ns = safe_realloc(sk->ticks_ns, sk->cap_ticks *
+		    sizeof (*sk->ticks_ns));
+	}
+	sk->ticks_ns[sk->n_ticks++] = bench_ns() - t0;
+#ifdef	LIBELEC_WITH_NETLINK
+	if (params->conn_every != 0) {
+		/* Nobody else runs the sender, see net_send_thread */
+		net_send_frame(sk->sys, sk->sys->net_send.thr.tick,
+		    sk->sys->net_send.thr.sim_time_us,
+		    sk->sys->net_send.thr.pub_time_us);
+		if (sk->tick % params->conn_every == 0)
+			soak_reconnect(sk);
+	}
+#endif	/* LIBELEC_WITH_NETLINK */
+	if (params->ser_every != 0 && sk->tick % params->ser_every == 0)
+		soak_serialize(sk);
+	sk->tick++;
+}
+
+/*
+ * Takes the measurements of the report interval which just ended and
+ * resets the tick durations for the next one.
+ */
+static void
+soak_sample(soak_t *sk, soak_sample_t *smp)
+{
+	elec_alloc_stats_t as;
+
+	ASSERT(sk != NULL);
+	ASSERT(smp != NULL);
+
+	memset(smp, 0, sizeof (*smp));
+	if (sk->n_ticks != 0) {
+		qsort(sk->ticks_ns, sk->n_ticks, sizeof (*sk->ticks_ns),
+		    soak_ns_cmp);
+		smp->p50_ns = sk->ticks_ns[sk->n_ticks / 2];
+		smp->p99_ns = sk->ticks_ns[sk->n_ticks * 99 / 100];
+		smp->max_ns = sk->ticks_ns[sk->n_ticks - 1];
+	}
+	smp->rss = soak_rss();
+	libelec_get_alloc_stats(&as);
+	smp->heap = as.live_bytes;
+}
+
+/*
+ * Checks a report interval against the reference interval. Returns a
+ * bitmask of the quantities which grew by more than `growth' percent:
+ * 1 for the tick time median, 2 for its 99th percentile, 4 for the
+ * resident set size and 8 for libelec's heap.
+ */
+static unsigned
+soak_drift(const soak_sample_t *ref, const soak_sample_t *smp,
+    unsigned growth)
+{
+	double lim = 1 + growth / 100.0;
+	unsigned drift = 0;
+
+	ASSERT(ref != NULL);
+	ASSERT(smp != NULL);
+
+	if (smp->p50_ns > ref->p50_ns * lim)
+		drift |= 1;
+	if (smp->p99_ns > ref->p99_ns * lim)
+		drift |= 2;
+	if (smp->rss > ref->rss * lim)
+		drift |= 4;
+	if (smp->heap > ref->heap * lim)
+		drift |= 8;
+
+	return (drift);
+}
+
+static void
+soak_print_drift(unsigned drift)
+{
+	static const char *names[] = { "p50", "p99", "rss", "heap" };
+	bool first = true;
+
+	for (unsigned i = 0; i < ARRAY_NUM_ELEM(names); i++) {
+		if (drift & (1 << i)) {
+			printf("%s%s", first ? "  " : ",", names[i]);
+			first = false;
+		}
+	}
+	printf("\n");
+}
+
+/*
+ * Runs a network for a long time with random inputs, failures,
+ * netlink connection churn and serialization round trips, to catch
+ * anything which slowly leaks memory or slows down the passes. The
+ * first report interval serves as the reference. If the last one has
+ * grown past it by more than the allowed margin, the drift is taken
+ * to be persistent and the exit status says so.
+ */
+static int
+soak_main(int argc, char **argv, const char *progname)
+{
+	soak_params_t params = {
+		.duration = SOAK_DURATION_DFL,
+		.interval = SOAK_INTERVAL_DFL,
+		.d_t = USEC2SEC(EXEC_INTVAL),
+		.fail_rate = SOAK_FAIL_RATE_DFL,
+		.conn_every = SOAK_CONN_EVERY_DFL,
+		.ser_every = SOAK_SER_EVERY_DFL,
+		.growth = SOAK_GROWTH_DFL
+	};
+	const char *filename;
+	elec_sys_t *sys;
+	soak_t sk;
+	soak_sample_t ref, smp;
+	uint64_t start, end, next, prev_ticks = 0, prev_allocs = 0;
+	unsigned drift = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hD:I:d:f:c:S:G:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_usage(stdout, progname);
+			return (EXIT_SUCCESS);
+		case 'D':
+			params.duration = MAX(atoi(optarg), 1);
+			break;
+		case 'I':
+			params.interval = MAX(atoi(optarg), 1);
+			break;
+		case 'd':
+			params.d_t = atof(optarg);
+			break;
+		case 'f':
+			params.fail_rate = MAX(atoi(optarg), 0);
+			break;
+		case 'c':
+			params.conn_every = MAX(atoi(optarg), 0);
+			break;
+		case 'S':
+			params.ser_every = MAX(atoi(optarg), 0);
+			break;
+		case 'G':
+			params.growth = MAX(atoi(optarg), 0);
+			break;
+		default:
+			print_usage(stderr, progname);
+			return (EXIT_FAILURE);
+		}
+	}
+	if (optind + 1 != argc || params.d_t <= 0) {
+		print_usage(stderr, progname);
+		return (EXIT_FAILURE);
+	}
+	filename = argv[optind];
+
+	sys = libelec_new(filename);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	sys_prep(sys, false);
+#ifdef	LIBELEC_WITH_NETLINK
+	if (params.conn_every != 0)
+		libelec_enable_net_send(sys);
+#else	/* !LIBELEC_WITH_NETLINK */
+	params.conn_every = 0;
+#endif	/* !LIBELEC_WITH_NETLINK */
+	soak_setup(&sk, sys, &params);
+	printf("%s: %llu components, soaking for %u s%s\n\n", filename,
+	    (unsigned long long)libelec_get_num_comps(sys), params.duration,
+	    params.conn_every != 0 ? "" : " (without connection churn)");
+	printf("  TIME_s        TICKS   P50_us   P99_us   MAX_us     RSS_kB"
+	    "    HEAP_kB  ALLOCS/TICK  DRIFT\n"
+	    "--------  -----------  -------  -------  -------  ---------"
+	    "  ---------  -----------  -----\n");
+
+	/* The random failures would otherwise flood the log */
+	debug_quiet = true;
+	start = bench_ns();
+	end = start + params.duration * 1000000000llu;
+	next = start + params.interval * 1000000000llu;
+	for (;;) {
+		uint64_t now = bench_ns();
+		elec_alloc_stats_t as;
+		unsigned d;
+
+		if (now < next && now < end) {
+			soak_tick(&sk);
+			continue;
+		}
+		soak_sample(&sk, &smp);
+		if (prev_ticks == 0)
+			ref = smp;
+		libelec_get_alloc_stats(&as);
+		d = soak_drift(&ref, &smp, params.growth);
+		printf("%8.1f  %11llu  %7.2f  %7.2f  %7.2f  %9llu  %9llu  "
+		    "%11.2f", (now - start) / 1e9, (unsigned long long)sk.tick,
+		    smp.p50_ns / 1e3, smp.p99_ns / 1e3, smp.max_ns / 1e3,
+		    (unsigned long long)(smp.rss >> 10),
+		    (unsigned long long)(smp.heap >> 10),
+		    (double)(as.n_allocs - prev_allocs) /
+		    MAX(sk.tick - prev_ticks, 1));
+		soak_print_drift(d);
+		fflush(stdout);
+		prev_ticks = sk.tick;
+		prev_allocs = as.n_allocs;
+		sk.n_ticks = 0;
+		if (now >= end) {
+			drift = d;
+			break;
+		}
+		next = now + params.interval * 1000000000llu;
+	}
+	debug_quiet = false;
+
+	printf("\n%llu ticks, %llu reconnects, %llu serialize/deserialize "
+	    "cycles (avg %.1f us)\n", (unsigned long long)sk.tick,
+	    (unsigned long long)sk.n_reconns, (unsigned long long)sk.n_sers,
+	    sk.n_sers != 0 ? sk.ser_ns / 1e3 / sk.n_sers : 0.0);
+	soak_teardown(&sk);
+	libelec_destroy(sys);
+	if (drift != 0) {
+		printf("%s: drifted more than %u%% from the first interval:",
+		    filename, params.growth);
+		soak_print_drift(drift);
+		return (SOAK_EXIT_DRIFT);
+	}
+	return (EXIT_SUCCESS);
+}
+
+int
+main(int argc, char **argv)
+{
+	log_init(debug_print, "bench");
+	/*
+	 * Same as nettest, we seed the PRNG with a fixed value, so that
+	 * the random load fluctuations are the same on every run.
+	 */
+	crc64_init();
+	crc64_srand(0);
+
+	if (argc < 2) {
+		print_usage(stderr, argv[0]);
+		return (EXIT_FAILURE);
+	}
+	if (strcmp(argv[1], "gen") == 0)
+		return (gen_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "run") == 0)
+		return (run_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "api") == 0)
+		return (api_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "cgen") == 0)
+		return (cgen_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "draw") == 0)
+		return (draw_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "replay") == 0)
+		return (replay_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "analyze") == 0)
+		return (analyze_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "soak") == 0)
+		return (soak_main(argc - 1, argv + 1, argv[0]));
+	if (strcmp(argv[1], "-h") == 0) {
+		print_usage(stdout, argv[0]);
+		return (EXIT_SUCCESS);
+	}
+	print_usage(stderr, argv[0]);
+	return (EXIT_FAILURE);
+}
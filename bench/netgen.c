@@ -0,0 +1,256 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+
+#include "netgen.h"
+
+#define	EFF_CURVE(eff) \
+	"    CURVEPT\tEFF\t0\t" eff "\n" \
+	"    CURVEPT\tEFF\t30000\t" eff "\n"
+
+static void
+write_gen(FILE *fp, unsigned k)
+{
+	fprintf(fp, "GEN\t\tGEN_%u\n"
+	    "    VOLTS\t115\n"
+	    "    FREQ\t400\n"
+	    "    STAB_RATE\t0.1\n"
+	    "    STAB_RATE_F\t0.1\n"
+	    "    EXC_RPM\t15\n"
+	    "    MIN_RPM\t50\n"
+	    "    MAX_RPM\t120\n"
+	    EFF_CURVE("0.9")
+	    "\n", k);
+}
+
+static void
+write_batt(FILE *fp, unsigned i)
+{
+	fprintf(fp, "BATT\t\tBATT_%u\n"
+	    "    VOLTS\t25.4\n"
+	    "    CAPACITY\t1468800\n"
+	    "    MAX_PWR\t13000\n"
+	    "    CHG_R\t0.07\n"
+	    "    INT_R\t1\n"
+	    "\n", i);
+}
+
+static void
+write_tru(FILE *fp, const char *name)
+{
+	fprintf(fp, "TRU\t\t%s\n"
+	    "    IN_VOLTS\t115\n"
+	    "    OUT_VOLTS\t28\n"
+	    EFF_CURVE("0.9")
+	    "\n", name);
+}
+
+static void
+write_inv(FILE *fp, const char *name)
+{
+	fprintf(fp, "INV\t\t%s\n"
+	    "    IN_VOLTS\t28\n"
+	    "    OUT_VOLTS\t115\n"
+	    "    OUT_FREQ\t400\n"
+	    EFF_CURVE("0.9")
+	    "\n", name);
+}
+
+/*
+ * Emits the definitions of the loads hanging off of bus `bus'. The
+ * matching bus endpoints are emitted by write_bus_loads.
+ */
+static void
+write_loads(FILE *fp, const netgen_params_t *params, const char *bus, bool ac)
+{
+	for (unsigned n = 0; n < params->n_loads; n++) {
+		fprintf(fp, "LOAD\t\tL_%s_%u%s\n"
+		    "    STAB\tTRUE\n"
+		    "    MIN_VOLTS\t%s\n", bus, n, ac ? "\t\tAC" : "",
+		    ac ? "90" : "18");
+		if (params->load_cbs)
+			fprintf(fp, "    LOADCB\t5\n");
+		fprintf(fp, "    STD_LOAD\t%u\n\n", 10 + 10 * (n % 4));
+	}
+}
+
+static void
+write_bus_loads(FILE *fp, const netgen_params_t *params, const char *bus)
+{
+	for (unsigned n = 0; n < params->n_loads; n++) {
+		fprintf(fp, "    ENDPT\t%sL_%s_%u\n",
+		    params->load_cbs ? "CB_" : "", bus, n);
+	}
+}
+
+static bool
+check_params(const netgen_params_t *params)
+{
+	ASSERT(params != NULL);
+
+	if (params->n_gens == 0 && params->n_batts == 0) {
+		fprintf(stderr, "Network needs at least one generator or "
+		    "battery\n");
+		return (false);
+	}
+	if (params->n_buses == 0) {
+		fprintf(stderr, "Network needs at least one DC bus per "
+		    "channel\n");
+		return (false);
+	}
+	return (true);
+}
+
+/*
+ * Emits the device definitions of channel `k'. Only channels which have
+ * a generator get the AC side and the converter chain.
+ */
+static void
+write_chan_devs(FILE *fp, const netgen_params_t *params, unsigned k)
+{
+	char bus[64], name[64];
+
+	if (k < params->n_gens) {
+		write_gen(fp, k);
+		snprintf(name, sizeof (name), "TRU_%u", k);
+		write_tru(fp, name);
+		snprintf(bus, sizeof (bus), "AC_%u", k);
+		write_loads(fp, params, bus, true);
+		for (unsigned c = 0; c < params->chain_len; c++) {
+			snprintf(name, sizeof (name), "TRUX_%u_%u", k, c);
+			write_tru(fp, name);
+			snprintf(name, sizeof (name), "INV_%u_%u", k, c);
+			write_inv(fp, name);
+			snprintf(bus, sizeof (bus), "DCX_%u_%u", k, c);
+			write_loads(fp, params, bus, false);
+			snprintf(bus, sizeof (bus), "ACX_%u_%u", k, c);
+			write_loads(fp, params, bus, true);
+		}
+	}
+	for (unsigned j = 0; j < params->n_buses; j++) {
+		if (j + 1 < params->n_buses)
+			fprintf(fp, "CB\t\tCB_DC_%u_%u\t50\n\n", k, j);
+		snprintf(bus, sizeof (bus), "DC_%u_%u", k, j);
+		write_loads(fp, params, bus, false);
+	}
+}
+
+/*
+ * Emits the converter chain hanging off of the AC bus of channel `k'.
+ * Each stage is a TRU feeding a DC bus, which feeds an inverter. The
+ * inverter's AC bus then feeds the TRU of the next stage. Every bus in
+ * the chain only ever has a single source, as required for AC buses.
+ */
+static void
+write_chan_chain(FILE *fp, const netgen_params_t *params, unsigned k)
+{
+	char bus[64];
+
+	for (unsigned c = 0; c < params->chain_len; c++) {
+		snprintf(bus, sizeof (bus), "DCX_%u_%u", k, c);
+		fprintf(fp, "BUS\t\t%s\tDC\n"
+		    "    ENDPT\tTRUX_%u_%u\t\tDC\n"
+		    "    ENDPT\tINV_%u_%u\t\tDC\n", bus, k, c, k, c);
+		write_bus_loads(fp, params, bus);
+		fprintf(fp, "\n");
+
+		snprintf(bus, sizeof (bus), "ACX_%u_%u", k, c);
+		fprintf(fp, "BUS\t\t%s\tAC\n"
+		    "    ENDPT\tINV_%u_%u\t\tAC\n", bus, k, c);
+		if (c + 1 < params->chain_len)
+			fprintf(fp, "    ENDPT\tTRUX_%u_%u\t\tAC\n", k, c + 1);
+		write_bus_loads(fp, params, bus);
+		fprintf(fp, "\n");
+	}
+}
+
+static void
+write_chan_buses(FILE *fp, const netgen_params_t *params, unsigned k,
+    unsigned n_chans, unsigned n_ties)
+{
+	char bus[64];
+
+	if (k < params->n_gens) {
+		snprintf(bus, sizeof (bus), "AC_%u", k);
+		fprintf(fp, "BUS\t\t%s\tAC\n"
+		    "    ENDPT\tGEN_%u\n"
+		    "    ENDPT\tTRU_%u\t\tAC\n", bus, k, k);
+		if (params->chain_len != 0)
+			fprintf(fp, "    ENDPT\tTRUX_%u_0\t\tAC\n", k);
+		write_bus_loads(fp, params, bus);
+		fprintf(fp, "\n");
+		write_chan_chain(fp, params, k);
+	}
+	for (unsigned j = 0; j < params->n_buses; j++) {
+		snprintf(bus, sizeof (bus), "DC_%u_%u", k, j);
+		fprintf(fp, "BUS\t\t%s\tDC\n", bus);
+		if (j == 0 && k < params->n_gens)
+			fprintf(fp, "    ENDPT\tTRU_%u\t\tDC\n", k);
+		if (j == 0) {
+			for (unsigned i = k; i < params->n_batts; i += n_chans)
+				fprintf(fp, "    ENDPT\tBATT_%u\n", i);
+		}
+		if (j == 0 && params->tie_fanout >= 2 &&
+		    k / params->tie_fanout < n_ties) {
+			fprintf(fp, "    ENDPT\tTIE_%u\n",
+			    k / params->tie_fanout);
+		}
+		if (j != 0)
+			fprintf(fp, "    ENDPT\tCB_DC_%u_%u\n", k, j - 1);
+		if (j + 1 < params->n_buses)
+			fprintf(fp, "    ENDPT\tCB_DC_%u_%u\n", k, j);
+		write_bus_loads(fp, params, bus);
+		fprintf(fp, "\n");
+	}
+}
+
+/*
+ * Writes a synthetic network definition of the shape described by
+ * `params' into `fp'. See netgen_params_t for a description of the
+ * network layout.
+ */
+bool
+netgen_write(FILE *fp, const netgen_params_t *params)
+{
+	unsigned n_chans, n_ties = 0;
+
+	ASSERT(fp != NULL);
+	ASSERT(params != NULL);
+
+	if (!check_params(params))
+		return (false);
+	n_chans = MAX(params->n_gens, 1);
+	/* A trailing group with a single channel doesn't get a tie */
+	if (params->tie_fanout >= 2) {
+		n_ties = n_chans / params->tie_fanout +
+		    (n_chans % params->tie_fanout >= 2 ? 1 : 0);
+	}
+
+	fprintf(fp, "# Synthetic network generated by libelec_bench\n"
+	    "# gens=%u batts=%u buses=%u loads=%u tie_fanout=%u "
+	    "chain_len=%u load_cbs=%d\n\n", params->n_gens, params->n_batts,
+	    params->n_buses, params->n_loads, params->tie_fanout,
+	    params->chain_len, params->load_cbs);
+	/*
+	 * Devices first, buses later, so that all bus endpoints refer to
+	 * previously defined components.
+	 */
+	for (unsigned i = 0; i < params->n_batts; i++)
+		write_batt(fp, i);
+	for (unsigned g = 0; g < n_ties; g++)
+		fprintf(fp, "TIE\t\tTIE_%u\n\n", g);
+	for (unsigned k = 0; k < n_chans; k++)
+		write_chan_devs(fp, params, k);
+	for (unsigned k = 0; k < n_chans; k++)
+		write_chan_buses(fp, params, k, n_chans, n_ties);
+
+	return (!ferror(fp));
+}
@@ -0,0 +1,50 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	__LIBELEC_BENCH_NETGEN_H__
+#define	__LIBELEC_BENCH_NETGEN_H__
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shape parameters of a synthetic network. The network is built out of
+ * `n_gens' channels. Each channel consists of a generator feeding an AC
+ * bus, which in turn feeds a TRU and a string of `n_buses' DC buses
+ * joined by circuit breakers. The AC bus also feeds a chain of
+ * `chain_len' TRU-inverter pairs. The first DC bus of every group of
+ * `tie_fanout' consecutive channels is joined by a single tie.
+ * Batteries are distributed round-robin over the first DC buses and
+ * every bus gets `n_loads' loads of a matching type.
+ */
+typedef struct {
+	unsigned	n_gens;
+	unsigned	n_batts;
+	unsigned	n_buses;	/* DC buses per channel */
+	unsigned	n_loads;	/* loads per bus */
+	unsigned	tie_fanout;	/* 0 or 1 means no ties */
+	unsigned	chain_len;	/* TRU/inverter pairs per channel */
+	bool		load_cbs;	/* give each load its own LOADCB */
+} netgen_params_t;
+
+#define	NETGEN_PARAMS_DFL \
+	((netgen_params_t){ .n_gens = 4, .n_batts = 2, .n_buses = 2, \
+	    .n_loads = 4, .tie_fanout = 2, .chain_len = 1, .load_cbs = true })
+
+bool netgen_write(FILE *fp, const netgen_params_t *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __LIBELEC_BENCH_NETGEN_H__ */
@@ -8,6 +8,7 @@
  */
 
 #include <errno.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -27,10 +28,19 @@
 #include <acfutils/mt_cairo_render.h>
 #include <acfutils/perf.h>
 #include <acfutils/safe_alloc.h>
+#include <acfutils/thread.h>
+#include <acfutils/time.h>
 
 #include "libelec.h"
 #include "libelec_drawing.h"
 
+#ifdef	CAIRO_HAS_SVG_SURFACE
+#include <cairo-svg.h>
+#endif
+#ifdef	CAIRO_HAS_PDF_SURFACE
+#include <cairo-pdf.h>
+#endif
+
 #define	WHITE_RGB	1, 1, 1
 #define	BLACK_RGB	0, 0, 0
 #define	LIGHT_GRAY_RGB	0.67, 0.67, 0.67
@@ -41,6 +51,7 @@
 #define	AUTOFMT_AMPS_5(val)	fixed_decimals(val, 4), (val)
 #define	AUTOFMT_PWR_6(val)	\
 	pwr_length(val), pwr_decimals(val), pwr_conv(val), pwr_units(val)
+#define	NET_TOPO_TIMEOUT	10	/* seconds, see the -r option */
 
 static char **cmd_comps = NULL;
 static size_t n_cmd_comps = 0;
@@ -54,8 +65,10 @@ typedef struct {
 
 static elec_sys_t *sys = NULL;
 static avl_tree_t load_infos;
+static elec_load_profile_t *load_prof = NULL;
 
 static double get_load(elec_comp_t *comp, void *userinfo);
+static bool read_commands(FILE *fp, const char *filename, bool interactive);
 
 static enum {
     FORMAT_HUMAN_READABLE,
@@ -63,6 +76,17 @@ static enum {
     FORMAT_JSON
 } output_format = FORMAT_HUMAN_READABLE;
 
+/*
+ * In batch mode (--batch), the network is never started. It only ever
+ * advances using the "run", "ff" and "bench" commands, so a script produces
+ * the same results every time it is run.
+ */
+static bool batch_mode = false;
+static unsigned n_errors = 0;
+#ifdef	LIBELEC_WITH_NETLINK
+static bool net_recv = false;
+#endif
+
 static int
 pwr_length(double val)
 {
@@ -130,14 +154,215 @@ load_info_compar(const void *a, const void *b)
 	return (0);
 }
 
+/*
+ * Index of the component names in the network, built once by
+ * name_idx_build() right after the network is loaded. `ents' holds all
+ * the components sorted by their lower-cased names, so that all names
+ * starting with a given prefix (for tab completion and "PREFIX*"
+ * listings) can be found with a binary search, instead of case-folding
+ * every name in the network each time. `order' holds the components in
+ * network order and `by_type' the same, split up by component type.
+ */
+typedef struct {
+	char		*key;
+	elec_comp_t	*comp;
+} name_ent_t;
+
+#define	NUM_COMP_TYPES	(ELEC_LABEL_BOX + 1)
+
+static struct {
+	name_ent_t	*ents;
+	size_t		n_ents;
+	elec_comp_t	**order;
+	elec_comp_t	**by_type[NUM_COMP_TYPES];
+	size_t		n_by_type[NUM_COMP_TYPES];
+} name_idx = {0};
+
+static char *
+name_fold(const char *name)
+{
+	char *key;
+
+	ASSERT(name != NULL);
+	key = safe_strdup(name);
+	strtolower(key);
+	return (key);
+}
+
+static int
+name_ent_compar(const void *a, const void *b)
+{
+	const name_ent_t *ea = a, *eb = b;
+	return (strcmp(ea->key, eb->key));
+}
+
+static void
+name_idx_add(elec_comp_t *comp, void *userinfo)
+{
+	name_ent_t *ent;
+
+	ASSERT(comp != NULL);
+	UNUSED(userinfo);
+	ent = &name_idx.ents[name_idx.n_ents];
+	ent->key = name_fold(libelec_comp2info(comp)->name);
+	ent->comp = comp;
+	name_idx.order[name_idx.n_ents] = comp;
+	name_idx.n_ents++;
+}
+
+static void
+name_idx_build(void)
+{
+	size_t n_comps = libelec_get_num_comps(sys);
+
+	name_idx.ents = safe_calloc(MAX(n_comps, 1),
+	    sizeof (*name_idx.ents));
+	name_idx.order = safe_calloc(MAX(n_comps, 1),
+	    sizeof (*name_idx.order));
+	libelec_walk_comps(sys, name_idx_add, NULL);
+	ASSERT3U(name_idx.n_ents, ==, n_comps);
+
+	for (size_t i = 0; i < n_comps; i++) {
+		elec_comp_type_t type =
+		    libelec_comp2info(name_idx.order[i])->type;
+		name_idx.n_by_type[type]++;
+	}
+	for (int type = 0; type < NUM_COMP_TYPES; type++) {
+		name_idx.by_type[type] = safe_calloc(
+		    MAX(name_idx.n_by_type[type], 1),
+		    sizeof (*name_idx.by_type[type]));
+		name_idx.n_by_type[type] = 0;
+	}
+	for (size_t i = 0; i < n_comps; i++) {
+		elec_comp_t *comp = name_idx.order[i];
+		elec_comp_type_t type = libelec_comp2info(comp)->type;
+
+		name_idx.by_type[type][name_idx.n_by_type[type]++] = comp;
+	}
+	qsort(name_idx.ents, n_comps, sizeof (*name_idx.ents),
+	    name_ent_compar);
+}
+
+static void
+name_idx_destroy(void)
+{
+	for (size_t i = 0; i < name_idx.n_ents; i++)
+		free(name_idx.ents[i].key);
+	free(name_idx.ents);
+	free(name_idx.order);
+	for (int type = 0; type < NUM_COMP_TYPES; type++)
+		free(name_idx.by_type[type]);
+	memset(&name_idx, 0, sizeof (name_idx));
+}
+
+/*
+ * Returns the range of `name_idx.ents' (from `*lo' up to, but not
+ * including `*hi') whose names match `name' case-insensitively. With
+ * `prefix' set, `name' only needs to match the start of the names.
+ */
+static void
+name_idx_range(const char *name, bool prefix, size_t *lo, size_t *hi)
+{
+	char *key = name_fold(name);
+	size_t len = strlen(key), l, h;
+
+	ASSERT(lo != NULL);
+	ASSERT(hi != NULL);
+
+	l = 0;
+	h = name_idx.n_ents;
+	while (l < h) {
+		size_t m = l + (h - l) / 2;
+
+		if (strcmp(name_idx.ents[m].key, key) < 0)
+			l = m + 1;
+		else
+			h = m;
+	}
+	*lo = l;
+	h = name_idx.n_ents;
+	while (l < h) {
+		size_t m = l + (h - l) / 2;
+		int c = (prefix ? strncmp(name_idx.ents[m].key, key, len) :
+		    strcmp(name_idx.ents[m].key, key));
+
+		if (c <= 0)
+			l = m + 1;
+		else
+			h = m;
+	}
+	*hi = l;
+	free(key);
+}
+
+/*
+ * Calls `cb' on the components whose type is in `type_mask', selected
+ * by `name':
+ *	- empty: all of them, in network order
+ *	- ending in '*': those whose names start with the text before the
+ *	  '*', sorted by name
+ *	- otherwise: those whose names match `name'
+ * All name matching is case-insensitive.
+ */
+static void
+list_comps(const char *name, unsigned type_mask,
+    void (*cb)(elec_comp_t *comp, void *userinfo))
+{
+	ASSERT(name != NULL);
+	ASSERT(cb != NULL);
+
+	if (name[0] == '\0') {
+		for (int type = 0; type < NUM_COMP_TYPES; type++) {
+			if (type_mask != (1u << type))
+				continue;
+			for (size_t i = 0; i < name_idx.n_by_type[type]; i++)
+				cb(name_idx.by_type[type][i], NULL);
+			return;
+		}
+		for (size_t i = 0; i < name_idx.n_ents; i++) {
+			elec_comp_t *comp = name_idx.order[i];
+
+			if (type_mask & (1 << libelec_comp2info(comp)->type))
+				cb(comp, NULL);
+		}
+	} else {
+		char *pfx = safe_strdup(name);
+		size_t len = strlen(pfx), lo, hi;
+		bool prefix = (pfx[len - 1] == '*');
+
+		if (prefix)
+			pfx[len - 1] = '\0';
+		name_idx_range(pfx, prefix, &lo, &hi);
+		for (size_t i = lo; i < hi; i++) {
+			elec_comp_t *comp = name_idx.ents[i].comp;
+
+			if (type_mask & (1 << libelec_comp2info(comp)->type))
+				cb(comp, NULL);
+		}
+		free(pfx);
+	}
+}
+
+static bool
+is_prefix_pattern(const char *name)
+{
+	size_t len;
+
+	ASSERT(name != NULL);
+	len = strlen(name);
+	return (len != 0 && name[len - 1] == '*');
+}
+
 static void
 print_usage(FILE *fp, const char *progname)
 {
-	fprintf(fp, "Usage: %s [-hvJC] [-i <init_cmds_file>] <elec_file>"
+	fprintf(fp, "Usage: %s [-hvJC] [--batch] [-i <init_cmds_file>] "
 #ifdef	LIBELEC_WITH_NETLINK
-	    " [-s <url>|-r <url>]\n"
+	    "[-c <image_file>] [-s|-r] <elec_file>\n"
+	    "       %s -r [-hvJC] [-i <init_cmds_file>] "
+	    "[-c <image_file>]\n"
 #else	/* !defined(LIBELEC_WITH_NETLINK) */
-	    "\n"
+	    "[-c <image_file>] <elec_file>\n"
 #endif	/* !defined(LIBELEC_WITH_NETLINK) */
 	    "  -h : Show this help screen.\n"
 	    "  -v : Show version number and copyright screen, then exit.\n"
@@ -157,12 +382,38 @@ print_usage(FILE *fp, const char *progname)
 	    "generation\n"
 	    "       and configures nettest to operate as a scriptable "
 	    "backend.\n"
+	    "  --batch : Run the commands from <init_cmds_file> and then "
+	    "from stdin\n"
+	    "       without ever starting the network in real time, then "
+	    "exit. The\n"
+	    "       network only advances using the \"run\" and \"bench\" "
+	    "commands, so the\n"
+	    "       results are reproducible. Output is in JSON, unless "
+	    "-C is given.\n"
+	    "       The exit status is non-zero if any errors were "
+	    "reported.\n"
 	    "  -i <init_cmds_file> : File containing list of commands to "
 	    "run at startup.\n"
 	    "       Use this to configure the network to an initial state. "
 	    "After running\n"
-	    "       these commands, nettest will switch to interactive mode.\n",
-	    progname);
+	    "       these commands, nettest will switch to interactive mode.\n"
+	    "  -c <image_file> : Compile the network into a precompiled "
+	    "image, then exit.\n"
+	    "       Name the image <elec_file>c for libelec to load it "
+	    "automatically.\n"
+#ifdef	LIBELEC_WITH_NETLINK
+	    "  -s : Send the state of the network to network clients.\n"
+	    "  -r : Receive the state of the network from a network "
+	    "sender, instead of\n"
+	    "       simulating it locally. Without <elec_file>, the "
+	    "network definition\n"
+	    "       is downloaded from the sender.\n"
+#endif	/* defined(LIBELEC_WITH_NETLINK) */
+	    , progname
+#ifdef	LIBELEC_WITH_NETLINK
+	    , progname
+#endif	/* defined(LIBELEC_WITH_NETLINK) */
+	    );
 }
 
 static void
@@ -224,6 +475,7 @@ report_error(const char *format, ...)
 
 	va_list ap;
 
+	n_errors++;
 	va_start(ap, format);
 	buf1 = vsprintf_alloc(format, ap);
 	va_end(ap);
@@ -713,9 +965,10 @@ bus_cmd(void)
 	char bus_name[128], subcmd[32];
 	elec_comp_t *comp;
 
-	if (!get_next_word(bus_name, sizeof (bus_name))) {
+	if (!get_next_word(bus_name, sizeof (bus_name)) ||
+	    is_prefix_pattern(bus_name)) {
 		print_table_header("NAME", -30, "U", 6, NULL);
-		libelec_walk_comps(sys, print_buses_i, NULL);
+		list_comps(bus_name, 1 << ELEC_BUS, print_buses_i);
 		print_table_footer();
 		return;
 	}
@@ -727,7 +980,7 @@ bus_cmd(void)
 	}
 	if (!get_next_word(subcmd, sizeof (subcmd))) {
 		print_table_header("NAME", -30, "U", 6, NULL);
-		libelec_walk_comps(sys, print_buses_i, bus_name);
+		list_comps(bus_name, 1 << ELEC_BUS, print_buses_i);
 		print_table_footer();
 		return;
 	}
@@ -815,13 +1068,14 @@ tru_xfrmr_cmd(bool is_tru)
 	char name[128];
 	elec_comp_t *comp;
 
-	if (!get_next_word(name, sizeof (name))) {
+	if (!get_next_word(name, sizeof (name)) || is_prefix_pattern(name)) {
 		print_table_header("NAME", -30, "U_in", 6, "W_in", 6,
 		    "Eff", 6, "U_out", 6, "I_out", 6, "W_out", 6, NULL);
 		if (is_tru) {
-			libelec_walk_comps(sys, print_trus_i, NULL);
+			list_comps(name, (1 << ELEC_TRU) | (1 << ELEC_INV),
+			    print_trus_i);
 		} else {
-			libelec_walk_comps(sys, print_xfrmrs_i, NULL);
+			list_comps(name, 1 << ELEC_XFRMR, print_xfrmrs_i);
 		}
 		print_table_footer();
 		return;
@@ -842,7 +1096,12 @@ tru_xfrmr_cmd(bool is_tru)
 	}
 	print_table_header("NAME", -30, "U_in", 6, "W_in", 6,
 	    "Eff", 6, "U_out", 6, "I_out", 6, "W_out", 6, NULL);
-	libelec_walk_comps(sys, is_tru ? print_trus_i : print_xfrmrs_i, name);
+	if (is_tru) {
+		list_comps(name, (1 << ELEC_TRU) | (1 << ELEC_INV),
+		    print_trus_i);
+	} else {
+		list_comps(name, 1 << ELEC_XFRMR, print_xfrmrs_i);
+	}
 	print_table_footer();
 }
 
@@ -877,10 +1136,11 @@ gen_cmd(void)
 	char gen_name[128], subcmd[128];
 	elec_comp_t *comp;
 
-	if (!get_next_word(gen_name, sizeof (gen_name))) {
+	if (!get_next_word(gen_name, sizeof (gen_name)) ||
+	    is_prefix_pattern(gen_name)) {
 		print_table_header("NAME", -30, "RPM", 6, "W_in", 6,
 		    "Eff", 6, "U_out", 6, "I_out", 6, "W_out", 6, NULL);
-		libelec_walk_comps(sys, print_gens_i, NULL);
+		list_comps(gen_name, 1 << ELEC_GEN, print_gens_i);
 		print_table_footer();
 		return;
 	}
@@ -893,7 +1153,7 @@ gen_cmd(void)
 	if (!get_next_word(subcmd, sizeof (subcmd))) {
 		print_table_header("NAME", -30, "RPM", 6, "W_in", 6,
 		    "Eff", 6, "U_out", 6, "I_out", 6, "W_out", 6, NULL);
-		libelec_walk_comps(sys, print_gens_i, gen_name);
+		list_comps(gen_name, 1 << ELEC_GEN, print_gens_i);
 		print_table_footer();
 		return;
 	}
@@ -953,9 +1213,10 @@ tie_cmd(void)
 	 * If no tie name was provided on the command line, print the state
 	 * of all ties in the network.
 	 */
-	if (!get_next_word(tie_name, sizeof (tie_name))) {
+	if (!get_next_word(tie_name, sizeof (tie_name)) ||
+	    is_prefix_pattern(tie_name)) {
 		print_table_header("NAME", -30, "BUSES", -30, NULL);
-		libelec_walk_comps(sys, print_ties_i, NULL);
+		list_comps(tie_name, 1 << ELEC_TIE, print_ties_i);
 		print_table_footer();
 		return;
 	}
@@ -996,7 +1257,7 @@ tie_cmd(void)
 		 * one tie specified by the user.
 		 */
 		print_table_header("NAME", -30, "BUSES", -30, NULL);
-		libelec_walk_comps(sys, print_ties_i, tie_name);
+		list_comps(tie_name, 1 << ELEC_TIE, print_ties_i);
 		print_table_footer();
 	}
 out:
@@ -1030,10 +1291,11 @@ cb_cmd(void)
 	char cb_name[64], subcmd[32];
 	elec_comp_t *comp;
 
-	if (!get_next_word(cb_name, sizeof (cb_name))) {
+	if (!get_next_word(cb_name, sizeof (cb_name)) ||
+	    is_prefix_pattern(cb_name)) {
 		print_table_header("NAME", -30, "U", 6, "I", 6, "TEMP", 4,
 		    "SET", 3, NULL);
-		libelec_walk_comps(sys, print_cbs_i, NULL);
+		list_comps(cb_name, 1 << ELEC_CB, print_cbs_i);
 		print_table_footer();
 		return;
 	}
@@ -1045,7 +1307,7 @@ cb_cmd(void)
 	if (!get_next_word(subcmd, sizeof (subcmd))) {
 		print_table_header("NAME", -30, "U", 6, "I", 6, "TEMP", 4,
 		    "SET", 3, NULL);
-		libelec_walk_comps(sys, print_cbs_i, cb_name);
+		list_comps(cb_name, 1 << ELEC_CB, print_cbs_i);
 		print_table_footer();
 		return;
 	}
@@ -1105,10 +1367,11 @@ batt_cmd(void)
 	char batt_name[64], subcmd[32];
 	elec_comp_t *comp;
 
-	if (!get_next_word(batt_name, sizeof (batt_name))) {
+	if (!get_next_word(batt_name, sizeof (batt_name)) ||
+	    is_prefix_pattern(batt_name)) {
 		print_table_header("NAME", -30, "U_out", 6, "I_out", 6,
 		    "I_in", 6, "CHG", 6, "TEMP", 5, NULL);
-		libelec_walk_comps(sys, print_batts_i, NULL);
+		list_comps(batt_name, 1 << ELEC_BATT, print_batts_i);
 		print_table_footer();
 		return;
 	}
@@ -1121,7 +1384,7 @@ batt_cmd(void)
 	if (!get_next_word(subcmd, sizeof (subcmd))) {
 		print_table_header("NAME", -30, "U_out", 6, "I_out", 6,
 		    "I_in", 6, "CHG%", 6, "TEMP", 5, NULL);
-		libelec_walk_comps(sys, print_batts_i, batt_name);
+		list_comps(batt_name, 1 << ELEC_BATT, print_batts_i);
 		print_table_footer();
 		return;
 	}
@@ -1190,10 +1453,10 @@ load_cmd(void)
 	char name[128], subcmd[32];
 	elec_comp_t *comp;
 
-	if (!get_next_word(name, sizeof (name))) {
+	if (!get_next_word(name, sizeof (name)) || is_prefix_pattern(name)) {
 		print_table_header("NAME", -30, "U_out", 6, "I_out", 6,
 		    "W_out", 6, "U_c_in", 6, "I_in", 6, NULL);
-		libelec_walk_comps(sys, print_loads_i, NULL);
+		list_comps(name, 1 << ELEC_LOAD, print_loads_i);
 		print_table_footer();
 		return;
 	}
@@ -1206,7 +1469,7 @@ load_cmd(void)
 	if (!get_next_word(subcmd, sizeof (subcmd))) {
 		print_table_header("NAME", -30, "U_out", 6, "I_out", 6,
 		    "W_out", 6, "U_c_in", 6, "I_in", 6, NULL);
-		libelec_walk_comps(sys, print_loads_i, name);
+		list_comps(name, 1 << ELEC_LOAD, print_loads_i);
 		print_table_footer();
 		return;
 	}
@@ -1236,6 +1499,455 @@ load_cmd(void)
 	}
 }
 
+/*
+ * A single image to be rendered by draw_flush(). Jobs are rendered in
+ * parallel, so each job carries its own copy of the drawing settings
+ * which were in effect when it was queued.
+ */
+typedef struct {
+	char			filename[288];
+	double			offset[2];
+	double			pos_scale;
+	double			fontsz;
+	unsigned		imgsz[2];
+	const elec_comp_t	*comp;
+	char			err[128];
+} draw_job_t;
+
+static struct {
+	bool		batch;
+	draw_job_t	*jobs;
+	size_t		n_jobs;
+	size_t		cap_jobs;
+	mutex_t		lock;
+	size_t		next_job;	/* protected by lock */
+} draw_queue = {0};
+
+static unsigned
+num_cpus(void)
+{
+#if	IBM
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (MAX(si.dwNumberOfProcessors, 1));
+#else	/* !IBM */
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0 ? n : 1);
+#endif	/* !IBM */
+}
+
+static bool
+has_ext(const char *filename, const char *ext)
+{
+	const char *dot = strrchr(filename, '.');
+	return (dot != NULL && lacf_strcasecmp(dot, ext) == 0);
+}
+
+/*
+ * Creates the surface to render `job' into. Vector formats write into
+ * the output file directly, so for those `vector' is set to true and
+ * the caller doesn't need to write out anything after rendering.
+ */
+static cairo_surface_t *
+draw_surf_create(draw_job_t *job, bool *vector)
+{
+	*vector = false;
+#ifdef	CAIRO_HAS_SVG_SURFACE
+	if (has_ext(job->filename, ".svg")) {
+		*vector = true;
+		return (cairo_svg_surface_create(job->filename,
+		    job->imgsz[0], job->imgsz[1]));
+	}
+#endif	/* defined(CAIRO_HAS_SVG_SURFACE) */
+#ifdef	CAIRO_HAS_PDF_SURFACE
+	if (has_ext(job->filename, ".pdf")) {
+		*vector = true;
+		return (cairo_pdf_surface_create(job->filename,
+		    job->imgsz[0], job->imgsz[1]));
+	}
+#endif	/* defined(CAIRO_HAS_PDF_SURFACE) */
+	if (has_ext(job->filename, ".svg") || has_ext(job->filename, ".pdf")) {
+		snprintf(job->err, sizeof (job->err), "output format not "
+		    "supported by this build, try drawing a PNG instead");
+		return (NULL);
+	}
+	return (cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+	    job->imgsz[0], job->imgsz[1]));
+}
+
+/*
+ * Renders a single draw job. This runs on the draw worker threads, so
+ * it mustn't touch any global state. Errors are stored in the job and
+ * reported by draw_flush() once all workers are done.
+ */
+static void
+draw_render(draw_job_t *job)
+{
+	cairo_surface_t *surf;
+	cairo_t *cr;
+	cairo_status_t st;
+	bool vector;
+
+	surf = draw_surf_create(job, &vector);
+	if (surf == NULL)
+		return;
+	st = cairo_surface_status(surf);
+	if (st != CAIRO_STATUS_SUCCESS) {
+		snprintf(job->err, sizeof (job->err), "cannot create %ux%u "
+		    "surface: %s", job->imgsz[0], job->imgsz[1],
+		    cairo_status_to_string(st));
+		cairo_surface_destroy(surf);
+		return;
+	}
+	cr = cairo_create(surf);
+
+	cairo_set_source_rgb(cr, 1, 1, 1);
+	cairo_paint(cr);
+	cairo_translate(cr, job->offset[0], job->offset[1]);
+
+	cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL,
+	    CAIRO_FONT_WEIGHT_NORMAL);
+
+	libelec_draw_layout(sys, cr, job->pos_scale, job->fontsz);
+	if (job->comp != NULL) {
+		libelec_draw_comp_info(job->comp, cr, job->pos_scale,
+		    job->fontsz, libelec_comp2info(job->comp)->gui.pos);
+	}
+	cairo_destroy(cr);
+
+	if (vector) {
+		cairo_surface_finish(surf);
+		st = cairo_surface_status(surf);
+	} else {
+		st = cairo_surface_write_to_png(surf, job->filename);
+	}
+	if (st != CAIRO_STATUS_SUCCESS) {
+		snprintf(job->err, sizeof (job->err), "%s",
+		    cairo_status_to_string(st));
+	}
+	cairo_surface_destroy(surf);
+}
+
+static void
+draw_worker(void *unused)
+{
+	UNUSED(unused);
+
+	for (;;) {
+		draw_job_t *job;
+
+		mutex_enter(&draw_queue.lock);
+		if (draw_queue.next_job == draw_queue.n_jobs) {
+			mutex_exit(&draw_queue.lock);
+			break;
+		}
+		job = &draw_queue.jobs[draw_queue.next_job++];
+		mutex_exit(&draw_queue.lock);
+
+		draw_render(job);
+	}
+}
+
+/*
+ * Renders all queued draw jobs, spreading them across as many threads
+ * as there are CPUs, and reports any errors encountered.
+ */
+static void
+draw_flush(void)
+{
+	unsigned n_thr;
+	thread_t *thrs;
+
+	if (draw_queue.n_jobs == 0)
+		return;
+
+	n_thr = MIN(draw_queue.n_jobs, num_cpus());
+	thrs = safe_calloc(n_thr, sizeof (*thrs));
+	mutex_init(&draw_queue.lock);
+	draw_queue.next_job = 0;
+	for (unsigned i = 0; i < n_thr; i++)
+		VERIFY(thread_create(&thrs[i], draw_worker, NULL));
+	for (unsigned i = 0; i < n_thr; i++)
+		thread_join(&thrs[i]);
+	mutex_destroy(&draw_queue.lock);
+	free(thrs);
+
+	for (size_t i = 0; i < draw_queue.n_jobs; i++) {
+		const draw_job_t *job = &draw_queue.jobs[i];
+		if (job->err[0] != '\0')
+			report_error("%s: %s", job->filename, job->err);
+	}
+	draw_queue.n_jobs = 0;
+}
+
+static draw_job_t *
+draw_job_add(void)
+{
+	draw_job_t *job;
+
+	if (draw_queue.n_jobs == draw_queue.cap_jobs) {
+		draw_queue.cap_jobs = MAX(2 * draw_queue.cap_jobs, 16);
+		draw_queue.jobs = safe_realloc(draw_queue.jobs,
+		    draw_queue.cap_jobs * sizeof (*draw_queue.jobs));
+	}
+	job = &draw_queue.jobs[draw_queue.n_jobs++];
+	memset(job, 0, sizeof (*job));
+
+	return (job);
+}
+
+/*
+ * Queues an image for drawing. If `tilesz' is non-zero, the image is
+ * split into tiles of at most that size, with each tile going into a
+ * file named "<base>-<row>-<column>.<ext>".
+ */
+static void
+draw_queue_image(const char *filename, const double offset[2],
+    double pos_scale, double fontsz, const unsigned imgsz[2],
+    const unsigned tilesz[2], const elec_comp_t *comp)
+{
+	const char *dot, *slash;
+	int base_len;
+
+	if (tilesz[0] == 0 || tilesz[1] == 0) {
+		draw_job_t *job = draw_job_add();
+
+		lacf_strlcpy(job->filename, filename, sizeof (job->filename));
+		memcpy(job->offset, offset, sizeof (job->offset));
+		job->pos_scale = pos_scale;
+		job->fontsz = fontsz;
+		memcpy(job->imgsz, imgsz, sizeof (job->imgsz));
+		job->comp = comp;
+		return;
+	}
+	dot = strrchr(filename, '.');
+	slash = strrchr(filename, '/');
+	if (dot == NULL || (slash != NULL && dot < slash))
+		dot = filename + strlen(filename);
+	base_len = dot - filename;
+
+	for (unsigned y = 0, row = 0; y < imgsz[1]; y += tilesz[1], row++) {
+		for (unsigned x = 0, col = 0; x < imgsz[0];
+		    x += tilesz[0], col++) {
+			draw_job_t *job = draw_job_add();
+
+			snprintf(job->filename, sizeof (job->filename),
+			    "%.*s-%u-%u%s", base_len, filename, row, col, dot);
+			job->offset[0] = offset[0] - x;
+			job->offset[1] = offset[1] - y;
+			job->pos_scale = pos_scale;
+			job->fontsz = fontsz;
+			job->imgsz[0] = MIN(tilesz[0], imgsz[0] - x);
+			job->imgsz[1] = MIN(tilesz[1], imgsz[1] - y);
+			job->comp = comp;
+		}
+	}
+}
+
+/*
+ * Live drawing keeps re-rendering a single image in the background
+ * while the network runs, so that an external image viewer which
+ * reloads the file on change acts as a visualizer. Combined with the
+ * -r option, this renders a network running in another process (or on
+ * another machine) without costing that process anything beyond its
+ * net sender. Each image is first rendered into a temporary file and
+ * then renamed over the previous one, so viewers never see a partially
+ * written image.
+ */
+static struct {
+	bool		active;
+	bool		stop;		/* protected by lock */
+	draw_job_t	job;
+	double		intval;		/* seconds */
+	mutex_t		lock;
+	condvar_t	cv;
+	thread_t	thr;
+} draw_live = {0};
+
+static bool
+replace_file(const char *src, const char *dst)
+{
+#if	IBM
+	return (MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING));
+#else	/* !IBM */
+	return (rename(src, dst) == 0);
+#endif	/* !IBM */
+}
+
+static bool
+draw_live_render(void)
+{
+	draw_job_t tmp = draw_live.job;
+	const char *dot = strrchr(draw_live.job.filename, '.');
+	int base_len;
+
+	/* Keep the extension, it selects the output format */
+	if (dot == NULL || strchr(dot, '/') != NULL)
+		dot = draw_live.job.filename + strlen(draw_live.job.filename);
+	base_len = dot - draw_live.job.filename;
+	snprintf(tmp.filename, sizeof (tmp.filename), "%.*s.tmp%s", base_len,
+	    draw_live.job.filename, dot);
+	draw_render(&tmp);
+	if (tmp.err[0] != '\0') {
+		logMsg("%s: %s", draw_live.job.filename, tmp.err);
+		return (false);
+	}
+	if (!replace_file(tmp.filename, draw_live.job.filename)) {
+		logMsg("%s: can't replace image: %s", draw_live.job.filename,
+		    strerror(errno));
+		return (false);
+	}
+	return (true);
+}
+
+static void
+draw_live_worker(void *unused)
+{
+	uint64_t hash = 0;
+	bool first = true;
+
+	UNUSED(unused);
+
+	mutex_enter(&draw_live.lock);
+	while (!draw_live.stop) {
+		uint64_t new_hash = libelec_draw_get_state_hash(sys);
+		/*
+		 * The values in a details box aren't covered by the
+		 * state hash, so with one shown, redraw every time.
+		 */
+		if (first || new_hash != hash || draw_live.job.comp != NULL) {
+			bool ok;
+
+			mutex_exit(&draw_live.lock);
+			ok = draw_live_render();
+			mutex_enter(&draw_live.lock);
+			if (!ok)
+				break;
+			hash = new_hash;
+			first = false;
+		}
+		cv_timedwait(&draw_live.cv, &draw_live.lock,
+		    microclock() + SEC2USEC(draw_live.intval));
+	}
+	mutex_exit(&draw_live.lock);
+}
+
+static void
+draw_live_stop(void)
+{
+	if (!draw_live.active)
+		return;
+	mutex_enter(&draw_live.lock);
+	draw_live.stop = true;
+	cv_broadcast(&draw_live.cv);
+	mutex_exit(&draw_live.lock);
+	thread_join(&draw_live.thr);
+	mutex_destroy(&draw_live.lock);
+	cv_destroy(&draw_live.cv);
+	draw_live.active = false;
+}
+
+static void
+draw_live_start(const char *filename, const double offset[2],
+    double pos_scale, double fontsz, const unsigned imgsz[2],
+    const elec_comp_t *comp, double intval)
+{
+	draw_job_t *job = &draw_live.job;
+
+	draw_live_stop();
+
+	memset(job, 0, sizeof (*job));
+	lacf_strlcpy(job->filename, filename, sizeof (job->filename));
+	memcpy(job->offset, offset, sizeof (job->offset));
+	job->pos_scale = pos_scale;
+	job->fontsz = fontsz;
+	memcpy(job->imgsz, imgsz, sizeof (job->imgsz));
+	job->comp = comp;
+	draw_live.intval = intval;
+	draw_live.stop = false;
+	mutex_init(&draw_live.lock);
+	cv_init(&draw_live.cv);
+	VERIFY(thread_create(&draw_live.thr, draw_live_worker, NULL));
+	draw_live.active = true;
+}
+
+static void
+draw_live_cmd(const char *filename, const double offset[2],
+    double pos_scale, double fontsz, const unsigned imgsz[2],
+    const unsigned tilesz[2])
+{
+	char intval_str[16], comp_name[128];
+	const elec_comp_t *comp = NULL;
+	double intval;
+
+	if (!get_next_word(intval_str, sizeof (intval_str))) {
+		report_error("missing live drawing interval argument. "
+		    "Try typing \"help\".");
+		return;
+	}
+	if (lacf_strcasecmp(intval_str, "off") == 0) {
+		draw_live_stop();
+		return;
+	}
+	if (sscanf(intval_str, "%lf", &intval) != 1 || intval < 0.05 ||
+	    intval > 3600) {
+		report_error("live drawing interval is invalid. "
+		    "Try typing \"help\".");
+		return;
+	}
+	if (filename[0] == '\0') {
+		report_error("missing filename. You must draw an image "
+		    "at least once before starting live drawing. Try "
+		    "typing \"help\".");
+		return;
+	}
+	if (tilesz[0] != 0 && tilesz[1] != 0) {
+		report_error("live drawing doesn't support tiling, use "
+		    "\"draw tile 0 0\" to disable it first");
+		return;
+	}
+	if (get_next_word(comp_name, sizeof (comp_name))) {
+		comp = libelec_comp_find(sys, comp_name);
+		if (comp == NULL) {
+			report_error("component %s not found", comp_name);
+			return;
+		}
+		if (IS_NULL_VECT(libelec_comp2info(comp)->gui.pos)) {
+			report_error("component %s has no defined "
+			    "graphical position", comp_name);
+			return;
+		}
+	}
+	draw_live_start(filename, offset, pos_scale, fontsz, imgsz, comp,
+	    intval);
+}
+
+static void
+draw_batch(void)
+{
+	char filename[256];
+	FILE *fp;
+
+	if (!get_next_word(filename, sizeof (filename))) {
+		report_error("missing batch file argument. Try typing "
+		    "\"help\".");
+		return;
+	}
+	if (draw_queue.batch) {
+		report_error("\"draw batch\" cannot be nested");
+		return;
+	}
+	fp = fopen(filename, "r");
+	if (fp == NULL) {
+		report_error("can't open %s: %s", filename, strerror(errno));
+		return;
+	}
+	draw_queue.batch = true;
+	read_commands(fp, filename, false);
+	draw_queue.batch = false;
+	fclose(fp);
+}
+
 static void
 draw_cmd(void)
 {
@@ -1244,10 +1956,10 @@ draw_cmd(void)
 	static double pos_scale = 16;
 	static double fontsz = 14;
 	static unsigned imgsz[2] = { 2048, 2048 };
+	static unsigned tilesz[2] = {0};
 
 	char subcmd[256], comp_name[128];
-	cairo_surface_t *surf;
-	cairo_t *cr;
+	const elec_comp_t *comp = NULL;
 
 	if (!get_next_word(subcmd, sizeof (subcmd))) {
 		if (filename[0] == '\0') {
@@ -1316,586 +2028,2058 @@ draw_cmd(void)
 		imgsz[1] = new_imgsz[1];
 		return;
 	}
-
-	surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-	    imgsz[0], imgsz[1]);
-	cr = cairo_create(surf);
-
-	cairo_set_source_rgb(cr, 1, 1, 1);
-	cairo_paint(cr);
-	cairo_translate(cr, offset[0], offset[1]);
-
-	cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL,
-	    CAIRO_FONT_WEIGHT_NORMAL);
-
-	libelec_draw_layout(sys, cr, pos_scale, fontsz);
-
-	if (get_next_word(comp_name, sizeof (comp_name))) {
-		const elec_comp_t *comp = libelec_comp_find(sys, comp_name);
-		const elec_comp_info_t *info;
-
+	if (lacf_strcasecmp(subcmd, "tile") == 0) {
+		char tilesz_str[2][16];
+		int new_tilesz[2];
+		if (!get_next_word(tilesz_str[0], sizeof (tilesz_str[0])) ||
+		    !get_next_word(tilesz_str[1], sizeof (tilesz_str[1])) ||
+		    sscanf(tilesz_str[0], "%d", &new_tilesz[0]) != 1 ||
+		    sscanf(tilesz_str[1], "%d", &new_tilesz[1]) != 1 ||
+		    ((new_tilesz[0] != 0 || new_tilesz[1] != 0) &&
+		    (new_tilesz[0] < 256 || new_tilesz[1] < 256))) {
+			report_error("missing tile size argument, or tile "
+			    "size is invalid. Try typing \"help\".");
+			return;
+		}
+		tilesz[0] = new_tilesz[0];
+		tilesz[1] = new_tilesz[1];
+		return;
+	}
+	if (lacf_strcasecmp(subcmd, "batch") == 0) {
+		draw_batch();
+		return;
+	}
+	if (lacf_strcasecmp(subcmd, "wait") == 0) {
+		char secs_str[16];
+		double secs;
+		if (!get_next_word(secs_str, sizeof (secs_str)) ||
+		    sscanf(secs_str, "%lf", &secs) != 1 ||
+		    secs < 0 || secs > 3600) {
+			report_error("missing wait argument, or wait time "
+			    "is invalid. Try typing \"help\".");
+			return;
+		}
+		draw_flush();
+		usleep(secs * 1000000);
+		return;
+	}
+	if (lacf_strcasecmp(subcmd, "live") == 0) {
+		draw_live_cmd(filename, offset, pos_scale, fontsz, imgsz,
+		    tilesz);
+		return;
+	}
+
+	if (get_next_word(comp_name, sizeof (comp_name))) {
+		comp = libelec_comp_find(sys, comp_name);
 		if (comp == NULL) {
 			report_error("component %s not found", comp_name);
-			goto errout;
+			return;
 		}
-		info = libelec_comp2info(comp);
-		if (IS_NULL_VECT(info->gui.pos)) {
+		if (IS_NULL_VECT(libelec_comp2info(comp)->gui.pos)) {
 			report_error("component %s has no defined "
 			    "graphical position", comp_name);
-			goto errout;
+			return;
 		}
-		libelec_draw_comp_info(comp, cr, pos_scale, fontsz,
-		    info->gui.pos);
 	}
-	cairo_surface_write_to_png(surf, subcmd);
+	draw_queue_image(subcmd, offset, pos_scale, fontsz, imgsz, tilesz,
+	    comp);
 	lacf_strlcpy(filename, subcmd, sizeof (filename));
-errout:
-	cairo_destroy(cr);
-	cairo_surface_destroy(surf);
+	/*
+	 * Outside of batch mode, draw right away. In batch mode, the
+	 * queue is flushed by the next command which isn't a draw command,
+	 * so that the images always show the state in effect at the time
+	 * they were queued.
+	 */
+	if (!draw_queue.batch)
+		draw_flush();
 }
 
 static void
-print_help(const char *cmd)
+prof_cmd(void)
 {
-	bool cmd_found = false;
+	static const struct {
+		const char	*name;
+		elec_prof_key_t	key;
+	} keys[] = {
+	    { "paint", ELEC_PROF_PAINT_VISITS },
+	    { "integ", ELEC_PROF_INTEG_VISITS },
+	    { "depth", ELEC_PROF_DEPTH },
+	    { "srcs", ELEC_PROF_SRCS },
+	    { "cb", ELEC_PROF_CB_TIME }
+	};
+	char subcmd[32], count_str[32];
+	elec_prof_key_t key = ELEC_PROF_PAINT_VISITS;
+	unsigned count = 20;
+	elec_comp_prof_t *top;
+	size_t n_top;
 
-	/* cmd can be NULL */
-	if (cmd == NULL) {
-		printf(
-		    "nettest expects that you type interactive commands after "
-		    "the '>' prompt.\n"
-		    "Commands use the following general syntax:\n"
-		    "\n"
-		    "	COMMAND [optional_argument(s)...]\n"
-		    "	COMMAND <mandatory_argument> SUBCOMMAND "
-		    "[optional_argument(s)...]\n"
-		    "\n"
-		    "If an argument uses angle brackets (\"<something>\"), you "
-		    "MUST provide a value\n"
-		    "for the argument. If the argument uses square brackets "
-		    "instead (\"[something]\"),\n"
-		    "the argument is optional and may be omitted.\n"
-		    "Most commands have a plain version without any arguments. "
-		    "Those commands will\n"
-		    "print out the state of all the instances of a given "
-		    "component type as a table.\n");
-#ifdef	WITH_READLINE
-		printf(
-		    "\n"
-		    "nettest has been compiled with GNU readline support. "
-		    "That means you can use\n"
-		    "readline-style editing features:\n"
-		    "	- use the <TAB> key for command and component name "
-		    "auto-completion\n"
-		    "	- use the up- and down-arrow keys to navigate command "
-		    "history\n"
-		    "	- use Ctrl+R for reverse-i-search in the command "
-		    "history\n"
-		    "	- use meta-B and meta-F for backward and forward "
-		    "jumping "
-		    "by word\n"
-		    "	- use Ctrl+A and Ctrl+E to the start or end of the "
-		    "line\n"
-		    "	  (etc.)\n"
-		    "\n");
-#endif	/* defined(WITH_READLINE) */
+	if (get_next_word(subcmd, sizeof (subcmd))) {
+		bool key_found = false;
+
+		if (lacf_strcasecmp(subcmd, "on") == 0) {
+			libelec_sys_set_profiling(sys, true);
+			return;
+		} else if (lacf_strcasecmp(subcmd, "off") == 0) {
+			libelec_sys_set_profiling(sys, false);
+			return;
+		} else if (lacf_strcasecmp(subcmd, "reset") == 0) {
+			libelec_sys_reset_profile(sys);
+			return;
+		}
+		for (size_t i = 0; i < ARRAY_NUM_ELEM(keys); i++) {
+			if (lacf_strcasecmp(subcmd, keys[i].name) == 0) {
+				key = keys[i].key;
+				key_found = true;
+				break;
+			}
+		}
+		if (!key_found) {
+			report_error("unknown prof subcommand \"%s\". "
+			    "Try typing \"help\".", subcmd);
+			return;
+		}
+		if (get_next_word(count_str, sizeof (count_str)) &&
+		    (sscanf(count_str, "%u", &count) != 1 || count == 0)) {
+			report_error("component count argument to \"%s\" "
+			    "subcommand must be a positive number. "
+			    "Try typing \"help\".", subcmd);
+			return;
+		}
 	}
-	if (cmd == NULL) {
-		printf(
-		    "===============\n"
-		    "==== BUSES ====\n"
-		    "===============\n");
+	if (!libelec_sys_get_profiling(sys)) {
+		report_error("solver profiling is off, enable it using "
+		    "\"prof on\"");
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "bus") == 0) {
-		cmd_found = true;
-		printf(
-		    "bus [BUS_NAME]\n"
-		    "    Print all buses with voltages, currents and power "
-		    "flows. Use this to get a\n"
-		    "    quick overview of the network state. If you provide "
-		    "an optional bus name,\n"
-		    "    only the data for the listed bus will be printed. "
-		    "Table columns:\n"
-		    "	U - voltage on the bus\n"
-		    "bus <BUS_NAME> list [DEVICE ...]\n"
-		    "    Lists the state of all devices attached to the "
-		    "specified bus. You may\n"
-		    "    provide an optional list of devices to narrow the "
-		    "printout to only those\n"
-		    "    devices listed.\n");
+	top = safe_calloc(count, sizeof (*top));
+	n_top = libelec_sys_get_profile_top(sys, key, top, count);
+	print_table_header("NAME", -30, "PAINT", 7, "INTEG", 7, "DEPTH", 5,
+	    "SRCS", 4, "CB", 8, NULL);
+	for (size_t i = 0; i < n_top; i++) {
+		double n_passes = MAX(top[i].n_passes, 1);
+
+		print_table_row(stdout,
+		    PRINT_STR("NAME", -30, libelec_comp2info(top[i].comp)->name),
+		    PRINT_F64("PAINT", 7, 2, top[i].paint_visits / n_passes,
+		    NULL),
+		    PRINT_F64("INTEG", 7, 2, top[i].integ_visits / n_passes,
+		    NULL),
+		    PRINT_I32("DEPTH", 5, top[i].max_depth, NULL),
+		    PRINT_I32("SRCS", 4, top[i].max_srcs, NULL),
+		    PRINT_F64("CB", 6, 1, SEC2USEC(top[i].cb_time) / n_passes,
+		    "us"),
+		    NULL);
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "====================\n"
-		    "==== GENERATORS ====\n"
-		    "====================\n");
+	print_table_footer();
+	free(top);
+}
+
+static void
+solver_cmd(void)
+{
+	char subcmd[32];
+
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		printf("%s\n", libelec_sys_get_solver(sys) ==
+		    ELEC_SOLVER_NODAL ? "nodal" : "paint");
+	} else if (lacf_strcasecmp(subcmd, "paint") == 0) {
+		libelec_sys_set_solver(sys, ELEC_SOLVER_PAINT);
+	} else if (lacf_strcasecmp(subcmd, "nodal") == 0) {
+		libelec_sys_set_solver(sys, ELEC_SOLVER_NODAL);
+	} else {
+		report_error("unknown solver \"%s\". Try typing \"help\".",
+		    subcmd);
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "gen") == 0) {
-		cmd_found = true;
-		printf(
-		    "gen [GEN_NAME]\n"
-		    "    Prints all generators on the network. If you provide "
-		    "an optional generator\n"
-		    "    name, only the data for the listed generator will be "
-		    "printed. Table columns:\n"
-		    "	RPM - the RPM value at which the generator is "
-		    "currently operating\n"
-		    "	W_in - input power demand from the generator on its "
-		    "mechanical input.\n"
-		    "	Eff - current generator efficiency in percent.\n"
-		    "	U_out - current generator output voltage.\n"
-		    "	I_out - current generator output current.\n"
-		    "	W_out - current generator output power load.\n"
-		    "gen <GEN_NAME> rpm <RPM>\n"
-		    "    Sets a new generator rpm value in the same units as "
-		    "what was used in the\n"
-		    "    electrical network definition.\n");
+}
+
+/*
+ * The synchronous stepper can't be used while the worker thread is
+ * running the network, so "run", "ff" and "bench" stop it for their
+ * duration.
+ * Returns true if the worker needs to be restarted afterwards.
+ */
+static bool
+sync_step_begin(void)
+{
+	if (!libelec_sys_is_started(sys))
+		return (false);
+	libelec_sys_stop(sys);
+	return (true);
+}
+
+static void
+sync_step_end(bool restart)
+{
+	if (restart)
+		VERIFY(libelec_sys_start(sys));
+}
+
+static bool
+parse_pos_num(const char *cmd, const char *what, const char *str,
+    double *num)
+{
+	ASSERT(cmd != NULL);
+	ASSERT(what != NULL);
+	ASSERT(num != NULL);
+
+	if (str == NULL || sscanf(str, "%lf", num) != 1 || !isfinite(*num) ||
+	    *num <= 0) {
+		report_error("%s argument to \"%s\" must be a positive "
+		    "number. Try typing \"help\".", what, cmd);
+		return (false);
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "==========================\n"
-		    "==== TRUS & INVERTERS ====\n"
-		    "==========================\n");
+	return (true);
+}
+
+static void
+run_cmd(void)
+{
+	char secs_str[32], dt_str[32];
+	double secs, d_t = libelec_sys_get_exec_intval(sys);
+	uint64_t n_steps, start, wall;
+	bool restart;
+
+	if (!get_next_word(secs_str, sizeof (secs_str))) {
+		report_error("missing argument to \"run\". "
+		    "Try typing \"help\".");
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "tru") == 0) {
-		cmd_found = true;
-		printf(
-		    "tru [TRU_NAME|INV_NAME]\n"
-		    "    Prints all TRUs and inverters on the network. If "
-		    "you provide an optional\n"
-		    "    TRU/inverter name, only the data for the listed "
-		    "TRU/inverter will be\n"
-		    "    printed. Table columns:\n"
-		    "	U_in - input voltage into the TRU/inverter in Volts\n"
-		    "	W_in - input power draw into the TRU/inverter in "
-		    "Watts\n"
-		    "	Eff - TRU/inverter power conversion efficiency in "
-		    "percent\n"
-		    "	U_out - output voltage out of the TRU/inverter in "
-		    "Volts\n"
-		    "	I_out - output current out of the TRU/inverter in "
-		    "Amps\n"
-		    "	W_out - output power out of the TRU/inverter in "
-		    "Watts\n");
+	if (!parse_pos_num("run", "seconds", secs_str, &secs))
+		return;
+	if (get_next_word(dt_str, sizeof (dt_str)) &&
+	    !parse_pos_num("run", "time step", dt_str, &d_t)) {
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "xfrmr") == 0) {
-		cmd_found = true;
-		printf(
-		    "xfrmr XFRMR_NAME\n"
-		    "    Prints all transfoemrs on the network. If you "
-		    "provide an optional\n"
-		    "    transformer name, only the data for the listed "
-		    "transfomer will be\n"
-		    "    printed. Table columns:\n"
-		    "	U_in - input voltage into the TRU/inverter in Volts\n"
-		    "	W_in - input power draw into the TRU/inverter in "
-		    "Watts\n"
-		    "	Eff - TRU/inverter power conversion efficiency in "
-		    "percent\n"
-		    "	U_out - output voltage out of the TRU/inverter in "
-		    "Volts\n"
-		    "	I_out - output current out of the TRU/inverter in "
-		    "Amps\n"
-		    "	W_out - output power out of the TRU/inverter in "
-		    "Watts\n");
+	n_steps = ceil(secs / d_t);
+
+	restart = sync_step_begin();
+	start = microclock();
+	for (uint64_t i = 0; i < n_steps; i++)
+		libelec_sys_step(sys, d_t);
+	wall = microclock() - start;
+	sync_step_end(restart);
+
+	print_table_header("SIM", 8, "DT", 6, "STEPS", 8, "WALL", 8,
+	    "SPEED", 9, NULL);
+	print_table_row(stdout,
+	    PRINT_F64("SIM", 8, 2, n_steps * d_t, "s"),
+	    PRINT_F64("DT", 6, 3, d_t, "s"),
+	    PRINT_I32("STEPS", 8, (int)n_steps, NULL),
+	    PRINT_F64("WALL", 8, 3, USEC2SEC(wall), "s"),
+	    PRINT_F64("SPEED", 9, 1, (n_steps * d_t) /
+	    MAX(USEC2SEC(wall), 1e-6), "x"),
+	    NULL);
+	print_table_footer();
+}
+
+static void
+ff_cmd(void)
+{
+	static const char *stop_names[] = {
+	    [ELEC_FF_DONE] = "done", [ELEC_FF_SWITCHED] = "switched",
+	    [ELEC_FF_WATCH] = "watch"
+	};
+	char secs_str[32];
+	double secs, done;
+	elec_ff_stop_t stop;
+	uint64_t start, wall;
+	bool restart;
+
+	if (!get_next_word(secs_str, sizeof (secs_str))) {
+		report_error("missing argument to \"ff\". "
+		    "Try typing \"help\".");
+		return;
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "===============\n"
-		    "==== LOADS ====\n"
-		    "===============\n");
+	if (!parse_pos_num("ff", "seconds", secs_str, &secs))
+		return;
+
+	restart = sync_step_begin();
+	start = microclock();
+	done = libelec_sys_fast_forward(sys, secs, &stop);
+	wall = microclock() - start;
+	sync_step_end(restart);
+
+	print_table_header("SIM", 10, "WALL", 8, "SPEED", 11, "STOP", 8,
+	    NULL);
+	print_table_row(stdout,
+	    PRINT_F64("SIM", 10, 2, done, "s"),
+	    PRINT_F64("WALL", 8, 3, USEC2SEC(wall), "s"),
+	    PRINT_F64("SPEED", 11, 1, done / MAX(USEC2SEC(wall), 1e-6),
+	    "x"),
+	    PRINT_STR("STOP", 8, stop_names[stop]),
+	    NULL);
+	print_table_footer();
+}
+
+static void
+bench_cmd(void)
+{
+	char ticks_str[32];
+	double ticks, d_t = libelec_sys_get_exec_intval(sys);
+	uint64_t total = 0, min_us = UINT64_MAX, max_us = 0;
+	bool restart;
+
+	if (!get_next_word(ticks_str, sizeof (ticks_str))) {
+		report_error("missing argument to \"bench\". "
+		    "Try typing \"help\".");
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "load") == 0) {
-		cmd_found = true;
-		printf(
-		    "load [LOAD_NAME]\n"
-		    "    Print all loads. If you provide an optional load "
-		    "name, only the data for\n"
-		    "    the listed load will be printed. "
-		    "Table columns:\n"
-		    "	U_out - output voltage out of the load's power supply\n"
-		    "	I_out - output current out of the load's power supply\n"
-		    "	W_out - output power out of the load's power supply\n"
-		    "	U_c_in - voltage of the power supply's virtual input "
-		    "capacitance\n"
-		    "	I_in - input current into the load's power supply\n"
-		    "load <LOAD_NAME> set <AMPS|WATTS>\n"
-		    "    Configures a constant load for an ELEC_LOAD device. "
-		    "Whether the load expects\n"
-		    "    a specification in Amps or Watts depends on whether "
-		    "the device is declared\n"
-		    "    as having a stabilized input power supply or not in "
-		    "the network definition\n"
-		    "    (STAB line).\n"
-		    "    N.B. the load argument must NOT be negative.\n");
+	if (!parse_pos_num("bench", "tick count", ticks_str, &ticks))
+		return;
+	ticks = ceil(ticks);
+
+	restart = sync_step_begin();
+	for (uint64_t i = 0; i < ticks; i++) {
+		uint64_t start = microclock(), dur;
+
+		libelec_sys_step(sys, d_t);
+		dur = microclock() - start;
+		total += dur;
+		min_us = MIN(min_us, dur);
+		max_us = MAX(max_us, dur);
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "==========================\n"
-		    "==== CIRCUIT BREAKERS ====\n"
-		    "==========================\n");
-	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "cb") == 0) {
-		cmd_found = true;
-		printf(
-		    "cb [CB_NAME]\n"
-		    "    Print the state of all circuit breakers. If you "
-		    "provide an optional\n"
-		    "    breaker name, only the data for the listed breaker "
-		    "will be printed.\n"
-		    "cb <CB_NAME> set <Y|N|1|0>\n"
-		    "    Sets/resets a circuit breaker. A breaker that's set "
-		    "('1' or 'Y')\n"
-		    "    allows current flow, while a reset breaker "
-		    "('0' or 'N') does not.\n");
+	sync_step_end(restart);
+
+	print_table_header("TICKS", 8, "TOTAL", 10, "MEAN", 10, "MIN", 10,
+	    "MAX", 10, NULL);
+	print_table_row(stdout,
+	    PRINT_I32("TICKS", 8, (int)ticks, NULL),
+	    PRINT_F64("TOTAL", 10, 3, total / 1000.0, "ms"),
+	    PRINT_F64("MEAN", 10, 1, total / ticks, "us"),
+	    PRINT_F64("MIN", 10, 0, (double)min_us, "us"),
+	    PRINT_F64("MAX", 10, 0, (double)max_us, "us"),
+	    NULL);
+	print_table_footer();
+}
+
+/* Upper bound of elec_lat_t hist bucket `i' in seconds */
+#define	LAT_BUCKET_MAX(i)	(1e-4 * pow(2, (i) / 3.0))
+
+/*
+ * Estimates a percentile of a latency distribution from its histogram,
+ * as the upper bound of the bucket it falls into (or the largest
+ * sample, if that is smaller).
+ */
+static double
+lat_percentile(const elec_lat_t *lat, double pct)
+{
+	uint64_t rank = ceil(lat->timing.n * pct / 100), n = 0;
+
+	for (unsigned i = 0; i + 1 < ELEC_NUM_LAT_BUCKETS; i++) {
+		n += lat->hist[i];
+		if (n >= rank)
+			return (MIN(LAT_BUCKET_MAX(i), lat->timing.max));
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "==============\n"
-		    "==== TIES ====\n"
-		    "==============\n");
+	return (lat->timing.max);
+}
+
+static void
+print_lat_row(const char *stage, const elec_lat_t *lat)
+{
+	if (lat->timing.n == 0)
+		return;
+	print_table_row(stdout,
+	    PRINT_STR("STAGE", -8, stage),
+	    PRINT_I32("N", 6, (int)lat->timing.n, NULL),
+	    PRINT_F64("MIN", 8, 2, lat->timing.min * 1000, "ms"),
+	    PRINT_F64("AVG", 8, 2, lat->timing.avg * 1000, "ms"),
+	    PRINT_F64("P50", 8, 2, lat_percentile(lat, 50) * 1000, "ms"),
+	    PRINT_F64("P90", 8, 2, lat_percentile(lat, 90) * 1000, "ms"),
+	    PRINT_F64("P99", 8, 2, lat_percentile(lat, 99) * 1000, "ms"),
+	    PRINT_F64("MAX", 8, 2, lat->timing.max * 1000, "ms"),
+	    NULL);
+}
+
+/*
+ * Prints the latencies measured by the latency probe. `visible' holds
+ * the latencies measured by "lat inject", or is NULL.
+ */
+static void
+print_lat(const elec_lat_t *visible)
+{
+	elec_lat_stats_t stats;
+
+	libelec_sys_get_lat_stats(sys, &stats);
+	print_table_header("STAGE", -8, "N", 6, "MIN", 8, "AVG", 8,
+	    "P50", 8, "P90", 8, "P99", 8, "MAX", 8, NULL);
+	print_lat_row("pickup", &stats.pickup);
+	print_lat_row("publish", &stats.publish);
+	print_lat_row("send", &stats.send);
+	print_lat_row("recv", &stats.recv);
+	if (visible != NULL)
+		print_lat_row("visible", visible);
+	print_table_footer();
+}
+
+/*
+ * Implements "lat inject": flips the breaker `comp' `count' times at
+ * random points of the worker cycle, each time timing how long it
+ * takes for the getters to show the breaker's output following it.
+ */
+static void
+lat_inject(elec_comp_t *comp, unsigned count)
+{
+	uint64_t intval_us = SEC2USEC(libelec_sys_get_exec_intval(sys));
+	bool orig_set = libelec_cb_get(comp);
+	elec_lat_t visible = {};
+	unsigned lost = 0;
+
+	libelec_sys_set_lat_probe(sys, false);
+	libelec_sys_set_lat_probe(sys, true);
+	for (unsigned i = 0; i < count; i++) {
+		bool set = !libelec_cb_get(comp);
+		uint64_t t0, t;
+		double lat;
+		int bucket = 0;
+
+		usleep(crc64_rand() % (2 * intval_us + 1));
+		t0 = microclock();
+		libelec_cb_set(comp, set);
+		while (((libelec_comp_get_out_volts(comp) > 0) != set) &&
+		    (t = microclock()) - t0 < SEC2USEC(1))
+			usleep(100);
+		t = microclock();
+		if (t - t0 >= SEC2USEC(1)) {
+			lost++;
+			continue;
+		}
+		lat = USEC2SEC(t - t0);
+		if (visible.timing.n == 0) {
+			visible.timing.min = lat;
+			visible.timing.max = lat;
+		}
+		visible.timing.min = MIN(visible.timing.min, lat);
+		visible.timing.max = MAX(visible.timing.max, lat);
+		visible.timing.avg = (visible.timing.avg * visible.timing.n +
+		    lat) / (visible.timing.n + 1);
+		visible.timing.last = lat;
+		visible.timing.n++;
+		if (lat >= 1e-4)
+			bucket = floor(3 * log2(lat / 1e-4)) + 1;
+		visible.hist[MIN(bucket, ELEC_NUM_LAT_BUCKETS - 1)]++;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "tie") == 0) {
-		cmd_found = true;
-		printf(
-		    "tie [TIE_NAME]\n"
-		    "    Prints a list of all ties and their state. The "
-		    "table lists each tie,\n"
-		    "    and a list of buses currently tied into it. If you "
-		    "provide an optional\n"
-		    "    tie name, only the data for the listed tie will be "
-		    "printed.\n"
-		    "tie <TIE_NAME> <all|none|BUS1 BUS2 ...>\n"
-		    "    Configures a tie. The remaining arguments must "
-		    "be a list of buses to\n"
-		    "    which the tie connects. Any buses not mentioned "
-		    "will become untied.\n"
-		    "    You can also use the symbolic keywords \"none\" and "
-		    "\"all\" to untie and\n"
-		    "    tie all buses connected to the tie, "
-		    "respectively.\n");
+	libelec_cb_set(comp, orig_set);
+	print_lat(&visible);
+	if (lost != 0) {
+		report_error("%u of %u changes didn't show up within 1 second",
+		    lost, count);
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "===================\n"
-		    "==== BATTERIES ====\n"
-		    "===================\n");
+}
+
+static void
+lat_cmd(void)
+{
+	char subcmd[32], cb_name[64], count_str[32];
+	elec_comp_t *comp;
+	unsigned count = 100;
+
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		if (!libelec_sys_get_lat_probe(sys)) {
+			report_error("latency probe is off, enable it using "
+			    "\"lat on\"");
+			return;
+		}
+		print_lat(NULL);
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "batt") == 0) {
-		cmd_found = true;
-		printf(
-		    "batt [BATT_NAME]\n"
-		    "    Print the state of all batteries. If you provide "
-		    "an optional battery name,\n"
-		    "    only the data for the listed battery will be printed. "
-		    "Table columns:\n"
-		    "	U_out - output voltage in Volts\n"
-		    "	I_out - discharge current in Amps\n"
-		    "	I_in - recharge current in Amps\n"
-		    "	CHG - relative state of charge in percent\n"
-		    "	TEMP - temperature in degrees Celsius\n"
-		    "batt <BATT_NAME> chg <0..100>\n"
-		    "    Sets a new relative charge state of the battery "
-		    "in percent.\n"
-		    "batt <BATT_NAME> temp <TEMP\u00B0C>\n"
-		    "    Sets a new battery temperature in degrees Celsius.\n");
+	if (lacf_strcasecmp(subcmd, "on") == 0) {
+		libelec_sys_set_lat_probe(sys, true);
+		return;
+	} else if (lacf_strcasecmp(subcmd, "off") == 0) {
+		libelec_sys_set_lat_probe(sys, false);
+		return;
+	} else if (lacf_strcasecmp(subcmd, "reset") == 0) {
+		libelec_sys_reset_lat_stats(sys);
+		return;
+	} else if (lacf_strcasecmp(subcmd, "inject") != 0) {
+		report_error("unknown lat subcommand \"%s\". "
+		    "Try typing \"help\".", subcmd);
+		return;
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "=======================\n"
-		    "==== IMAGE DRAWING ====\n"
-		    "=======================\n");
+	if (!get_next_word(cb_name, sizeof (cb_name))) {
+		report_error("missing argument to \"inject\" subcommand. "
+		    "Try typing \"help\".");
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "draw") == 0) {
-		cmd_found = true;
-		printf(
-		    "draw [filename.png] [COMP_NAME]\n"
-		    "    Draw a rendered image of the network. Your network "
-		    "must use \"GUI_*\"\n"
-		    "    stanzas in its network definition to control how the "
-		    "render is to be done.\n"
-		    "    This is useful for quickly iterating on the network "
-		    "render, instead of\n"
-		    "    having to wait for an aircraft reload in the "
-		    "simulator. The rendering\n"
-		    "    offset, scale factor, font size and image size can "
-		    "be changed using the\n"
-		    "    subcommands below.\n"
-		    "    N.B. the filename argument is optional only after "
-		    "the first successful\n"
-		    "    invocation of this command. This defines which file "
-		    "nettest is supposed\n"
-		    "    to write into. Subsequent invocations of the \"draw\" "
-		    "command without\n"
-		    "    arguments simply overwrite this file with a new "
-		    "image when it becomes\n"
-		    "    available. If you specify a component following "
-		    "the filename, that\n"
-		    "    component is drawn with its details box overlaid on "
-		    "top of it, as if\n"
-		    "    the user had clicked on it in the interactive network "
-		    "visualizer.\n"
-		    "draw offset <pixels_x> <pixels_y>\n"
-		    "    Sets the network drawing offset in pixels. The "
-		    "default offset is zero\n"
-		    "    for both X and Y.\n"
-		    "draw scale <scale>\n"
-		    "    Sets the rendering scale for network drawing. The "
-		    "default rendering scale\n"
-		    "    is 16.\n"
-		    "draw fontsz <size>\n"
-		    "    Sets the font size for network drawing. The default "
-		    "font size is 14 points.\n"
-		    "draw imgsz <pixels_x> <pixels_y>\n"
-		    "    Sets the image size for network drawing. The default "
-		    "image size is\n"
-		    "    2048x2048 pixels.\n");
+	comp = libelec_comp_find(sys, cb_name);
+	if (comp == NULL || libelec_comp2info(comp)->type != ELEC_CB) {
+		report_error("unknown CB %s", cb_name);
+		return;
 	}
-	if (cmd == NULL) {
-		printf("\n"
-		    "=========================\n"
-		    "==== PROGRAM CONTROL ====\n"
-		    "=========================\n");
+	if (get_next_word(count_str, sizeof (count_str)) &&
+	    (sscanf(count_str, "%u", &count) != 1 || count == 0)) {
+		report_error("count argument to \"inject\" subcommand must "
+		    "be a positive number. Try typing \"help\".");
+		return;
 	}
-	if (cmd == NULL || lacf_strcasecmp(cmd, "quit") == 0) {
-		cmd_found = true;
-		printf(
-		    "quit\n"
-		    "    Quits nettest.\n");
+	if (!libelec_sys_is_started(sys)) {
+		report_error("\"lat inject\" needs the network running in "
+		    "real time");
+		return;
 	}
-	if (cmd != NULL && !cmd_found) {
-		report_error("unknown command \"%s\". "
-		    "Try typing \"help\".", cmd);
+	if (libelec_comp_get_in_volts(comp) <= 0) {
+		report_error("CB %s isn't powered, so flipping it has no "
+		    "visible effect", cb_name);
+		return;
 	}
+	lat_inject(comp, count);
 }
 
-#ifdef	WITH_READLINE
+#ifdef	LIBELEC_WITH_NETLINK
 
-enum { MAX_SUBCMD_PARTS = 12 };
+/* Remote reports are sent every second, see NET_STATS_INTVAL_US */
+#define	NETSTATS_POLL_US	100000
 
-#define	COMP_TYPE_ANY_MASK \
-	((1 << ELEC_BATT) | (1 << ELEC_GEN) | (1 << ELEC_TRU) | \
-	(1 << ELEC_INV) | (1 << ELEC_LOAD) | (1 << ELEC_BUS) | \
-	(1 << ELEC_CB) | (1 << ELEC_SHUNT) | (1 << ELEC_TIE) | \
-	(1 << ELEC_DIODE))
+static void
+print_timing_row(const char *name, const elec_timing_t *timing)
+{
+	if (timing->n == 0)
+		return;
+	print_table_row(stdout,
+	    PRINT_STR("TIMING", -10, name),
+	    PRINT_I32("N", 8, (int)timing->n, NULL),
+	    PRINT_F64("LAST", 8, 3, timing->last * 1000, "ms"),
+	    PRINT_F64("AVG", 8, 3, timing->avg * 1000, "ms"),
+	    PRINT_F64("MIN", 8, 3, timing->min * 1000, "ms"),
+	    PRINT_F64("MAX", 8, 3, timing->max * 1000, "ms"),
+	    NULL);
+}
 
-typedef enum {
-    CMD_PART_NONE = 0,
-    CMD_PART_KEYWORD,
-    CMD_PART_COMP_NAME,
-    CMD_PART_FILE_NAME
-} cmd_part_type_t;
+/*
+ * Prints a complete performance report received from the sender.
+ */
+static void
+print_netstats(const elec_net_stats_t *ns)
+{
+	static const char *phase_names[ELEC_NUM_PHASES] = {
+	    [ELEC_PHASE_RESET] = "reset",
+	    [ELEC_PHASE_SRCS_UPDATE] = "srcs",
+	    [ELEC_PHASE_LOADS_RANDOMIZE] = "randomize",
+	    [ELEC_PHASE_INCR] = "incr",
+	    [ELEC_PHASE_PAINT] = "paint",
+	    [ELEC_PHASE_LOAD_INTEGRATE] = "integrate",
+	    [ELEC_PHASE_LOADS_UPDATE] = "loads",
+	    [ELEC_PHASE_TIES_UPDATE] = "ties",
+	    [ELEC_PHASE_STATE_XFER] = "xfer"
+	};
+	static const char *jitter_names[ELEC_NUM_JITTER_BUCKETS] = {
+	    "<0.5ms", "<1ms", "<2ms", "<5ms", "<10ms", "<20ms", "<50ms",
+	    ">=50ms"
+	};
+	const elec_stats_t *st = &ns->stats;
 
-typedef struct cmd_part_s {
-	cmd_part_type_t		type;
-	const char		*keyword;
-	uint32_t		comp_type_mask;
-	bool			variadic;
-	bool			attached;
-	bool			autogen;
-	unsigned		comp_name_word_idx;
-	const struct cmd_part_s	*subparts[MAX_SUBCMD_PARTS];
-} cmd_part_t;
+	print_table_header("PASSES", 10, "OVERRUNS", 8, "DEGRADED", 8,
+	    "MAX_OVR", 8, "CLIENTS", 7, "GROUPS", 6, "SENT", 10,
+	    "FRAMES", 10, "AGE", 6, NULL);
+	print_table_row(stdout,
+	    PRINT_I32("PASSES", 10, (int)st->n_passes, NULL),
+	    PRINT_I32("OVERRUNS", 8, (int)ns->overruns.n_overruns, NULL),
+	    PRINT_I32("DEGRADED", 8, (int)ns->overruns.n_degraded, NULL),
+	    PRINT_F64("MAX_OVR", 8, 2, ns->overruns.max_overrun * 1000, "ms"),
+	    PRINT_I32("CLIENTS", 7, ns->n_clients, NULL),
+	    PRINT_I32("GROUPS", 6, ns->n_groups, NULL),
+	    PRINT_F64("SENT", 10, 1, ns->bytes_sent / 1024.0, "kB"),
+	    PRINT_I32("FRAMES", 10, (int)ns->frames_sent, NULL),
+	    PRINT_F64("AGE", 6, 1, USEC2SEC(microclock() - ns->recv_time_us),
+	    "s"),
+	    NULL);
+	print_table_footer();
 
-static const cmd_part_t *cmd_parts_top[] = {
-    &(cmd_part_t){
-	.type = CMD_PART_KEYWORD,
-	.keyword = "bus",
-	.subparts = {
+	print_table_header("TIMING", -10, "N", 8, "LAST", 8, "AVG", 8,
+	    "MIN", 8, "MAX", 8, NULL);
+	print_timing_row("pass", &st->pass);
+	print_timing_row("interlock", &st->interlock);
+	print_timing_row("jitter", &st->jitter);
+	print_timing_row("wake_err", &st->wake_err);
+	for (int i = 0; i < ELEC_NUM_PHASES; i++)
+		print_timing_row(phase_names[i], &st->phases[i]);
+	print_timing_row("pre_cbs", &st->pre_user_cbs);
+	print_timing_row("post_cbs", &st->post_user_cbs);
+	print_timing_row("load_cbs", &st->load_cbs);
+	print_timing_row("rpm_cbs", &st->rpm_cbs);
+	print_timing_row("temp_cbs", &st->temp_cbs);
+	print_table_footer();
+
+	print_table_header("JITTER", -8, "COUNT", 10, NULL);
+	for (int i = 0; i < ELEC_NUM_JITTER_BUCKETS; i++) {
+		print_table_row(stdout,
+		    PRINT_STR("JITTER", -8, jitter_names[i]),
+		    PRINT_I32("COUNT", 10, (int)st->jitter_hist[i], NULL),
+		    NULL);
+	}
+	print_table_footer();
+}
+
+/*
+ * Implements "netstats watch": prints a summary line for every report
+ * arriving from the sender within `secs' seconds.
+ */
+static void
+netstats_watch(double secs)
+{
+	elec_net_stats_t prev = {}, ns;
+	bool have_prev;
+	uint64_t t_end = microclock() + SEC2USEC(secs);
+
+	have_prev = libelec_net_recv_get_remote_stats(sys, &prev);
+	print_table_header("PASSES", 10, "PASS", 8, "MAX", 8, "INTLCK", 8,
+	    "JITTER", 8, "OVERRUNS", 8, "CLIENTS", 7, "RATE", 10, NULL);
+	while (microclock() < t_end) {
+		double rate = 0;
+
+		usleep(NETSTATS_POLL_US);
+		if (!libelec_net_recv_get_remote_stats(sys, &ns) ||
+		    (have_prev && ns.recv_time_us == prev.recv_time_us))
+			continue;
+		if (have_prev && ns.time_us > prev.time_us &&
+		    ns.bytes_sent >= prev.bytes_sent) {
+			rate = (ns.bytes_sent - prev.bytes_sent) / 1024.0 /
+			    USEC2SEC(ns.time_us - prev.time_us);
+		}
+		print_table_row(stdout,
+		    PRINT_I32("PASSES", 10, (int)ns.stats.n_passes, NULL),
+		    PRINT_F64("PASS", 8, 3, ns.stats.pass.avg * 1000, "ms"),
+		    PRINT_F64("MAX", 8, 3, ns.stats.pass.max * 1000, "ms"),
+		    PRINT_F64("INTLCK", 8, 3, ns.stats.interlock.avg * 1000,
+		    "ms"),
+		    PRINT_F64("JITTER", 8, 3, ns.stats.jitter.avg * 1000, "ms"),
+		    PRINT_I32("OVERRUNS", 8, (int)ns.overruns.n_overruns,
+		    NULL),
+		    PRINT_I32("CLIENTS", 7, ns.n_clients, NULL),
+		    PRINT_F64("RATE", 10, 1, rate, "kB/s"),
+		    NULL);
+		fflush(stdout);
+		prev = ns;
+		have_prev = true;
+	}
+	print_table_footer();
+}
+
+static void
+netstats_cmd(void)
+{
+	char subcmd[32], secs_str[32];
+	elec_net_stats_t ns;
+	double secs;
+
+	if (!net_recv) {
+		report_error("\"netstats\" is only available with -r");
+		return;
+	}
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		if (!libelec_net_recv_get_remote_stats(sys, &ns)) {
+			report_error("no report received yet, subscribe to "
+			    "them using \"netstats on\"");
+			return;
+		}
+		print_netstats(&ns);
+		return;
+	}
+	if (lacf_strcasecmp(subcmd, "on") == 0) {
+		libelec_net_recv_set_remote_stats(sys, true);
+		return;
+	} else if (lacf_strcasecmp(subcmd, "off") == 0) {
+		libelec_net_recv_set_remote_stats(sys, false);
+		return;
+	} else if (lacf_strcasecmp(subcmd, "watch") != 0) {
+		report_error("unknown netstats subcommand \"%s\". "
+		    "Try typing \"help\".", subcmd);
+		return;
+	}
+	if (!get_next_word(secs_str, sizeof (secs_str))) {
+		report_error("missing argument to \"watch\" subcommand. "
+		    "Try typing \"help\".");
+		return;
+	}
+	if (!parse_pos_num("netstats watch", "duration", secs_str, &secs))
+		return;
+	libelec_net_recv_set_remote_stats(sys, true);
+	netstats_watch(secs);
+}
+
+#endif	/* defined(LIBELEC_WITH_NETLINK) */
+
+static void
+profile_cmd(void)
+{
+	char subcmd[32], filename[512], t_str[32];
+	elec_load_profile_t *prof;
+	double t = 0;
+
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		if (load_prof == NULL) {
+			report_error("no load profile is being played back");
+			return;
+		}
+		print_table_header("TIME", 10, "DURATION", 10, NULL);
+		print_table_row(stdout,
+		    PRINT_F64("TIME", 10, 1,
+		    libelec_sys_get_load_profile_time(sys), "s"),
+		    PRINT_F64("DURATION", 10, 1,
+		    libelec_load_profile_get_duration(load_prof), "s"),
+		    NULL);
+		print_table_footer();
+	} else if (lacf_strcasecmp(subcmd, "play") == 0) {
+		if (!get_next_word(filename, sizeof (filename))) {
+			report_error("missing filename argument to \"play\" "
+			    "subcommand. Try typing \"help\".");
+			return;
+		}
+		if (get_next_word(t_str, sizeof (t_str)) &&
+		    (sscanf(t_str, "%lf", &t) != 1 || !isfinite(t))) {
+			report_error("start time argument to \"play\" "
+			    "subcommand must be a number. Try typing "
+			    "\"help\".");
+			return;
+		}
+		prof = libelec_load_profile_load(filename);
+		if (prof == NULL)
+			return;
+		if (!libelec_sys_set_load_profile(sys, prof, t)) {
+			libelec_load_profile_destroy(prof);
+			return;
+		}
+		libelec_load_profile_destroy(load_prof);
+		load_prof = prof;
+	} else if (lacf_strcasecmp(subcmd, "stop") == 0) {
+		VERIFY(libelec_sys_set_load_profile(sys, NULL, 0));
+		libelec_load_profile_destroy(load_prof);
+		load_prof = NULL;
+	} else if (lacf_strcasecmp(subcmd, "write") == 0) {
+		if (!get_next_word(filename, sizeof (filename))) {
+			report_error("missing filename argument to \"write\" "
+			    "subcommand. Try typing \"help\".");
+			return;
+		}
+		if (load_prof == NULL) {
+			report_error("no load profile is being played back");
+			return;
+		}
+		(void)libelec_load_profile_write(load_prof, filename);
+	} else {
+		report_error("unknown profile subcommand \"%s\". "
+		    "Try typing \"help\".", subcmd);
+	}
+}
+
+/*
+ * Prints the contents of a binary telemetry log written by the
+ * libelec_rec_start() recorder. If `comp_name' isn't NULL, only the
+ * values of that component are printed.
+ */
+static void
+rec_dump(const char *filename, const char *comp_name)
+{
+	elec_rec_hdr_t hdr;
+	char *names = NULL;
+	const char **comp_names = NULL;
+	float *vals = NULL;
+	double t;
+	FILE *fp;
+
+	ASSERT(filename != NULL);
+
+	fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		report_error("can't open %s: %s", filename, strerror(errno));
+		return;
+	}
+	if (fread(&hdr, sizeof (hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, ELEC_REC_MAGIC, sizeof (hdr.magic)) != 0 ||
+	    hdr.version != ELEC_REC_VERSION ||
+	    hdr.n_quants != ELEC_REC_NUM_QUANTS) {
+		report_error("%s is not a libelec binary telemetry log",
+		    filename);
+		goto out;
+	}
+	names = safe_calloc(hdr.names_len + 1, 1);
+	comp_names = safe_calloc(MAX(hdr.n_comps, 1), sizeof (*comp_names));
+	if (fread(names, 1, hdr.names_len, fp) != hdr.names_len) {
+		report_error("%s: log header is truncated", filename);
+		goto out;
+	}
+	for (uint32_t i = 0, off = 0; i < hdr.n_comps; i++) {
+		if (off >= hdr.names_len) {
+			report_error("%s: log header is malformed", filename);
+			goto out;
+		}
+		comp_names[i] = &names[off];
+		off += strlen(&names[off]) + 1;
+	}
+	vals = safe_calloc(MAX(hdr.n_comps * hdr.n_quants, 1),
+	    sizeof (*vals));
+	print_table_header("T", 9, "NAME", -30, "U_in", 6, "U_out", 6,
+	    "I_in", 6, "I_out", 6, "f_in", 6, "f_out", 6, "AUX", 5, NULL);
+	while (fread(&t, sizeof (t), 1, fp) == 1 &&
+	    fread(vals, sizeof (*vals), hdr.n_comps * hdr.n_quants, fp) ==
+	    hdr.n_comps * hdr.n_quants) {
+		for (uint32_t i = 0; i < hdr.n_comps; i++) {
+			const float *v = &vals[i * hdr.n_quants];
+
+			if (comp_name != NULL &&
+			    strcmp(comp_names[i], comp_name) != 0) {
+				continue;
+			}
+			print_table_row(stdout,
+			    PRINT_F64("T", 8, 3, t, "s"),
+			    PRINT_STR("NAME", -30, comp_names[i]),
+			    PRINT_VOLTS("U_in", v[ELEC_REC_IN_VOLTS]),
+			    PRINT_VOLTS("U_out", v[ELEC_REC_OUT_VOLTS]),
+			    PRINT_AMPS("I_in", v[ELEC_REC_IN_AMPS]),
+			    PRINT_AMPS("I_out", v[ELEC_REC_OUT_AMPS]),
+			    PRINT_F64("f_in", 5, 1, v[ELEC_REC_IN_FREQ],
+			    "Hz"),
+			    PRINT_F64("f_out", 5, 1, v[ELEC_REC_OUT_FREQ],
+			    "Hz"),
+			    PRINT_F64("AUX", 5, 3, v[ELEC_REC_AUX], NULL),
+			    NULL);
+		}
+	}
+	print_table_footer();
+out:
+	free(vals);
+	free(comp_names);
+	free(names);
+	fclose(fp);
+}
+
+static void
+rec_cmd(void)
+{
+	static size_t rotate_bytes = 0;
+	char subcmd[32], filename[256], comp_name[128];
+
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		size_t n_recs, n_dropped;
+
+		libelec_rec_get_stats(sys, &n_recs, &n_dropped);
+		printf("%s, %lu records written, %lu dropped\n",
+		    libelec_rec_is_active(sys) ? "recording" : "stopped",
+		    (unsigned long)n_recs, (unsigned long)n_dropped);
+	} else if (lacf_strcasecmp(subcmd, "bin") == 0 ||
+	    lacf_strcasecmp(subcmd, "csv") == 0) {
+		elec_comp_t **comps = NULL;
+		size_t n_comps = 0;
+
+		if (!get_next_word(filename, sizeof (filename))) {
+			report_error("missing filename argument. "
+			    "Try typing \"help\".");
+			return;
+		}
+		while (get_next_word(comp_name, sizeof (comp_name))) {
+			elec_comp_t *comp = libelec_comp_find(sys, comp_name);
+
+			if (comp == NULL) {
+				report_error("unknown component %s",
+				    comp_name);
+				free(comps);
+				return;
+			}
+			comps = safe_realloc(comps, (n_comps + 1) *
+			    sizeof (*comps));
+			comps[n_comps++] = comp;
+		}
+		if (n_comps == 0) {
+			report_error("missing component name argument(s). "
+			    "Try typing \"help\".");
+			return;
+		}
+		libelec_rec_stop(sys);
+		if (!libelec_rec_start(sys, filename,
+		    lacf_strcasecmp(subcmd, "csv") == 0 ? ELEC_REC_CSV :
+		    ELEC_REC_BINARY, comps, n_comps, rotate_bytes)) {
+			report_error("can't start recording to %s",
+			    filename);
+		}
+		free(comps);
+	} else if (lacf_strcasecmp(subcmd, "stop") == 0) {
+		libelec_rec_stop(sys);
+	} else if (lacf_strcasecmp(subcmd, "rotate") == 0) {
+		char size_str[32];
+		unsigned long kb;
+
+		if (!get_next_word(size_str, sizeof (size_str)) ||
+		    sscanf(size_str, "%lu", &kb) != 1) {
+			report_error("missing or invalid size argument to "
+			    "\"rotate\" subcommand. Try typing \"help\".");
+			return;
+		}
+		rotate_bytes = kb * 1024;
+	} else if (lacf_strcasecmp(subcmd, "dump") == 0) {
+		if (!get_next_word(filename, sizeof (filename))) {
+			report_error("missing filename argument. "
+			    "Try typing \"help\".");
+			return;
+		}
+		if (get_next_word(comp_name, sizeof (comp_name)))
+			rec_dump(filename, comp_name);
+		else
+			rec_dump(filename, NULL);
+	} else {
+		report_error("unknown rec subcommand \"%s\". "
+		    "Try typing \"help\".", subcmd);
+	}
+}
+
+static void
+capture_cmd(void)
+{
+	char subcmd[32], filename[256];
+
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		size_t n_passes, n_bytes;
+
+		libelec_capture_get_stats(sys, &n_passes, &n_bytes);
+		printf("%s, %lu passes captured, %lu bytes written\n",
+		    libelec_capture_is_active(sys) ? "capturing" : "stopped",
+		    (unsigned long)n_passes, (unsigned long)n_bytes);
+	} else if (lacf_strcasecmp(subcmd, "start") == 0) {
+		if (!get_next_word(filename, sizeof (filename))) {
+			report_error("missing filename argument. "
+			    "Try typing \"help\".");
+			return;
+		}
+		libelec_capture_stop(sys);
+		if (!libelec_capture_start(sys, filename))
+			report_error("can't start capturing to %s", filename);
+	} else if (lacf_strcasecmp(subcmd, "stop") == 0) {
+		libelec_capture_stop(sys);
+	} else {
+		report_error("unknown capture subcommand \"%s\". "
+		    "Try typing \"help\".", subcmd);
+	}
+}
+
+static void
+preset_cmd(void)
+{
+	char subcmd[32], arg[256];
+	size_t n_presets;
+
+	if (!get_next_word(subcmd, sizeof (subcmd))) {
+		report_error("missing preset subcommand. "
+		    "Try typing \"help\".");
+		return;
+	}
+	if (!get_next_word(arg, sizeof (arg))) {
+		report_error("missing %s argument. Try typing \"help\".",
+		    (lacf_strcasecmp(subcmd, "write") == 0 ||
+		    lacf_strcasecmp(subcmd, "read") == 0) ? "filename" :
+		    "preset name");
+		return;
+	}
+	if (lacf_strcasecmp(subcmd, "save") == 0) {
+		libelec_sys_save_preset(sys, arg);
+	} else if (lacf_strcasecmp(subcmd, "apply") == 0) {
+		if (!libelec_sys_apply_preset(sys, arg))
+			report_error("no preset named \"%s\"", arg);
+	} else if (lacf_strcasecmp(subcmd, "rm") == 0) {
+		if (!libelec_sys_remove_preset(sys, arg))
+			report_error("no preset named \"%s\"", arg);
+	} else if (lacf_strcasecmp(subcmd, "write") == 0) {
+		if (!libelec_sys_write_presets(sys, arg))
+			report_error("can't write presets to %s", arg);
+	} else if (lacf_strcasecmp(subcmd, "read") == 0) {
+		if (libelec_sys_read_presets(sys, arg, &n_presets))
+			printf("%lu presets read\n", (unsigned long)n_presets);
+		else
+			report_error("can't read presets from %s", arg);
+	} else {
+		report_error("unknown preset subcommand \"%s\". "
+		    "Try typing \"help\".", subcmd);
+	}
+}
+
+static void
+print_help(const char *cmd)
+{
+	bool cmd_found = false;
+
+	/* cmd can be NULL */
+	if (cmd == NULL) {
+		printf(
+		    "nettest expects that you type interactive commands after "
+		    "the '>' prompt.\n"
+		    "Commands use the following general syntax:\n"
+		    "\n"
+		    "	COMMAND [optional_argument(s)...]\n"
+		    "	COMMAND <mandatory_argument> SUBCOMMAND "
+		    "[optional_argument(s)...]\n"
+		    "\n"
+		    "If an argument uses angle brackets (\"<something>\"), you "
+		    "MUST provide a value\n"
+		    "for the argument. If the argument uses square brackets "
+		    "instead (\"[something]\"),\n"
+		    "the argument is optional and may be omitted.\n"
+		    "Most commands have a plain version without any arguments. "
+		    "Those commands will\n"
+		    "print out the state of all the instances of a given "
+		    "component type as a table.\n"
+		    "In place of a component name, those commands also "
+		    "accept a name prefix ending\n"
+		    "in '*' (e.g. \"load FWD_*\"), which prints all the "
+		    "matching components.\n");
+#ifdef	WITH_READLINE
+		printf(
+		    "\n"
+		    "nettest has been compiled with GNU readline support. "
+		    "That means you can use\n"
+		    "readline-style editing features:\n"
+		    "	- use the <TAB> key for command and component name "
+		    "auto-completion\n"
+		    "	- use the up- and down-arrow keys to navigate command "
+		    "history\n"
+		    "	- use Ctrl+R for reverse-i-search in the command "
+		    "history\n"
+		    "	- use meta-B and meta-F for backward and forward "
+		    "jumping "
+		    "by word\n"
+		    "	- use Ctrl+A and Ctrl+E to the start or end of the "
+		    "line\n"
+		    "	  (etc.)\n"
+		    "\n");
+#endif	/* defined(WITH_READLINE) */
+	}
+	if (cmd == NULL) {
+		printf(
+		    "===============\n"
+		    "==== BUSES ====\n"
+		    "===============\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "bus") == 0) {
+		cmd_found = true;
+		printf(
+		    "bus [BUS_NAME]\n"
+		    "    Print all buses with voltages, currents and power "
+		    "flows. Use this to get a\n"
+		    "    quick overview of the network state. If you provide "
+		    "an optional bus name,\n"
+		    "    only the data for the listed bus will be printed. "
+		    "Table columns:\n"
+		    "	U - voltage on the bus\n"
+		    "bus <BUS_NAME> list [DEVICE ...]\n"
+		    "    Lists the state of all devices attached to the "
+		    "specified bus. You may\n"
+		    "    provide an optional list of devices to narrow the "
+		    "printout to only those\n"
+		    "    devices listed.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "====================\n"
+		    "==== GENERATORS ====\n"
+		    "====================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "gen") == 0) {
+		cmd_found = true;
+		printf(
+		    "gen [GEN_NAME]\n"
+		    "    Prints all generators on the network. If you provide "
+		    "an optional generator\n"
+		    "    name, only the data for the listed generator will be "
+		    "printed. Table columns:\n"
+		    "	RPM - the RPM value at which the generator is "
+		    "currently operating\n"
+		    "	W_in - input power demand from the generator on its "
+		    "mechanical input.\n"
+		    "	Eff - current generator efficiency in percent.\n"
+		    "	U_out - current generator output voltage.\n"
+		    "	I_out - current generator output current.\n"
+		    "	W_out - current generator output power load.\n"
+		    "gen <GEN_NAME> rpm <RPM>\n"
+		    "    Sets a new generator rpm value in the same units as "
+		    "what was used in the\n"
+		    "    electrical network definition.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "==========================\n"
+		    "==== TRUS & INVERTERS ====\n"
+		    "==========================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "tru") == 0) {
+		cmd_found = true;
+		printf(
+		    "tru [TRU_NAME|INV_NAME]\n"
+		    "    Prints all TRUs and inverters on the network. If "
+		    "you provide an optional\n"
+		    "    TRU/inverter name, only the data for the listed "
+		    "TRU/inverter will be\n"
+		    "    printed. Table columns:\n"
+		    "	U_in - input voltage into the TRU/inverter in Volts\n"
+		    "	W_in - input power draw into the TRU/inverter in "
+		    "Watts\n"
+		    "	Eff - TRU/inverter power conversion efficiency in "
+		    "percent\n"
+		    "	U_out - output voltage out of the TRU/inverter in "
+		    "Volts\n"
+		    "	I_out - output current out of the TRU/inverter in "
+		    "Amps\n"
+		    "	W_out - output power out of the TRU/inverter in "
+		    "Watts\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "xfrmr") == 0) {
+		cmd_found = true;
+		printf(
+		    "xfrmr XFRMR_NAME\n"
+		    "    Prints all transfoemrs on the network. If you "
+		    "provide an optional\n"
+		    "    transformer name, only the data for the listed "
+		    "transfomer will be\n"
+		    "    printed. Table columns:\n"
+		    "	U_in - input voltage into the TRU/inverter in Volts\n"
+		    "	W_in - input power draw into the TRU/inverter in "
+		    "Watts\n"
+		    "	Eff - TRU/inverter power conversion efficiency in "
+		    "percent\n"
+		    "	U_out - output voltage out of the TRU/inverter in "
+		    "Volts\n"
+		    "	I_out - output current out of the TRU/inverter in "
+		    "Amps\n"
+		    "	W_out - output power out of the TRU/inverter in "
+		    "Watts\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "===============\n"
+		    "==== LOADS ====\n"
+		    "===============\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "load") == 0) {
+		cmd_found = true;
+		printf(
+		    "load [LOAD_NAME]\n"
+		    "    Print all loads. If you provide an optional load "
+		    "name, only the data for\n"
+		    "    the listed load will be printed. "
+		    "Table columns:\n"
+		    "	U_out - output voltage out of the load's power supply\n"
+		    "	I_out - output current out of the load's power supply\n"
+		    "	W_out - output power out of the load's power supply\n"
+		    "	U_c_in - voltage of the power supply's virtual input "
+		    "capacitance\n"
+		    "	I_in - input current into the load's power supply\n"
+		    "load <LOAD_NAME> set <AMPS|WATTS>\n"
+		    "    Configures a constant load for an ELEC_LOAD device. "
+		    "Whether the load expects\n"
+		    "    a specification in Amps or Watts depends on whether "
+		    "the device is declared\n"
+		    "    as having a stabilized input power supply or not in "
+		    "the network definition\n"
+		    "    (STAB line).\n"
+		    "    N.B. the load argument must NOT be negative.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "==========================\n"
+		    "==== CIRCUIT BREAKERS ====\n"
+		    "==========================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "cb") == 0) {
+		cmd_found = true;
+		printf(
+		    "cb [CB_NAME]\n"
+		    "    Print the state of all circuit breakers. If you "
+		    "provide an optional\n"
+		    "    breaker name, only the data for the listed breaker "
+		    "will be printed.\n"
+		    "cb <CB_NAME> set <Y|N|1|0>\n"
+		    "    Sets/resets a circuit breaker. A breaker that's set "
+		    "('1' or 'Y')\n"
+		    "    allows current flow, while a reset breaker "
+		    "('0' or 'N') does not.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "==============\n"
+		    "==== TIES ====\n"
+		    "==============\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "tie") == 0) {
+		cmd_found = true;
+		printf(
+		    "tie [TIE_NAME]\n"
+		    "    Prints a list of all ties and their state. The "
+		    "table lists each tie,\n"
+		    "    and a list of buses currently tied into it. If you "
+		    "provide an optional\n"
+		    "    tie name, only the data for the listed tie will be "
+		    "printed.\n"
+		    "tie <TIE_NAME> <all|none|BUS1 BUS2 ...>\n"
+		    "    Configures a tie. The remaining arguments must "
+		    "be a list of buses to\n"
+		    "    which the tie connects. Any buses not mentioned "
+		    "will become untied.\n"
+		    "    You can also use the symbolic keywords \"none\" and "
+		    "\"all\" to untie and\n"
+		    "    tie all buses connected to the tie, "
+		    "respectively.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "===================\n"
+		    "==== BATTERIES ====\n"
+		    "===================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "batt") == 0) {
+		cmd_found = true;
+		printf(
+		    "batt [BATT_NAME]\n"
+		    "    Print the state of all batteries. If you provide "
+		    "an optional battery name,\n"
+		    "    only the data for the listed battery will be printed. "
+		    "Table columns:\n"
+		    "	U_out - output voltage in Volts\n"
+		    "	I_out - discharge current in Amps\n"
+		    "	I_in - recharge current in Amps\n"
+		    "	CHG - relative state of charge in percent\n"
+		    "	TEMP - temperature in degrees Celsius\n"
+		    "batt <BATT_NAME> chg <0..100>\n"
+		    "    Sets a new relative charge state of the battery "
+		    "in percent.\n"
+		    "batt <BATT_NAME> temp <TEMP\u00B0C>\n"
+		    "    Sets a new battery temperature in degrees Celsius.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "=======================\n"
+		    "==== IMAGE DRAWING ====\n"
+		    "=======================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "draw") == 0) {
+		cmd_found = true;
+		printf(
+		    "draw [filename.png] [COMP_NAME]\n"
+		    "    Draw a rendered image of the network. Your network "
+		    "must use \"GUI_*\"\n"
+		    "    stanzas in its network definition to control how the "
+		    "render is to be done.\n"
+		    "    This is useful for quickly iterating on the network "
+		    "render, instead of\n"
+		    "    having to wait for an aircraft reload in the "
+		    "simulator. The rendering\n"
+		    "    offset, scale factor, font size and image size can "
+		    "be changed using the\n"
+		    "    subcommands below.\n"
+		    "    N.B. the filename argument is optional only after "
+		    "the first successful\n"
+		    "    invocation of this command. This defines which file "
+		    "nettest is supposed\n"
+		    "    to write into. Subsequent invocations of the \"draw\" "
+		    "command without\n"
+		    "    arguments simply overwrite this file with a new "
+		    "image when it becomes\n"
+		    "    available. If you specify a component following "
+		    "the filename, that\n"
+		    "    component is drawn with its details box overlaid on "
+		    "top of it, as if\n"
+		    "    the user had clicked on it in the interactive network "
+		    "visualizer.\n"
+		    "draw offset <pixels_x> <pixels_y>\n"
+		    "    Sets the network drawing offset in pixels. The "
+		    "default offset is zero\n"
+		    "    for both X and Y.\n"
+		    "draw scale <scale>\n"
+		    "    Sets the rendering scale for network drawing. The "
+		    "default rendering scale\n"
+		    "    is 16.\n"
+		    "draw fontsz <size>\n"
+		    "    Sets the font size for network drawing. The default "
+		    "font size is 14 points.\n"
+		    "draw imgsz <pixels_x> <pixels_y>\n"
+		    "    Sets the image size for network drawing. The default "
+		    "image size is\n"
+		    "    2048x2048 pixels.\n"
+		    "draw tile <pixels_x> <pixels_y>\n"
+		    "    Splits subsequently drawn images into tiles of at "
+		    "most the given size.\n"
+		    "    Each tile is written into a separate file named "
+		    "\"<base>-<row>-<col>.<ext>\".\n"
+		    "    This lets you export schematics larger than a single "
+		    "image can hold. Pass\n"
+		    "    \"0 0\" to disable tiling (the default).\n"
+		    "draw batch <commands_file>\n"
+		    "    Reads commands from a file. Images drawn from the "
+		    "file are rendered in\n"
+		    "    parallel, with every image reflecting the network "
+		    "state and drawing\n"
+		    "    settings at the point where it appears in the file. "
+		    "Any command other\n"
+		    "    than \"draw\" waits for the images preceding it to "
+		    "be finished.\n"
+		    "draw wait <seconds>\n"
+		    "    Finishes drawing all pending images and then waits "
+		    "for the given number\n"
+		    "    of seconds. Use this after changing the network "
+		    "state to give the\n"
+		    "    network time to settle before drawing it.\n"
+		    "draw live <seconds|off> [COMP_NAME]\n"
+		    "    Keeps redrawing the last drawn image in the "
+		    "background, checking for\n"
+		    "    changes in the network every given number of "
+		    "seconds. Point an image\n"
+		    "    viewer which reloads changed files at the image to "
+		    "get a live view of\n"
+		    "    the network. Together with the -r option, this "
+		    "visualizes a network\n"
+		    "    running in another process. Images are replaced "
+		    "atomically. Tiling\n"
+		    "    isn't supported. Use \"draw live off\" to "
+		    "stop.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "==========================\n"
+		    "==== SOLVER PROFILING ====\n"
+		    "==========================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "prof") == 0) {
+		cmd_found = true;
+		printf(
+		    "prof on\n"
+		    "prof off\n"
+		    "    Enables or disables the per-component solver "
+		    "profile. Disabling it keeps\n"
+		    "    the results collected so far.\n"
+		    "prof reset\n"
+		    "    Discards the results collected so far.\n"
+		    "prof [paint|integ|depth|srcs|cb] [N]\n"
+		    "    Prints the N components (20 by default) which "
+		    "rank highest in the\n"
+		    "    given column (\"paint\" by default):\n"
+		    "	PAINT - painting pass visits per network pass\n"
+		    "	INTEG - load integration pass visits per network "
+		    "pass\n"
+		    "	DEPTH - deepest point in the network at which the "
+		    "component was\n"
+		    "	    reached by a source\n"
+		    "	SRCS - largest number of sources reaching the "
+		    "component in one pass\n"
+		    "	CB - time spent in the component's callback per "
+		    "network pass\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "solver") == 0) {
+		cmd_found = true;
+		printf(
+		    "solver [paint|nodal]\n"
+		    "    Switches the network to the painting (the default) "
+		    "or the nodal\n"
+		    "    analysis solver. Without an argument, prints the "
+		    "solver in use.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "=============================\n"
+		    "==== TELEMETRY RECORDING ====\n"
+		    "=============================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "rec") == 0) {
+		cmd_found = true;
+		printf(
+		    "rec\n"
+		    "    Prints whether a recording is active, and how many "
+		    "records it has\n"
+		    "    written and dropped so far.\n"
+		    "rec bin <FILENAME> <DEVICE> [DEVICE ...]\n"
+		    "rec csv <FILENAME> <DEVICE> [DEVICE ...]\n"
+		    "    Starts recording the voltages, currents, frequencies "
+		    "and CB temperature\n"
+		    "    or battery charge of the listed devices after every "
+		    "network pass into\n"
+		    "    a binary or CSV log file. Any previous recording is "
+		    "stopped first.\n"
+		    "rec stop\n"
+		    "    Stops the recording and closes the log file.\n"
+		    "rec rotate <KB>\n"
+		    "    Makes recordings started afterwards continue in a "
+		    "new file (with a\n"
+		    "    \".1\", \".2\", etc. suffix) every time the log "
+		    "file reaches the given\n"
+		    "    size. Use 0 (the default) to disable rotation.\n"
+		    "rec dump <FILENAME> [DEVICE]\n"
+		    "    Prints the contents of a binary log file, "
+		    "optionally only for one device.\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "capture") == 0) {
+		cmd_found = true;
+		printf(
+		    "capture\n"
+		    "    Prints whether an input capture is active, and how "
+		    "many passes it has\n"
+		    "    captured so far.\n"
+		    "capture start <FILENAME>\n"
+		    "    Starts capturing all inputs of the network (device "
+		    "failures, CB & tie\n"
+		    "    states, generator rpms, battery temperatures and "
+		    "load demands) into\n"
+		    "    a file, which \"libelec_bench replay\" can "
+		    "re-execute offline. Any\n"
+		    "    previous capture is stopped first.\n"
+		    "capture stop\n"
+		    "    Stops the capture and closes the capture file.\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "preset") == 0) {
+		cmd_found = true;
+		printf(
+		    "preset save <NAME>\n"
+		    "    Saves the current state of the network as a named "
+		    "preset, replacing\n"
+		    "    any preset of the same name.\n"
+		    "preset apply <NAME>\n"
+		    "    Instantly returns the network to the state saved "
+		    "in a preset.\n"
+		    "preset rm <NAME>\n"
+		    "    Removes a preset.\n"
+		    "preset write <FILENAME>\n"
+		    "    Writes all presets into a file.\n"
+		    "preset read <FILENAME>\n"
+		    "    Reads presets from a file written using "
+		    "\"preset write\". The file is\n"
+		    "    only accepted if it was written for the same "
+		    "network definition.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "=========================\n"
+		    "==== SIMULATION RUNS ====\n"
+		    "=========================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "run") == 0) {
+		cmd_found = true;
+		printf(
+		    "run <SECONDS> [DT]\n"
+		    "    Advances the network by the given number of "
+		    "simulated seconds as fast\n"
+		    "    as possible, in steps of DT seconds (by default, "
+		    "the network's\n"
+		    "    execution interval). Prints the simulated time, the "
+		    "number of steps,\n"
+		    "    the wall clock time taken and the speed relative to "
+		    "real time.\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "ff") == 0) {
+		cmd_found = true;
+		printf(
+		    "ff <SECONDS>\n"
+		    "    Fast-forwards a quiescent network by the given number "
+		    "of simulated\n"
+		    "    seconds, using passes of up to a minute. Stops early "
+		    "when a breaker\n"
+		    "    or tie changes state. Prints the simulated time, the "
+		    "wall clock time\n"
+		    "    taken, the speed relative to real time and why it "
+		    "stopped.\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "bench") == 0) {
+		cmd_found = true;
+		printf(
+		    "bench <TICKS>\n"
+		    "    Advances the network by the given number of steps "
+		    "as fast as\n"
+		    "    possible and prints the total, mean, minimum and "
+		    "maximum wall clock\n"
+		    "    time taken by the steps.\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "lat") == 0) {
+		cmd_found = true;
+		printf(
+		    "lat on\n"
+		    "lat off\n"
+		    "    Enables or disables the latency probe, which times "
+		    "every input change\n"
+		    "    until the worker pass picking it up starts, until "
+		    "the resulting state\n"
+		    "    is published and (with -s) until it has been sent "
+		    "to the network\n"
+		    "    clients. With -r, it times every received state "
+		    "update from its\n"
+		    "    publication by the sender instead.\n"
+		    "lat reset\n"
+		    "    Discards the results collected so far.\n"
+		    "lat\n"
+		    "    Prints the latencies measured so far.\n"
+		    "lat inject <CB_NAME> [N]\n"
+		    "    Flips a powered breaker N times (100 by default) at "
+		    "random points of\n"
+		    "    the worker cycle, each time timing how long it takes "
+		    "for the breaker's\n"
+		    "    output to follow in the getters, then puts the "
+		    "breaker back and\n"
+		    "    prints the results of the latency probe for these "
+		    "changes.\n");
+	}
+#ifdef	LIBELEC_WITH_NETLINK
+	if (cmd == NULL || lacf_strcasecmp(cmd, "netstats") == 0) {
+		cmd_found = true;
+		printf(
+		    "netstats on\n"
+		    "netstats off\n"
+		    "    With -r, subscribes to or unsubscribes from the "
+		    "performance reports\n"
+		    "    of the sender, which are sent about once a second. "
+		    "The sender\n"
+		    "    collects its worker statistics while anybody is "
+		    "subscribed.\n"
+		    "netstats\n"
+		    "    Prints the last report received: pass counts, "
+		    "overruns, clients and\n"
+		    "    data sent, the timings of the worker pass and its "
+		    "phases, and the\n"
+		    "    wakeup jitter histogram.\n"
+		    "netstats watch <SECONDS>\n"
+		    "    Subscribes to the reports and prints a summary line "
+		    "for each one\n"
+		    "    arriving within the given number of seconds.\n");
+	}
+#endif	/* defined(LIBELEC_WITH_NETLINK) */
+	if (cmd == NULL || lacf_strcasecmp(cmd, "profile") == 0) {
+		cmd_found = true;
+		printf(
+		    "profile\n"
+		    "    Prints the playback time and the duration of the "
+		    "load profile being\n"
+		    "    played back.\n"
+		    "profile play <FILENAME> [TIME]\n"
+		    "    Loads a CSV or binary load profile and starts "
+		    "playing it back on the\n"
+		    "    network from the given profile time (0 by default). "
+		    "The demands of the\n"
+		    "    loads named in the profile then follow the profile, "
+		    "overriding any\n"
+		    "    \"load set\" commands.\n"
+		    "profile stop\n"
+		    "    Stops the load profile playback.\n"
+		    "profile write <FILENAME>\n"
+		    "    Writes the load profile being played back into a "
+		    "binary profile file,\n"
+		    "    which loads much faster than a CSV file.\n");
+	}
+	if (cmd == NULL) {
+		printf("\n"
+		    "=========================\n"
+		    "==== PROGRAM CONTROL ====\n"
+		    "=========================\n");
+	}
+	if (cmd == NULL || lacf_strcasecmp(cmd, "quit") == 0) {
+		cmd_found = true;
+		printf(
+		    "quit\n"
+		    "    Quits nettest.\n");
+	}
+	if (cmd != NULL && !cmd_found) {
+		report_error("unknown command \"%s\". "
+		    "Try typing \"help\".", cmd);
+	}
+}
+
+#ifdef	WITH_READLINE
+
+enum { MAX_SUBCMD_PARTS = 32 };
+
+#define	COMP_TYPE_ANY_MASK \
+	((1 << ELEC_BATT) | (1 << ELEC_GEN) | (1 << ELEC_TRU) | \
+	(1 << ELEC_INV) | (1 << ELEC_LOAD) | (1 << ELEC_BUS) | \
+	(1 << ELEC_CB) | (1 << ELEC_SHUNT) | (1 << ELEC_TIE) | \
+	(1 << ELEC_DIODE))
+
+typedef enum {
+    CMD_PART_NONE = 0,
+    CMD_PART_KEYWORD,
+    CMD_PART_COMP_NAME,
+    CMD_PART_FILE_NAME
+} cmd_part_type_t;
+
+typedef struct cmd_part_s {
+	cmd_part_type_t		type;
+	const char		*keyword;
+	uint32_t		comp_type_mask;
+	bool			variadic;
+	bool			attached;
+	bool			autogen;
+	unsigned		comp_name_word_idx;
+	const struct cmd_part_s	*subparts[MAX_SUBCMD_PARTS];
+} cmd_part_t;
+
+static const cmd_part_t *cmd_parts_top[] = {
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "bus",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_BUS,
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "list",
+			.subparts = {
+			    &(cmd_part_t){
+				.type = CMD_PART_COMP_NAME,
+				.comp_type_mask = COMP_TYPE_ANY_MASK,
+				.attached = true,
+				.comp_name_word_idx = 1,
+				.variadic = true
+			    }
+			}
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "gen",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_GEN,
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "rpm"
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "tru",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = (1 << ELEC_TRU) | (1 << ELEC_INV)
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "xfrmr",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_XFRMR,
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "load",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_LOAD,
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "set"
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "cb",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_CB,
+		.autogen = true,
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "set",
+			.subparts = {
+			    &(cmd_part_t){
+				.type = CMD_PART_KEYWORD,
+				.keyword = "0"
+			    },
+			    &(cmd_part_t){
+				.type = CMD_PART_KEYWORD,
+				.keyword = "1"
+			    },
+			    &(cmd_part_t){
+				.type = CMD_PART_KEYWORD,
+				.keyword = "N"
+			    },
+			    &(cmd_part_t){
+				.type = CMD_PART_KEYWORD,
+				.keyword = "Y"
+			    }
+			}
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "tie",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_TIE,
+		.subparts = {
+		    /*
+		     * "all" and "none" must come first, because the
+		     * component name is variadic, so it will stop
+		     * any depth-search afterwards.
+		     */
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "all"
+		    },
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "none"
+		    },
+		    &(cmd_part_t){
+			.type = CMD_PART_COMP_NAME,
+			.comp_type_mask = 1 << ELEC_BUS,
+			.attached = true,
+			.comp_name_word_idx = 1,
+			.subparts = {
+			    &(cmd_part_t){
+				.type = CMD_PART_COMP_NAME,
+				.comp_type_mask = 1 << ELEC_BUS,
+				.variadic = true,
+				.attached = true,
+				.comp_name_word_idx = 1
+			    }
+			}
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "batt",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_COMP_NAME,
+		.comp_type_mask = 1 << ELEC_BATT,
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "chg"
+		    },
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "temp"
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "draw",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "offset"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "scale"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "fontsz"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "imgsz"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "tile"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "batch",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_FILE_NAME
+		    }
+		}
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "wait"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "live",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_KEYWORD,
+			.keyword = "off"
+		    }
+		}
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_FILE_NAME,
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_COMP_NAME,
+			.comp_type_mask = COMP_TYPE_ANY_MASK
+		    }
+		}
+	    }
+	}
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "help",
+	.subparts = {
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "bus"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "gen"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "tru"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "xfrmr"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "load"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "cb"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "tie"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "batt"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "draw"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "prof"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "solver"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "rec"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "capture"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "preset"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "run"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "ff"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "bench"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "lat"
+	    },
+#ifdef	LIBELEC_WITH_NETLINK
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_BUS,
-		.subparts = {
-		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "list",
-			.subparts = {
-			    &(cmd_part_t){
-				.type = CMD_PART_COMP_NAME,
-				.comp_type_mask = COMP_TYPE_ANY_MASK,
-				.attached = true,
-				.comp_name_word_idx = 1,
-				.variadic = true
-			    }
-			}
-		    }
-		}
-	    }
-	}
-    },
-    &(cmd_part_t){
-	.type = CMD_PART_KEYWORD,
-	.keyword = "gen",
-	.subparts = {
+		.type = CMD_PART_KEYWORD,
+		.keyword = "netstats"
+	    },
+#endif
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_GEN,
-		.subparts = {
-		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "rpm"
-		    }
-		}
-	    }
-	}
-    },
-    &(cmd_part_t){
-	.type = CMD_PART_KEYWORD,
-	.keyword = "tru",
-	.subparts = {
+		.type = CMD_PART_KEYWORD,
+		.keyword = "profile"
+	    },
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = (1 << ELEC_TRU) | (1 << ELEC_INV)
+		.type = CMD_PART_KEYWORD,
+		.keyword = "quit"
 	    }
 	}
     },
     &(cmd_part_t){
 	.type = CMD_PART_KEYWORD,
-	.keyword = "xfrmr",
+	.keyword = "prof",
 	.subparts = {
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_XFRMR,
+		.type = CMD_PART_KEYWORD,
+		.keyword = "on"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "off"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "reset"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "paint"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "integ"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "depth"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "srcs"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "cb"
 	    }
 	}
     },
     &(cmd_part_t){
 	.type = CMD_PART_KEYWORD,
-	.keyword = "load",
+	.keyword = "solver",
 	.subparts = {
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_LOAD,
-		.subparts = {
-		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "set"
-		    }
-		}
+		.type = CMD_PART_KEYWORD,
+		.keyword = "paint"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "nodal"
 	    }
 	}
     },
     &(cmd_part_t){
 	.type = CMD_PART_KEYWORD,
-	.keyword = "cb",
+	.keyword = "rec",
 	.subparts = {
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_CB,
-		.autogen = true,
+		.type = CMD_PART_KEYWORD,
+		.keyword = "bin",
 		.subparts = {
 		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "set",
+			.type = CMD_PART_FILE_NAME,
 			.subparts = {
 			    &(cmd_part_t){
-				.type = CMD_PART_KEYWORD,
-				.keyword = "0"
-			    },
-			    &(cmd_part_t){
-				.type = CMD_PART_KEYWORD,
-				.keyword = "1"
-			    },
-			    &(cmd_part_t){
-				.type = CMD_PART_KEYWORD,
-				.keyword = "N"
-			    },
-			    &(cmd_part_t){
-				.type = CMD_PART_KEYWORD,
-				.keyword = "Y"
+				.type = CMD_PART_COMP_NAME,
+				.comp_type_mask = COMP_TYPE_ANY_MASK,
+				.variadic = true
 			    }
 			}
 		    }
 		}
-	    }
-	}
-    },
-    &(cmd_part_t){
-	.type = CMD_PART_KEYWORD,
-	.keyword = "tie",
-	.subparts = {
+	    },
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_TIE,
+		.type = CMD_PART_KEYWORD,
+		.keyword = "csv",
 		.subparts = {
-		    /*
-		     * "all" and "none" must come first, because the
-		     * component name is variadic, so it will stop
-		     * any depth-search afterwards.
-		     */
-		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "all"
-		    },
-		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "none"
-		    },
 		    &(cmd_part_t){
-			.type = CMD_PART_COMP_NAME,
-			.comp_type_mask = 1 << ELEC_BUS,
-			.attached = true,
-			.comp_name_word_idx = 1,
+			.type = CMD_PART_FILE_NAME,
 			.subparts = {
 			    &(cmd_part_t){
 				.type = CMD_PART_COMP_NAME,
-				.comp_type_mask = 1 << ELEC_BUS,
-				.variadic = true,
-				.attached = true,
-				.comp_name_word_idx = 1
+				.comp_type_mask = COMP_TYPE_ANY_MASK,
+				.variadic = true
 			    }
 			}
 		    }
 		}
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "stop"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "rotate"
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "dump",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_FILE_NAME
+		    }
+		}
 	    }
 	}
     },
     &(cmd_part_t){
 	.type = CMD_PART_KEYWORD,
-	.keyword = "batt",
+	.keyword = "capture",
 	.subparts = {
 	    &(cmd_part_t){
-		.type = CMD_PART_COMP_NAME,
-		.comp_type_mask = 1 << ELEC_BATT,
+		.type = CMD_PART_KEYWORD,
+		.keyword = "start",
 		.subparts = {
 		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "chg"
-		    },
-		    &(cmd_part_t){
-			.type = CMD_PART_KEYWORD,
-			.keyword = "temp"
+			.type = CMD_PART_FILE_NAME
 		    }
 		}
+	    },
+	    &(cmd_part_t){
+		.type = CMD_PART_KEYWORD,
+		.keyword = "stop"
 	    }
 	}
     },
     &(cmd_part_t){
 	.type = CMD_PART_KEYWORD,
-	.keyword = "draw",
+	.keyword = "preset",
 	.subparts = {
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "offset"
+		.keyword = "save"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "scale"
+		.keyword = "apply"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "fontsz"
+		.keyword = "rm"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "imgsz"
+		.keyword = "write",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_FILE_NAME
+		    }
+		}
 	    },
 	    &(cmd_part_t){
-		.type = CMD_PART_FILE_NAME,
+		.type = CMD_PART_KEYWORD,
+		.keyword = "read",
 		.subparts = {
 		    &(cmd_part_t){
-			.type = CMD_PART_COMP_NAME,
-			.comp_type_mask = COMP_TYPE_ANY_MASK
+			.type = CMD_PART_FILE_NAME
 		    }
 		}
 	    }
@@ -1903,47 +4087,89 @@ static const cmd_part_t *cmd_parts_top[] = {
     },
     &(cmd_part_t){
 	.type = CMD_PART_KEYWORD,
-	.keyword = "help",
+	.keyword = "run"
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "ff"
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "bench"
+    },
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "lat",
 	.subparts = {
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "bus"
+		.keyword = "on"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "gen"
+		.keyword = "off"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "tru"
+		.keyword = "reset"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "xfrmr"
-	    },
+		.keyword = "inject",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_COMP_NAME,
+			.comp_type_mask = 1 << ELEC_CB
+		    }
+		}
+	    }
+	}
+    },
+#ifdef	LIBELEC_WITH_NETLINK
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "netstats",
+	.subparts = {
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "load"
+		.keyword = "on"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "cb"
+		.keyword = "off"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "tie"
-	    },
+		.keyword = "watch"
+	    }
+	}
+    },
+#endif
+    &(cmd_part_t){
+	.type = CMD_PART_KEYWORD,
+	.keyword = "profile",
+	.subparts = {
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "batt"
+		.keyword = "play",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_FILE_NAME
+		    }
+		}
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "draw"
+		.keyword = "stop"
 	    },
 	    &(cmd_part_t){
 		.type = CMD_PART_KEYWORD,
-		.keyword = "quit"
+		.keyword = "write",
+		.subparts = {
+		    &(cmd_part_t){
+			.type = CMD_PART_FILE_NAME
+		    }
+		}
 	    }
 	}
     },
@@ -2025,40 +4251,45 @@ find_cur_cmd_part(const cmd_part_t **parts, unsigned num_parts,
 static const cmd_part_t **completion_parts = NULL;
 static unsigned completion_num_parts = 0;
 static unsigned completion_part_idx = 0;
-static unsigned completion_info_idx = 0;
+static size_t completion_info_idx = 0;
+/*
+ * The component which the candidates of `completion_attach_part' must
+ * be attached to, looked up once per completion.
+ */
+static const cmd_part_t *completion_attach_part = NULL;
+static const elec_comp_t *completion_attach_comp = NULL;
 
 static bool
 completion_check_comp_attachment(const char *name, const cmd_part_t *part)
 {
-	size_t n_comps;
-	char **comps;
-	const elec_comp_t *comp;
-	bool result = false;
-
 	ASSERT(name != NULL);
 	ASSERT(part != NULL);
 	ASSERT3U(part->type, ==, CMD_PART_COMP_NAME);
 
 	if (!part->attached)
 		return (true);
-	comps = strsplit(rl_line_buffer, " ", true, &n_comps);
-	if (part->comp_name_word_idx >= n_comps)
-		goto errout;
-	comp = libelec_comp_find(sys, comps[part->comp_name_word_idx]);
-	if (comp == NULL)
-		goto errout;
-	result = check_comp_attachment(comp, name);
-errout:
-	free_strlist(comps, n_comps);
-	return (result);
+	if (completion_attach_part != part) {
+		size_t n_comps;
+		char **comps = strsplit(rl_line_buffer, " ", true, &n_comps);
+
+		completion_attach_part = part;
+		completion_attach_comp = NULL;
+		if (part->comp_name_word_idx < n_comps) {
+			completion_attach_comp = libelec_comp_find(sys,
+			    comps[part->comp_name_word_idx]);
+		}
+		free_strlist(comps, n_comps);
+	}
+	if (completion_attach_comp == NULL)
+		return (false);
+	return (check_comp_attachment(completion_attach_comp, name));
 }
 
 static char *
 tab_completion_generator(const char *text, int state)
 {
 	const cmd_part_t *part;
-	const elec_comp_info_t *infos;
-	size_t num_infos;
+	size_t lo, hi;
 
 	ASSERT(text != NULL);
 	/*
@@ -2087,13 +4318,12 @@ tab_completion_generator(const char *text, int state)
 		completion_part_idx++;
 		return (tab_completion_generator(text, state));
 	case CMD_PART_COMP_NAME:
-		infos = libelec_get_comp_infos(sys, &num_infos);
-		for (; completion_info_idx < num_infos;
-		    completion_info_idx++) {
-			const elec_comp_info_t *info =
-			    &infos[completion_info_idx];
-			if (lacf_strncasecmp(text, info->name, strlen(text)) ==
-			    0 && (!info->autogen || part->autogen) &&
+		name_idx_range(text, true, &lo, &hi);
+		completion_info_idx = MAX(completion_info_idx, lo);
+		for (; completion_info_idx < hi; completion_info_idx++) {
+			const elec_comp_info_t *info = libelec_comp2info(
+			    name_idx.ents[completion_info_idx].comp);
+			if ((!info->autogen || part->autogen) &&
 			    (part->comp_type_mask & (1 << info->type)) &&
 			    completion_check_comp_attachment(info->name,
 			    part)) {
@@ -2131,6 +4361,8 @@ tab_completion(const char *text, int start, int end)
 	completion_num_parts = num_parts;
 	completion_part_idx = 0;
 	completion_info_idx = 0;
+	completion_attach_part = NULL;
+	completion_attach_comp = NULL;
 	return (rl_completion_matches(text, tab_completion_generator));
 }
 
@@ -2198,6 +4430,9 @@ read_commands(FILE *fp, const char *filename, bool interactive)
 
 		if (!get_next_word(cmd, sizeof (cmd)))
 			break;
+		/* Queued images must show the state before this command */
+		if (lacf_strcasecmp(cmd, "draw") != 0)
+			draw_flush();
 		if (lacf_strcasecmp(cmd, "quit") == 0) {
 			break;
 		} else if (lacf_strcasecmp(cmd, "bus") == 0) {
@@ -2218,6 +4453,30 @@ read_commands(FILE *fp, const char *filename, bool interactive)
 			batt_cmd();
 		} else if (lacf_strcasecmp(cmd, "draw") == 0) {
 			draw_cmd();
+		} else if (lacf_strcasecmp(cmd, "prof") == 0) {
+			prof_cmd();
+		} else if (lacf_strcasecmp(cmd, "solver") == 0) {
+			solver_cmd();
+		} else if (lacf_strcasecmp(cmd, "rec") == 0) {
+			rec_cmd();
+		} else if (lacf_strcasecmp(cmd, "capture") == 0) {
+			capture_cmd();
+		} else if (lacf_strcasecmp(cmd, "preset") == 0) {
+			preset_cmd();
+		} else if (lacf_strcasecmp(cmd, "run") == 0) {
+			run_cmd();
+		} else if (lacf_strcasecmp(cmd, "ff") == 0) {
+			ff_cmd();
+		} else if (lacf_strcasecmp(cmd, "bench") == 0) {
+			bench_cmd();
+		} else if (lacf_strcasecmp(cmd, "lat") == 0) {
+			lat_cmd();
+#ifdef	LIBELEC_WITH_NETLINK
+		} else if (lacf_strcasecmp(cmd, "netstats") == 0) {
+			netstats_cmd();
+#endif
+		} else if (lacf_strcasecmp(cmd, "profile") == 0) {
+			profile_cmd();
 		} else if (lacf_strcasecmp(cmd, "help") == 0) {
 			char subcmd[32];
 			if (get_next_word(subcmd, sizeof (subcmd)))
@@ -2245,6 +4504,7 @@ read_commands(FILE *fp, const char *filename, bool interactive)
 #ifndef	WITH_READLINE
 	free(cmdline);
 #endif
+	draw_flush();
 	return (true);
 }
 
@@ -2266,10 +4526,15 @@ int
 main(int argc, char **argv)
 {
 	const char *filename = NULL, *init_filename = NULL;
+	const char *img_filename = NULL;
 	int opt;
 	void *cookie;
+	static const struct option long_opts[] = {
+	    { "batch", no_argument, NULL, 'B' },
+	    { NULL, 0, NULL, 0 }
+	};
 #ifdef	LIBELEC_WITH_NETLINK
-	const char *send_url = NULL, *recv_url = NULL;
+	bool net_send = false;
 #endif
 	load_info_t *load_info;
 	/*
@@ -2292,8 +4557,12 @@ main(int argc, char **argv)
 	/*
 	 * Command line argument parsing.
 	 */
-	while ((opt = getopt(argc, argv, "hvi:s:r:JC")) != -1) {
+	while ((opt = getopt_long(argc, argv, "hvi:c:srJC", long_opts,
+	    NULL)) != -1) {
 		switch (opt) {
+		case 'B':
+			batch_mode = true;
+			break;
 		case 'h':
 			print_usage(stdout, argv[0]);
 			exit(EXIT_SUCCESS);
@@ -2303,6 +4572,9 @@ main(int argc, char **argv)
 		case 'i':
 			init_filename = optarg;
 			break;
+		case 'c':
+			img_filename = optarg;
+			break;
 		case 'J':
 			output_format = FORMAT_JSON;
 			break;
@@ -2311,18 +4583,18 @@ main(int argc, char **argv)
 			break;
 #ifdef	LIBELEC_WITH_NETLINK
 		case 's':
-			if (recv_url != NULL) {
+			if (net_recv) {
 				logMsg("-s and -r are mutually exclusive");
 				exit(EXIT_FAILURE);
 			}
-			send_url = optarg;
+			net_send = true;
 			break;
 		case 'r':
-			if (send_url != NULL) {
+			if (net_send) {
 				logMsg("-s and -r are mutually exclusive");
 				exit(EXIT_FAILURE);
 			}
-			recv_url = optarg;
+			net_recv = true;
 			break;
 #endif	/* defined(LIBELEC_WITH_NETLINK) */
 		default: /* '?' */
@@ -2332,24 +4604,51 @@ main(int argc, char **argv)
 	}
 	/*
 	 * Check for the last non-option argument. That's our network filename.
+	 * Network receivers can also go without one, see below.
 	 */
-	if (optind + 1 > argc) {
+	if (optind < argc)
+		filename = argv[optind++];
+#ifdef	LIBELEC_WITH_NETLINK
+	if (filename == NULL && !net_recv) {
+#else	/* !defined(LIBELEC_WITH_NETLINK) */
+	if (filename == NULL) {
+#endif	/* !defined(LIBELEC_WITH_NETLINK) */
 		print_usage(stderr, argv[0]);
 		exit(EXIT_FAILURE);
 	}
-	filename = argv[optind++];
+	if (batch_mode && output_format == FORMAT_HUMAN_READABLE)
+		output_format = FORMAT_JSON;
 	/*
 	 * libelec initialization. We now have the network definition file
-	 * in `filename`, so just pass that to libelec_new() to load.
+	 * in `filename`, so just pass that to libelec_new() to load. A
+	 * network receiver without a definition file downloads it from
+	 * the sender instead, which also sets up the receiving.
 	 */
-	sys = libelec_new(filename);
+	if (filename != NULL)
+		sys = libelec_new(filename);
+#ifdef	LIBELEC_WITH_NETLINK
+	else
+		sys = libelec_new_net_client(NET_TOPO_TIMEOUT);
+#endif	/* defined(LIBELEC_WITH_NETLINK) */
 	if (sys == NULL)
 		exit(EXIT_FAILURE);
+	/*
+	 * In compile mode, we only write the precompiled image of the
+	 * network and exit.
+	 */
+	if (img_filename != NULL) {
+		bool ok = libelec_write_image(sys, img_filename);
+		libelec_destroy(sys);
+		exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 	/*
 	 * We want to configure all ELEC_LOAD devices to use our get_load()
 	 * callback, so we can dynamically modify their electrical load.
 	 */
 	libelec_walk_comps(sys, setup_comp_binds, NULL);
+	name_idx_build();
+	if (batch_mode)
+		libelec_sys_set_seed(sys, 0);
 	/*
 	 * We allow the user to pass an "initial commands" file, to set up
 	 * this test utility for easier testing. So this feature simply
@@ -2372,16 +4671,19 @@ main(int argc, char **argv)
 	 * Debugging of network synchronization.
 	 */
 #ifdef	LIBELEC_WITH_NETLINK
-	if (send_url != NULL)
-		libelec_enable_net_send(sys, send_url);
-	if (recv_url != NULL)
-		libelec_enable_net_recv(sys, recv_url);
+	if (net_send)
+		libelec_enable_net_send(sys);
+	if (net_recv && filename != NULL)
+		libelec_enable_net_recv(sys);
 #endif	/* defined(LIBELEC_WITH_NETLINK) */
 	/*
 	 * Having loaded and configured the network to our needs, we can
-	 * start the libelec() physics thread.
+	 * start the libelec() physics thread. In batch mode, the network
+	 * is only ever stepped synchronously by the "run" and "bench"
+	 * commands.
 	 */
-	VERIFY(libelec_sys_start(sys));
+	if (!batch_mode)
+		VERIFY(libelec_sys_start(sys));
 	/*
 	 * Read and implement the user's interactive commands from STDIN.
 	 */
@@ -2389,8 +4691,12 @@ main(int argc, char **argv)
 	/*
 	 * Shut down and free the network.
 	 */
-	libelec_sys_stop(sys);
+	draw_live_stop();
+	if (libelec_sys_is_started(sys))
+		libelec_sys_stop(sys);
+	name_idx_destroy();
 	libelec_destroy(sys);
+	libelec_load_profile_destroy(load_prof);
 	/*
 	 * Clean out any load_infos the user might have set up using the
 	 * "load" command, then destroy the tree.
@@ -2400,7 +4706,7 @@ main(int argc, char **argv)
 		free(load_info);
 	avl_destroy(&load_infos);
 
-	return (0);
+	return (batch_mode && n_errors != 0 ? EXIT_FAILURE : 0);
 }
 
 static double
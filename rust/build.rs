@@ -7,9 +7,106 @@
  * Copyright 2023 Saso Kiselkov. All rights reserved.
  */
 
+use std::collections::HashSet;
+use std::env;
+use std::fmt::Write;
+use std::fs;
+use std::path::Path;
+use std::process::Command;
+
+const LACF_DIR: &str = "../nettest/libacfutils-redist-v0.37";
+const ELEC_DIR: &str = "../src/build";
+
+/* Variant names of CompType, indexed by elec_comp_type_t */
+const COMP_TYPES: [&str; 12] = [
+	"Batt", "Gen", "TRU", "Inv", "Transformer", "Load", "Bus", "CB",
+	"Shunt", "Tie", "Diode", "LabelBox"
+];
+
+/*
+ * Turns a component name into a Rust constant name. Anything that
+ * can't be part of an identifier becomes an underscore.
+ */
+fn const_name(name: &str) -> String {
+	let mut ident: String = name.chars()
+	    .map(|c| if c.is_ascii_alphanumeric() { c.to_ascii_uppercase() }
+	    else { '_' })
+	    .collect();
+	if ident.is_empty() || ident.starts_with(|c: char| c.is_ascii_digit()) {
+		ident.insert(0, '_');
+	}
+	ident
+}
+
+/*
+ * Loads the network definition using libelec's own parser (through the
+ * gen_comps.c helper, linked against the same libraries as the crate)
+ * and writes a module of typed component index constants to `out`.
+ */
+fn gen_comps(net: &str, out_dir: &str, out: &Path) {
+	let cc = env::var("CC").unwrap_or("cc".to_string());
+	let helper = Path::new(out_dir).join("gen_comps");
+	let status = Command::new(&cc)
+	    .args(["-O1", "-DIBM=0", "-DLIN=1", "-DAPL=0",
+	    "-D_LACF_WITHOUT_XPLM", "-I../src"])
+	    .arg(format!("-I{}/include", LACF_DIR))
+	    .arg(format!("-I{}/lin64/include", LACF_DIR))
+	    .arg("gen_comps.c")
+	    .arg("-o").arg(&helper)
+	    .arg(format!("-L{}", ELEC_DIR))
+	    .arg(format!("-L{}/lin64/lib", LACF_DIR))
+	    .args(["-lelec", "-lacfutils", "-lcurl", "-lssl", "-lcrypto",
+	    "-lz", "-lm", "-lpthread", "-ldl"])
+	    .status()
+	    .unwrap_or_else(|e| panic!("Cannot run {}: {}", cc, e));
+	assert!(status.success(), "Cannot build the gen_comps helper");
+
+	let output = Command::new(&helper).arg(net).output()
+	    .unwrap_or_else(|e| panic!("Cannot run gen_comps: {}", e));
+	assert!(output.status.success(), "Cannot load {}:\n{}", net,
+	    String::from_utf8_lossy(&output.stderr));
+
+	let mut names = vec![];
+	let mut idents = vec![];
+	let mut consts = String::new();
+	let mut seen = HashSet::new();
+	for line in String::from_utf8(output.stdout)
+	    .expect("Component names not valid UTF-8?!").lines() {
+		let mut words = line.splitn(3, ' ');
+		let (Some(idx), Some(ty), Some(name)) =
+		    (words.next(), words.next(), words.next()) else {
+			panic!("Malformed gen_comps output: {}", line);
+		};
+		let ty: usize = ty.parse().expect("Bad component type");
+		let ident = const_name(name);
+		assert!(seen.insert(ident.clone()), "Components in {} map to \
+		    the same constant name {}", net, ident);
+		writeln!(consts, "pub const {}: CompId = \
+		    CompId::new({}, CompType::{});", ident, idx,
+		    COMP_TYPES[ty]).unwrap();
+		names.push(format!("{:?}", name));
+		idents.push(ident);
+	}
+	let module = format!("/* Generated by build.rs from {} */\n\n\
+	    /* The network definition, as passed in LIBELEC_NET */\n\
+	    pub const FILE: &str = {:?};\n\n\
+	    {}\n\
+	    /* All components and their names, in index order */\n\
+	    pub const COMPS: [CompId; {}] = [\n\t{}\n];\n\
+	    pub const NAMES: [&str; {}] = [\n\t{}\n];\n\n\
+	    /*\n \
+	    * Checks that `sys` is the network these constants were\n \
+	    * generated for, see ElecSys::check_comps().\n \
+	    */\n\
+	    pub fn check(sys: &ElecSys) -> bool {{\n\
+	    \tsys.check_comps(&NAMES)\n\
+	    }}\n", net, net, consts, idents.len(), idents.join(",\n\t"),
+	    names.len(), names.join(",\n\t"));
+	fs::write(out, module).expect("Cannot write the component module");
+}
+
 fn main() {
-	const LACF_DIR: &str = "../nettest/libacfutils-redist-v0.37";
-	println!("cargo:rustc-link-search=native=../src/build");
+	println!("cargo:rustc-link-search=native={}", ELEC_DIR);
 	println!("cargo:rustc-link-lib=static=elec");
 	println!("cargo:rustc-link-search=native={}/lin64/lib", LACF_DIR);
 	println!("cargo:rustc-link-lib=static=acfutils");
@@ -17,4 +114,20 @@ fn main() {
 	println!("cargo:rustc-link-lib=static=ssl");
 	println!("cargo:rustc-link-lib=static=curl");
 	println!("cargo:rustc-link-lib=static=z");
+	/*
+	 * Optionally, generate the `net` module of component constants
+	 * for the network definition given in LIBELEC_NET.
+	 */
+	println!("cargo:rustc-check-cfg=cfg(libelec_net)");
+	println!("cargo:rerun-if-env-changed=LIBELEC_NET");
+	println!("cargo:rerun-if-changed=build.rs");
+	println!("cargo:rerun-if-changed=gen_comps.c");
+	if let Ok(net) = env::var("LIBELEC_NET") {
+		let out_dir = env::var("OUT_DIR").unwrap();
+		println!("cargo:rerun-if-changed={}", net);
+		println!("cargo:rerun-if-changed={}/libelec.a", ELEC_DIR);
+		gen_comps(&net, &out_dir,
+		    &Path::new(&out_dir).join("net_comps.rs"));
+		println!("cargo:rustc-cfg=libelec_net");
+	}
 }
@@ -0,0 +1,55 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+/*
+ * Helper run by build.rs to list the components of a network definition,
+ * one "<index> <type> <name>" line per component, in index order. The
+ * definition is loaded using libelec's own parser, so the indices are
+ * exactly the ones libelec assigns at run time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <acfutils/crc64.h>
+#include <acfutils/log.h>
+
+#include "libelec.h"
+
+static void
+log_cb(const char *str)
+{
+	fputs(str, stderr);
+}
+
+int
+main(int argc, char **argv)
+{
+	elec_sys_t *sys;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <network.net>\n", argv[0]);
+		return (EXIT_FAILURE);
+	}
+	log_init(log_cb, "gen_comps");
+	crc64_init();
+
+	sys = libelec_new(argv[1]);
+	if (sys == NULL)
+		return (EXIT_FAILURE);
+	for (size_t i = 0, n = libelec_get_num_comps(sys); i < n; i++) {
+		const elec_comp_t *comp = libelec_get_comp(sys, i);
+
+		printf("%lu %d %s\n", (unsigned long)i,
+		    (int)libelec_comp_get_type(comp),
+		    libelec_comp_get_name(comp));
+	}
+	libelec_destroy(sys);
+
+	return (EXIT_SUCCESS);
+}
@@ -11,9 +11,16 @@
 #![allow(non_camel_case_types)]
 
 use std::os::raw::c_char;
+use std::os::raw::c_int;
 use std::os::raw::c_void;
 use std::ffi::CString;
 use std::ffi::CStr;
+use std::collections::VecDeque;
+use std::sync::Arc;
+use std::sync::Condvar;
+use std::sync::Mutex;
+use std::sync::MutexGuard;
+use std::time::Duration;
 
 use acfutils::conf::conf_t;
 
@@ -34,6 +41,18 @@ impl ElecSys {
 			Err(())
 		}
 	}
+	/*
+	 * Creates a new instance of the network, sharing the parsed
+	 * network definition with `self`. See libelec_new_instance().
+	 */
+	pub fn new_instance(&self) -> Result<ElecSys, ()> {
+		let elec = unsafe { libelec_new_instance(self.elec) };
+		if !elec.is_null() {
+			Ok(ElecSys{elec: elec})
+		} else {
+			Err(())
+		}
+	}
 	pub fn start(&mut self) -> Result<(), ()> {
 		if unsafe { libelec_sys_start(self.elec) } {
 			Ok(())
@@ -46,6 +65,79 @@ impl ElecSys {
 			libelec_sys_stop(self.elec)
 		}
 	}
+	/*
+	 * Synchronously advances a stopped network by `d_t` seconds.
+	 */
+	pub fn step(&mut self, d_t: f64) {
+		assert!(d_t > 0.0);
+		unsafe {
+			libelec_sys_step(self.elec, d_t)
+		}
+	}
+	/*
+	 * Brings a stopped network straight to its steady state, see
+	 * libelec_sys_settle(). Returns true if it has converged to
+	 * within `tol` in at most `max_iter` passes.
+	 */
+	pub fn settle(&mut self, tol: f64, max_iter: u32) -> bool {
+		assert!(tol >= 0.0);
+		assert!(max_iter > 0);
+		unsafe { libelec_sys_settle(self.elec, tol, max_iter) }
+	}
+	/*
+	 * Advances a stopped, quiescent network by `seconds` using as few
+	 * passes as possible, see libelec_sys_fast_forward(). Returns the
+	 * amount of simulated time actually advanced and why it stopped.
+	 */
+	pub fn fast_forward(&mut self, seconds: f64) -> (f64, FastFwdStop) {
+		assert!(seconds > 0.0);
+		let mut stop = FastFwdStop::Done;
+		let done = unsafe {
+			libelec_sys_fast_forward(self.elec, seconds, &mut stop)
+		};
+		(done, stop)
+	}
+	/*
+	 * Host-driven mode, in which the network doesn't get its own
+	 * worker thread and instead runs a pass on every call to tick().
+	 * See libelec_sys_set_host_tick().
+	 */
+	pub fn set_host_tick(&mut self, flag: bool) {
+		unsafe { libelec_sys_set_host_tick(self.elec, flag) }
+	}
+	pub fn host_tick(&self) -> bool {
+		unsafe { libelec_sys_get_host_tick(self.elec) }
+	}
+	pub fn tick(&mut self) {
+		unsafe { libelec_sys_tick(self.elec) }
+	}
+	/*
+	 * Early worker wakeups on switching & failure inputs.
+	 * See libelec_sys_set_input_wake().
+	 */
+	pub fn set_input_wake(&mut self, min_intval: f64) {
+		unsafe { libelec_sys_set_input_wake(self.elec, min_intval) }
+	}
+	pub fn input_wake(&self) -> f64 {
+		unsafe { libelec_sys_get_input_wake(self.elec) }
+	}
+	/*
+	 * Worker statistics collection. See libelec_sys_get_stats().
+	 */
+	pub fn set_stats_enabled(&mut self, enabled: bool) {
+		unsafe { libelec_sys_set_stats_enabled(self.elec, enabled) }
+	}
+	pub fn stats_enabled(&self) -> bool {
+		unsafe { libelec_sys_get_stats_enabled(self.elec) }
+	}
+	pub fn stats(&self) -> ElecStats {
+		let mut stats = ElecStats::default();
+		unsafe { libelec_sys_get_stats(self.elec, &mut stats) };
+		stats
+	}
+	pub fn reset_stats(&mut self) {
+		unsafe { libelec_sys_reset_stats(self.elec) }
+	}
 	pub fn serialize(&self, conf: &mut acfutils::conf::Conf, prefix: &str) {
 		unsafe {
 			let c_prefix = CString::new(prefix)
@@ -68,6 +160,73 @@ impl ElecSys {
 			}
 		}
 	}
+	/*
+	 * Compact binary state snapshots for rapid save & restore. See
+	 * libelec_snapshot_save() and libelec_snapshot_restore().
+	 */
+	pub fn snapshot(&self) -> Vec<u8> {
+		unsafe {
+			let len = libelec_snapshot_save(self.elec,
+			    std::ptr::null_mut(), 0);
+			let mut buf = vec![0u8; len];
+			let written = libelec_snapshot_save(self.elec,
+			    buf.as_mut_ptr() as *mut c_void, len);
+			assert_eq!(written, len);
+			buf
+		}
+	}
+	#[must_use]
+	pub fn restore_snapshot(&mut self, snap: &[u8]) -> Result<(), ()> {
+		let ok = unsafe {
+			libelec_snapshot_restore(self.elec,
+			    snap.as_ptr() as *const c_void, snap.len())
+		};
+		if ok {
+			Ok(())
+		} else {
+			Err(())
+		}
+	}
+	/*
+	 * State history recorder for rewind & replay. See
+	 * libelec_sys_set_history() and libelec_sys_history_seek().
+	 */
+	pub fn set_history(&mut self, seconds: f64, max_bytes: usize) {
+		assert!(seconds >= 0.0);
+		unsafe {
+			libelec_sys_set_history(self.elec, seconds, max_bytes)
+		}
+	}
+	pub fn history_span(&self) -> f64 {
+		unsafe { libelec_sys_get_history_span(self.elec) }
+	}
+	#[must_use]
+	pub fn history_seek(&mut self, secs_ago: f64) -> Result<(), ()> {
+		assert!(secs_ago >= 0.0);
+		if unsafe { libelec_sys_history_seek(self.elec, secs_ago) } {
+			Ok(())
+		} else {
+			Err(())
+		}
+	}
+	/*
+	 * Writes a precompiled image of the network definition, which
+	 * speeds up subsequent loads. With `None`, the image is written
+	 * next to the definition file, where ElecSys::new() looks for it.
+	 */
+	pub fn write_image(&self, filename: Option<&str>) -> Result<(), ()> {
+		let c_filename = filename.map(|filename| CString::new(filename)
+		    .expect("`filename` contains a NUL byte"));
+		let ok = unsafe {
+			libelec_write_image(self.elec, c_filename.as_ref()
+			    .map_or(std::ptr::null(), |c| c.as_ptr()))
+		};
+		if ok {
+			Ok(())
+		} else {
+			Err(())
+		}
+	}
 	pub fn is_started(&self) -> bool {
 		unsafe {
 			libelec_sys_is_started(self.elec)
@@ -78,6 +237,28 @@ impl ElecSys {
 			libelec_sys_can_start(self.elec)
 		}
 	}
+	/*
+	 * Synchronously advances a batch of stopped networks by `d_t`
+	 * seconds, spread across `n_threads` threads.
+	 */
+	pub fn step_batch(systems: &mut [ElecSys], d_t: f64, n_threads: u32) {
+		assert!(d_t > 0.0);
+		let elecs: Vec<*mut elec_t> =
+		    systems.iter().map(|sys| sys.elec).collect();
+		unsafe {
+			libelec_sys_step_batch(elecs.as_ptr(), elecs.len(), d_t,
+			    n_threads)
+		}
+	}
+	/*
+	 * Seeds the network's random number generator, for reproducible
+	 * runs. See libelec_sys_set_seed().
+	 */
+	pub fn set_seed(&mut self, seed: u64) {
+		unsafe {
+			libelec_sys_set_seed(self.elec, seed)
+		}
+	}
 	pub fn sys_set_time_factor(&mut self, time_factor: f64) {
 		unsafe {
 			libelec_sys_set_time_factor(self.elec, time_factor)
@@ -128,6 +309,85 @@ impl ElecSys {
 		};
 		comps
 	}
+	/*
+	 * Same as all_comps(), but only returns the components of the
+	 * given types, grouped by type in the order of CompType.
+	 */
+	pub fn comps_of_type(&self, types: &[CompType]) -> Vec<ElecComp> {
+		let mut comps: Vec<ElecComp> = vec![];
+		let mask = types.iter()
+		    .fold(0u32, |m, t| m | (1u32 << *t as u32));
+		unsafe {
+			let comps_ptr: *mut Vec<ElecComp> = &mut comps;
+			libelec_walk_comps_type(self.elec, mask,
+			    Self::comp_walk_cb, comps_ptr as *mut c_void)
+		};
+		comps
+	}
+	/*
+	 * Iterates over all components in index order. Unlike all_comps(),
+	 * this doesn't allocate.
+	 */
+	pub fn comps(&self) -> impl Iterator<Item = ElecComp> + '_ {
+		let n = unsafe { libelec_get_num_comps(self.elec) };
+		(0 .. n).map(move |i| ElecComp{
+			comp: unsafe { libelec_get_comp(self.elec, i) }
+		})
+	}
+	/*
+	 * O(1) lookup of a component constant generated at build time
+	 * (see the `net` module). Unlike comp_find(), this doesn't touch
+	 * the heap. The network must be the one the constant was
+	 * generated for, see check_comps().
+	 */
+	pub fn comp(&self, id: CompId) -> ElecComp {
+		assert!(id.idx < unsafe { libelec_get_num_comps(self.elec) });
+		let comp = ElecComp{
+			comp: unsafe { libelec_get_comp(self.elec, id.idx) }
+		};
+		debug_assert_eq!(comp.get_type(), id.ty);
+		comp
+	}
+	/*
+	 * Checks that the components of the network are exactly `names`,
+	 * in index order. Used by `net::check()` to verify that the
+	 * network loaded at run time is the one the build-time component
+	 * constants were generated for.
+	 */
+	pub fn check_comps(&self, names: &[&str]) -> bool {
+		let n = unsafe { libelec_get_num_comps(self.elec) };
+		n == names.len() &&
+		    self.comps().zip(names).all(|(comp, name)|
+		    self.comp_name(&comp) == *name)
+	}
+	/*
+	 * Non-allocating versions of ElecComp::get_name() and
+	 * ElecComp::get_location(). The strings are part of the network
+	 * definition, so they live as long as the network itself.
+	 */
+	pub fn comp_name(&self, comp: &ElecComp) -> &str {
+		unsafe { c_str(libelec_comp_get_name(comp.comp)) }
+	}
+	pub fn comp_location(&self, comp: &ElecComp) -> &str {
+		unsafe { c_str(libelec_comp_get_location(comp.comp)) }
+	}
+	pub fn view(&self) -> ElecView<'_> {
+		ElecView::new(self)
+	}
+	pub fn query_new(&self) -> ElecQuery {
+		ElecQuery{
+			elec: self.elec,
+			query: unsafe { libelec_query_new(self.elec) }
+		}
+	}
+	/*
+	 * Subscribes to the state published by every worker pass (or
+	 * step()), with up to `depth` snapshots in flight between the
+	 * worker and the consumer. See ElecSnapshots.
+	 */
+	pub fn subscribe(&self, depth: usize) -> ElecSnapshots {
+		ElecSnapshots::new(self, depth)
+	}
 }
 
 impl Drop for ElecSys {
@@ -141,12 +401,130 @@ impl Drop for ElecSys {
 	}
 }
 
+/*
+ * libelec has no thread affinity: a network may be created, stepped and
+ * destroyed on any thread, and all of the interrogation functions
+ * available through `&ElecSys` are safe to call concurrently with each
+ * other and with the network being stepped elsewhere. Anything that
+ * mutates the network's state as a whole requires `&mut ElecSys`.
+ */
+unsafe impl Send for ElecSys {}
+unsafe impl Sync for ElecSys {}
+
+/*
+ * A set of instances of a single network definition, for running many
+ * variants of the same network side by side (e.g. with different
+ * failures or load profiles applied to each instance). The parsed
+ * definition is loaded once and shared by all instances, while each
+ * instance carries its own state and random number generator. None of
+ * the instances may be started (see ElecSys::start()); instead, they
+ * are advanced together using par_step().
+ *
+ * ElecBatch is Send and Sync, so it can be handed to worker threads as
+ * a whole. Callers which prefer their own thread pool can also iterate
+ * over instances_mut() directly and call ElecSys::step() on each one.
+ */
+pub struct ElecBatch {
+	proto: ElecSys,
+	instances: Vec<ElecSys>,
+	n_threads: u32
+}
+
+impl ElecBatch {
+	/*
+	 * Loads the network definition from `filename` and creates
+	 * `n_instances` instances of it.
+	 */
+	pub fn new(filename: &str, n_instances: usize) ->
+	    Result<ElecBatch, ()> {
+		ElecBatch::from_proto(ElecSys::new(filename)?, n_instances)
+	}
+	/*
+	 * Creates `n_instances` instances sharing the definition of
+	 * `proto`. The batch takes ownership of `proto`, which remains
+	 * available through proto(), but isn't stepped by par_step().
+	 */
+	pub fn from_proto(proto: ElecSys, n_instances: usize) ->
+	    Result<ElecBatch, ()> {
+		let n_threads = std::thread::available_parallelism()
+		    .map_or(1, |n| n.get() as u32);
+		let mut batch = ElecBatch{
+		    proto: proto,
+		    instances: Vec::with_capacity(n_instances),
+		    n_threads: n_threads
+		};
+		batch.add_instances(n_instances)?;
+		Ok(batch)
+	}
+	/*
+	 * Appends `n` new instances, in a freshly loaded state.
+	 */
+	pub fn add_instances(&mut self, n: usize) -> Result<(), ()> {
+		for _ in 0..n {
+			let inst = self.proto.new_instance()?;
+			self.instances.push(inst);
+		}
+		Ok(())
+	}
+	pub fn proto(&self) -> &ElecSys {
+		&self.proto
+	}
+	pub fn len(&self) -> usize {
+		self.instances.len()
+	}
+	pub fn instance(&self, idx: usize) -> &ElecSys {
+		&self.instances[idx]
+	}
+	pub fn instance_mut(&mut self, idx: usize) -> &mut ElecSys {
+		&mut self.instances[idx]
+	}
+	pub fn instances(&self) -> &[ElecSys] {
+		&self.instances
+	}
+	pub fn instances_mut(&mut self) -> &mut [ElecSys] {
+		&mut self.instances
+	}
+	/*
+	 * Sets the number of threads used by par_step(). The calling
+	 * thread counts as one of them, so 0 or 1 steps the instances
+	 * serially. Defaults to the available hardware parallelism.
+	 */
+	pub fn set_threads(&mut self, n_threads: u32) {
+		self.n_threads = n_threads;
+	}
+	pub fn threads(&self) -> u32 {
+		self.n_threads
+	}
+	/*
+	 * Advances all instances by a single step of `d_t` seconds,
+	 * spreading them across the batch's threads. The results don't
+	 * depend on the number of threads used.
+	 */
+	pub fn par_step(&mut self, d_t: f64) {
+		let n_threads = self.n_threads
+		    .min(self.instances.len() as u32);
+		ElecSys::step_batch(&mut self.instances, d_t, n_threads);
+	}
+}
+
+/*
+ * Borrows a C string owned by the network definition.
+ */
+unsafe fn c_str<'a>(s: *const c_char) -> &'a str {
+	CStr::from_ptr(s).to_str().expect("Component name not valid UTF-8?!")
+}
+
+/*
+ * Layout-compatible with `elec_comp_t *`, so that slices of components
+ * can be filled in directly by libelec.
+ */
 #[derive(Clone, Copy)]
+#[repr(transparent)]
 pub struct ElecComp {
 	comp: *mut elec_comp_t
 }
 
-#[derive(Debug, PartialEq)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
 #[repr(C)]
 pub enum CompType {
 	Batt,
@@ -163,6 +541,40 @@ pub enum CompType {
 	LabelBox
 }
 
+/*
+ * Index of a component known at build time. Set the LIBELEC_NET
+ * environment variable to the path of a network definition when
+ * building, and build.rs generates a constant for each of its
+ * components into the `net` module (e.g. `net::GEN_1`), so misspelled
+ * component names are caught by the compiler. Use them with
+ * ElecSys::comp(), ElecView::comp_id() and ElecSnapshot::get().
+ */
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct CompId {
+	idx: usize,
+	ty: CompType
+}
+
+impl CompId {
+	pub const fn new(idx: usize, ty: CompType) -> CompId {
+		CompId{idx: idx, ty: ty}
+	}
+	pub fn idx(&self) -> usize {
+		self.idx
+	}
+	pub fn get_type(&self) -> CompType {
+		self.ty
+	}
+}
+
+#[cfg(libelec_net)]
+pub mod net {
+	use super::CompId;
+	use super::CompType;
+	use super::ElecSys;
+	include!(concat!(env!("OUT_DIR"), "/net_comps.rs"));
+}
+
 impl ElecComp {
 	/*
 	 * Configuration interrogation
@@ -241,16 +653,64 @@ impl ElecComp {
 		unsafe { libelec_comp_get_eff(self.comp) }
 	}
 	pub fn get_srcs(&self) -> Vec<ElecComp> {
-		let mut srcs_array: [*mut elec_comp_t; ELEC_MAX_SRCS] =
-		    [std::ptr::null_mut(); ELEC_MAX_SRCS];
-		let n = unsafe {
-			libelec_comp_get_srcs(self.comp, &mut srcs_array)
+		let mut srcs: Vec<*mut elec_comp_t> = vec![];
+		/* Retry if more sources showed up since we counted them */
+		loop {
+			let n = unsafe {
+				libelec_comp_get_src_list(self.comp,
+				    srcs.len(), srcs.as_mut_ptr())
+			};
+			if n <= srcs.len() {
+				srcs.truncate(n);
+				break;
+			}
+			srcs.resize(n, std::ptr::null_mut());
+		}
+		srcs.into_iter().map(|comp| ElecComp{ comp: comp }).collect()
+	}
+	pub fn has_src(&self, src: &ElecComp) -> bool {
+		unsafe { libelec_comp_has_src(self.comp, src.comp) }
+	}
+	pub fn get_pwr_acct(&self) -> ElecPwrAcct {
+		let mut acct = ElecPwrAcct::default();
+		unsafe { libelec_comp_get_pwr_acct(self.comp, &mut acct) };
+		acct
+	}
+	/*
+	 * Power accounting of a whole set of components, read out of a
+	 * single worker pass. The components must belong to the same
+	 * network.
+	 */
+	pub fn get_pwr_accts(comps: &[ElecComp]) -> Vec<ElecPwrAcct> {
+		let mut accts = vec![ElecPwrAcct::default(); comps.len()];
+		unsafe {
+			libelec_comps_get_pwr_acct(
+			    comps.as_ptr() as *const *const elec_comp_t,
+			    comps.len(), accts.as_mut_ptr())
 		};
-		let mut srcs: Vec<ElecComp> = vec![];
-		for i in 0 .. n {
-			srcs.push(ElecComp{ comp: srcs_array[i] });
+		accts
+	}
+	/*
+	 * Power flow tracing (batteries & generators only)
+	 */
+	pub fn trace(&self) -> Vec<ElecTraceNode> {
+		let mut nodes: Vec<ElecTraceNode> = vec![];
+		/* Retry if the trace grew since we counted its nodes */
+		loop {
+			let n = unsafe {
+				libelec_comp_trace(self.comp, nodes.len(),
+				    nodes.as_mut_ptr())
+			};
+			if n <= nodes.len() {
+				nodes.truncate(n);
+				break;
+			}
+			nodes.resize(n, ElecTraceNode::default());
 		}
-		srcs
+		nodes
+	}
+	pub fn print_trace(&self) {
+		unsafe { libelec_comp_print_trace(self.comp) }
 	}
 	/*
 	 * Failures
@@ -273,6 +733,15 @@ impl ElecComp {
 	pub fn set_random_freq(&mut self, stddev: f64) -> f64 {
 		unsafe { libelec_gen_set_random_freq(self.comp, stddev) }
 	}
+	/*
+	 * Callback-free inputs. See libelec_comp_set_input().
+	 */
+	pub fn set_input(&mut self, value: f64) {
+		unsafe { libelec_comp_set_input(self.comp, value) }
+	}
+	pub fn clear_input(&mut self) {
+		unsafe { libelec_comp_clear_input(self.comp) }
+	}
 	/*
 	 * CBs
 	 */
@@ -326,6 +795,43 @@ impl ElecComp {
 		assert_eq!(self.get_type(), CompType::Tie);
 		unsafe { libelec_tie_get_num_buses(self.comp) }
 	}
+	/*
+	 * Port numbers for tie_set_mask() and tie_get_mask(), stable
+	 * for as long as the network exists.
+	 */
+	pub fn tie_get_port(&self, bus: &ElecComp) -> Option<u32> {
+		assert_eq!(self.get_type(), CompType::Tie);
+		let port = unsafe { libelec_tie_get_port(self.comp, bus.comp) };
+		if port >= 0 { Some(port as u32) } else { None }
+	}
+	pub fn tie_set_mask(&mut self, mask: u64) -> u64 {
+		assert_eq!(self.get_type(), CompType::Tie);
+		unsafe { libelec_tie_set_mask(self.comp, mask) }
+	}
+	pub fn tie_get_mask(&self) -> u64 {
+		assert_eq!(self.get_type(), CompType::Tie);
+		unsafe { libelec_tie_get_mask(self.comp) }
+	}
+	/*
+	 * Loads
+	 */
+	pub fn load_set_demand_cache(&mut self, cache: bool, max_age: f64) {
+		assert_eq!(self.get_type(), CompType::Load);
+		unsafe { libelec_load_set_demand_cache(self.comp, cache,
+		    max_age) }
+	}
+	pub fn load_get_demand_cache(&self) -> (bool, f64) {
+		assert_eq!(self.get_type(), CompType::Load);
+		let mut max_age: f64 = 0.0;
+		let cache = unsafe {
+			libelec_load_get_demand_cache(self.comp, &mut max_age)
+		};
+		(cache, max_age)
+	}
+	pub fn load_invalidate(&self) {
+		assert_eq!(self.get_type(), CompType::Load);
+		unsafe { libelec_load_invalidate(self.comp) }
+	}
 	/*
 	 * Batteries
 	 */
@@ -356,74 +862,660 @@ impl ElecComp {
 }
 
 /*
- * libelec C interface
+ * A single hop of a power flow trace, see ElecComp::trace().
  */
-type elec_user_cb_t = extern "C" fn(*mut c_void);
-type elec_comp_walk_cb_t = extern "C" fn(*mut elec_comp_t, *mut c_void);
-type elec_get_temp_cb_t = extern "C" fn(*mut elec_comp_t,
-    userinfo: *mut c_void) -> f64;
-type elec_get_rpm_cb_t = extern "C" fn(*mut elec_comp_t,
-    userinfo: *mut c_void) -> f64;
-type elec_get_load_cb_t = extern "C" fn(*mut elec_comp_t,
-    userinfo: *mut c_void) -> f64;
-
+#[derive(Clone, Copy)]
 #[repr(C)]
-pub struct elec_t {
-	_unused: [u8; 0],
+#[allow(non_snake_case)]
+pub struct ElecTraceNode {
+	pub comp: ElecComp,
+	pub parent: c_int,	/* -1 for the source itself */
+	pub depth: u32,
+	pub W: f64,
+	pub W_loads: f64
 }
 
+/*
+ * Power accounting of a single component, see ElecComp::get_pwr_acct().
+ */
+#[derive(Clone, Copy, Debug, Default)]
 #[repr(C)]
-pub struct elec_comp_t {
-	_unused: [u8; 0],
+pub struct ElecPwrAcct {
+	pub in_amps: f64,
+	pub out_amps: f64,
+	pub in_pwr: f64,
+	pub out_pwr: f64,
+	pub in_energy: f64,	/* Joules since the network was created */
+	pub out_energy: f64
 }
 
-const ELEC_MAX_SRCS: usize =	64;
+impl Default for ElecTraceNode {
+	fn default() -> ElecTraceNode {
+		ElecTraceNode {
+			comp: ElecComp{ comp: std::ptr::null_mut() },
+			parent: -1,
+			depth: 0,
+			W: 0.0,
+			W_loads: 0.0
+		}
+	}
+}
 
-extern "C" {
-	fn libelec_new(filename: *const c_char) -> *mut elec_t;
-	fn libelec_destroy(elec: *mut elec_t);
+#[derive(Clone, Copy, Debug, PartialEq)]
+#[repr(C)]
+pub enum Quantity {
+	InVolts,
+	OutVolts,
+	InAmps,
+	OutAmps,
+	InPwr,
+	OutPwr,
+	InFreq,
+	OutFreq
+}
 
-	fn libelec_sys_start(elec: *mut elec_t) -> bool;
-	fn libelec_sys_stop(elec: *mut elec_t);
-	fn libelec_sys_is_started(elec: *const elec_t) -> bool;
-	fn libelec_sys_can_start(elec: *const elec_t) -> bool;
+/*
+ * Why ElecSys::fast_forward() stopped.
+ */
+#[derive(Clone, Copy, Debug, PartialEq)]
+#[repr(C)]
+pub enum FastFwdStop {
+	Done,
+	Switched,
+	Watch
+}
 
-	fn libelec_sys_set_time_factor(elec: *mut elec_t, time_factor: f64);
-	fn libelec_sys_get_time_factor(elec: *const elec_t) -> f64;
+/*
+ * Worker pass phases, indexing ElecStats::phases.
+ */
+#[derive(Clone, Copy, Debug, PartialEq)]
+#[repr(C)]
+pub enum Phase {
+	Reset,
+	SrcsUpdate,
+	LoadsRandomize,
+	Incr,
+	Paint,
+	LoadIntegrate,
+	LoadsUpdate,
+	TiesUpdate,
+	StateXfer
+}
 
-	fn libelec_add_user_cb(elec: *mut elec_t, pre: bool,
-	    cb: elec_user_cb_t, userinfo: *mut c_void);
-	fn libelec_remove_user_cb(elec: *mut elec_t, pre: bool,
-	    cb: elec_user_cb_t, userinfo: *mut c_void);
+const ELEC_NUM_PHASES: usize =	9;
+const ELEC_NUM_JITTER_BUCKETS: usize =	8;
 
-	fn libelec_comp_find(elec: *const elec_t, name: *const c_char) ->
-	    *mut elec_comp_t;
-	fn libelec_walk_comps(elec: *const elec_t, cb: elec_comp_walk_cb_t,
-	    userinfo: *mut c_void);
+/*
+ * Timing statistics of a single quantity, in seconds.
+ */
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct ElecTiming {
+	pub n: u64,
+	pub last: f64,
+	pub min: f64,
+	pub max: f64,
+	pub avg: f64
+}
 
-	fn libelec_comp_get_num_conns(comp: *const elec_comp_t) -> usize;
-	fn libelec_comp_get_conn(comp: *const elec_comp_t, i: usize) ->
-	    *mut elec_comp_t;
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct ElecStats {
+	pub n_passes: u64,
+	pub d_t: ElecTiming,
+	pub pass: ElecTiming,
+	pub interlock: ElecTiming,
+	pub phases: [ElecTiming; ELEC_NUM_PHASES],
+	pub pre_user_cbs: ElecTiming,
+	pub post_user_cbs: ElecTiming,
+	pub load_cbs: ElecTiming,
+	pub rpm_cbs: ElecTiming,
+	pub temp_cbs: ElecTiming,
+	pub paint_visits: u32,
+	pub integ_visits: u32,
+	pub jitter: ElecTiming,
+	pub jitter_hist: [u64; ELEC_NUM_JITTER_BUCKETS],
+	pub wake_err: ElecTiming,
+	pub allocs: u32,
+	pub max_allocs: u32
+}
 
-	fn libelec_comp_is_AC(comp: *const elec_comp_t) -> bool;
-	fn libelec_comp_get_name(comp: *const elec_comp_t) -> *const c_char;
-	fn libelec_comp_get_type(comp: *const elec_comp_t) -> CompType;
-	fn libelec_comp_get_location(comp: *const elec_comp_t) -> *const c_char;
-	fn libelec_comp_get_autogen(comp: *const elec_comp_t) -> bool;
+impl ElecStats {
+	pub fn phase(&self, phase: Phase) -> &ElecTiming {
+		&self.phases[phase as usize]
+	}
+}
 
-	fn libelec_comp_get_in_volts(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_out_volts(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_in_amps(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_out_amps(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_in_pwr(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_out_pwr(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_in_freq(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_out_freq(comp: *const elec_comp_t) -> f64;
+/*
+ * Precompiled bulk state query. Must be dropped before the ElecSys
+ * from which it was created.
+ */
+pub struct ElecQuery {
+	elec: *mut elec_t,
+	query: *mut elec_query_t
+}
+
+impl ElecQuery {
+	pub fn add(&mut self, comp: &ElecComp, qty: Quantity) -> usize {
+		unsafe { libelec_query_add(self.query, comp.comp, qty) }
+	}
+	pub fn len(&self) -> usize {
+		unsafe { libelec_query_get_len(self.query) }
+	}
+	pub fn read(&self, values: &mut [f64]) {
+		assert!(values.len() >= self.len());
+		unsafe {
+			libelec_sys_read_many(self.elec, self.query,
+			    values.as_mut_ptr())
+		}
+	}
+	pub fn read_vec(&self) -> Vec<f64> {
+		let mut values = vec![0.0; self.len()];
+		self.read(&mut values);
+		values
+	}
+}
+
+impl Drop for ElecQuery {
+	fn drop(&mut self) {
+		unsafe { libelec_query_destroy(self.query) }
+	}
+}
+
+/*
+ * A consistent view of the state of all components in a network, which
+ * is read in a single call to ElecView::refresh(). All buffers are
+ * allocated up front, so refreshing and reading the view doesn't touch
+ * the heap, except when the number of powered sources in the network
+ * grows past what it has seen before. Component names, locations and
+ * sources are borrowed from the network, so the view can't outlive it.
+ */
+pub struct ElecView<'a> {
+	sys: &'a ElecSys,
+	query: ElecQuery,
+	values: Vec<f64>,
+	srcs_start: Vec<u32>,
+	srcs: Vec<ElecComp>
+}
+
+const VIEW_QTYS: [Quantity; 8] = [
+	Quantity::InVolts, Quantity::OutVolts,
+	Quantity::InAmps, Quantity::OutAmps,
+	Quantity::InPwr, Quantity::OutPwr,
+	Quantity::InFreq, Quantity::OutFreq
+];
+
+impl<'a> ElecView<'a> {
+	/*
+	 * Creates a view and reads the current network state into it.
+	 */
+	pub fn new(sys: &'a ElecSys) -> ElecView<'a> {
+		let mut query = sys.query_new();
+		for comp in sys.comps() {
+			for qty in VIEW_QTYS {
+				query.add(&comp, qty);
+			}
+		}
+		let n_comps = unsafe { libelec_get_num_comps(sys.elec) };
+		let mut view = ElecView{
+			sys: sys,
+			values: vec![0.0; query.len()],
+			query: query,
+			srcs_start: vec![0; n_comps + 1],
+			srcs: vec![]
+		};
+		view.refresh();
+		view
+	}
+	/*
+	 * Re-reads the network state into the view.
+	 */
+	pub fn refresh(&mut self) {
+		loop {
+			let n_srcs = unsafe {
+				libelec_sys_read_view(self.sys.elec,
+				    self.query.query, self.values.as_mut_ptr(),
+				    self.srcs_start.as_mut_ptr(),
+				    self.srcs.as_mut_ptr() as *mut*mut elec_comp_t,
+				    self.srcs.len())
+			};
+			if n_srcs <= self.srcs.len() {
+				break;
+			}
+			self.srcs.resize(n_srcs, ElecComp{
+				comp: std::ptr::null_mut()
+			});
+		}
+	}
+	pub fn len(&self) -> usize {
+		self.srcs_start.len() - 1
+	}
+	pub fn comp(&self, idx: usize) -> CompView<'_, 'a> {
+		assert!(idx < self.len());
+		CompView{view: self, idx: idx}
+	}
+	pub fn comps(&self) -> impl Iterator<Item = CompView<'_, 'a>> {
+		(0 .. self.len()).map(move |idx| CompView{view: self, idx: idx})
+	}
+	pub fn comp_id(&self, id: CompId) -> CompView<'_, 'a> {
+		self.comp(id.idx)
+	}
+}
+
+/*
+ * A single component in an ElecView.
+ */
+#[derive(Clone, Copy)]
+pub struct CompView<'v, 'a> {
+	view: &'v ElecView<'a>,
+	idx: usize
+}
+
+impl<'v, 'a> CompView<'v, 'a> {
+	pub fn comp(&self) -> ElecComp {
+		ElecComp{
+			comp: unsafe { libelec_get_comp(self.view.sys.elec,
+			    self.idx) }
+		}
+	}
+	pub fn get_name(&self) -> &'a str {
+		self.view.sys.comp_name(&self.comp())
+	}
+	pub fn get_location(&self) -> &'a str {
+		self.view.sys.comp_location(&self.comp())
+	}
+	pub fn get_type(&self) -> CompType {
+		self.comp().get_type()
+	}
+	pub fn get_autogen(&self) -> bool {
+		self.comp().get_autogen()
+	}
+	fn value(&self, qty: Quantity) -> f64 {
+		self.view.values[self.idx * VIEW_QTYS.len() + qty as usize]
+	}
+	pub fn in_volts(&self) -> f64 {
+		self.value(Quantity::InVolts)
+	}
+	pub fn out_volts(&self) -> f64 {
+		self.value(Quantity::OutVolts)
+	}
+	pub fn in_amps(&self) -> f64 {
+		self.value(Quantity::InAmps)
+	}
+	pub fn out_amps(&self) -> f64 {
+		self.value(Quantity::OutAmps)
+	}
+	pub fn in_pwr(&self) -> f64 {
+		self.value(Quantity::InPwr)
+	}
+	pub fn out_pwr(&self) -> f64 {
+		self.value(Quantity::OutPwr)
+	}
+	pub fn in_freq(&self) -> f64 {
+		self.value(Quantity::InFreq)
+	}
+	pub fn out_freq(&self) -> f64 {
+		self.value(Quantity::OutFreq)
+	}
+	pub fn get_srcs(&self) -> &'v [ElecComp] {
+		let start = self.view.srcs_start[self.idx] as usize;
+		let end = self.view.srcs_start[self.idx + 1] as usize;
+		&self.view.srcs[start .. end]
+	}
+}
+
+/*
+ * Subscription to the network state published by every worker pass,
+ * see ElecSys::subscribe(). Right after the new state is published, the
+ * worker reads the state of all components into one of `depth` recycled
+ * buffers and queues it up for the consumer, so the consumer gets to
+ * process every pass exactly once, without polling or any per-value
+ * FFI calls. If the consumer falls behind and all buffers are in use,
+ * the worker skips the pass rather than waiting for the consumer (see
+ * ElecSnapshot::missed()). Must be dropped before the ElecSys from
+ * which it was created.
+ */
+pub struct ElecSnapshots {
+	sub: Box<SnapSub>
+}
+
+/*
+ * A single published network state. The values of every quantity are
+ * stored contiguously, in component index order (see ElecSys::comps()).
+ * Dropping the snapshot hands its buffer back to the worker.
+ */
+pub struct ElecSnapshot {
+	pool: Arc<SnapPool>,
+	tick: u64,
+	missed: u64,
+	n_comps: usize,
+	values: Vec<f64>
+}
+
+struct SnapSub {
+	elec: *mut elec_t,
+	query: ElecQuery,
+	n_comps: usize,
+	pool: Arc<SnapPool>
+}
+
+struct SnapPool {
+	queue: Mutex<SnapQueue>,
+	cv: Condvar
+}
+
+struct SnapQueue {
+	ready: VecDeque<(u64, u64, Vec<f64>)>,
+	free: Vec<Vec<f64>>,
+	tick: u64,
+	missed: u64
+}
+
+/* The worker only touches the subscription through the pool lock */
+unsafe impl Send for ElecSnapshots {}
+
+impl SnapPool {
+	fn lock(&self) -> MutexGuard<'_, SnapQueue> {
+		/* never panic on the worker thread */
+		self.queue.lock().unwrap_or_else(|e| e.into_inner())
+	}
+}
+
+impl ElecSnapshots {
+	fn new(sys: &ElecSys, depth: usize) -> ElecSnapshots {
+		assert!(depth > 0);
+		let mut query = sys.query_new();
+		for qty in VIEW_QTYS {
+			for comp in sys.comps() {
+				query.add(&comp, qty);
+			}
+		}
+		let len = query.len();
+		let sub = Box::new(SnapSub{
+			elec: sys.elec,
+			query: query,
+			n_comps: unsafe { libelec_get_num_comps(sys.elec) },
+			pool: Arc::new(SnapPool{
+				queue: Mutex::new(SnapQueue{
+					ready: VecDeque::with_capacity(depth),
+					free: (0 .. depth)
+					    .map(|_| vec![0.0; len]).collect(),
+					tick: 0,
+					missed: 0
+				}),
+				cv: Condvar::new()
+			})
+		});
+		unsafe {
+			libelec_add_user_cb(sys.elec, false, Self::post_cb,
+			    &*sub as *const SnapSub as *mut c_void)
+		};
+		ElecSnapshots{sub: sub}
+	}
+	extern "C" fn post_cb(_elec: *mut elec_t, _pre: bool,
+	    userinfo: *mut c_void) {
+		let sub = unsafe { &*(userinfo as *const SnapSub) };
+		let mut queue = sub.pool.lock();
+		queue.tick += 1;
+		let tick = queue.tick;
+		let Some(mut values) = queue.free.pop() else {
+			queue.missed += 1;
+			return;
+		};
+		drop(queue);
+		sub.query.read(&mut values);
+		let mut queue = sub.pool.lock();
+		let missed = std::mem::take(&mut queue.missed);
+		queue.ready.push_back((tick, missed, values));
+		sub.pool.cv.notify_one();
+	}
+	fn wrap(&self, (tick, missed, values): (u64, u64, Vec<f64>)) ->
+	    ElecSnapshot {
+		ElecSnapshot{
+			pool: self.sub.pool.clone(),
+			tick: tick,
+			missed: missed,
+			n_comps: self.sub.n_comps,
+			values: values
+		}
+	}
+	/*
+	 * Blocks until the next snapshot is published.
+	 */
+	pub fn recv(&self) -> ElecSnapshot {
+		let mut queue = self.sub.pool.lock();
+		loop {
+			if let Some(snap) = queue.ready.pop_front() {
+				drop(queue);
+				return self.wrap(snap);
+			}
+			queue = self.sub.pool.cv.wait(queue)
+			    .unwrap_or_else(|e| e.into_inner());
+		}
+	}
+	/*
+	 * Same as recv(), but gives up after `timeout`.
+	 */
+	pub fn recv_timeout(&self, timeout: Duration) ->
+	    Option<ElecSnapshot> {
+		let queue = self.sub.pool.lock();
+		let (mut queue, _) = self.sub.pool.cv.wait_timeout_while(
+		    queue, timeout, |queue| queue.ready.is_empty())
+		    .unwrap_or_else(|e| e.into_inner());
+		let snap = queue.ready.pop_front();
+		drop(queue);
+		snap.map(|snap| self.wrap(snap))
+	}
+	/*
+	 * Returns the next snapshot, if one has already been published.
+	 */
+	pub fn try_recv(&self) -> Option<ElecSnapshot> {
+		let snap = self.sub.pool.lock().ready.pop_front();
+		snap.map(|snap| self.wrap(snap))
+	}
+}
+
+impl Iterator for ElecSnapshots {
+	type Item = ElecSnapshot;
+	/*
+	 * Never ends, blocks until the next snapshot is published.
+	 */
+	fn next(&mut self) -> Option<ElecSnapshot> {
+		Some(self.recv())
+	}
+}
+
+impl Drop for ElecSnapshots {
+	fn drop(&mut self) {
+		/* synchronizes with the worker, so post_cb() is done */
+		unsafe {
+			libelec_remove_user_cb(self.sub.elec, false,
+			    Self::post_cb,
+			    &*self.sub as *const SnapSub as *mut c_void)
+		}
+	}
+}
+
+impl ElecSnapshot {
+	/*
+	 * Number of worker passes since the subscription was created,
+	 * including this one.
+	 */
+	pub fn tick(&self) -> u64 {
+		self.tick
+	}
+	/*
+	 * Number of passes just before this one, which were skipped
+	 * because the consumer hadn't released any of its buffers.
+	 */
+	pub fn missed(&self) -> u64 {
+		self.missed
+	}
+	pub fn len(&self) -> usize {
+		self.n_comps
+	}
+	/*
+	 * The values of `qty` of all components, in index order.
+	 */
+	pub fn values(&self, qty: Quantity) -> &[f64] {
+		let start = qty as usize * self.n_comps;
+		&self.values[start .. start + self.n_comps]
+	}
+	/*
+	 * The value of `qty` of a single component.
+	 */
+	pub fn get(&self, qty: Quantity, id: CompId) -> f64 {
+		self.values(qty)[id.idx]
+	}
+	pub fn in_volts(&self) -> &[f64] {
+		self.values(Quantity::InVolts)
+	}
+	pub fn out_volts(&self) -> &[f64] {
+		self.values(Quantity::OutVolts)
+	}
+	pub fn in_amps(&self) -> &[f64] {
+		self.values(Quantity::InAmps)
+	}
+	pub fn out_amps(&self) -> &[f64] {
+		self.values(Quantity::OutAmps)
+	}
+	pub fn in_pwr(&self) -> &[f64] {
+		self.values(Quantity::InPwr)
+	}
+	pub fn out_pwr(&self) -> &[f64] {
+		self.values(Quantity::OutPwr)
+	}
+	pub fn in_freq(&self) -> &[f64] {
+		self.values(Quantity::InFreq)
+	}
+	pub fn out_freq(&self) -> &[f64] {
+		self.values(Quantity::OutFreq)
+	}
+}
+
+impl Drop for ElecSnapshot {
+	fn drop(&mut self) {
+		let values = std::mem::take(&mut self.values);
+		self.pool.lock().free.push(values);
+	}
+}
+
+/*
+ * libelec C interface
+ */
+type elec_user_cb_t = extern "C" fn(*mut elec_t, bool, *mut c_void);
+type elec_comp_walk_cb_t = extern "C" fn(*mut elec_comp_t, *mut c_void);
+type elec_get_temp_cb_t = extern "C" fn(*mut elec_comp_t,
+    userinfo: *mut c_void) -> f64;
+type elec_get_rpm_cb_t = extern "C" fn(*mut elec_comp_t,
+    userinfo: *mut c_void) -> f64;
+type elec_get_load_cb_t = extern "C" fn(*mut elec_comp_t,
+    userinfo: *mut c_void) -> f64;
+
+#[repr(C)]
+pub struct elec_t {
+	_unused: [u8; 0],
+}
+
+#[repr(C)]
+pub struct elec_comp_t {
+	_unused: [u8; 0],
+}
+
+#[repr(C)]
+pub struct elec_query_t {
+	_unused: [u8; 0],
+}
+
+extern "C" {
+	fn libelec_new(filename: *const c_char) -> *mut elec_t;
+	fn libelec_new_instance(proto: *const elec_t) -> *mut elec_t;
+	fn libelec_destroy(elec: *mut elec_t);
+
+	fn libelec_sys_start(elec: *mut elec_t) -> bool;
+	fn libelec_sys_stop(elec: *mut elec_t);
+	fn libelec_sys_step(elec: *mut elec_t, d_t: f64);
+	fn libelec_sys_set_host_tick(elec: *mut elec_t, flag: bool);
+	fn libelec_sys_get_host_tick(elec: *const elec_t) -> bool;
+	fn libelec_sys_tick(elec: *mut elec_t);
+	fn libelec_sys_set_input_wake(elec: *mut elec_t, min_intval: f64);
+	fn libelec_sys_get_input_wake(elec: *const elec_t) -> f64;
+	fn libelec_sys_settle(elec: *mut elec_t, tol: f64, max_iter: u32)
+	    -> bool;
+	fn libelec_sys_fast_forward(elec: *mut elec_t, seconds: f64,
+	    stop: *mut FastFwdStop) -> f64;
+	fn libelec_sys_step_batch(systems: *const *mut elec_t, n_sys: usize,
+	    d_t: f64, n_threads: u32);
+	fn libelec_sys_set_stats_enabled(elec: *mut elec_t, enabled: bool);
+	fn libelec_sys_get_stats_enabled(elec: *const elec_t) -> bool;
+	fn libelec_sys_get_stats(elec: *mut elec_t, stats: *mut ElecStats);
+	fn libelec_sys_reset_stats(elec: *mut elec_t);
+	fn libelec_sys_is_started(elec: *const elec_t) -> bool;
+	fn libelec_sys_can_start(elec: *const elec_t) -> bool;
+
+	fn libelec_sys_set_seed(elec: *mut elec_t, seed: u64);
+	fn libelec_sys_set_time_factor(elec: *mut elec_t, time_factor: f64);
+	fn libelec_sys_get_time_factor(elec: *const elec_t) -> f64;
+
+	fn libelec_add_user_cb(elec: *mut elec_t, pre: bool,
+	    cb: elec_user_cb_t, userinfo: *mut c_void);
+	fn libelec_remove_user_cb(elec: *mut elec_t, pre: bool,
+	    cb: elec_user_cb_t, userinfo: *mut c_void);
+
+	fn libelec_comp_find(elec: *const elec_t, name: *const c_char) ->
+	    *mut elec_comp_t;
+	fn libelec_walk_comps(elec: *const elec_t, cb: elec_comp_walk_cb_t,
+	    userinfo: *mut c_void);
+	fn libelec_walk_comps_type(elec: *const elec_t, type_mask: u32,
+	    cb: elec_comp_walk_cb_t, userinfo: *mut c_void);
+	fn libelec_get_num_comps(elec: *const elec_t) -> usize;
+	fn libelec_get_comp(elec: *const elec_t, idx: usize) ->
+	    *mut elec_comp_t;
+
+	fn libelec_comp_get_num_conns(comp: *const elec_comp_t) -> usize;
+	fn libelec_comp_get_conn(comp: *const elec_comp_t, i: usize) ->
+	    *mut elec_comp_t;
+
+	fn libelec_comp_is_AC(comp: *const elec_comp_t) -> bool;
+	fn libelec_comp_get_name(comp: *const elec_comp_t) -> *const c_char;
+	fn libelec_comp_get_type(comp: *const elec_comp_t) -> CompType;
+	fn libelec_comp_get_location(comp: *const elec_comp_t) -> *const c_char;
+	fn libelec_comp_get_autogen(comp: *const elec_comp_t) -> bool;
+
+	fn libelec_comp_get_in_volts(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_out_volts(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_in_amps(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_out_amps(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_in_pwr(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_out_pwr(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_in_freq(comp: *const elec_comp_t) -> f64;
+	fn libelec_comp_get_out_freq(comp: *const elec_comp_t) -> f64;
 	fn libelec_comp_get_incap_volts(comp: *const elec_comp_t) -> f64;
 	fn libelec_comp_is_powered(comp: *const elec_comp_t) -> bool;
 	fn libelec_comp_get_eff(comp: *const elec_comp_t) -> f64;
-	fn libelec_comp_get_srcs(comp: *const elec_comp_t,
-	    srcs: &mut [*mut elec_comp_t; ELEC_MAX_SRCS]) -> usize;
+	fn libelec_comp_get_src_list(comp: *const elec_comp_t, cap: usize,
+	    srcs: *mut *mut elec_comp_t) -> usize;
+	fn libelec_comp_has_src(comp: *const elec_comp_t,
+	    src: *const elec_comp_t) -> bool;
+	fn libelec_comp_trace(src: *const elec_comp_t, cap: usize,
+	    nodes: *mut ElecTraceNode) -> usize;
+	fn libelec_comp_print_trace(src: *const elec_comp_t);
+	fn libelec_comp_get_pwr_acct(comp: *const elec_comp_t,
+	    acct: *mut ElecPwrAcct);
+	fn libelec_comps_get_pwr_acct(comps: *const *const elec_comp_t,
+	    n: usize, accts: *mut ElecPwrAcct);
+
+	fn libelec_query_new(elec: *mut elec_t) -> *mut elec_query_t;
+	fn libelec_query_destroy(query: *mut elec_query_t);
+	fn libelec_query_add(query: *mut elec_query_t,
+	    comp: *const elec_comp_t, qty: Quantity) -> usize;
+	fn libelec_query_get_len(query: *const elec_query_t) -> usize;
+	fn libelec_sys_read_many(elec: *const elec_t,
+	    query: *const elec_query_t, values: *mut f64);
+	fn libelec_sys_read_view(elec: *const elec_t,
+	    query: *const elec_query_t, values: *mut f64,
+	    srcs_start: *mut u32, srcs: *mut*mut elec_comp_t,
+	    srcs_cap: usize) -> usize;
 
 	fn libelec_comp_set_failed(comp: *mut elec_comp_t, failed: bool);
 	fn libelec_comp_get_failed(comp: *const elec_comp_t) -> bool;
@@ -449,10 +1541,18 @@ extern "C" {
 	fn libelec_gen_get_rpm_cb(gen: *const elec_comp_t) ->
 	    elec_get_rpm_cb_t;
 
+	fn libelec_comp_set_input(comp: *mut elec_comp_t, value: f64);
+	fn libelec_comp_clear_input(comp: *mut elec_comp_t);
+
 	fn libelec_load_set_load_cb(load: *mut elec_comp_t,
 	    cb: elec_get_load_cb_t);
 	fn libelec_load_get_load_cb(load: *const elec_comp_t) ->
 	    elec_get_load_cb_t;
+	fn libelec_load_set_demand_cache(load: *mut elec_comp_t, cache: bool,
+	    max_age: f64);
+	fn libelec_load_get_demand_cache(load: *const elec_comp_t,
+	    max_age: *mut f64) -> bool;
+	fn libelec_load_invalidate(load: *mut elec_comp_t);
 
 	fn libelec_cb_set(comp: *mut elec_comp_t, set: bool);
 	fn libelec_cb_get(comp: *const elec_comp_t) -> bool;
@@ -465,6 +1565,10 @@ extern "C" {
 	fn libelec_tie_get_list(comp: *const elec_comp_t, cap: usize,
 	    bus_list: *mut*mut elec_comp_t) -> usize;
 	fn libelec_tie_get_num_buses(comp: *const elec_comp_t) -> usize;
+	fn libelec_tie_get_port(tie: *const elec_comp_t,
+	    bus: *const elec_comp_t) -> c_int;
+	fn libelec_tie_set_mask(tie: *mut elec_comp_t, mask: u64) -> u64;
+	fn libelec_tie_get_mask(tie: *const elec_comp_t) -> u64;
 
 	fn libelec_batt_get_chg_rel(batt: *const elec_comp_t) -> f64;
 	fn libelec_batt_set_chg_rel(batt: *mut elec_comp_t, chg_rel: f64);
@@ -476,10 +1580,20 @@ extern "C" {
 	pub fn libelec_phys_get_batt_voltage(U_nominal: f64, chg_rel: f64,
 	    I_rel: f64) -> f64;
 
+	fn libelec_write_image(sys: *const elec_t, filename: *const c_char) ->
+	    bool;
 	fn libelec_serialize(sys: *const elec_t, ser: *mut conf_t,
 	    prefix: *const c_char);
 	fn libelec_deserialize(sys: *mut elec_t, ser: *const conf_t,
 	    prefix: *const c_char) -> bool;
+	fn libelec_sys_set_history(sys: *mut elec_t, seconds: f64,
+	    max_bytes: usize);
+	fn libelec_sys_get_history_span(sys: *mut elec_t) -> f64;
+	fn libelec_sys_history_seek(sys: *mut elec_t, secs_ago: f64) -> bool;
+	fn libelec_snapshot_save(sys: *mut elec_t, buf: *mut c_void,
+	    cap: usize) -> usize;
+	fn libelec_snapshot_restore(sys: *mut elec_t, buf: *const c_void,
+	    len: usize) -> bool;
 }
 
 mod tests {
@@ -551,6 +1665,396 @@ mod tests {
 		acfutils::log::fini();
 	}
 	#[test]
+	fn step_stopped_net() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		assert!(!sys.is_started());
+		assert!(sys.all_comps().iter().any(|comp| comp.is_powered()));
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn fast_forward_stopped_net() {
+		use crate::{ElecSys, FastFwdStop};
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let (done, stop) = sys.fast_forward(3600.0);
+		assert_eq!(stop, FastFwdStop::Done);
+		assert!((done - 3600.0).abs() < 1e-6);
+		assert!(!sys.is_started());
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn seeded_runs_match() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys1 = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let mut sys2 = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		sys1.set_seed(1234);
+		sys2.set_seed(1234);
+		for _ in 0..25 {
+			sys1.step(0.04);
+		}
+		for _ in 0..25 {
+			sys2.step(0.04);
+		}
+		for (comp1, comp2) in sys1.all_comps().iter()
+		    .zip(sys2.all_comps().iter()) {
+			assert_eq!(comp1.out_amps(), comp2.out_amps());
+			assert_eq!(comp1.in_volts(), comp2.in_volts());
+		}
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn step_instance_batch() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let proto = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let mut systems: Vec<ElecSys> = (0..8).map(|_| proto
+		    .new_instance().expect("Failed to create instance"))
+		    .collect();
+		/* Instances must outlive the network they were created from */
+		drop(proto);
+		for sys in systems.iter_mut() {
+			sys.set_seed(42);
+		}
+		systems[1].comp_find("MAIN_BATT")
+		    .expect("MAIN_BATT not found").set_failed(true);
+		for _ in 0..25 {
+			ElecSys::step_batch(&mut systems, 0.04, 4);
+		}
+		let batt_volts: Vec<f64> = systems.iter().map(|sys| sys
+		    .comp_find("MAIN_BATT").expect("MAIN_BATT not found")
+		    .out_volts()).collect();
+		assert!(batt_volts[0] > 0.0);
+		assert_eq!(batt_volts[1], 0.0);
+		for volts in batt_volts.iter().skip(2) {
+			assert_eq!(*volts, batt_volts[0]);
+		}
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn batch_par_step() {
+		use crate::ElecBatch;
+
+		fn assert_send_sync<T: Send + Sync>() {}
+		assert_send_sync::<ElecBatch>();
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut batch = ElecBatch::new(TEST_NET_FILE, 6)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		batch.set_threads(3);
+		for sys in batch.instances_mut() {
+			sys.set_seed(7);
+		}
+		batch.instance(2).comp_find("MAIN_BATT")
+		    .expect("MAIN_BATT not found").set_failed(true);
+		/* the batch can be moved to and stepped on another thread */
+		let batch = std::thread::spawn(move || {
+			for _ in 0..25 {
+				batch.par_step(0.04);
+			}
+			batch
+		}).join().expect("Stepping thread panicked");
+		assert_eq!(batch.len(), 6);
+		assert!(!batch.proto().is_started());
+		let batt_volts: Vec<f64> = batch.instances().iter()
+		    .map(|sys| sys.comp_find("MAIN_BATT")
+		    .expect("MAIN_BATT not found").out_volts()).collect();
+		assert!(batt_volts[0] > 0.0);
+		assert_eq!(batt_volts[2], 0.0);
+		for (i, volts) in batt_volts.iter().enumerate() {
+			if i != 2 {
+				assert_eq!(*volts, batt_volts[0]);
+			}
+		}
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn find_comps_by_name() {
+		use crate::ElecSys;
+		use crate::CompType;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for comp in sys.all_comps().iter() {
+			if comp.get_type() == CompType::LabelBox {
+				continue;
+			}
+			let found = sys.comp_find(&comp.get_name())
+			    .expect("Component not found by its own name");
+			assert_eq!(found.comp, comp.comp);
+		}
+		assert!(sys.comp_find("NO_SUCH_COMPONENT").is_none());
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn worker_stats() {
+		use crate::ElecSys;
+		use crate::Phase;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		assert!(!sys.stats_enabled());
+		sys.set_stats_enabled(true);
+		for _ in 0..10 {
+			sys.step(0.05);
+		}
+		let stats = sys.stats();
+		assert_eq!(stats.n_passes, 10);
+		assert_eq!(stats.phase(Phase::Reset).n, 10);
+		assert!(stats.pass.max >= stats.pass.min);
+		assert!(stats.pass.max >= stats.interlock.min);
+		sys.reset_stats();
+		assert_eq!(sys.stats().n_passes, 0);
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn query_read_many() {
+		use crate::ElecSys;
+		use crate::Quantity;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let comps = sys.all_comps();
+		let mut query = sys.query_new();
+		for (i, comp) in comps.iter().enumerate() {
+			assert_eq!(query.add(comp, Quantity::OutVolts), 2 * i);
+			assert_eq!(query.add(comp, Quantity::OutAmps),
+			    2 * i + 1);
+		}
+		sys.start().expect("Startup failed");
+		std::thread::sleep(std::time::Duration::from_secs_f64(0.25));
+		sys.stop();
+		/* with the network stopped, the values must match exactly */
+		let values = query.read_vec();
+		for (i, comp) in comps.iter().enumerate() {
+			assert_eq!(values[2 * i], comp.out_volts());
+			assert_eq!(values[2 * i + 1], comp.out_amps());
+		}
+		drop(query);
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn snapshot_every_step() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let snaps = sys.subscribe(4);
+		for _ in 0..3 {
+			sys.step(0.05);
+		}
+		for tick in 1..=3 {
+			let snap = snaps.try_recv().expect("Snapshot missing");
+			assert_eq!(snap.tick(), tick);
+			assert_eq!(snap.missed(), 0);
+		}
+		assert!(snaps.try_recv().is_none());
+		/* with all buffers held, further passes are skipped */
+		let held: Vec<_> = (0..4).map(|_| {
+			sys.step(0.05);
+			snaps.recv()
+		}).collect();
+		sys.step(0.05);
+		sys.step(0.05);
+		assert!(snaps.try_recv().is_none());
+		drop(held);
+		sys.step(0.05);
+		let snap = snaps.recv();
+		assert_eq!(snap.tick(), 10);
+		assert_eq!(snap.missed(), 2);
+		for (i, comp) in sys.comps().enumerate() {
+			assert_eq!(snap.out_volts()[i], comp.out_volts());
+			assert_eq!(snap.in_amps()[i], comp.in_amps());
+		}
+		drop(snap);
+		drop(snaps);
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn view_matches_accessors() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		let mut view = sys.view();
+		assert_eq!(view.len(), sys.all_comps().len());
+		for (cv, comp) in view.comps().zip(sys.comps()) {
+			assert_eq!(cv.comp().comp, comp.comp);
+			assert_eq!(cv.get_name(), comp.get_name());
+			assert_eq!(cv.out_volts(), comp.out_volts());
+			assert_eq!(cv.in_amps(), comp.in_amps());
+			let srcs: Vec<_> = comp.get_srcs().iter()
+			    .map(|src| src.comp).collect();
+			let view_srcs: Vec<_> = cv.get_srcs().iter()
+			    .map(|src| src.comp).collect();
+			assert_eq!(srcs, view_srcs);
+		}
+		assert!(view.comps().any(|cv| !cv.get_srcs().is_empty()));
+		view.refresh();
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn has_src() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		let comps: Vec<_> = sys.comps().collect();
+		for comp in &comps {
+			let srcs = comp.get_srcs();
+			for src in &comps {
+				let listed = srcs.iter()
+				    .any(|s| s.comp == src.comp);
+				assert_eq!(comp.has_src(src), listed);
+			}
+		}
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn power_trace() {
+		use crate::{ElecSys, CompType};
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		let mut traced = 0;
+		for comp in sys.comps() {
+			let nodes = comp.trace();
+			match comp.get_type() {
+				CompType::Batt | CompType::Gen => {},
+				_ => {
+					assert!(nodes.is_empty());
+					continue;
+				}
+			}
+			assert_eq!(nodes[0].comp.comp, comp.comp);
+			assert_eq!(nodes[0].parent, -1);
+			for (i, node) in nodes.iter().enumerate().skip(1) {
+				let parent = &nodes[node.parent as usize];
+				assert!((node.parent as usize) < i);
+				assert_eq!(node.depth, parent.depth + 1);
+				assert!(node.comp.has_src(&comp) ||
+				    node.comp.get_srcs().iter().any(|s|
+				    s.get_type() != CompType::Batt &&
+				    s.get_type() != CompType::Gen));
+			}
+			/* Loads below the root are accounted for only once */
+			let loads: f64 = nodes.iter().skip(1)
+			    .filter(|n| n.comp.get_type() == CompType::Load)
+			    .map(|n| n.W).sum();
+			assert!(nodes[0].W_loads >= loads - 1e-6);
+			if nodes.len() > 1 {
+				traced += 1;
+			}
+			comp.print_trace();
+		}
+		assert!(traced != 0);
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn pwr_acct() {
+		use crate::{ElecSys, ElecComp, CompType};
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		let comps: Vec<_> = sys.comps().collect();
+		let before = ElecComp::get_pwr_accts(&comps);
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		let after = ElecComp::get_pwr_accts(&comps);
+		let mut powered = 0;
+		for (i, comp) in comps.iter().enumerate() {
+			let acct = comp.get_pwr_acct();
+			assert_eq!(acct.in_pwr, after[i].in_pwr);
+			assert_eq!(acct.out_amps, after[i].out_amps);
+			assert_eq!(acct.in_energy, after[i].in_energy);
+			assert_eq!(acct.in_pwr, comp.in_pwr());
+			assert!(after[i].in_energy >= before[i].in_energy);
+			assert!(after[i].out_energy >= before[i].out_energy);
+			if comp.get_type() == CompType::Bus &&
+			    acct.in_pwr > 0.0 {
+				assert!(after[i].in_energy >
+				    before[i].in_energy);
+				powered += 1;
+			}
+		}
+		assert!(powered != 0);
+
+		acfutils::log::fini();
+	}
+	#[test]
 	fn serialize_deserialize() {
 		use crate::ElecSys;
 		use acfutils::conf::Conf;
@@ -573,6 +2077,184 @@ mod tests {
 		    .expect("Cannot deserialize our own network?!");
 		sys.stop();
 
+		acfutils::log::fini();
+	}
+	#[test]
+	fn snapshot_restore() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		for _ in 0..25 {
+			sys.step(0.04);
+		}
+		let snap = sys.snapshot();
+		let run = |sys: &mut ElecSys| -> Vec<f64> {
+			sys.set_seed(1234);
+			for _ in 0..25 {
+				sys.step(0.04);
+			}
+			sys.all_comps().iter().map(|comp| comp.out_amps())
+			    .collect()
+		};
+		let amps1 = run(&mut sys);
+		sys.restore_snapshot(&snap)
+		    .expect("Cannot restore our own snapshot?!");
+		let amps2 = run(&mut sys);
+		assert_eq!(amps1, amps2);
+		assert!(sys.restore_snapshot(&snap[..snap.len() - 1])
+		    .is_err());
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn history_rewind() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		assert!(sys.history_seek(0.0).is_err());
+		sys.set_history(10.0, 1 << 20);
+		for _ in 0..50 {
+			sys.step(0.05);
+		}
+		let snap = sys.snapshot();
+		for _ in 0..40 {
+			sys.step(0.05);
+		}
+		assert!(sys.history_span() >= 4.0);
+		/* 40 passes back, with a bit of slack for rounding */
+		sys.history_seek(40.0 * 0.05 - 0.01)
+		    .expect("Failed to seek history");
+		assert_eq!(sys.snapshot(), snap);
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn load_input_slot() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys1 = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let mut sys2 = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		sys1.set_seed(1234);
+		sys2.set_seed(1234);
+		/* on top of the load's STD_LOAD of 20 Watts */
+		sys1.comp_find("LOAD_1").unwrap().set_input(20.0);
+		for _ in 0..25 {
+			sys1.step(0.04);
+			sys2.step(0.04);
+		}
+		let pwr1 = sys1.comp_find("LOAD_1").unwrap().in_pwr();
+		let pwr2 = sys2.comp_find("LOAD_1").unwrap().in_pwr();
+		assert!(pwr2 > 0.0);
+		assert!(pwr1 > 1.5 * pwr2);
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn tie_mask() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let sys = ElecSys::new(TEST_NET_FILE)
+		    .expect(&format!("Failed to load net {}", TEST_NET_FILE));
+		let mut tie = sys.comp_find("TIE_1").unwrap();
+		let bus_1 = sys.comp_find("TRU_1_BUS").unwrap();
+		let bus_2 = sys.comp_find("TRU_2_BUS").unwrap();
+		let port_1 = tie.tie_get_port(&bus_1).unwrap();
+		let port_2 = tie.tie_get_port(&bus_2).unwrap();
+		assert_ne!(port_1, port_2);
+		assert_eq!(tie.tie_get_port(&sys.comp_find("GEN_2_BUS")
+		    .unwrap()), None);
+
+		assert_eq!(tie.tie_set_mask((1 << port_1) | (1 << port_2)), 0);
+		assert!(tie.tie_get_all());
+		tie.tie_set_list(&vec![bus_2]);
+		assert_eq!(tie.tie_get_mask(), 1 << port_2);
+		assert_eq!(tie.tie_set_mask(0), 1 << port_2);
+		assert!(!tie.tie_get_all());
+
+		acfutils::log::fini();
+	}
+	#[test]
+	fn precompiled_image() {
+		use crate::ElecSys;
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let dir = std::env::temp_dir()
+		    .join(format!("libelec_img_{}", std::process::id()));
+		std::fs::create_dir_all(&dir).unwrap();
+		let net_file = dir.join("test.net");
+		std::fs::copy(TEST_NET_FILE, &net_file).unwrap();
+		let net_file = net_file.to_str().unwrap();
+
+		let sys = ElecSys::new(net_file)
+		    .expect(&format!("Failed to load net {}", net_file));
+		sys.write_image(None).expect("Failed to write image");
+		assert!(dir.join("test.netc").exists());
+		let names: Vec<String> = sys.all_comps().iter()
+		    .map(|comp| comp.get_name()).collect();
+		drop(sys);
+		/* this time around, the network is loaded from the image */
+		let mut sys = ElecSys::new(net_file)
+		    .expect("Failed to load net from image");
+		let names_img: Vec<String> = sys.all_comps().iter()
+		    .map(|comp| comp.get_name()).collect();
+		assert_eq!(names, names_img);
+		sys.step(0.05);
+		drop(sys);
+		std::fs::remove_dir_all(&dir).unwrap();
+
+		acfutils::log::fini();
+	}
+	/*
+	 * Only built with LIBELEC_NET set, e.g. to ../nettest/test.net.
+	 */
+	#[cfg(libelec_net)]
+	#[test]
+	fn build_time_comps() {
+		use crate::{ElecSys, Quantity, net};
+
+		acfutils::log::init(None, "nettest");
+		acfutils::crc64::init();
+
+		let mut sys = ElecSys::new(net::FILE)
+		    .expect(&format!("Failed to load net {}", net::FILE));
+		assert!(net::check(&sys));
+		for (id, name) in net::COMPS.iter().zip(net::NAMES) {
+			let comp = sys.comp(*id);
+			assert_eq!(comp.get_name(), name);
+			assert_eq!(comp.get_type(), id.get_type());
+			assert_eq!(sys.comp_find(name).unwrap().comp,
+			    comp.comp);
+		}
+		let snaps = sys.subscribe(1);
+		sys.step(0.05);
+		let snap = snaps.recv();
+		let view = sys.view();
+		for id in net::COMPS {
+			assert_eq!(snap.get(Quantity::OutVolts, id),
+			    view.comp_id(id).out_volts());
+		}
+		drop(view);
+		drop(snap);
+		drop(snaps);
+
 		acfutils::log::fini();
 	}
 }
@@ -17,6 +17,7 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <acfutils/conf.h>
 #include <acfutils/geom.h>
@@ -40,13 +41,45 @@ extern "C" {
 #endif	/* __STDC_VERSION__ < 199901L || defined(_MSC_VER) */
 #endif	/* !defined(STATIC_ARRAY_LEN_ARG) && !defined(CONST_ARRAY_LEN_ARG) */
 
+/*
+ * Maximum number of sources reported for a single component by
+ * libelec_comp_get_srcs(). This does not limit the number of sources
+ * which can exist in the network.
+ */
 enum {
     ELEC_MAX_SRCS = 64
 };
 
+/*
+ * Formerly the maximum number of steps on a path from a source through
+ * the network which the solver supported. The solver no longer limits
+ * the depth of the network, this is only kept for compatibility.
+ */
+enum {
+    ELEC_MAX_NETWORK_DEPTH = 100
+};
+
+/*
+ * Maximum number of ports of a tie which can be controlled using
+ * libelec_tie_set_mask() and libelec_tie_get_mask().
+ */
+enum {
+    ELEC_TIE_MAX_MASK_PORTS = 64
+};
+
 typedef struct elec_sys_s elec_sys_t;
+typedef struct elec_sched_s elec_sched_t;
+typedef struct elec_part_s elec_part_t;
+typedef struct elec_load_profile_s elec_load_profile_t;
+typedef struct elec_sweep_s elec_sweep_t;
+typedef struct elec_loader_s elec_loader_t;
 typedef struct elec_comp_s elec_comp_t;
 typedef struct elec_comp_info_s elec_comp_info_t;
+typedef struct elec_query_s elec_query_t;
+typedef struct elec_watch_s elec_watch_t;
+typedef struct elec_table_s elec_table_t;
+typedef struct elec_replay_s elec_replay_t;
+typedef struct elec_batch_s elec_batch_t;
 
 /**
  * Identifies the type of electrical component. Every component in a libelec
@@ -211,6 +244,14 @@ typedef enum {
 	ELEC_LABEL_BOX
 } elec_comp_type_t;
 
+/**
+ * Bit of the component type `type` in a type mask, as taken by
+ * libelec_walk_comps_type() and libelec_walk_comps_par().
+ */
+#define	ELEC_TYPE_BIT(type)	(1u << (type))
+/** Type mask selecting the components of all types. */
+#define	ELEC_TYPE_ALL		UINT32_MAX
+
 /**
  * This is the callback type used by batteries to determine the temperature
  * of the battery. Temperature has a significant effect on a battery's
@@ -218,6 +259,19 @@ typedef enum {
  * @return The temperature the battery in **Kelvin**.
  */
 typedef double (*elec_get_temp_cb_t)(elec_comp_t *comp, void *userinfo);
+/**
+ * Load-shedding limits of a generator or battery (`SHED_LIMIT` stanza).
+ * When the source's output power stays above `shed_pwr` for `delay`
+ * seconds, the load-shedding engine opens the least important breakers
+ * it feeds (see elec_cb_info_t). Once the output power plus the load of
+ * a shed breaker fits under `restore_pwr`, the breaker is closed again.
+ */
+typedef struct {
+	double	shed_pwr;	/**< Shedding threshold in Watts, 0 if none. */
+	double	restore_pwr;	/**< Restoring threshold in Watts. */
+	double	delay;		/**< Min secs between two actions. */
+} elec_shed_info_t;
+
 /**
  * Info structure describing a battery.
  */
@@ -231,6 +285,7 @@ typedef struct {
 	 * @see elec_get_temp_cb_t
 	 */
 	elec_get_temp_cb_t get_temp;
+	elec_shed_info_t shed;	/**< Load-shedding limits. */
 } elec_batt_info_t;
 
 /**
@@ -268,6 +323,7 @@ typedef struct elec_gen_info_s {
 	 * @see elec_get_rpm_cb_t
 	 */
 	elec_get_rpm_cb_t get_rpm;
+	elec_shed_info_t shed;	/**< Load-shedding limits. */
 } elec_gen_info_t;
 
 /**
@@ -339,8 +395,15 @@ typedef struct {
 	/**
 	 * Fixed load (in Watts for stabilized and Amps for unstabilized)
 	 * for constant-demand loads (specified using the `STD_LOAD` stanza).
+	 * For a load group, this is the default demand of each member.
 	 */
 	double		std_load;
+	/**
+	 * Number of identical members of a load group (specified using
+	 * the `GROUP` stanza), or 0 for an ordinary load.
+	 * @see libelec_load_get_num_members()
+	 */
+	unsigned	n_members;
 } elec_load_info_t;
 
 /**
@@ -360,6 +423,11 @@ typedef struct {
 	double			rate;		/**< Heating rate */
 	bool			fuse;		/**< Is this breaker a fuse? */
 	bool			triphase;	/**< Is a 3-phase breaker? */
+	/**
+	 * Load-shedding priority (`SHED_PRIO` stanza), 0 if the breaker
+	 * is never shed. Breakers with higher numbers are shed first.
+	 */
+	unsigned		shed_prio;
 } elec_cb_info_t;
 
 /**
@@ -384,6 +452,87 @@ typedef struct {
 	double			font_scale;
 } elec_label_box_info_t;
 
+/**
+ * Identifies an electrical quantity which can be read out in bulk using
+ * libelec_sys_read_many(). Each of these corresponds to the value that
+ * would be returned by the equivalent libelec_comp_get_* function.
+ * @see libelec_query_add()
+ */
+typedef enum {
+	ELEC_QTY_IN_VOLTS,	///< see libelec_comp_get_in_volts()
+	ELEC_QTY_OUT_VOLTS,	///< see libelec_comp_get_out_volts()
+	ELEC_QTY_IN_AMPS,	///< see libelec_comp_get_in_amps()
+	ELEC_QTY_OUT_AMPS,	///< see libelec_comp_get_out_amps()
+	ELEC_QTY_IN_PWR,	///< see libelec_comp_get_in_pwr()
+	ELEC_QTY_OUT_PWR,	///< see libelec_comp_get_out_pwr()
+	ELEC_QTY_IN_FREQ,	///< see libelec_comp_get_in_freq()
+	ELEC_QTY_OUT_FREQ	///< see libelec_comp_get_out_freq()
+} elec_qty_t;
+
+/**
+ * Sliding windows over which windowed statistics are kept.
+ * @see libelec_comp_set_wstats()
+ */
+typedef enum {
+	ELEC_WSTATS_1S,		///< the last second
+	ELEC_WSTATS_10S,	///< the last 10 seconds
+	ELEC_WSTATS_60S,	///< the last minute
+	ELEC_NUM_WSTATS_WINS
+} elec_wstats_win_t;
+
+/**
+ * Windowed statistics of a quantity, see libelec_comp_get_wstats().
+ * All fields are NAN until the worker has run at least one pass with
+ * the statistics enabled.
+ */
+typedef struct {
+	double	min;	///< lowest value seen in the window
+	double	max;	///< highest value seen in the window
+	double	mean;	///< time-weighted average over the window
+} elec_wstats_t;
+
+/** Maximum number of coupling ports per component. */
+#define	ELEC_MAX_COMP_PORTS	4
+/** Maximum number of tags per component, see the `TAG` stanza. */
+#define	ELEC_MAX_COMP_TAGS	4
+
+/**
+ * A coupling port of a component, defined using the `PORT` stanza.
+ * @see libelec_sys_exchange_ports()
+ */
+typedef struct {
+	/** Name of the port. An empty name marks an unused slot. */
+	char		name[32];
+	/**
+	 * Input ports drive the component's input slot (see
+	 * libelec_comp_set_input()), output ports publish `qty`.
+	 */
+	bool		input;
+	elec_qty_t	qty;	/**< Published quantity of an output port. */
+} elec_port_info_t;
+
+/** Maximum length of a compiled relay logic program. */
+#define	ELEC_LOGIC_MAX_OPS	32
+/** Maximum number of buses a relay logic can tie together. */
+#define	ELEC_LOGIC_MAX_BUSES	8
+
+/**
+ * Relay logic driving a circuit breaker or tie, defined using the
+ * `LOGIC` stanza. The `WHEN` condition is stored as a compiled program,
+ * which refers to other components by their info indices (see
+ * libelec_comp_get_idx()), so it's only meaningful within the network
+ * it was parsed for.
+ */
+typedef struct {
+	unsigned	n_ops;		/**< 0 if the component has no logic */
+	uint32_t	ops[ELEC_LOGIC_MAX_OPS];	/**< postfix program */
+	double		on_delay;	/**< Secs the condition must hold. */
+	double		off_delay;	/**< Secs it must stay false. */
+	/** Ties only: the buses to tie, 0 meaning all of the tie's buses. */
+	unsigned	n_buses;
+	uint32_t	buses[ELEC_LOGIC_MAX_BUSES];	/**< info indices */
+} elec_logic_info_t;
+
 /**
  * \struct elec_comp_info_t
  * After parsing the electrical definition, each component gets an info
@@ -413,6 +562,18 @@ struct elec_comp_info_s {
 	double				int_R;
 	/** Line number in input file on which the component was found. */
 	unsigned			parse_linenum;
+	/**
+	 * Position of the component in the network definition. The
+	 * components are laid out in a cache-friendly order instead (see
+	 * libelec_comp_get_idx()), which this maps back from.
+	 */
+	unsigned			def_idx;
+	/**
+	 * Update rate divisor (RATE_DIV line) of batteries, CBs and
+	 * loads. 0 means the network's per-type default applies.
+	 * @see libelec_comp_set_rate_div()
+	 */
+	unsigned			rate_div;
 	union {
 		elec_batt_info_t	batt;	/**< Valid for an ELEC_BATT. */
 		elec_gen_info_t		gen;	/**< Valid for an ELEC_GEN. */
@@ -426,7 +587,12 @@ struct elec_comp_info_s {
 		/** Valid for an ELEC_LABEL_BOX */
 		elec_label_box_info_t	label_box;
 	};
-	/** Visual information, for drawing on the network diagram plot */
+	/**
+	 * Visual information, for drawing on the network diagram plot.
+	 * This is only parsed from the definition once the network is
+	 * first drawn. If you read it directly, call libelec_sys_load_gui()
+	 * first.
+	 */
 	struct {
 		vect2_t			pos;
 		double			sz;
@@ -449,8 +615,454 @@ struct elec_comp_info_s {
 		/// `NULL_VECT3` if undefined.
 		vect3_t			rot;
 	} phys;
+	/** Coupling ports, in the order of their `PORT` stanzas. */
+	elec_port_info_t		ports[ELEC_MAX_COMP_PORTS];
+	/**
+	 * Tags assigned using the `TAG` stanza. An empty name marks an
+	 * unused slot.
+	 */
+	char				tags[ELEC_MAX_COMP_TAGS][32];
+	/** Breakers and ties only: relay logic driving the component. */
+	elec_logic_info_t		logic;
 };
 
+/**
+ * Identifies a phase of a network worker pass in \ref elec_stats_t.
+ * When the parallel solver is active, painting and load integration
+ * are interleaved on the solver threads, so their combined time is
+ * reported under \ref ELEC_PHASE_LOAD_INTEGRATE.
+ * @see libelec_sys_get_stats()
+ */
+typedef enum {
+	ELEC_PHASE_RESET,		///< resetting the network state
+	ELEC_PHASE_SRCS_UPDATE,		///< batteries, gens, TRUs & CBs
+	ELEC_PHASE_LOADS_RANDOMIZE,	///< random load fluctuations
+	ELEC_PHASE_INCR,		///< incremental evaluation checks
+	ELEC_PHASE_PAINT,		///< source painting
+	ELEC_PHASE_LOAD_INTEGRATE,	///< load integration
+	ELEC_PHASE_LOADS_UPDATE,	///< load state update
+	ELEC_PHASE_TIES_UPDATE,		///< bus tie state update
+	ELEC_PHASE_STATE_XFER,		///< publishing the new state
+	ELEC_NUM_PHASES
+} elec_phase_t;
+
+/**
+ * Timing statistics of a single measured quantity. All values are in
+ * seconds.
+ * @see elec_stats_t
+ */
+typedef struct {
+	uint64_t	n;	///< Number of samples taken.
+	double		last;	///< Most recent sample.
+	double		min;	///< Smallest sample.
+	double		max;	///< Largest sample.
+	double		avg;	///< Exponentially weighted moving average.
+} elec_timing_t;
+
+/**
+ * Number of buckets in elec_stats_t::jitter_hist. The buckets count
+ * worker wakeups whose absolute jitter was below 0.5, 1, 2, 5, 10, 20
+ * and 50 milliseconds respectively, with the last bucket counting all
+ * wakeups which were off by 50 milliseconds or more.
+ */
+#define	ELEC_NUM_JITTER_BUCKETS	8
+
+/**
+ * Runtime statistics of the network worker. Unless noted otherwise,
+ * each member is sampled once per worker pass.
+ * @see libelec_sys_get_stats()
+ */
+typedef struct {
+	/// Number of worker passes since statistics were enabled or reset.
+	uint64_t	n_passes;
+	/// Simulation time step of each pass.
+	elec_timing_t	d_t;
+	/// Entire pass, including the user callbacks.
+	elec_timing_t	pass;
+	/// Time spent holding the worker interlock. While it is held,
+	/// calls which reconfigure the network have to wait.
+	elec_timing_t	interlock;
+	/// Each phase of the network solve. A phase is only sampled on
+	/// passes in which it actually ran.
+	elec_timing_t	phases[ELEC_NUM_PHASES];
+	/// Pre- and post-pass user callbacks (see libelec_add_user_cb()).
+	elec_timing_t	pre_user_cbs;
+	elec_timing_t	post_user_cbs;
+	/// Total time spent in load callbacks during a pass
+	/// (see libelec_load_set_load_cb()).
+	elec_timing_t	load_cbs;
+	/// Total time spent in generator RPM callbacks during a pass
+	/// (see libelec_gen_set_rpm_cb()).
+	elec_timing_t	rpm_cbs;
+	/// Total time spent in battery temperature callbacks during a pass
+	/// (see libelec_batt_set_temp_cb()).
+	elec_timing_t	temp_cbs;
+	/// Number of traversal plan steps painted in the last pass.
+	unsigned	paint_visits;
+	/// Number of traversal plan steps integrated in the last pass.
+	unsigned	integ_visits;
+	/// Worker wakeup jitter: the actual interval between the starts of
+	/// two consecutive worker passes, minus the requested interval.
+	/// Only sampled on passes run by the worker thread (see
+	/// libelec_sys_start()), not by libelec_sys_step().
+	elec_timing_t	jitter;
+	/// Histogram of the absolute worker wakeup jitter, see
+	/// \ref ELEC_NUM_JITTER_BUCKETS for the bucket boundaries.
+	uint64_t	jitter_hist[ELEC_NUM_JITTER_BUCKETS];
+	/// Worker scheduling error: how much later (or, if negative,
+	/// earlier) the worker thread started each pass than the time it
+	/// was scheduled to. Passes started early due to an input change
+	/// (see libelec_sys_set_input_wake()) aren't sampled. Only sampled
+	/// by the worker thread of a system started using
+	/// libelec_sys_start() without a shared scheduler.
+	elec_timing_t	wake_err;
+	/// Number of heap allocations (including reallocations) made by
+	/// the thread running the pass during the last pass, see
+	/// libelec_get_alloc_stats(). A steady-state pass shouldn't need
+	/// to allocate anything.
+	unsigned	allocs;
+	/// Largest number of allocations made by a single pass.
+	unsigned	max_allocs;
+} elec_stats_t;
+
+/**
+ * Number of buckets in elec_lat_t::hist. There are three buckets per
+ * doubling of the latency, bucket `i` counting the latencies below
+ * 2^(i/3) x 100 microseconds (but not below those of bucket `i - 1`).
+ * The last bucket counts all latencies of about 0.8 seconds or more.
+ */
+#define	ELEC_NUM_LAT_BUCKETS	40
+
+/**
+ * Distribution of a single latency measured by the latency probe.
+ * @see elec_lat_stats_t
+ */
+typedef struct {
+	/// Summary of the samples, in seconds.
+	elec_timing_t	timing;
+	/// Histogram of the samples, see \ref ELEC_NUM_LAT_BUCKETS
+	/// for the bucket boundaries.
+	uint64_t	hist[ELEC_NUM_LAT_BUCKETS];
+} elec_lat_t;
+
+/**
+ * Latencies measured by the latency probe. Every input change (such as
+ * libelec_cb_set() or libelec_comp_fail()) made while the probe is
+ * enabled is timestamped and followed through the stages below, each
+ * measured from the input change.
+ * @see libelec_sys_set_lat_probe()
+ */
+typedef struct {
+	/// Until the start of the worker pass which picked up the input.
+	elec_lat_t	pickup;
+	/// Until the state computed from the input was published to the
+	/// getters.
+	elec_lat_t	publish;
+	/// In net-send mode, until the sender thread has handed the
+	/// network frames of that state to netlink (see
+	/// libelec_enable_net_send()).
+	elec_lat_t	send;
+	/// In net-recv mode, this instead measures every received state
+	/// update, from its publication by the sender to its publication
+	/// by us. These are taken from the wall clocks of both machines,
+	/// so unless they run on the same machine, this is only as good
+	/// as the synchronization of their clocks.
+	elec_lat_t	recv;
+} elec_lat_stats_t;
+
+/**
+ * Why libelec_sys_fast_forward() stopped.
+ */
+typedef enum {
+	/// The full requested time span has elapsed.
+	ELEC_FF_DONE,
+	/// A circuit breaker or tie changed state, e.g. a breaker popped.
+	ELEC_FF_SWITCHED,
+	/// A component watch produced an event, see libelec_watch_add().
+	ELEC_FF_WATCH
+} elec_ff_stop_t;
+
+/**
+ * How the network worker follows an accelerated simulation.
+ * @see libelec_sys_set_accel_mode()
+ */
+typedef enum {
+	/// Shorten the worker interval by the time factor, so that every
+	/// pass covers the same amount of simulation time. This is the
+	/// default.
+	ELEC_ACCEL_RATE,
+	/// Keep the worker interval fixed and let each pass cover a longer
+	/// amount of simulation time, integrating the stiff parts of the
+	/// simulation in sub-steps no longer than the worker interval.
+	ELEC_ACCEL_SUBSTEP
+} elec_accel_mode_t;
+
+/**
+ * Graceful degradation measures, which the network worker can apply to
+ * passes following a pass which overran its time budget. The values are
+ * bit flags, which can be combined.
+ * @see libelec_sys_set_overrun_policy()
+ */
+typedef enum {
+	/// Keep the random load fluctuations at their previous values,
+	/// rather than drawing new ones.
+	ELEC_OVERRUN_SKIP_RANDOMIZE = 1 << 0,
+	/// Integrate the stiff parts of the simulation (see
+	/// libelec_sys_set_substep()) in steps no longer than the nominal
+	/// time step, so that the longer time step of a late pass doesn't
+	/// destabilize them.
+	ELEC_OVERRUN_SUBSTEP = 1 << 1
+} elec_overrun_policy_t;
+
+/**
+ * Time budget overrun counters of the network worker.
+ * @see libelec_sys_get_overrun_stats()
+ */
+typedef struct {
+	/// Number of passes which took longer than their time budget.
+	uint64_t	n_overruns;
+	/// Number of passes which ran with the degradation measures of
+	/// the overrun policy applied.
+	uint64_t	n_degraded;
+	/// Time in seconds by which the most recent overrun exceeded
+	/// the budget.
+	double		last_overrun;
+	/// Largest time in seconds by which a pass exceeded the budget.
+	double		max_overrun;
+} elec_overrun_stats_t;
+
+/**
+ * Results of the sampled invariant checks. Every component counts at
+ * most once per kind of violation and checked pass.
+ * @see libelec_sys_set_inv_checks()
+ */
+typedef struct {
+	/// Number of passes which were checked.
+	uint64_t		n_checks;
+	/// Number of checked passes which found at least one violation.
+	uint64_t		n_failed;
+	/// Number of NaN or infinite quantities.
+	uint64_t		n_nonfinite;
+	/// Number of negative voltages, currents or frequencies.
+	uint64_t		n_negative;
+	/// Number of components putting out more power than they draw.
+	uint64_t		n_balance;
+	/// Number of components whose set of sources is inconsistent
+	/// with their state (see libelec_comp_get_srcs()).
+	uint64_t		n_srcs;
+	/// Component of the most recent violation, or NULL if none.
+	const elec_comp_t	*last_comp;
+} elec_inv_stats_t;
+
+/**
+ * A single hop of a power flow trace.
+ * @see libelec_comp_trace()
+ */
+typedef struct {
+	/// The component being fed.
+	const elec_comp_t	*comp;
+	/// Index of the upstream node in the trace, or -1 for the source.
+	int			parent;
+	/// Number of hops from the source, which is at depth 0.
+	unsigned		depth;
+	/// Power in Watts flowing into the component from the traced
+	/// source. For the source itself, this is its output power.
+	double			W;
+	/// Power in Watts consumed by the loads and charging batteries
+	/// in the subtree of this node (including the node itself),
+	/// which is being supplied by the traced source.
+	double			W_loads;
+} elec_trace_node_t;
+
+/**
+ * Power accounting of a single component, as published by the network
+ * worker at the end of its last pass. Short-circuit leakage is excluded
+ * from all values, same as in libelec_comp_get_in_amps() & friends.
+ * @see libelec_comp_get_pwr_acct()
+ */
+typedef struct {
+	/// Input & output current in Amps.
+	double		in_amps;
+	double		out_amps;
+	/// Input & output power in Watts. For a bus, this is the total
+	/// power flowing through it, for a source the power it delivers.
+	double		in_pwr;
+	double		out_pwr;
+	/// Input & output energy in Joules since the network was created.
+	/// These only ever grow, take the difference of two readings to
+	/// obtain the energy consumed over a period of time.
+	double		in_energy;
+	double		out_energy;
+} elec_pwr_acct_t;
+
+/**
+ * Publication stamps of the network state returned by the getters.
+ * @see libelec_sys_get_state_age()
+ */
+typedef struct {
+	/// Number of the worker pass which produced the state. This counts
+	/// up with every pass, including passes which found the network
+	/// cold & dark and didn't need to change anything.
+	uint64_t	tick;
+	/// Simulation time in seconds at the end of that pass, counted
+	/// from the start of the network.
+	double		sim_time;
+	/// Wall clock time at which the worker published the state, in
+	/// microseconds since the Unix epoch (see lacf_microtime()).
+	uint64_t	pub_time_us;
+	/// Wall clock time at which the state became available locally.
+	/// This only differs from `pub_time_us` for network readers.
+	uint64_t	recv_time_us;
+	/// Time in seconds since the state became available locally.
+	double		age;
+} elec_state_age_t;
+
+/**
+ * Memory footprint of a network in bytes, broken down by category.
+ * @see libelec_sys_get_mem_stats()
+ */
+typedef struct {
+	/// Number of components in the network.
+	size_t	n_comps;
+	/// Size of the part of a single component used by the solver.
+	size_t	comp_hot_sz;
+	/// Size of the part of a single component only used by the API
+	/// and for bookkeeping, which the solver doesn't touch.
+	size_t	comp_cold_sz;
+	/// Solver part of all components, plus the component indices.
+	size_t	comps_hot;
+	/// API & bookkeeping part of all components, including the
+	/// source lists published to libelec_comp_get_srcs().
+	size_t	comps_cold;
+	/// Links between the components, along with the per-source
+	/// arrays the solver keeps on the links and components.
+	size_t	links;
+	/// Compiled network traversal plans of batteries and generators.
+	size_t	plans;
+	/// Electrical state and input arrays.
+	size_t	state;
+	/// Network definition (component info structures). This is
+	/// shared with any instances (see libelec_new_instance()).
+	size_t	defs;
+	/// State history (see libelec_sys_set_history()).
+	size_t	history;
+	/// Sum of all of the above categories.
+	size_t	total;
+} elec_mem_stats_t;
+
+/**
+ * Solver cost attributed to a single component. Unless noted otherwise,
+ * the counts are totals over all passes since profiling was enabled or
+ * last reset, so divide them by `n_passes` to get per-pass figures.
+ * @see libelec_sys_set_profiling()
+ */
+typedef struct {
+	/// The component being described.
+	const elec_comp_t	*comp;
+	/// Number of worker passes profiled.
+	uint64_t	n_passes;
+	/// Number of times the painting pass visited the component.
+	uint64_t	paint_visits;
+	/// Number of times the load integration pass visited the component.
+	uint64_t	integ_visits;
+	/// Deepest traversal plan step at which the component was seen.
+	unsigned	max_depth;
+	/// Largest number of sources whose painting reached the component
+	/// in a single pass.
+	unsigned	max_srcs;
+	/// Total time spent in the component's load, RPM or temperature
+	/// callback in seconds.
+	double		cb_time;
+} elec_comp_prof_t;
+
+/**
+ * Sort keys for libelec_sys_get_profile_top().
+ */
+typedef enum {
+	ELEC_PROF_PAINT_VISITS,	///< elec_comp_prof_t::paint_visits
+	ELEC_PROF_INTEG_VISITS,	///< elec_comp_prof_t::integ_visits
+	ELEC_PROF_DEPTH,	///< elec_comp_prof_t::max_depth
+	ELEC_PROF_SRCS,		///< elec_comp_prof_t::max_srcs
+	ELEC_PROF_CB_TIME	///< elec_comp_prof_t::cb_time
+} elec_prof_key_t;
+
+/**
+ * Network solver backends, see libelec_sys_set_solver().
+ */
+typedef enum {
+	/**
+	 * Paints the network from each source along the precompiled
+	 * traversal plans and integrates the loads back up to them. This
+	 * is the default.
+	 */
+	ELEC_SOLVER_PAINT,
+	/**
+	 * Solves for the bus voltages using sparse nodal analysis, with
+	 * the sources modeled by their internal resistance.
+	 */
+	ELEC_SOLVER_NODAL
+} elec_solver_t;
+
+/**
+ * Scheduling priority of the network worker thread.
+ * @see elec_worker_opts_t
+ */
+typedef enum {
+	/** Leave the thread at the operating system's default priority. */
+	ELEC_WORKER_PRIO_DEFAULT,
+	/**
+	 * Below-normal priority. Maps to a nice value of 5 on Linux, the
+	 * utility QoS class on macOS and THREAD_PRIORITY_BELOW_NORMAL on
+	 * Windows.
+	 */
+	ELEC_WORKER_PRIO_LOW,
+	/**
+	 * Above-normal priority. Maps to a nice value of -5 on Linux
+	 * (requires CAP_SYS_NICE or a sufficient RLIMIT_NICE), the
+	 * user-interactive QoS class on macOS and
+	 * THREAD_PRIORITY_ABOVE_NORMAL on Windows.
+	 */
+	ELEC_WORKER_PRIO_HIGH,
+	/**
+	 * Real-time priority. Maps to the lowest SCHED_FIFO priority on
+	 * Linux (requires CAP_SYS_NICE or a sufficient RLIMIT_RTPRIO),
+	 * the user-interactive QoS class on macOS and
+	 * THREAD_PRIORITY_TIME_CRITICAL on Windows. A real-time worker
+	 * preempts all normally scheduled threads, so make sure your
+	 * callbacks never spin waiting on another thread.
+	 */
+	ELEC_WORKER_PRIO_RT
+} elec_worker_prio_t;
+
+/**
+ * Scheduling options of the network worker thread.
+ * @see libelec_sys_set_worker_opts()
+ */
+typedef struct {
+	/**
+	 * CPU affinity mask of the worker thread. Bit N set means the
+	 * thread may run on CPU N. Zero means no restriction. Not
+	 * supported on macOS, where a non-zero mask is ignored.
+	 */
+	uint64_t		cpu_mask;
+	/** Scheduling priority of the worker thread. */
+	elec_worker_prio_t	prio;
+	/**
+	 * Use high-resolution wakeups. Normally, the worker sleeps out
+	 * its interval in a condition variable wait, which on Windows is
+	 * only as precise as the system timer (about 15.6 ms by default).
+	 * In high-resolution mode, the worker wakes up a little early and
+	 * sleeps out the rest of its interval on a precise timer: a
+	 * high-resolution waitable timer on Windows, mach_wait_until()
+	 * on macOS and nanosleep() on Linux. The passes are also kept
+	 * on a fixed grid, so that late wakeups don't accumulate. The
+	 * trade-off is that input-triggered wakeups (see
+	 * libelec_sys_set_input_wake()) can't cut the precise part of
+	 * the sleep short. Check the effect using elec_stats_t::wake_err.
+	 */
+	bool			hires_wake;
+} elec_worker_opts_t;
+
 /**
  * Custom physics callback, which you can install using libelec_add_user_cb(),
  * or remove using libelec_remove_user_cb(). This will be called from the
@@ -461,7 +1073,477 @@ struct elec_comp_info_s {
  */
 typedef void (*elec_user_cb_t)(elec_sys_t *sys, bool pre, void *userinfo);
 
+/**
+ * Runtime statistics of a single user callback.
+ * @see libelec_sys_get_user_cb_stats()
+ */
+typedef struct {
+	/// The callback, as passed to libelec_add_user_cb().
+	elec_user_cb_t	cb;
+	/// The userinfo pointer, as passed to libelec_add_user_cb().
+	void		*userinfo;
+	/// True for a pre-pass callback, false for a post-pass one.
+	bool		pre;
+	/// Duration of each call of the callback.
+	elec_timing_t	time;
+} elec_user_cb_stats_t;
+
+/**
+ * Completion callback for libelec_serialize_async(). This is called from
+ * a libelec background thread once the network state has been fully
+ * written into `ser`.
+ * @see libelec_serialize_async()
+ */
+typedef void (*elec_ser_done_cb_t)(elec_sys_t *sys, conf_t *ser,
+    void *userinfo);
+
+/**
+ * Callback for libelec_reload(), which lets you re-point the component
+ * handles you keep from the old network to the reloaded one.
+ * @param old_comp A component of the old network, or NULL if
+ *	`new_comp` was newly added to the network definition.
+ * @param new_comp The counterpart of `old_comp` in the reloaded network,
+ *	or NULL if `old_comp` was removed from the network definition.
+ * @see libelec_reload()
+ */
+typedef void (*elec_reload_cb_t)(elec_comp_t *old_comp, elec_comp_t *new_comp,
+    void *userinfo);
+
+/**
+ * Kind of fault injected by a fault-injection sweep.
+ * @see libelec_sweep_add_fault()
+ */
+typedef enum {
+	/** The component is failed, see libelec_comp_set_failed(). */
+	ELEC_FAULT_FAIL,
+	/** The component is shorted, see libelec_comp_set_shorted(). */
+	ELEC_FAULT_SHORT,
+	/** The circuit breaker is popped, see libelec_cb_set(). */
+	ELEC_FAULT_CB_POP
+} elec_fault_type_t;
+
+/**
+ * Prepares a network instance for a fault-injection sweep, by putting
+ * it into the state in which the faults are to be evaluated (generator
+ * rpms, breaker & tie states, input slots, etc.)
+ * @see libelec_sweep_new()
+ */
+typedef void (*elec_sweep_setup_cb_t)(elec_sys_t *sys, void *userinfo);
+
+/**
+ * A predicate evaluated by a fault-injection sweep on the settled
+ * network. Called concurrently from multiple threads, each with its
+ * own network instance.
+ * @see libelec_sweep_add_pred()
+ */
+typedef bool (*elec_sweep_pred_t)(elec_sys_t *sys, void *userinfo);
+
+/**
+ * Condition watched by a component watch, see libelec_watch_add().
+ */
+typedef enum {
+	/** libelec_comp_is_powered() of the component changed */
+	ELEC_WATCH_POWERED,
+	/** the output voltage of the component crossed a threshold */
+	ELEC_WATCH_VOLTS,
+	/** the circuit breaker popped or was reset (see libelec_cb_get()) */
+	ELEC_WATCH_CB
+} elec_watch_type_t;
+
+/**
+ * A change event produced by a component watch, as returned by
+ * libelec_sys_poll_events().
+ */
+typedef struct {
+	/** The component whose watched condition changed. */
+	elec_comp_t		*comp;
+	/** The watched condition, as passed to libelec_watch_add(). */
+	elec_watch_type_t	type;
+	/**
+	 * The new state of the condition: whether the component is now
+	 * powered (\ref ELEC_WATCH_POWERED), whether its output voltage is
+	 * now above the threshold (\ref ELEC_WATCH_VOLTS), or whether the
+	 * breaker is now set (\ref ELEC_WATCH_CB).
+	 */
+	bool			state;
+	/** The output voltage of the component at the time of the change. */
+	double			volts;
+	/** The `userinfo` argument passed to libelec_watch_add(). */
+	void			*userinfo;
+} elec_event_t;
+
+/**
+ * Type of an entry in the system-wide event log.
+ * @see libelec_sys_set_event_log()
+ */
+typedef enum {
+	/** A circuit breaker popped, see \ref elec_log_ent_t.cb_reason. */
+	ELEC_LOG_CB_POPPED,
+	/** A circuit breaker was reset (closed) again. */
+	ELEC_LOG_CB_RESET,
+	/** The set of buses a tie connects changed. */
+	ELEC_LOG_TIE,
+	/** A source (battery, generator, TRU, inverter or transformer)
+	 * started producing output voltage. */
+	ELEC_LOG_SRC_ONLINE,
+	/** A source stopped producing output voltage. */
+	ELEC_LOG_SRC_OFFLINE
+} elec_log_type_t;
+
+/**
+ * Why a circuit breaker popped, see \ref ELEC_LOG_CB_POPPED.
+ */
+typedef enum {
+	ELEC_CB_POP_OC,		///< overcurrent
+	ELEC_CB_POP_SWITCH,	///< pulled using its libswitch switch
+	ELEC_CB_POP_EXT,	///< opened using libelec_cb_set()
+	ELEC_CB_POP_SHED	///< opened by the load-shedding engine
+} elec_cb_pop_reason_t;
+
+/**
+ * An entry of the system-wide event log, as returned by
+ * libelec_sys_poll_event_log().
+ */
+typedef struct {
+	/**
+	 * Number of the worker pass which logged the event. This counts
+	 * every pass since the network was created, so it's monotonic
+	 * and can be used to line up events with other recordings.
+	 */
+	uint64_t		tick;
+	/** The component which changed. */
+	elec_comp_t		*comp;
+	elec_log_type_t		type;
+	/** \ref ELEC_LOG_CB_POPPED only: why the breaker popped. */
+	elec_cb_pop_reason_t	cb_reason;
+	/**
+	 * \ref ELEC_LOG_CB_POPPED with \ref ELEC_CB_POP_OC only: the
+	 * current through the breaker relative to its rating.
+	 */
+	double			cb_amps_rel;
+	/**
+	 * \ref ELEC_LOG_TIE only: the new tie state in the format of
+	 * libelec_tie_get_mask().
+	 */
+	uint64_t		tie_mask;
+	/**
+	 * \ref ELEC_LOG_SRC_ONLINE and \ref ELEC_LOG_SRC_OFFLINE only:
+	 * the output voltage of the source after the change.
+	 */
+	double			src_volts;
+} elec_log_ent_t;
+
+/**
+ * Format of a telemetry log written by the recorder, see
+ * libelec_rec_start().
+ */
+typedef enum {
+	/** Compact binary log, see \ref elec_rec_hdr_t. */
+	ELEC_REC_BINARY,
+	/** CSV text with a header row naming the columns. */
+	ELEC_REC_CSV,
+	/**
+	 * Records are kept in memory as an \ref elec_table_t, which is
+	 * retrieved using libelec_rec_take_table() once the recording
+	 * has been stopped. No log file is written.
+	 */
+	ELEC_REC_MEMORY
+} elec_rec_fmt_t;
+
+/**
+ * Quantities which the telemetry recorder stores for every recorded
+ * component, in the order in which they appear in a record.
+ */
+typedef enum {
+	ELEC_REC_IN_VOLTS,	///< libelec_comp_get_in_volts()
+	ELEC_REC_OUT_VOLTS,	///< libelec_comp_get_out_volts()
+	ELEC_REC_IN_AMPS,	///< libelec_comp_get_in_amps()
+	ELEC_REC_OUT_AMPS,	///< libelec_comp_get_out_amps()
+	ELEC_REC_IN_FREQ,	///< libelec_comp_get_in_freq()
+	ELEC_REC_OUT_FREQ,	///< libelec_comp_get_out_freq()
+	/**
+	 * libelec_cb_get_temp() for circuit breakers,
+	 * libelec_batt_get_chg_rel() for batteries and NAN for all
+	 * other components.
+	 */
+	ELEC_REC_AUX,
+	ELEC_REC_NUM_QUANTS
+} elec_rec_quant_t;
+
+/** Value of the `magic` field of \ref elec_rec_hdr_t. */
+#define	ELEC_REC_MAGIC		"LIBELREC"
+/** Value of the `version` field of \ref elec_rec_hdr_t. */
+#define	ELEC_REC_VERSION	1
+
+/**
+ * Header at the start of every binary telemetry log file. It is followed
+ * by `names_len` bytes holding the `n_comps` NUL-terminated names of the
+ * recorded components, padded with zeros. The rest of the file consists
+ * of one record per worker pass: the simulation time in seconds since
+ * libelec_rec_start() as a `double`, followed by `n_comps * n_quants`
+ * `float` values (all quantities of the first component, then all
+ * quantities of the second component, etc., see \ref elec_rec_quant_t).
+ * All fields are in the byte order of the machine which wrote the log.
+ */
+typedef struct {
+	char		magic[8];	///< \ref ELEC_REC_MAGIC, not terminated
+	uint32_t	version;	///< \ref ELEC_REC_VERSION
+	uint32_t	n_comps;
+	uint32_t	n_quants;	///< \ref ELEC_REC_NUM_QUANTS
+	uint32_t	names_len;
+} elec_rec_hdr_t;
+
+/** Value of the `magic` field of \ref elec_cap_hdr_t. */
+#define	ELEC_CAP_MAGIC		"LIBELCAP"
+/** Value of the `version` field of \ref elec_cap_hdr_t. */
+#define	ELEC_CAP_VERSION	1
+
+/**
+ * Header at the start of every input capture file written by
+ * libelec_capture_start(). It is followed by `snap_sz` bytes holding a
+ * snapshot of the network taken when the capture was started (see
+ * libelec_snapshot_save()), padded with zeros to a multiple of 8 bytes.
+ * The rest of the file consists of one \ref elec_cap_pass_t per worker
+ * pass, each followed by its `n_ents` \ref elec_cap_ent_t's.
+ *
+ * The inputs of a pass are kept in `n_slots` numbered slots, whose
+ * layout only depends on the network definition. Every component, in
+ * the order of definition, gets slots for its failed and shorted flags,
+ * followed by its type-specific inputs: one slot holding the set state
+ * of a breaker, the rpm of a generator, the temperature of a battery or
+ * the demand of a load, or one slot per port of a tie holding the state
+ * of that port. All fields are in the byte order of the machine which
+ * wrote the capture.
+ */
+typedef struct {
+	char		magic[8];	///< \ref ELEC_CAP_MAGIC, not terminated
+	uint32_t	version;	///< \ref ELEC_CAP_VERSION
+	uint32_t	n_slots;
+	uint64_t	conf_crc;	///< CRC of the network definition
+	uint64_t	rng_s[4];	///< random number generator state
+	double		rng_spare;
+	uint32_t	rng_has_spare;
+	uint32_t	snap_sz;
+} elec_cap_hdr_t;
+
+/** \ref elec_cap_pass_t flag: the pass was run by libelec_sys_settle(). */
+#define	ELEC_CAP_PASS_SETTLING	(1 << 0)
+
+/**
+ * A single worker pass in an input capture, see \ref elec_cap_hdr_t.
+ * The first pass of a capture carries all slots, every following pass
+ * only the slots which have changed since the pass before it.
+ */
+typedef struct {
+	uint32_t	tick;		///< pass number, starting at 0
+	uint32_t	n_ents;		///< number of following slots
+	double		d_t;		///< time step in seconds
+	double		substep;	///< max. sub-step, 0 if unlimited
+	/**
+	 * Every 25 passes, a CRC of the network state after the pass,
+	 * which lets a replay detect that it has diverged from the
+	 * captured run. 0 on all other passes.
+	 */
+	uint64_t	state_crc;
+	uint32_t	flags;		///< ELEC_CAP_PASS_* flags
+	uint32_t	pad;
+} elec_cap_pass_t;
+
+/** Value of an input slot, see \ref elec_cap_hdr_t. */
+typedef struct {
+	uint32_t	slot;
+	uint32_t	pad;
+	double		value;
+} elec_cap_ent_t;
+
+/**
+ * Element type of a column in an \ref elec_table_layout_t.
+ */
+typedef enum {
+	ELEC_COL_F64,		///< `double`
+	ELEC_COL_F32		///< `float`
+} elec_col_type_t;
+
+/**
+ * Describes a single column of an \ref elec_table_layout_t. The value
+ * in row `i` is located at `(const char *)data + i * stride` and is
+ * `itemsize` bytes long. This maps directly onto a strided 1-D array
+ * (e.g. a NumPy array created from the buffer protocol), without any
+ * copying.
+ */
+typedef struct {
+	/** Name of the column, see the function returning the table. */
+	const char	*name;
+	elec_col_type_t	type;
+	size_t		itemsize;	///< bytes per value
+	size_t		stride;		///< bytes between consecutive rows
+	const void	*data;		///< value of the first row
+} elec_col_t;
+
+/**
+ * Memory layout of an \ref elec_table_t, as returned by
+ * libelec_table_get_layout(). All pointers remain valid until the
+ * table is destroyed.
+ */
+typedef struct {
+	size_t		n_rows;
+	size_t		n_cols;
+	/** Array of `n_cols` column descriptors. */
+	const elec_col_t *cols;
+	/**
+	 * Array of `n_rows` row names, or NULL if the rows aren't named
+	 * (e.g. the rows of a recording are successive records).
+	 */
+	const char *const *row_names;
+} elec_table_layout_t;
+
+/**
+ * Points in the worker's pass at which solver stages can run.
+ * @see libelec_sys_add_stage()
+ */
+typedef enum {
+	/**
+	 * The inputs of the pass have been picked up (failures, switch
+	 * states and input slots), but nothing has been computed yet.
+	 * Input slots written here are used by the same pass.
+	 */
+	ELEC_STAGE_INPUTS,
+	/** Batteries, generators and TRU regulation have been updated. */
+	ELEC_STAGE_SRCS,
+	/**
+	 * The network has been solved, but breaker heating, input
+	 * capacitors and power values have not been updated yet.
+	 */
+	ELEC_STAGE_SOLVED,
+	/** The pass is complete, right before its state is published. */
+	ELEC_STAGE_DONE,
+	ELEC_NUM_STAGES
+} elec_stage_point_t;
+
+/**
+ * Direct view of the worker's working state, as passed to a solver
+ * stage. All arrays are indexed by libelec_comp_get_idx() and only
+ * remain valid for the duration of the stage call. The quantity arrays
+ * hold `double` or `float` values, depending on `real_type` (see the
+ * LIBELEC_FLOAT_STATE build option).
+ */
+typedef struct {
+	elec_stage_point_t	point;
+	double			d_t;		///< Length of the pass
+	size_t			n_comps;
+	/** The components, in the order of the arrays below. */
+	elec_comp_t *const	*comps;
+	elec_col_type_t		real_type;
+	void			*in_volts;
+	void			*out_volts;
+	void			*in_amps;
+	void			*out_amps;
+	void			*in_freq;
+	void			*out_freq;
+	bool			*failed;
+	bool			*shorted;
+	/**
+	 * Input slot values (see libelec_comp_set_input()). A value is
+	 * only used by the worker while its `inputs_used` flag is set.
+	 */
+	double			*inputs;
+	bool			*inputs_used;
+} elec_stage_view_t;
+
+/**
+ * Solver stage callback, see libelec_sys_add_stage().
+ */
+typedef void (*elec_stage_cb_t)(elec_sys_t *sys,
+    const elec_stage_view_t *view, void *userinfo);
+
+/**
+ * Memory allocator used by libelec for all of its heap allocations.
+ * All four callbacks must be provided. They receive `userinfo` as their
+ * last argument. The callbacks may be called from any thread, including
+ * the network workers, so they must be thread-safe. Allocation failures
+ * are fatal, so the callbacks need not return NULL.
+ * @see libelec_set_allocator()
+ */
+typedef struct {
+	void	*(*malloc_cb)(size_t sz, void *userinfo);
+	void	*(*calloc_cb)(size_t n, size_t sz, void *userinfo);
+	void	*(*realloc_cb)(void *ptr, size_t sz, void *userinfo);
+	void	(*free_cb)(void *ptr, void *userinfo);
+	void	*userinfo;
+} elec_allocator_t;
+
+/**
+ * Heap allocation accounting of libelec.
+ * @see libelec_get_alloc_stats()
+ */
+typedef struct {
+	/// Bytes currently allocated by libelec (excluding the allocator's
+	/// own bookkeeping overhead).
+	uint64_t	live_bytes;
+	/// Number of blocks currently allocated by libelec.
+	uint64_t	live_blocks;
+	/// Total number of allocations (including reallocations) made by
+	/// libelec since it was loaded.
+	uint64_t	n_allocs;
+	/// Total number of blocks freed by libelec since it was loaded.
+	uint64_t	n_frees;
+} elec_alloc_stats_t;
+
+/**
+ * Job function submitted to the host's job system, see elec_job_sys_t.
+ */
+typedef void (*elec_job_func_t)(void *arg);
+
+/**
+ * Job system of the host application, through which libelec runs its
+ * parallel phases instead of spawning helper threads of its own. All
+ * four callbacks must be provided. They receive `userinfo` as their
+ * last argument and may be called from any thread, including the
+ * network workers, so they must be thread-safe.
+ * @see libelec_set_job_system()
+ */
+typedef struct {
+	/**
+	 * Starts a new wait group and returns an opaque handle to it,
+	 * which libelec passes to `submit_cb` and `wait_cb`.
+	 */
+	void		*(*group_cb)(void *userinfo);
+	/**
+	 * Queues `func(arg)` to be run by the job system as part of
+	 * `group`. The job may also be run before this returns.
+	 */
+	void		(*submit_cb)(void *group, elec_job_func_t func,
+	    void *arg, void *userinfo);
+	/**
+	 * Waits for all the jobs submitted to `group` to return and
+	 * releases the group. If libelec is stepped from within a job
+	 * (e.g. using libelec_sys_step()), this must keep running queued
+	 * jobs while waiting, or the job system may deadlock.
+	 */
+	void		(*wait_cb)(void *group, void *userinfo);
+	/**
+	 * Returns the number of worker threads of the job system. libelec
+	 * never submits more jobs than this for any one phase.
+	 */
+	unsigned	(*num_workers_cb)(void *userinfo);
+	void		*userinfo;
+} elec_job_sys_t;
+
+void libelec_set_allocator(const elec_allocator_t *alloc);
+void libelec_get_alloc_stats(elec_alloc_stats_t *stats);
+void libelec_set_job_system(const elec_job_sys_t *js);
+
 elec_sys_t *libelec_new(const char *filename);
+elec_sys_t *libelec_new_from_buffer(const void *buf, size_t len,
+    const char *name);
+elec_sys_t *libelec_new_instance(const elec_sys_t *proto);
+elec_loader_t *libelec_new_async(const char *filename);
+bool libelec_new_async_done(elec_loader_t *loader);
+elec_sys_t *libelec_new_async_finish(elec_loader_t *loader);
+elec_sys_t *libelec_sys_fork(elec_sys_t *sys);
+void libelec_sys_load_gui(const elec_sys_t *sys);
+elec_sys_t *libelec_reload(elec_sys_t *sys, elec_reload_cb_t cb,
+    void *userinfo);
 void libelec_destroy(elec_sys_t *sys);
 
 const elec_comp_info_t *libelec_get_comp_infos(const elec_sys_t *sys,
@@ -469,25 +1551,266 @@ const elec_comp_info_t *libelec_get_comp_infos(const elec_sys_t *sys,
 
 bool libelec_sys_start(elec_sys_t *sys);
 void libelec_sys_stop(elec_sys_t *sys);
+void libelec_sys_step(elec_sys_t *sys, double d_t);
+bool libelec_sys_settle(elec_sys_t *sys, double tol, unsigned max_iter);
+double libelec_sys_fast_forward(elec_sys_t *sys, double seconds,
+    elec_ff_stop_t *stop);
+void libelec_sys_step_batch(elec_sys_t *const *systems, size_t n_sys,
+    double d_t, unsigned n_threads);
+elec_sched_t *libelec_sched_new(double intval, unsigned n_threads);
+void libelec_sched_destroy(elec_sched_t *sched);
+void libelec_sys_set_sched(elec_sys_t *sys, elec_sched_t *sched);
+elec_sched_t *libelec_sys_get_sched(const elec_sys_t *sys);
+void libelec_sys_set_host_tick(elec_sys_t *sys, bool flag);
+bool libelec_sys_get_host_tick(const elec_sys_t *sys);
+void libelec_sys_tick(elec_sys_t *sys);
+void libelec_sys_set_input_wake(elec_sys_t *sys, double min_intval);
+double libelec_sys_get_input_wake(const elec_sys_t *sys);
+elec_part_t *libelec_part_new(void);
+void libelec_part_destroy(elec_part_t *part);
+bool libelec_part_add_bnd(elec_part_t *part, elec_comp_t *load,
+    elec_comp_t *gen);
+void libelec_part_exchange(elec_part_t *part);
+void libelec_part_step(elec_part_t *part, elec_sys_t *const *systems,
+    size_t n_sys, double d_t, unsigned n_threads);
+elec_sweep_t *libelec_sweep_new(const elec_sys_t *proto,
+    elec_sweep_setup_cb_t setup, void *userinfo);
+void libelec_sweep_destroy(elec_sweep_t *sweep);
+void libelec_sweep_add_fault(elec_sweep_t *sweep, const elec_comp_t *comp,
+    elec_fault_type_t type);
+void libelec_sweep_add_powered(elec_sweep_t *sweep, const elec_comp_t *comp);
+void libelec_sweep_add_pred(elec_sweep_t *sweep, elec_sweep_pred_t pred,
+    void *userinfo);
+bool libelec_sweep_run(elec_sweep_t *sweep, unsigned order, bool prune,
+    double d_t, double max_time, unsigned n_threads);
+size_t libelec_sweep_get_num_cases(const elec_sweep_t *sweep);
+unsigned libelec_sweep_get_case(const elec_sweep_t *sweep, size_t case_idx,
+    size_t faults[2], bool *pruned);
+bool libelec_sweep_get_result(const elec_sweep_t *sweep, size_t case_idx,
+    size_t pred_idx);
+const uint64_t *libelec_sweep_get_matrix(const elec_sweep_t *sweep,
+    size_t *stride);
 bool libelec_sys_is_started(const elec_sys_t *sys);
 bool libelec_sys_can_start(const elec_sys_t *sys);
 
+void libelec_sys_set_seed(elec_sys_t *sys, uint64_t seed);
+void libelec_sys_set_digest(elec_sys_t *sys, double quantum);
+double libelec_sys_get_digest(const elec_sys_t *sys);
+uint64_t libelec_sys_state_digest(elec_sys_t *sys);
+uint64_t libelec_comp_state_digest(const elec_comp_t *comp);
+uint64_t libelec_comps_state_digest(elec_comp_t *const *comps, size_t n);
+void libelec_sys_set_change_eps(elec_sys_t *sys, double eps);
+double libelec_sys_get_change_eps(const elec_sys_t *sys);
+uint64_t libelec_sys_get_change_gen(elec_sys_t *sys);
+uint64_t libelec_comp_get_change_gen(const elec_comp_t *comp);
+size_t libelec_sys_changed_since(elec_sys_t *sys, uint64_t gen,
+    elec_comp_t **comps, size_t cap, uint64_t *cur_gen);
+void libelec_comp_set_wstats(elec_comp_t *comp, elec_qty_t qty, bool enable);
+bool libelec_comp_get_wstats(const elec_comp_t *comp, elec_qty_t qty,
+    elec_wstats_win_t win, elec_wstats_t *stats);
+bool libelec_sys_get_state_age(elec_sys_t *sys, elec_state_age_t *age);
 void libelec_sys_set_time_factor(elec_sys_t *sys, double time_factor);
 double libelec_sys_get_time_factor(const elec_sys_t *sys);
+void libelec_sys_set_exec_intval(elec_sys_t *sys, double intval);
+double libelec_sys_get_exec_intval(const elec_sys_t *sys);
+void libelec_sys_set_substep(elec_sys_t *sys, double substep);
+double libelec_sys_get_substep(const elec_sys_t *sys);
+void libelec_sys_set_rate_div(elec_sys_t *sys, elec_comp_type_t type,
+    unsigned div);
+unsigned libelec_sys_get_rate_div(const elec_sys_t *sys,
+    elec_comp_type_t type);
+void libelec_comp_set_rate_div(elec_comp_t *comp, unsigned div);
+unsigned libelec_comp_get_rate_div(const elec_comp_t *comp);
+
+void libelec_sys_set_incremental(elec_sys_t *sys, bool enabled,
+    double epsilon);
+bool libelec_sys_get_incremental(const elec_sys_t *sys);
+bool libelec_sys_set_lazy_pwr(elec_sys_t *sys, bool enabled);
+bool libelec_sys_get_lazy_pwr(const elec_sys_t *sys);
+void libelec_sys_set_solver_threads(elec_sys_t *sys, unsigned n_threads);
+unsigned libelec_sys_get_solver_threads(const elec_sys_t *sys);
+void libelec_sys_set_cb_threads(elec_sys_t *sys, unsigned n_threads);
+unsigned libelec_sys_get_cb_threads(const elec_sys_t *sys);
+void libelec_comp_set_cb_concurrent(elec_comp_t *comp, bool flag);
+bool libelec_comp_get_cb_concurrent(const elec_comp_t *comp);
+void libelec_sys_set_solver(elec_sys_t *sys, elec_solver_t solver);
+elec_solver_t libelec_sys_get_solver(const elec_sys_t *sys);
+
+void libelec_sys_set_worker_opts(elec_sys_t *sys,
+    const elec_worker_opts_t *opts);
+void libelec_sys_get_worker_opts(elec_sys_t *sys, elec_worker_opts_t *opts);
+
+void libelec_sys_set_stats_enabled(elec_sys_t *sys, bool enabled);
+bool libelec_sys_get_stats_enabled(const elec_sys_t *sys);
+void libelec_sys_get_stats(elec_sys_t *sys, elec_stats_t *stats);
+void libelec_sys_reset_stats(elec_sys_t *sys);
+void libelec_sys_set_lat_probe(elec_sys_t *sys, bool enabled);
+bool libelec_sys_get_lat_probe(const elec_sys_t *sys);
+void libelec_sys_get_lat_stats(elec_sys_t *sys, elec_lat_stats_t *stats);
+void libelec_sys_reset_lat_stats(elec_sys_t *sys);
+size_t libelec_sys_get_user_cb_stats(elec_sys_t *sys,
+    elec_user_cb_stats_t *stats, size_t cap);
+
+void libelec_sys_set_accel_mode(elec_sys_t *sys, elec_accel_mode_t mode);
+elec_accel_mode_t libelec_sys_get_accel_mode(const elec_sys_t *sys);
+
+void libelec_sys_set_overrun_policy(elec_sys_t *sys, unsigned policy);
+unsigned libelec_sys_get_overrun_policy(const elec_sys_t *sys);
+void libelec_sys_get_overrun_stats(elec_sys_t *sys,
+    elec_overrun_stats_t *stats);
+void libelec_sys_reset_overrun_stats(elec_sys_t *sys);
+
+void libelec_sys_set_inv_checks(elec_sys_t *sys, unsigned intval,
+    double prob, bool fatal);
+void libelec_sys_get_inv_stats(elec_sys_t *sys, elec_inv_stats_t *stats);
+void libelec_sys_reset_inv_stats(elec_sys_t *sys);
+
+void libelec_sys_get_mem_stats(elec_sys_t *sys, elec_mem_stats_t *stats);
+
+void libelec_sys_set_profiling(elec_sys_t *sys, bool enabled);
+bool libelec_sys_get_profiling(const elec_sys_t *sys);
+void libelec_sys_reset_profile(elec_sys_t *sys);
+void libelec_comp_get_profile(const elec_comp_t *comp,
+    elec_comp_prof_t *prof);
+size_t libelec_sys_get_profile_top(elec_sys_t *sys, elec_prof_key_t key,
+    elec_comp_prof_t *top, size_t n);
+
+bool libelec_write_image(const elec_sys_t *sys, const char *filename);
 
 void libelec_serialize(elec_sys_t *sys, conf_t *ser, const char *prefix);
 bool libelec_deserialize(elec_sys_t *sys, const conf_t *ser,
     const char *prefix);
+size_t libelec_snapshot_save(elec_sys_t *sys, void *buf, size_t cap);
+bool libelec_snapshot_restore(elec_sys_t *sys, const void *buf, size_t len);
+void libelec_sys_set_history(elec_sys_t *sys, double seconds,
+    size_t max_bytes);
+double libelec_sys_get_history_span(elec_sys_t *sys);
+bool libelec_sys_history_seek(elec_sys_t *sys, double secs_ago);
+bool libelec_serialize_async(elec_sys_t *sys, conf_t *ser, const char *prefix,
+    elec_ser_done_cb_t done_cb, void *userinfo);
+bool libelec_enable_persist(elec_sys_t *sys, const char *filename,
+    unsigned intval, bool *resumed);
+void libelec_disable_persist(elec_sys_t *sys);
+void libelec_sys_save_preset(elec_sys_t *sys, const char *name);
+bool libelec_sys_apply_preset(elec_sys_t *sys, const char *name);
+bool libelec_sys_remove_preset(elec_sys_t *sys, const char *name);
+bool libelec_sys_write_presets(elec_sys_t *sys, const char *filename);
+bool libelec_sys_read_presets(elec_sys_t *sys, const char *filename,
+    size_t *n_presets);
 
 #ifdef	LIBELEC_WITH_NETLINK
+/**
+ * Rate class at which a network receiver asks the sender to transmit
+ * the state of a component. The rates are counted in passes of the
+ * sender's worker, so their frequencies scale with its interval (see
+ * libelec_sys_set_exec_intval()). The frequencies given below are at
+ * the default interval of 40 ms.
+ * @see libelec_comp_set_net_rate()
+ */
+typedef enum {
+	ELEC_NET_RATE_NORMAL = 0,	///< every 5th worker pass (5 Hz)
+	ELEC_NET_RATE_SLOW = 1,		///< every 25th worker pass (1 Hz)
+	ELEC_NET_RATE_FAST = 2,		///< every worker pass (25 Hz)
+	ELEC_NET_NUM_RATES
+} elec_net_rate_t;
+
+/**
+ * Quantities of a component which a network receiver asks the sender
+ * to transmit. Combine them into a bit mask.
+ * @see libelec_comp_set_net_fields()
+ */
+typedef enum {
+	ELEC_NET_FIELD_IN_VOLTS = 1 << 0,
+	ELEC_NET_FIELD_OUT_VOLTS = 1 << 1,
+	ELEC_NET_FIELD_IN_AMPS = 1 << 2,
+	ELEC_NET_FIELD_OUT_AMPS = 1 << 3,
+	ELEC_NET_FIELD_IN_FREQ = 1 << 4,
+	ELEC_NET_FIELD_OUT_FREQ = 1 << 5,
+	ELEC_NET_FIELD_LEAK = 1 << 6,	///< leak factor of the amps
+	ELEC_NET_FIELD_FLAGS = 1 << 7,	///< failed & shorted flags
+	ELEC_NET_FIELDS_ALL = 0xff
+} elec_net_field_t;
+
+/**
+ * Performance report of a network sender, as received by a network
+ * receiver which subscribed to it.
+ * @see libelec_net_recv_set_remote_stats()
+ */
+typedef struct {
+	/// Sender's wall clock time at which the report was taken, in
+	/// microseconds since the Unix epoch.
+	uint64_t		time_us;
+	/// Our own microclock() time at which the report arrived.
+	uint64_t		recv_time_us;
+	/// Worker statistics of the sender, see libelec_sys_get_stats().
+	elec_stats_t		stats;
+	/// Time budget overrun counters of the sender, see
+	/// libelec_sys_get_overrun_stats().
+	elec_overrun_stats_t	overruns;
+	/// Number of receivers connected to the sender.
+	unsigned		n_clients;
+	/// Number of distinct subscriptions the sender encodes frames for.
+	unsigned		n_groups;
+	/// Number of bytes of component data sent, over netlink and the
+	/// UDP side channel, since the sender was enabled.
+	uint64_t		bytes_sent;
+	/// Number of component data frames and datagrams sent since the
+	/// sender was enabled.
+	uint64_t		frames_sent;
+} elec_net_stats_t;
+
+/**
+ * Shared netlink connection context of several networks.
+ * @see libelec_net_mux_new()
+ */
+typedef struct elec_net_mux_s elec_net_mux_t;
+
+elec_sys_t *libelec_new_net_client(double timeout);
 void libelec_enable_net_send(elec_sys_t *sys);
 void libelec_disable_net_send(elec_sys_t *sys);
+void libelec_net_send_set_deadband(elec_sys_t *sys, elec_comp_type_t type,
+    unsigned fields, double abs, double rel);
 void libelec_enable_net_recv(elec_sys_t *sys);
 void libelec_disable_net_recv(elec_sys_t *sys);
+void libelec_comp_set_net_rate(const elec_comp_t *comp, elec_net_rate_t rate);
+void libelec_comp_set_net_fields(const elec_comp_t *comp, unsigned fields);
+void libelec_net_recv_set_smoothing(elec_sys_t *sys, bool flag);
+bool libelec_enable_net_send_udp(elec_sys_t *sys, const char *bind_addr,
+    unsigned port);
+void libelec_disable_net_send_udp(elec_sys_t *sys);
+bool libelec_enable_net_recv_udp(elec_sys_t *sys, const char *host,
+    unsigned port);
+void libelec_disable_net_recv_udp(elec_sys_t *sys);
+void libelec_net_recv_set_remote_stats(elec_sys_t *sys, bool enabled);
+bool libelec_net_recv_get_remote_stats(elec_sys_t *sys,
+    elec_net_stats_t *stats);
+void libelec_enable_net_mirror(elec_sys_t *sys);
+void libelec_disable_net_mirror(elec_sys_t *sys);
+bool libelec_net_mirror_is_synced(elec_sys_t *sys);
+void libelec_enable_net_part(elec_sys_t *sys);
+void libelec_disable_net_part(elec_sys_t *sys);
+elec_net_mux_t *libelec_net_mux_new(void);
+void libelec_net_mux_destroy(elec_net_mux_t *mux);
+void libelec_net_mux_add(elec_net_mux_t *mux, elec_sys_t *sys,
+    uint32_t sys_id);
+void libelec_net_mux_remove(elec_net_mux_t *mux, elec_sys_t *sys);
 #endif	/* defined(LIBELEC_WITH_NETLINK) */
 
+#ifdef	LIBELEC_WITH_WS
+bool libelec_enable_ws_gateway(elec_sys_t *sys, const char *bind_addr,
+    unsigned port);
+void libelec_disable_ws_gateway(elec_sys_t *sys);
+#endif	/* defined(LIBELEC_WITH_WS) */
+
+#ifdef	LIBELEC_WITH_SHM
+bool libelec_enable_shm_send(elec_sys_t *sys, const char *name);
+void libelec_disable_shm_send(elec_sys_t *sys);
+bool libelec_enable_shm_recv(elec_sys_t *sys, const char *name);
+void libelec_disable_shm_recv(elec_sys_t *sys);
+#endif	/* defined(LIBELEC_WITH_SHM) */
+
 #ifdef	LIBELEC_WITH_LIBSWITCH
-void libelec_create_cb_switches(const elec_sys_t *sys, const char *prefix,
+void libelec_create_cb_switches(elec_sys_t *sys, const char *prefix,
     float anim_rate);
 #endif	/* defined(LIBELEC_WITH_LIBSWITCH) */
 
@@ -501,10 +1824,68 @@ void libelec_add_user_cb(elec_sys_t *sys, bool pre, elec_user_cb_t cb,
 void libelec_remove_user_cb(elec_sys_t *sys, bool pre, elec_user_cb_t cb,
     void *userinfo);
 
+/* Solver stages */
+void libelec_sys_add_stage(elec_sys_t *sys, elec_stage_point_t point,
+    elec_stage_cb_t cb, void *userinfo);
+void libelec_sys_remove_stage(elec_sys_t *sys, elec_stage_point_t point,
+    elec_stage_cb_t cb, void *userinfo);
+size_t libelec_comp_get_idx(const elec_comp_t *comp);
+
+/* Change notifications */
+elec_watch_t *libelec_watch_add(elec_comp_t *comp, elec_watch_type_t type,
+    double threshold, void *userinfo);
+void libelec_watch_remove(elec_watch_t *watch);
+size_t libelec_sys_poll_events(elec_sys_t *sys, elec_event_t *events,
+    size_t max_events, size_t *n_dropped);
+void libelec_sys_set_event_log(elec_sys_t *sys, bool enabled);
+bool libelec_sys_get_event_log(const elec_sys_t *sys);
+size_t libelec_sys_poll_event_log(elec_sys_t *sys, elec_log_ent_t *ents,
+    size_t max_ents, size_t *n_dropped);
+
+/* Telemetry recording */
+bool libelec_rec_start(elec_sys_t *sys, const char *path, elec_rec_fmt_t fmt,
+    elec_comp_t *const *comps, size_t n_comps, size_t rotate_bytes);
+void libelec_rec_stop(elec_sys_t *sys);
+bool libelec_rec_is_active(const elec_sys_t *sys);
+void libelec_rec_get_stats(elec_sys_t *sys, size_t *n_recs,
+    size_t *n_dropped);
+elec_table_t *libelec_rec_take_table(elec_sys_t *sys);
+
+/* Input capture & replay */
+bool libelec_capture_start(elec_sys_t *sys, const char *path);
+void libelec_capture_stop(elec_sys_t *sys);
+bool libelec_capture_is_active(const elec_sys_t *sys);
+void libelec_capture_get_stats(elec_sys_t *sys, size_t *n_passes,
+    size_t *n_bytes);
+elec_replay_t *libelec_replay_open(elec_sys_t *sys, const char *path);
+bool libelec_replay_step(elec_replay_t *rp);
+void libelec_replay_get_stats(const elec_replay_t *rp, size_t *n_passes,
+    size_t *n_diverged);
+void libelec_replay_close(elec_replay_t *rp);
+
+/* Columnar state export */
+elec_table_t *libelec_state_table_new(elec_sys_t *sys);
+void libelec_state_table_update(elec_table_t *table);
+const elec_table_layout_t *libelec_table_get_layout(
+    const elec_table_t *table);
+void libelec_table_destroy(elec_table_t *table);
+
+/* Tracing */
+bool libelec_trace_start(elec_sys_t *sys, const char *path);
+void libelec_trace_stop(elec_sys_t *sys);
+bool libelec_trace_is_active(const elec_sys_t *sys);
+
 /* Finding devices and interrogating their configuration */
 elec_comp_t *libelec_comp_find(elec_sys_t *sys, const char *name);
 void libelec_walk_comps(const elec_sys_t *sys,
     void (*cb)(elec_comp_t *, void *), void *userinfo);
+void libelec_walk_comps_type(const elec_sys_t *sys, uint32_t type_mask,
+    void (*cb)(elec_comp_t *, void *), void *userinfo);
+void libelec_walk_comps_par(const elec_sys_t *sys, uint32_t type_mask,
+    unsigned n_threads, bool consistent, void (*cb)(elec_comp_t *, void *),
+    void *userinfo);
+size_t libelec_get_num_comps(const elec_sys_t *sys);
+elec_comp_t *libelec_get_comp(const elec_sys_t *sys, size_t idx);
 const elec_comp_info_t *libelec_comp2info(const elec_comp_t *comp);
 
 bool libelec_comp_is_AC(const elec_comp_t *comp);
@@ -526,10 +1907,34 @@ double libelec_comp_get_out_pwr(const elec_comp_t *comp);
 double libelec_comp_get_in_freq(const elec_comp_t *comp);
 double libelec_comp_get_out_freq(const elec_comp_t *comp);
 double libelec_comp_get_incap_volts(const elec_comp_t *comp);
+void libelec_comp_get_pwr_acct(const elec_comp_t *comp,
+    elec_pwr_acct_t *acct);
+void libelec_comps_get_pwr_acct(const elec_comp_t *const *comps, size_t n,
+    elec_pwr_acct_t *accts);
 bool libelec_comp_is_powered(const elec_comp_t *comp);
 double libelec_comp_get_eff(const elec_comp_t *gen);
 unsigned libelec_comp_get_srcs(const elec_comp_t *comp,
     elec_comp_t *srcs[CONST_ARRAY_LEN_ARG(ELEC_MAX_SRCS)]);
+size_t libelec_comp_get_src_list(const elec_comp_t *comp, size_t cap,
+    elec_comp_t **srcs);
+bool libelec_comp_has_src(const elec_comp_t *comp, const elec_comp_t *src);
+size_t libelec_comp_get_feed_path(const elec_comp_t *comp,
+    const elec_comp_t *src, size_t cap, elec_comp_t **path);
+size_t libelec_comp_trace(const elec_comp_t *src, size_t cap,
+    elec_trace_node_t *nodes);
+void libelec_comp_print_trace(const elec_comp_t *src);
+
+/* Bulk electrical state querying */
+elec_query_t *libelec_query_new(elec_sys_t *sys);
+void libelec_query_destroy(elec_query_t *query);
+size_t libelec_query_add(elec_query_t *query, const elec_comp_t *comp,
+    elec_qty_t qty);
+size_t libelec_query_get_len(const elec_query_t *query);
+void libelec_sys_read_many(const elec_sys_t *sys, const elec_query_t *query,
+    double *values);
+size_t libelec_sys_read_view(const elec_sys_t *sys, const elec_query_t *query,
+    double *values, unsigned *srcs_start, elec_comp_t **srcs,
+    size_t srcs_cap);
 
 /* Failures */
 void libelec_comp_set_failed(elec_comp_t *comp, bool failed);
@@ -551,11 +1956,76 @@ elec_get_rpm_cb_t libelec_gen_get_rpm_cb(const elec_comp_t *gen);
 
 void libelec_load_set_load_cb(elec_comp_t *load, elec_get_load_cb_t cb);
 elec_get_load_cb_t libelec_load_get_load_cb(elec_comp_t *load);
+void libelec_load_set_demand_cache(elec_comp_t *load, bool cache,
+    double max_age);
+bool libelec_load_get_demand_cache(const elec_comp_t *load, double *max_age);
+void libelec_load_invalidate(elec_comp_t *load);
+
+/* Load groups */
+unsigned libelec_load_get_num_members(const elec_comp_t *load);
+void libelec_load_member_set_demand(elec_comp_t *load, unsigned member,
+    double demand);
+double libelec_load_member_get_demand(elec_comp_t *load, unsigned member);
+void libelec_load_members_set_demand(elec_comp_t *load,
+    const double *demand);
+void libelec_load_member_set_failed(elec_comp_t *load, unsigned member,
+    bool failed);
+bool libelec_load_member_get_failed(elec_comp_t *load, unsigned member);
+double libelec_load_member_get_amps(elec_comp_t *load, unsigned member);
+
+/* Callback-free inputs */
+void libelec_comp_set_input(elec_comp_t *comp, double value);
+void libelec_comp_clear_input(elec_comp_t *comp);
+void libelec_sys_set_inputs(elec_sys_t *sys, elec_comp_t *const *comps,
+    const double *values, size_t n);
+
+/* Coupling ports */
+size_t libelec_sys_get_num_ports(const elec_sys_t *sys);
+int libelec_port_find(const elec_sys_t *sys, const char *name);
+const elec_port_info_t *libelec_port_get_info(const elec_sys_t *sys,
+    size_t idx);
+elec_comp_t *libelec_port_get_comp(const elec_sys_t *sys, size_t idx);
+void libelec_sys_exchange_ports(elec_sys_t *sys, double *values);
+
+/**
+ * State of the group of components carrying a tag as of the last pass,
+ * see libelec_tag_get_stats().
+ */
+typedef struct {
+	unsigned	n_comps;	/**< Components carrying the tag. */
+	/** Members which are powered, see libelec_comp_is_powered(). */
+	unsigned	n_powered;
+	unsigned	n_failed;	/**< Members which are failed. */
+	unsigned	n_shorted;	/**< Members which are shorted. */
+	/** Sum of the members' libelec_comp_get_in_pwr() in Watts. */
+	double		in_pwr;
+} elec_tag_stats_t;
+
+/* Component tags */
+size_t libelec_sys_get_num_tags(const elec_sys_t *sys);
+int libelec_tag_find(const elec_sys_t *sys, const char *name);
+const char *libelec_tag_get_name(const elec_sys_t *sys, size_t idx);
+size_t libelec_tag_get_comps(const elec_sys_t *sys, size_t idx, size_t cap,
+    elec_comp_t **comps);
+void libelec_tag_get_stats(elec_sys_t *sys, size_t idx,
+    elec_tag_stats_t *stats);
+bool libelec_comp_has_tag(const elec_comp_t *comp, size_t idx);
+
+/* Load profile playback */
+elec_load_profile_t *libelec_load_profile_load(const char *filename);
+void libelec_load_profile_destroy(elec_load_profile_t *prof);
+bool libelec_load_profile_write(const elec_load_profile_t *prof,
+    const char *filename);
+double libelec_load_profile_get_duration(const elec_load_profile_t *prof);
+bool libelec_sys_set_load_profile(elec_sys_t *sys,
+    const elec_load_profile_t *prof, double t);
+double libelec_sys_get_load_profile_time(elec_sys_t *sys);
 
 /* Circuit breakers */
 void libelec_cb_set(elec_comp_t *comp, bool set);
 bool libelec_cb_get(const elec_comp_t *comp);
 double libelec_cb_get_temp(const elec_comp_t *comp);
+bool libelec_cb_get_shed(const elec_comp_t *comp);
 #ifdef	LIBELEC_WITH_LIBSWITCH
 switch_t *libelec_cb_get_sw(const elec_comp_t *comp);
 #endif	// defined(LIBELEC_WITH_LIBSWITCH)
@@ -570,6 +2040,9 @@ bool libelec_tie_get_all(elec_comp_t *comp);
 size_t libelec_tie_get_list(elec_comp_t *comp, size_t cap,
     elec_comp_t **bus_list);
 size_t libelec_tie_get_num_buses(const elec_comp_t *comp);
+int libelec_tie_get_port(const elec_comp_t *tie, const elec_comp_t *bus);
+uint64_t libelec_tie_set_mask(elec_comp_t *tie, uint64_t mask);
+uint64_t libelec_tie_get_mask(elec_comp_t *tie);
 /*
  * Due to default argument promotion and va_start underneath,
  * we cannot use the native bool type here.
@@ -578,11 +2051,45 @@ bool libelec_tie_get(elec_comp_t *tie, bool_t exhaustive, ...)
     SENTINEL_ATTR;
 bool libelec_tie_get_v(elec_comp_t *tie, bool exhaustive, va_list ap);
 
+/* Batched switching & failures */
+elec_batch_t *libelec_batch_begin(elec_sys_t *sys);
+void libelec_batch_comp_set_failed(elec_batch_t *batch, elec_comp_t *comp,
+    bool failed);
+void libelec_batch_comp_set_shorted(elec_batch_t *batch, elec_comp_t *comp,
+    bool shorted);
+void libelec_batch_cb_set(elec_batch_t *batch, elec_comp_t *comp, bool set);
+void libelec_batch_tie_set_list(elec_batch_t *batch, elec_comp_t *tie,
+    size_t list_len, elec_comp_t *const *bus_list);
+void libelec_batch_tie_set_all(elec_batch_t *batch, elec_comp_t *tie,
+    bool tied);
+size_t libelec_batch_get_len(const elec_batch_t *batch);
+void libelec_batch_commit(elec_batch_t *batch);
+void libelec_batch_abort(elec_batch_t *batch);
+
+/* Frozen subnetworks */
+bool libelec_subnet_freeze(elec_comp_t *bus);
+void libelec_subnet_thaw(elec_comp_t *bus);
+bool libelec_comp_is_frozen(const elec_comp_t *comp);
+
+/* Automatic model reduction */
+bool libelec_sys_set_auto_reduce(elec_sys_t *sys, unsigned idle_passes);
+unsigned libelec_sys_get_auto_reduce(const elec_sys_t *sys);
+unsigned libelec_sys_get_num_reduced(elec_sys_t *sys);
+
+/* Bus islands */
+unsigned libelec_comp_get_island(const elec_comp_t *comp);
+bool libelec_bus_same_island(const elec_comp_t *bus1, const elec_comp_t *bus2);
+size_t libelec_island_get_srcs(elec_sys_t *sys, unsigned island, size_t cap,
+    elec_comp_t **srcs);
+
 /*
  * Generators
  */
 void libelec_gen_set_rpm(elec_comp_t *gen, double rpm);
 double libelec_gen_get_rpm(const elec_comp_t *gen);
+bool libelec_comp_set_boundary(elec_comp_t *comp, bool flag);
+bool libelec_comp_is_boundary(const elec_comp_t *comp);
+void libelec_gen_set_bnd_volts(elec_comp_t *gen, double volts, double freq);
 
 /* Batteries */
 double libelec_batt_get_chg_rel(const elec_comp_t *batt);
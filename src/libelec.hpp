@@ -0,0 +1,599 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+/**
+ * \file
+ * This file contains an optional header-only C++ layer on top of the C
+ * API in `libelec.h`. It requires C++20 (for `std::span`) and adds no
+ * code to libelec itself.
+ *
+ * - elec::System owns a network and destroys it when it goes out of
+ *	scope.
+ * - elec::Bus, elec::Load, elec::Cb, elec::Gen, elec::Batt and
+ *	elec::Tie are typed component handles. The type of a component is
+ *	checked once, when it is bound to a handle using
+ *	elec::System::find() or the handle's bind() function. A handle
+ *	which failed to bind is empty (it converts to false). The calls
+ *	made through a bound handle go straight to the C API, with no
+ *	further type checks.
+ * - Functions returning lists of components (sources feeding a
+ *	component, buses tied by a tie) fill a caller-provided buffer and
+ *	return a `std::span` over the filled part, so they don't allocate.
+ * - elec::Query and elec::Snapshot wrap bulk state queries (see
+ *	libelec_query_new()) and state snapshots (see
+ *	libelec_snapshot_save()). Their results are read through a
+ *	`std::span` into storage they keep between calls.
+ *
+ *```
+ * elec::System sys("aircraft.net");
+ * auto bus = sys.find<elec::Bus>("DC_BUS_1");
+ * auto cb = sys.find<elec::Cb>("CB_PUMP_1");
+ * elec::SrcBuf buf;
+ *
+ * if (!sys || !bus || !cb)
+ *	return (false);
+ * cb.set(false);
+ * for (elec_comp_t *src : bus.srcs(buf))
+ *	...
+ *```
+ *
+ * The handles are the size of a pointer and can be freely copied. They
+ * don't keep the network alive, so they must not be used once their
+ * elec::System has been destroyed.
+ */
+
+#ifndef	_LIBELEC_HPP_
+#define	_LIBELEC_HPP_
+
+/* MSVC only reports the actual language version in _MSVC_LANG */
+#if	defined(_MSVC_LANG) && _MSVC_LANG > __cplusplus
+#define	LIBELEC_HPP_CPLUSPLUS	_MSVC_LANG
+#else
+#define	LIBELEC_HPP_CPLUSPLUS	__cplusplus
+#endif
+#if	LIBELEC_HPP_CPLUSPLUS < 202002L
+#error	"libelec.hpp requires C++20"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <acfutils/assert.h>
+
+#include "libelec.h"
+
+namespace elec {
+
+/**
+ * Buffer for the sources feeding a component, see Comp::srcs().
+ */
+using SrcBuf = std::array<elec_comp_t *, ELEC_MAX_SRCS>;
+
+/**
+ * Untyped component handle. Every component can be bound to it. The
+ * typed handles below derive from it, so the functions common to all
+ * components are available on all of them.
+ */
+class Comp {
+public:
+	Comp() = default;
+	explicit Comp(elec_comp_t *comp) : comp_(comp) {}
+
+	/** Binds any component. An empty handle if `comp` is NULL. */
+	static Comp bind(elec_comp_t *comp) { return (Comp(comp)); }
+
+	explicit operator bool() const { return (comp_ != nullptr); }
+	elec_comp_t *get() const { return (comp_); }
+	bool operator==(const Comp &other) const
+	{
+		return (comp_ == other.comp_);
+	}
+
+	/** @see libelec_comp_get_name() */
+	const char *name() const
+	{
+		return (libelec_comp_get_name(comp_));
+	}
+	/** @see libelec_comp_get_type() */
+	elec_comp_type_t type() const
+	{
+		return (libelec_comp_get_type(comp_));
+	}
+	/** @see libelec_comp2info() */
+	const elec_comp_info_t *info() const
+	{
+		return (libelec_comp2info(comp_));
+	}
+
+	/** @see libelec_comp_get_in_volts() */
+	double in_volts() const { return (libelec_comp_get_in_volts(comp_)); }
+	/** @see libelec_comp_get_out_volts() */
+	double out_volts() const
+	{
+		return (libelec_comp_get_out_volts(comp_));
+	}
+	/** @see libelec_comp_get_in_amps() */
+	double in_amps() const { return (libelec_comp_get_in_amps(comp_)); }
+	/** @see libelec_comp_get_out_amps() */
+	double out_amps() const { return (libelec_comp_get_out_amps(comp_)); }
+	/** @see libelec_comp_get_in_pwr() */
+	double in_pwr() const { return (libelec_comp_get_in_pwr(comp_)); }
+	/** @see libelec_comp_get_out_pwr() */
+	double out_pwr() const { return (libelec_comp_get_out_pwr(comp_)); }
+	/** @see libelec_comp_get_in_freq() */
+	double in_freq() const { return (libelec_comp_get_in_freq(comp_)); }
+	/** @see libelec_comp_get_out_freq() */
+	double out_freq() const { return (libelec_comp_get_out_freq(comp_)); }
+	/** @see libelec_comp_is_powered() */
+	bool powered() const { return (libelec_comp_is_powered(comp_)); }
+	/** @see libelec_comp_is_frozen() */
+	bool frozen() const { return (libelec_comp_is_frozen(comp_)); }
+
+	/** @see libelec_comp_get_failed() */
+	bool failed() const { return (libelec_comp_get_failed(comp_)); }
+	/** @see libelec_comp_set_failed() */
+	void set_failed(bool failed) const
+	{
+		libelec_comp_set_failed(comp_, failed);
+	}
+	/** @see libelec_comp_get_shorted() */
+	bool shorted() const { return (libelec_comp_get_shorted(comp_)); }
+	/** @see libelec_comp_set_shorted() */
+	void set_shorted(bool shorted) const
+	{
+		libelec_comp_set_shorted(comp_, shorted);
+	}
+
+	/**
+	 * Fills `buf` with the sources currently feeding the component.
+	 * @return The filled part of `buf`.
+	 * @see libelec_comp_get_srcs()
+	 */
+	std::span<elec_comp_t *const> srcs(SrcBuf &buf) const
+	{
+		unsigned n = libelec_comp_get_srcs(comp_, buf.data());
+		return (std::span<elec_comp_t *const>(buf.data(), n));
+	}
+	/** @see libelec_comp_has_src() */
+	bool has_src(Comp src) const
+	{
+		return (libelec_comp_has_src(comp_, src.comp_));
+	}
+	/**
+	 * Fills `buf` with the feed path from `src`. If the path doesn't
+	 * fit, the returned span is truncated to the size of `buf`.
+	 * @see libelec_comp_get_feed_path()
+	 */
+	std::span<elec_comp_t *> feed_path(Comp src,
+	    std::span<elec_comp_t *> buf) const
+	{
+		size_t n = libelec_comp_get_feed_path(comp_, src.comp_,
+		    buf.size(), buf.data());
+		return (buf.first(std::min(n, buf.size())));
+	}
+
+protected:
+	/* Binds `comp` only if it's a component of type `type` */
+	static elec_comp_t *bind_type(elec_comp_t *comp, elec_comp_type_t type)
+	{
+		if (comp == nullptr || libelec_comp_get_type(comp) != type)
+			return (nullptr);
+		return (comp);
+	}
+
+	elec_comp_t	*comp_ = nullptr;
+};
+
+/**
+ * Typed handle base, which binds components of type `T` only.
+ */
+template<elec_comp_type_t T, class Self>
+class TypedComp : public Comp {
+public:
+	static constexpr elec_comp_type_t comp_type = T;
+
+	TypedComp() = default;
+
+	/**
+	 * Binds `comp`. An empty handle if `comp` is NULL or isn't a
+	 * component of type `T`.
+	 */
+	static Self bind(elec_comp_t *comp)
+	{
+		Self self;
+		self.comp_ = bind_type(comp, T);
+		return (self);
+	}
+};
+
+/** Handle of an \ref ELEC_BUS. */
+class Bus : public TypedComp<ELEC_BUS, Bus> {
+public:
+	/** @see libelec_comp_is_AC() */
+	bool is_AC() const { return (libelec_comp_is_AC(comp_)); }
+	/** @see libelec_comp_get_island() */
+	unsigned island() const { return (libelec_comp_get_island(comp_)); }
+	/** @see libelec_bus_same_island() */
+	bool same_island(Bus other) const
+	{
+		return (libelec_bus_same_island(comp_, other.comp_));
+	}
+	/** @see libelec_subnet_freeze() */
+	bool freeze() const { return (libelec_subnet_freeze(comp_)); }
+	/** @see libelec_subnet_thaw() */
+	void thaw() const { libelec_subnet_thaw(comp_); }
+};
+
+/** Handle of an \ref ELEC_LOAD. */
+class Load : public TypedComp<ELEC_LOAD, Load> {
+public:
+	/** @see libelec_load_set_load_cb() */
+	void set_load_cb(elec_get_load_cb_t cb) const
+	{
+		libelec_load_set_load_cb(comp_, cb);
+	}
+	/** @see libelec_comp_set_input() */
+	void set_demand(double demand) const
+	{
+		libelec_comp_set_input(comp_, demand);
+	}
+	/** @see libelec_comp_clear_input() */
+	void clear_demand() const { libelec_comp_clear_input(comp_); }
+	/** @see libelec_comp_get_incap_volts() */
+	double incap_volts() const
+	{
+		return (libelec_comp_get_incap_volts(comp_));
+	}
+	/** @see libelec_load_get_num_members() */
+	unsigned num_members() const
+	{
+		return (libelec_load_get_num_members(comp_));
+	}
+	/** @see libelec_load_member_set_demand() */
+	void set_member_demand(unsigned member, double demand) const
+	{
+		libelec_load_member_set_demand(comp_, member, demand);
+	}
+	/**
+	 * Sets the demands of all members at once. `demand` must hold
+	 * num_members() values.
+	 * @see libelec_load_members_set_demand()
+	 */
+	void set_member_demands(std::span<const double> demand) const
+	{
+		ASSERT3U(demand.size(), ==, num_members());
+		libelec_load_members_set_demand(comp_, demand.data());
+	}
+	/** @see libelec_load_member_get_amps() */
+	double member_amps(unsigned member) const
+	{
+		return (libelec_load_member_get_amps(comp_, member));
+	}
+};
+
+/** Handle of an \ref ELEC_CB. */
+class Cb : public TypedComp<ELEC_CB, Cb> {
+public:
+	/** @see libelec_cb_set() */
+	void set(bool set) const { libelec_cb_set(comp_, set); }
+	/** @see libelec_cb_get() */
+	bool get_set() const { return (libelec_cb_get(comp_)); }
+	/** @see libelec_cb_get_temp() */
+	double temp() const { return (libelec_cb_get_temp(comp_)); }
+	/** @see libelec_cb_get_shed() */
+	bool shed() const { return (libelec_cb_get_shed(comp_)); }
+};
+
+/** Handle of an \ref ELEC_GEN. */
+class Gen : public TypedComp<ELEC_GEN, Gen> {
+public:
+	/** @see libelec_gen_set_rpm() */
+	void set_rpm(double rpm) const { libelec_gen_set_rpm(comp_, rpm); }
+	/** @see libelec_gen_get_rpm() */
+	double rpm() const { return (libelec_gen_get_rpm(comp_)); }
+	/** @see libelec_gen_set_rpm_cb() */
+	void set_rpm_cb(elec_get_rpm_cb_t cb) const
+	{
+		libelec_gen_set_rpm_cb(comp_, cb);
+	}
+	/** @see libelec_comp_get_eff() */
+	double eff() const { return (libelec_comp_get_eff(comp_)); }
+};
+
+/** Handle of an \ref ELEC_BATT. */
+class Batt : public TypedComp<ELEC_BATT, Batt> {
+public:
+	/** @see libelec_batt_get_chg_rel() */
+	double chg_rel() const { return (libelec_batt_get_chg_rel(comp_)); }
+	/** @see libelec_batt_set_chg_rel() */
+	void set_chg_rel(double chg_rel) const
+	{
+		libelec_batt_set_chg_rel(comp_, chg_rel);
+	}
+	/** @see libelec_batt_get_temp() */
+	double temp() const { return (libelec_batt_get_temp(comp_)); }
+	/** @see libelec_batt_set_temp() */
+	void set_temp(double T) const { libelec_batt_set_temp(comp_, T); }
+	/** @see libelec_batt_set_temp_cb() */
+	void set_temp_cb(elec_get_temp_cb_t cb) const
+	{
+		libelec_batt_set_temp_cb(comp_, cb);
+	}
+};
+
+/** Handle of an \ref ELEC_TIE. */
+class Tie : public TypedComp<ELEC_TIE, Tie> {
+public:
+	/** @see libelec_tie_set_all() */
+	void set_all(bool tied) const { libelec_tie_set_all(comp_, tied); }
+	/** @see libelec_tie_get_all() */
+	bool get_all() const { return (libelec_tie_get_all(comp_)); }
+	/**
+	 * Ties exactly the buses in `buses` and unties all others.
+	 * @see libelec_tie_set_list()
+	 */
+	void set_list(std::span<elec_comp_t *const> buses) const
+	{
+		libelec_tie_set_list(comp_, buses.size(), buses.data());
+	}
+	/**
+	 * Fills `buf` with the buses currently tied. `buf` must be able
+	 * to hold num_buses() buses.
+	 * @return The filled part of `buf`.
+	 * @see libelec_tie_get_list()
+	 */
+	std::span<elec_comp_t *const> get_list(std::span<elec_comp_t *> buf)
+	    const
+	{
+		size_t n = libelec_tie_get_list(comp_, buf.size(), buf.data());
+		return (buf.first(n));
+	}
+	/** @see libelec_tie_get_num_buses() */
+	size_t num_buses() const { return (libelec_tie_get_num_buses(comp_)); }
+	/** @see libelec_tie_set_mask() */
+	uint64_t set_mask(uint64_t mask) const
+	{
+		return (libelec_tie_set_mask(comp_, mask));
+	}
+	/** @see libelec_tie_get_mask() */
+	uint64_t mask() const { return (libelec_tie_get_mask(comp_)); }
+};
+
+/**
+ * Owns an electrical network. The network is stopped (if it has been
+ * started) and destroyed along with the object. Check that loading the
+ * network has succeeded by converting the object to bool.
+ */
+class System {
+public:
+	System() = default;
+	/** @see libelec_new() */
+	explicit System(const char *filename) : sys_(libelec_new(filename)) {}
+	/** Takes over `sys`, which may be NULL. */
+	explicit System(elec_sys_t *sys) : sys_(sys) {}
+	~System() { reset(); }
+
+	System(const System &) = delete;
+	System &operator=(const System &) = delete;
+	System(System &&other) noexcept : sys_(other.release()) {}
+	System &operator=(System &&other) noexcept
+	{
+		if (this != &other)
+			reset(other.release());
+		return (*this);
+	}
+
+	explicit operator bool() const { return (sys_ != nullptr); }
+	elec_sys_t *get() const { return (sys_); }
+	/** Gives up ownership of the network without destroying it. */
+	elec_sys_t *release() { return (std::exchange(sys_, nullptr)); }
+	/** Destroys the owned network (if any) and takes over `sys`. */
+	void reset(elec_sys_t *sys = nullptr)
+	{
+		if (sys_ != nullptr) {
+			libelec_sys_stop(sys_);
+			libelec_destroy(sys_);
+		}
+		sys_ = sys;
+	}
+
+	/** @see libelec_sys_start() */
+	bool start() const { return (libelec_sys_start(sys_)); }
+	/** @see libelec_sys_stop() */
+	void stop() const { libelec_sys_stop(sys_); }
+	/** @see libelec_sys_step() */
+	void step(double d_t) const { libelec_sys_step(sys_, d_t); }
+
+	/**
+	 * Looks up a component by name and binds it to a handle of type
+	 * `H`. The handle is empty if there is no such component, or it
+	 * isn't of the handle's type.
+	 * @see libelec_comp_find()
+	 */
+	template<class H = Comp>
+	H find(const char *name) const
+	{
+		return (H::bind(libelec_comp_find(sys_, name)));
+	}
+	/** @see libelec_get_num_comps() */
+	size_t num_comps() const { return (libelec_get_num_comps(sys_)); }
+	/** @see libelec_get_comp() */
+	Comp comp(size_t idx) const
+	{
+		return (Comp(libelec_get_comp(sys_, idx)));
+	}
+
+private:
+	elec_sys_t	*sys_ = nullptr;
+};
+
+/**
+ * A bulk state query (see libelec_query_new()), along with storage for
+ * its results. Add all the quantities to read up front, then call
+ * read() as often as needed. Reading doesn't allocate.
+ */
+class Query {
+public:
+	explicit Query(const System &sys) :
+	    sys_(sys.get()), query_(libelec_query_new(sys.get())) {}
+	~Query() { libelec_query_destroy(query_); }
+
+	Query(const Query &) = delete;
+	Query &operator=(const Query &) = delete;
+
+	/**
+	 * Adds a quantity to the query.
+	 * @return The index of the quantity's value in the span returned
+	 *	by read().
+	 * @see libelec_query_add()
+	 */
+	size_t add(Comp comp, elec_qty_t qty)
+	{
+		size_t idx = libelec_query_add(query_, comp.get(), qty);
+
+		values_.resize(libelec_query_get_len(query_));
+		return (idx);
+	}
+	size_t size() const { return (values_.size()); }
+
+	/**
+	 * Reads all quantities of the query from the same network state.
+	 * @return The values, in the order in which they were added. The
+	 *	span remains valid until the next call to add().
+	 * @see libelec_sys_read_many()
+	 */
+	std::span<const double> read()
+	{
+		libelec_sys_read_many(sys_, query_, values_.data());
+		return (values_);
+	}
+	/** Values returned by the last call to read(). */
+	std::span<const double> values() const { return (values_); }
+
+private:
+	elec_sys_t		*sys_;
+	elec_query_t		*query_;
+	std::vector<double>	values_;
+};
+
+/**
+ * Storage for a snapshot of a network's state (see
+ * libelec_snapshot_save()). The storage is kept between saves, so only
+ * the first one allocates.
+ */
+class Snapshot {
+public:
+	/**
+	 * Takes a snapshot of `sys`.
+	 * @return The snapshot data, valid until the next call to save().
+	 */
+	std::span<const std::byte> save(const System &sys)
+	{
+		size_t sz = libelec_snapshot_save(sys.get(), data_.data(),
+		    data_.size());
+
+		if (sz > data_.size()) {
+			data_.resize(sz);
+			sz = libelec_snapshot_save(sys.get(), data_.data(),
+			    data_.size());
+		}
+		len_ = sz;
+		return (data());
+	}
+	/** @see libelec_snapshot_restore() */
+	bool restore(const System &sys) const
+	{
+		return (libelec_snapshot_restore(sys.get(), data_.data(),
+		    len_));
+	}
+	/** The data of the last snapshot taken. */
+	std::span<const std::byte> data() const
+	{
+		return (std::span<const std::byte>(data_.data(), len_));
+	}
+
+private:
+	std::vector<std::byte>	data_;
+	size_t			len_ = 0;
+};
+
+/**
+ * A batch of switching & failure changes (see libelec_batch_begin()),
+ * which take effect together once committed. A batch which is neither
+ * committed nor aborted is aborted along with the object.
+ */
+class Batch {
+public:
+	explicit Batch(const System &sys) :
+	    batch_(libelec_batch_begin(sys.get())) {}
+	~Batch() { abort(); }
+
+	Batch(const Batch &) = delete;
+	Batch &operator=(const Batch &) = delete;
+
+	/** @see libelec_batch_comp_set_failed() */
+	Batch &set_failed(Comp comp, bool failed)
+	{
+		libelec_batch_comp_set_failed(batch_, comp.get(), failed);
+		return (*this);
+	}
+	/** @see libelec_batch_comp_set_shorted() */
+	Batch &set_shorted(Comp comp, bool shorted)
+	{
+		libelec_batch_comp_set_shorted(batch_, comp.get(), shorted);
+		return (*this);
+	}
+	/** @see libelec_batch_cb_set() */
+	Batch &cb_set(Cb cb, bool set)
+	{
+		libelec_batch_cb_set(batch_, cb.get(), set);
+		return (*this);
+	}
+	/** @see libelec_batch_tie_set_all() */
+	Batch &tie_set_all(Tie tie, bool tied)
+	{
+		libelec_batch_tie_set_all(batch_, tie.get(), tied);
+		return (*this);
+	}
+	/** @see libelec_batch_tie_set_list() */
+	Batch &tie_set_list(Tie tie, std::span<elec_comp_t *const> buses)
+	{
+		libelec_batch_tie_set_list(batch_, tie.get(), buses.size(),
+		    buses.data());
+		return (*this);
+	}
+	/** @see libelec_batch_get_len() */
+	size_t size() const { return (libelec_batch_get_len(batch_)); }
+
+	/**
+	 * Applies the batch. Nothing more can be recorded afterwards.
+	 * @see libelec_batch_commit()
+	 */
+	void commit()
+	{
+		if (batch_ != nullptr)
+			libelec_batch_commit(std::exchange(batch_, nullptr));
+	}
+	/** @see libelec_batch_abort() */
+	void abort()
+	{
+		if (batch_ != nullptr)
+			libelec_batch_abort(std::exchange(batch_, nullptr));
+	}
+
+private:
+	elec_batch_t	*batch_;
+};
+
+}	/* namespace elec */
+
+#endif	/* _LIBELEC_HPP_ */
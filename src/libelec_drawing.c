@@ -7,7 +7,13 @@
  * Copyright 2023 Saso Kiselkov. All rights reserved.
  */
 
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <acfutils/avl.h>
 #include <acfutils/cairo_utils.h>
+#include <acfutils/crc64.h>
 #include <acfutils/perf.h>
 
 #include "libelec_drawing.h"
@@ -17,6 +23,41 @@
 #define	LINE_HEIGHT		1
 #define	COMP_INFO_BG_RGB	0.8, 0.8, 0.8
 #define	MAX_NAME_LEN		128
+/*
+ * Number of distinct scaled fonts for which we keep shaped text around
+ * and the maximum number of strings cached per font.
+ */
+#define	TEXT_CACHE_FONTS	8
+#define	TEXT_CACHE_MAX_STRS	4096
+/*
+ * Level-of-detail thresholds, in device pixels. Text smaller than
+ * LOD_TEXT_MIN_PX isn't drawn at all. Below LOD_SIMPLE_PX per layout
+ * unit, components are drawn as plain boxes, and below LOD_BLOCK_PX,
+ * label boxes are drawn as solid blocks covering their contents.
+ */
+#define	LOD_TEXT_MIN_PX		5
+#define	LOD_SIMPLE_PX		3
+#define	LOD_BLOCK_PX		1
+
+/*
+ * libelec_bench pulls this file into its own translation unit and
+ * defines this macro to measure how long `expr' takes to draw a part of
+ * the layout belonging to a component of type `type' (see the "draw"
+ * sub-command in bench/bench.c).
+ */
+#ifndef	DRAW_PROBE
+#define	DRAW_PROBE(type, expr)	expr
+#endif
+
+/*
+ * How much detail to draw, depending on how many device pixels a unit
+ * of the layout ends up on, see draw_get_lod().
+ */
+typedef enum {
+	LOD_FULL,	/* everything */
+	LOD_SIMPLE,	/* boxes in place of symbols, no connection dimples */
+	LOD_BLOCK	/* label boxes as blocks hiding their contents */
+} draw_lod_t;
 
 enum {
     TEXT_ALIGN_LEFT,
@@ -24,9 +65,296 @@ enum {
     TEXT_ALIGN_RIGHT
 };
 
+/*
+ * Components with switchable state (buses, breakers, shunts & ties) are
+ * drawn in two parts: their geometry, which depends on state, and their
+ * name label, which doesn't. These flags select which part to draw.
+ */
+enum {
+    DRAW_GEOM = 1 << 0,
+    DRAW_LABEL = 1 << 1,
+    DRAW_ALL = DRAW_GEOM | DRAW_LABEL
+};
+
+/*
+ * Shaping text is one of the most expensive parts of drawing the network,
+ * yet we keep drawing the same component names and unit suffixes over
+ * and over again. So every `cairo_t' we draw into gets a cache of the
+ * glyphs and extents of the strings we've drawn into it, attached as
+ * user data. This way the cache is only ever used from the thread which
+ * owns the `cairo_t' and gets released together with it. Shaping depends
+ * on the scaled font (font face, size & transformation matrix), so the
+ * strings are cached separately for each scaled font in use. Changing
+ * the zoom level creates new scaled fonts, which simply push the least
+ * recently added ones out of the cache.
+ */
+typedef struct {
+	char			*str;
+	cairo_glyph_t		*glyphs;
+	int			num_glyphs;
+	cairo_text_extents_t	te;
+	avl_node_t		node;
+} text_ent_t;
+
+typedef struct {
+	cairo_scaled_font_t	*font;
+	avl_tree_t		strs;
+} text_font_t;
+
+typedef struct {
+	text_font_t		fonts[TEXT_CACHE_FONTS];
+	unsigned		next_font;
+	/* Scratch space for positioning the cached glyphs */
+	cairo_glyph_t		*glyphs;
+	int			cap_glyphs;
+	/*
+	 * Set by libelec_draw_layout_layer() while the text would be too
+	 * small to read, which suppresses drawing of all text.
+	 */
+	bool			no_text;
+} text_cache_t;
+
+static cairo_user_data_key_t text_cache_key;
+
+/*
+ * The wiring between buses and the components they connect to only
+ * depends on the immutable layout of the network, yet working it out
+ * takes a fair amount of searching for the nearest connection points.
+ * So we build the paths of all of the bus connections once for a given
+ * network and `pos_scale' and keep them in a cache attached to the
+ * `cairo_t' (just like the text cache). Drawing a frame then only has
+ * to pick the colors to stroke the cached paths with.
+ */
+typedef struct {
+	const elec_comp_t	*bus;
+	/* Bounding box of all connections in drawing coordinates */
+	vect2_t			min, max;
+	cairo_path_t		*wires;		/* connection lines */
+	cairo_path_t		*dimples;	/* dots on the bus */
+} bus_geom_t;
+
+typedef struct {
+	const elec_sys_t	*sys;
+	uint64_t		conf_crc;
+	double			pos_scale;
+	size_t			n_buses;
+	bus_geom_t		*buses;
+} bus_geom_cache_t;
+
+static cairo_user_data_key_t bus_geom_cache_key;
+
+/*
+ * Everything a frame shows about the network state is read out once,
+ * when the frame starts (see snap_take()), rather than through a getter
+ * call for every value drawn. That's a single read section per frame
+ * instead of many and it keeps the frame internally consistent, even as
+ * the worker publishes new states while we're drawing. The buffers are
+ * kept in a cache attached to the `cairo_t' (just like the text cache),
+ * so once they've grown large enough, taking a snapshot doesn't
+ * allocate anything. Outside of a frame (or if the cache couldn't be
+ * attached), the drawing code falls back to the getters.
+ */
+#define	SNAP_NUM_QTYS	(ELEC_QTY_OUT_FREQ + 1)
+
+typedef struct {
+	const elec_sys_t	*sys;
+	bool			valid;		/* inside of a frame */
+	size_t			n_comps;
+	unsigned		*srcs_start;	/* n_comps + 1 */
+	bool			*cb_failed;	/* n_comps */
+	elec_comp_t		**srcs;
+	size_t			srcs_cap;
+	/*
+	 * Quantities shown by the info overlay of `query_comp': all of its
+	 * own (at their elec_qty_t index), followed by the input amps and
+	 * power of each of its neighbours, if it's a bus. `comp' is set
+	 * while `values' holds them for the current frame.
+	 */
+	const elec_comp_t	*query_comp;
+	uint64_t		conf_crc;
+	elec_query_t		*query;
+	double			*values;
+	const elec_comp_t	*comp;
+} draw_snap_t;
+
+static cairo_user_data_key_t draw_snap_key;
+
+static void draw_layout_layer(const elec_sys_t *sys, cairo_t *cr,
+    double pos_scale, double font_sz, elec_draw_layer_t layer);
 static void show_text_aligned(cairo_t *cr, double x, double y, unsigned align,
     const char *format, ...) PRINTF_ATTR(5);
 
+static int
+text_ent_compar(const void *a, const void *b)
+{
+	const text_ent_t *ea = a, *eb = b;
+	int res = strcmp(ea->str, eb->str);
+
+	if (res < 0)
+		return (-1);
+	if (res > 0)
+		return (1);
+	return (0);
+}
+
+static void
+text_font_flush(text_font_t *tf)
+{
+	text_ent_t *ent;
+	void *cookie = NULL;
+
+	ASSERT(tf != NULL);
+
+	while ((ent = avl_destroy_nodes(&tf->strs, &cookie)) != NULL) {
+		cairo_glyph_free(ent->glyphs);
+		elec_free(ent->str);
+		elec_free(ent);
+	}
+}
+
+static void
+text_cache_destroy(void *data)
+{
+	text_cache_t *tc = data;
+
+	ASSERT(tc != NULL);
+
+	for (unsigned i = 0; i < TEXT_CACHE_FONTS; i++) {
+		text_font_t *tf = &tc->fonts[i];
+
+		text_font_flush(tf);
+		avl_destroy(&tf->strs);
+		if (tf->font != NULL)
+			cairo_scaled_font_destroy(tf->font);
+	}
+	elec_free(tc->glyphs);
+	elec_free(tc);
+}
+
+static text_cache_t *
+text_cache_get(cairo_t *cr)
+{
+	text_cache_t *tc;
+
+	ASSERT(cr != NULL);
+
+	tc = cairo_get_user_data(cr, &text_cache_key);
+	if (tc != NULL)
+		return (tc);
+	tc = elec_calloc(1, sizeof (*tc));
+	for (unsigned i = 0; i < TEXT_CACHE_FONTS; i++) {
+		avl_create(&tc->fonts[i].strs, text_ent_compar,
+		    sizeof (text_ent_t), offsetof(text_ent_t, node));
+	}
+	if (cairo_set_user_data(cr, &text_cache_key, tc,
+	    text_cache_destroy) != CAIRO_STATUS_SUCCESS) {
+		text_cache_destroy(tc);
+		return (NULL);
+	}
+	return (tc);
+}
+
+/*
+ * Looks up the shaped version of `str' in the current font of `cr',
+ * shaping it and adding it to the cache if necessary. The returned glyphs
+ * are positioned relative to the text's origin at (0, 0). Returns NULL
+ * if the text couldn't be shaped, in which case the caller should fall
+ * back to the plain cairo text API.
+ */
+static const text_ent_t *
+text_lookup(cairo_t *cr, const char *str)
+{
+	text_cache_t *tc;
+	text_font_t *tf = NULL;
+	cairo_scaled_font_t *font;
+	const text_ent_t srch = { .str = (char *)str };
+	text_ent_t *ent;
+	avl_index_t where;
+
+	ASSERT(cr != NULL);
+	ASSERT(str != NULL);
+
+	tc = text_cache_get(cr);
+	font = cairo_get_scaled_font(cr);
+	if (tc == NULL || cairo_scaled_font_status(font) !=
+	    CAIRO_STATUS_SUCCESS) {
+		return (NULL);
+	}
+	for (unsigned i = 0; i < TEXT_CACHE_FONTS; i++) {
+		if (tc->fonts[i].font == font) {
+			tf = &tc->fonts[i];
+			break;
+		}
+	}
+	if (tf == NULL) {
+		tf = &tc->fonts[tc->next_font];
+		tc->next_font = (tc->next_font + 1) % TEXT_CACHE_FONTS;
+		text_font_flush(tf);
+		if (tf->font != NULL)
+			cairo_scaled_font_destroy(tf->font);
+		/* Holding a reference keeps the pointer from being reused */
+		tf->font = cairo_scaled_font_reference(font);
+	}
+	ent = avl_find(&tf->strs, &srch, &where);
+	if (ent != NULL)
+		return (ent);
+	if (avl_numnodes(&tf->strs) >= TEXT_CACHE_MAX_STRS) {
+		text_font_flush(tf);
+		where = 0;
+		VERIFY3P(avl_find(&tf->strs, &srch, &where), ==, NULL);
+	}
+
+	ent = elec_calloc(1, sizeof (*ent));
+	if (cairo_scaled_font_text_to_glyphs(font, 0, 0, str, -1,
+	    &ent->glyphs, &ent->num_glyphs, NULL, NULL, NULL) !=
+	    CAIRO_STATUS_SUCCESS) {
+		elec_free(ent);
+		return (NULL);
+	}
+	cairo_scaled_font_glyph_extents(font, ent->glyphs, ent->num_glyphs,
+	    &ent->te);
+	ent->str = elec_strdup(str);
+	avl_insert(&tf->strs, ent, where);
+
+	return (ent);
+}
+
+/*
+ * Draws a piece of previously shaped text at (x, y). This is equivalent
+ * to a cairo_move_to() followed by cairo_show_text().
+ */
+static void
+text_show(cairo_t *cr, const text_ent_t *ent, double x, double y)
+{
+	text_cache_t *tc;
+
+	ASSERT(cr != NULL);
+	ASSERT(ent != NULL);
+	tc = cairo_get_user_data(cr, &text_cache_key);
+	ASSERT(tc != NULL);
+
+	if (tc->cap_glyphs < ent->num_glyphs) {
+		tc->cap_glyphs = ent->num_glyphs;
+		elec_free(tc->glyphs);
+		tc->glyphs = elec_malloc(tc->cap_glyphs *
+		    sizeof (*tc->glyphs));
+	}
+	for (int i = 0; i < ent->num_glyphs; i++) {
+		tc->glyphs[i] = ent->glyphs[i];
+		tc->glyphs[i].x += x;
+		tc->glyphs[i].y += y;
+	}
+	cairo_show_glyphs(cr, tc->glyphs, ent->num_glyphs);
+	cairo_move_to(cr, x + ent->te.x_advance, y + ent->te.y_advance);
+}
+
+static bool
+text_hidden(cairo_t *cr)
+{
+	const text_cache_t *tc = cairo_get_user_data(cr, &text_cache_key);
+	return (tc != NULL && tc->no_text);
+}
+
 static void
 make_comp_name(const char *in_name, char out_name[MAX_NAME_LEN])
 {
@@ -47,61 +375,55 @@ make_comp_name(const char *in_name, char out_name[MAX_NAME_LEN])
 		out_name[n - 2] = '/';
 }
 
-static void
-get_srcs(const elec_comp_t *comp, elec_comp_t *srcs[ELEC_MAX_SRCS])
-{
-	ASSERT(comp != NULL);
-	ASSERT(srcs != NULL);
-
-	mutex_enter(&((elec_comp_t *)comp)->rw_ro_lock);
-	memcpy(srcs, comp->srcs_ext, sizeof (*srcs) * ELEC_MAX_SRCS);
-	mutex_exit(&((elec_comp_t *)comp)->rw_ro_lock);
-}
-
-static unsigned
-count_srcs(elec_comp_t *srcs[ELEC_MAX_SRCS])
-{
-	ASSERT(srcs != NULL);
-
-	for (unsigned n_srcs = 0; n_srcs < ELEC_MAX_SRCS; n_srcs++) {
-		if (srcs[n_srcs] == NULL)
-			return (n_srcs);
-	}
-	return (ELEC_MAX_SRCS);
-}
-
 static void
 show_text_aligned(cairo_t *cr, double x, double y, unsigned align,
     const char *format, ...)
 {
+	const text_ent_t *ent;
 	cairo_text_extents_t te;
-	char *str;
+	char buf[MAX_NAME_LEN], *str = buf;
 	va_list ap;
+	int n;
 
 	ASSERT(cr != NULL);
 	ASSERT(format != NULL);
+	if (text_hidden(cr))
+		return;
 	va_start(ap, format);
-	str = vsprintf_alloc(format, ap);
+	n = vsnprintf(buf, sizeof (buf), format, ap);
 	va_end(ap);
+	if (n >= (int)sizeof (buf)) {
+		va_start(ap, format);
+		str = elec_vsprintf_alloc(format, ap);
+		va_end(ap);
+	}
 
-	cairo_text_extents(cr, str, &te);
+	ent = text_lookup(cr, str);
+	if (ent != NULL)
+		te = ent->te;
+	else
+		cairo_text_extents(cr, str, &te);
 	switch (align) {
 	case TEXT_ALIGN_LEFT:
-		cairo_move_to(cr, x - te.x_bearing,
-		    y - te.height / 2 - te.y_bearing);
+		x = x - te.x_bearing;
 		break;
 	case TEXT_ALIGN_CENTER:
-		cairo_move_to(cr, x - te.width / 2 - te.x_bearing,
-		    y - te.height / 2 - te.y_bearing);
+		x = x - te.width / 2 - te.x_bearing;
 		break;
 	case TEXT_ALIGN_RIGHT:
-		cairo_move_to(cr, x - te.width - te.x_bearing,
-		    y - te.height / 2 - te.y_bearing);
+		x = x - te.width - te.x_bearing;
 		break;
 	}
-	cairo_show_text(cr, str);
+	y = y - te.height / 2 - te.y_bearing;
+	if (ent != NULL) {
+		text_show(cr, ent, x, y);
+	} else {
+		cairo_move_to(cr, x, y);
+		cairo_show_text(cr, str);
+	}
 
-	free(str);
+	if (str != buf)
+		elec_free(str);
 }
 
 static vect2_t
@@ -200,8 +522,301 @@ elec_comp_get_nearest_pos(const elec_comp_t *comp, vect2_t *comp_pos,
 	return (true);
 }
 
+/*
+ * Checks if a box, given in drawing coordinates, intersects the visible
+ * area `clip' (as returned by cairo_clip_extents()). Used to cull drawing
+ * of components which lie completely outside of the view.
+ */
+static bool
+box_in_view(const double clip[4], vect2_t min, vect2_t max)
+{
+	ASSERT(clip != NULL);
+	return (max.x >= clip[0] && min.x <= clip[2] &&
+	    max.y >= clip[1] && min.y <= clip[3]);
+}
+
+/*
+ * Conservative check whether any part of a component (including its name
+ * label) might be visible. All symbols fit within 4 units from their
+ * position, buses extend by their size vertically and we assume every
+ * character of the name label is at most one font size across.
+ */
 static void
-draw_src_path(cairo_t *cr, cairo_path_t *path, const elec_comp_t *comp)
+comp_extents(double pos_scale, double font_sz, const elec_comp_info_t *info,
+    vect2_t *min, vect2_t *max)
+{
+	vect2_t pos, ext;
+
+	ASSERT(info != NULL);
+	ASSERT(min != NULL);
+	ASSERT(max != NULL);
+
+	pos = VECT2(PX(info->gui.pos.x), PX(info->gui.pos.y));
+	ext = VECT2(PX(4) + strlen(info->name) * font_sz, PX(4) + 2 * font_sz);
+	if (info->type == ELEC_BUS)
+		ext.y += PX(info->gui.sz);
+	*min = vect2_sub(pos, ext);
+	*max = vect2_add(pos, ext);
+}
+
+static bool
+comp_in_view(const double clip[4], double pos_scale, double font_sz,
+    const elec_comp_info_t *info)
+{
+	vect2_t min, max;
+
+	ASSERT(clip != NULL);
+	comp_extents(pos_scale, font_sz, info, &min, &max);
+	return (box_in_view(clip, min, max));
+}
+
+/*
+ * Extents of a bus bar and all of its connection lines in layout units,
+ * with a margin for the symbols of the components at their ends.
+ */
+static void
+bus_extents(const elec_comp_t *bus, vect2_t *min_p, vect2_t *max_p)
+{
+	vect2_t min, max;
+
+	ASSERT(bus != NULL);
+	ASSERT3U(bus->info->type, ==, ELEC_BUS);
+	ASSERT(min_p != NULL);
+	ASSERT(max_p != NULL);
+
+	min = VECT2(bus->info->gui.pos.x, bus->info->gui.pos.y -
+	    bus->info->gui.sz);
+	max = VECT2(bus->info->gui.pos.x, bus->info->gui.pos.y +
+	    bus->info->gui.sz);
+	for (unsigned i = 0; i < bus->n_links; i++) {
+		vect2_t pos = bus->adj[i]->info->gui.pos;
+
+		if (IS_NULL_VECT(pos))
+			continue;
+		min = VECT2(MIN(min.x, pos.x), MIN(min.y, pos.y));
+		max = VECT2(MAX(max.x, pos.x), MAX(max.y, pos.y));
+	}
+	*min_p = vect2_sub(min, VECT2(4, 4));
+	*max_p = vect2_add(max, VECT2(4, 4));
+}
+
+static void
+draw_snap_destroy(void *data)
+{
+	draw_snap_t *snap = data;
+
+	ASSERT(snap != NULL);
+	elec_free(snap->srcs_start);
+	elec_free(snap->cb_failed);
+	elec_free(snap->srcs);
+	libelec_query_destroy(snap->query);
+	elec_free(snap->values);
+	elec_free(snap);
+}
+
+/*
+ * (Re)builds the query reading out the quantities shown by the info
+ * overlay of `comp', see draw_snap_t.
+ */
+static void
+snap_query_build(draw_snap_t *snap, const elec_comp_t *comp)
+{
+	elec_sys_t *sys;
+
+	ASSERT(snap != NULL);
+	ASSERT(comp != NULL);
+	sys = comp->sys;
+
+	libelec_query_destroy(snap->query);
+	elec_free(snap->values);
+	snap->query = libelec_query_new(sys);
+	for (int qty = 0; qty < SNAP_NUM_QTYS; qty++)
+		libelec_query_add(snap->query, comp, qty);
+	if (comp->info->type == ELEC_BUS) {
+		for (unsigned i = 0; i < comp->n_links; i++) {
+			libelec_query_add(snap->query, comp->adj[i],
+			    ELEC_QTY_IN_AMPS);
+			libelec_query_add(snap->query, comp->adj[i],
+			    ELEC_QTY_IN_PWR);
+		}
+	}
+	snap->values = elec_calloc(libelec_query_get_len(snap->query),
+	    sizeof (*snap->values));
+	snap->query_comp = comp;
+	snap->conf_crc = sys->conf_crc;
+}
+
+/*
+ * Starts a frame by taking a snapshot of the network state shown in
+ * it. If `comp' isn't NULL, the snapshot also covers the values shown
+ * by its info overlay. Must be paired with snap_release().
+ */
+static void
+snap_take(cairo_t *cr, const elec_sys_t *sys, const elec_comp_t *comp)
+{
+	draw_snap_t *snap;
+	size_t n_comps, n_srcs;
+
+	ASSERT(cr != NULL);
+	ASSERT(sys != NULL);
+
+	snap = cairo_get_user_data(cr, &draw_snap_key);
+	if (snap == NULL) {
+		snap = elec_calloc(1, sizeof (*snap));
+		if (cairo_set_user_data(cr, &draw_snap_key, snap,
+		    draw_snap_destroy) != CAIRO_STATUS_SUCCESS) {
+			elec_free(snap);
+			return;
+		}
+	}
+	n_comps = list_count(&sys->comps);
+	if (snap->sys != sys || snap->n_comps != n_comps) {
+		elec_free(snap->srcs_start);
+		elec_free(snap->cb_failed);
+		snap->srcs_start = elec_calloc(n_comps + 1,
+		    sizeof (*snap->srcs_start));
+		snap->cb_failed = elec_calloc(MAX(n_comps, 1),
+		    sizeof (*snap->cb_failed));
+		snap->sys = sys;
+		snap->n_comps = n_comps;
+	}
+	if (comp != NULL && (snap->query_comp != comp ||
+	    snap->conf_crc != sys->conf_crc)) {
+		snap_query_build(snap, comp);
+	}
+	for (;;) {
+		n_srcs = elec_draw_read_state(sys,
+		    comp != NULL ? snap->query : NULL, snap->values,
+		    snap->cb_failed, snap->srcs_start, snap->srcs,
+		    snap->srcs_cap);
+		if (n_srcs <= snap->srcs_cap)
+			break;
+		/* Some sources didn't fit, grow the buffer and try again */
+		snap->srcs_cap = 2 * n_srcs;
+		elec_free(snap->srcs);
+		snap->srcs = elec_calloc(snap->srcs_cap, sizeof (*snap->srcs));
+	}
+	snap->valid = true;
+	snap->comp = comp;
+}
+
+/*
+ * Ends a frame started by snap_take().
+ */
+static void
+snap_release(cairo_t *cr)
+{
+	draw_snap_t *snap = cairo_get_user_data(cr, &draw_snap_key);
+
+	if (snap != NULL)
+		snap->valid = false;
+}
+
+/*
+ * Returns the snapshot of the current frame, or NULL if we're outside
+ * of one, or it doesn't cover the network of `comp'.
+ */
+static const draw_snap_t *
+snap_get(cairo_t *cr, const elec_comp_t *comp)
+{
+	const draw_snap_t *snap = cairo_get_user_data(cr, &draw_snap_key);
+
+	ASSERT(comp != NULL);
+	if (snap == NULL || !snap->valid || snap->sys != comp->sys)
+		return (NULL);
+	ASSERT3U(comp->comp_idx, <, snap->n_comps);
+	return (snap);
+}
+
+/*
+ * Same as libelec_comp_get_src_list(), but reads from the snapshot of
+ * the current frame.
+ */
+static size_t
+snap_srcs(cairo_t *cr, const elec_comp_t *comp, size_t cap,
+    elec_comp_t **srcs)
+{
+	const draw_snap_t *snap = snap_get(cr, comp);
+	unsigned start, n_srcs;
+
+	if (snap == NULL)
+		return (libelec_comp_get_src_list(comp, cap, srcs));
+	start = snap->srcs_start[comp->comp_idx];
+	n_srcs = snap->srcs_start[comp->comp_idx + 1] - start;
+	if (cap != 0) {
+		memcpy(srcs, &snap->srcs[start],
+		    MIN(n_srcs, cap) * sizeof (*srcs));
+	}
+
+	return (n_srcs);
+}
+
+/*
+ * Same as libelec_comp_get_failed() for a circuit breaker, but reads
+ * from the snapshot of the current frame.
+ */
+static bool
+snap_cb_failed(cairo_t *cr, const elec_comp_t *cb)
+{
+	const draw_snap_t *snap = snap_get(cr, cb);
+
+	ASSERT3U(cb->info->type, ==, ELEC_CB);
+	if (snap == NULL)
+		return (libelec_comp_get_failed(cb));
+	return (snap->cb_failed[cb->comp_idx]);
+}
+
+/*
+ * Returns quantity `qty' of `comp', as read out by libelec_query_add()
+ * when the snapshot of the current frame was taken. `comp' must either
+ * be the component whose info overlay is being drawn, or a neighbour
+ * of it across link `link' (in which case `qty' must be
+ * ELEC_QTY_IN_AMPS or ELEC_QTY_IN_PWR).
+ */
+static double
+snap_qty(cairo_t *cr, const elec_comp_t *comp, int link, elec_qty_t qty)
+{
+	const draw_snap_t *snap;
+	const elec_comp_t *tgt;
+
+	ASSERT(comp != NULL);
+	tgt = (link < 0 ? comp : comp->adj[link]);
+	snap = snap_get(cr, comp);
+	if (snap != NULL && snap->comp == comp) {
+		if (link < 0)
+			return (snap->values[qty]);
+		ASSERT(qty == ELEC_QTY_IN_AMPS || qty == ELEC_QTY_IN_PWR);
+		return (snap->values[SNAP_NUM_QTYS + 2 * link +
+		    (qty == ELEC_QTY_IN_PWR)]);
+	}
+	switch (qty) {
+	case ELEC_QTY_IN_VOLTS:
+		return (libelec_comp_get_in_volts(tgt));
+	case ELEC_QTY_OUT_VOLTS:
+		return (libelec_comp_get_out_volts(tgt));
+	case ELEC_QTY_IN_AMPS:
+		return (libelec_comp_get_in_amps(tgt));
+	case ELEC_QTY_OUT_AMPS:
+		return (libelec_comp_get_out_amps(tgt));
+	case ELEC_QTY_IN_PWR:
+		return (libelec_comp_get_in_pwr(tgt));
+	case ELEC_QTY_OUT_PWR:
+		return (libelec_comp_get_out_pwr(tgt));
+	case ELEC_QTY_IN_FREQ:
+		return (libelec_comp_get_in_freq(tgt));
+	case ELEC_QTY_OUT_FREQ:
+		return (libelec_comp_get_out_freq(tgt));
+	}
+	VERIFY_FAIL();
+}
+
+/*
+ * Strokes `path' in the colors of the sources powering `comp'. Doesn't
+ * take ownership of the path, see draw_src_path() for that.
+ */
+static void
+stroke_src_path(cairo_t *cr, const cairo_path_t *path,
+    const elec_comp_t *comp)
 {
 	cairo_pattern_t *pat;
 	vect3_t color;
@@ -212,8 +827,7 @@ draw_src_path(cairo_t *cr, cairo_path_t *path, const elec_comp_t *comp)
 	ASSERT(path != NULL);
 	ASSERT(comp != NULL);
 
-	get_srcs(comp, srcs);
-	n_srcs = count_srcs(srcs);
+	n_srcs = MIN(snap_srcs(cr, comp, ELEC_MAX_SRCS, srcs), ELEC_MAX_SRCS);
 
 	switch (n_srcs) {
 	case 0:
@@ -244,35 +858,60 @@ draw_src_path(cairo_t *cr, cairo_path_t *path, const elec_comp_t *comp)
 		cairo_pattern_destroy(pat);
 		break;
 	}
+}
+
+static void
+draw_src_path(cairo_t *cr, cairo_path_t *path, const elec_comp_t *comp)
+{
+	stroke_src_path(cr, path, comp);
 	cairo_path_destroy(path);
 }
 
 static void
-draw_bus_conns(cairo_t *cr, double pos_scale, const elec_comp_t *bus)
+bus_geom_cache_flush(bus_geom_cache_t *gc)
 {
-	ASSERT(cr != NULL);
-	ASSERT(bus != NULL);
-	ASSERT3U(bus->info->type, ==, ELEC_BUS);
+	ASSERT(gc != NULL);
 
-	if (IS_NULL_VECT(bus->info->gui.pos))
-		return;
+	for (size_t i = 0; i < gc->n_buses; i++) {
+		cairo_path_destroy(gc->buses[i].wires);
+		cairo_path_destroy(gc->buses[i].dimples);
+	}
+	elec_free(gc->buses);
+	gc->buses = NULL;
+	gc->n_buses = 0;
+}
 
-	cairo_new_path(cr);
+static void
+bus_geom_cache_destroy(void *data)
+{
+	bus_geom_cache_t *gc = data;
+
+	ASSERT(gc != NULL);
+	bus_geom_cache_flush(gc);
+	elec_free(gc);
+}
 
+/*
+ * Builds the connection paths of a single bus. The paths are built in
+ * the current path of `cr', which is cleared afterwards.
+ */
+static void
+bus_geom_build(cairo_t *cr, double pos_scale, bus_geom_t *geom)
+{
+	const elec_comp_t *bus = geom->bus;
+	vect2_t min, max;
+
+	cairo_new_path(cr);
 	for (unsigned i = 0; i < bus->n_links; i++) {
 		vect2_t bus_pos = bus->info->gui.pos;
 		vect2_t comp_pos;
-		const elec_comp_t *comp = bus->links[i].comp;
+		const elec_comp_t *comp = bus->adj[i];
 		bool align_vert;
-		cairo_path_t *path;
 
 		if (!elec_comp_get_nearest_pos(comp, &comp_pos, &bus_pos,
 		    bus->info->gui.sz, &align_vert)) {
 			continue;
 		}
-		/*
-		 * The connection line itself.
-		 */
 		if (align_vert) {
 			cairo_move_to(cr, PX(bus_pos.x), PX(bus_pos.y));
 			cairo_line_to(cr, PX(comp_pos.x), PX(bus_pos.y));
@@ -285,25 +924,133 @@ draw_bus_conns(cairo_t *cr, double pos_scale, const elec_comp_t *bus)
 			    PX(comp_pos.y));
 			cairo_line_to(cr, PX(comp_pos.x), PX(comp_pos.y));
 		}
-		path = cairo_copy_path(cr);
+	}
+	geom->wires = cairo_copy_path(cr);
+	cairo_new_path(cr);
+	/*
+	 * The black dimples on the bus showing the connections
+	 */
+	for (unsigned i = 0; i < bus->n_links; i++) {
+		vect2_t bus_pos = bus->info->gui.pos;
+		vect2_t comp_pos;
+		bool align_vert;
+
+		if (!elec_comp_get_nearest_pos(bus->adj[i], &comp_pos,
+		    &bus_pos, bus->info->gui.sz, &align_vert)) {
+			continue;
+		}
+		cairo_new_sub_path(cr);
+		if (bus->info->gui.sz != 0 && !bus->info->gui.virt) {
+			cairo_arc(cr, PX(bus_pos.x), PX(bus_pos.y),
+			    PX(0.4), 0, DEG2RAD(360));
+		} else if (bus->n_links > 2) {
+			cairo_arc(cr, PX(bus_pos.x), PX(bus_pos.y),
+			    PX(0.25), 0, DEG2RAD(360));
+		}
+	}
+	geom->dimples = cairo_copy_path(cr);
+	cairo_new_path(cr);
+
+	bus_extents(bus, &min, &max);
+	geom->min = VECT2(PX(min.x), PX(min.y));
+	geom->max = VECT2(PX(max.x), PX(max.y));
+}
+
+/*
+ * Returns the bus connection geometry cache of `cr', (re)building it if
+ * it was built for a different network or `pos_scale'. The returned
+ * cache lists the buses in the order in which they appear in `sys->comps'.
+ * Returns NULL if the cache couldn't be attached to `cr'.
+ */
+static const bus_geom_cache_t *
+bus_geom_cache_get(cairo_t *cr, const elec_sys_t *sys, double pos_scale)
+{
+	bus_geom_cache_t *gc;
+	size_t i = 0;
+
+	ASSERT(cr != NULL);
+	ASSERT(sys != NULL);
+
+	gc = cairo_get_user_data(cr, &bus_geom_cache_key);
+	if (gc == NULL) {
+		gc = elec_calloc(1, sizeof (*gc));
+		if (cairo_set_user_data(cr, &bus_geom_cache_key, gc,
+		    bus_geom_cache_destroy) != CAIRO_STATUS_SUCCESS) {
+			elec_free(gc);
+			return (NULL);
+		}
+	}
+	if (gc->sys == sys && gc->conf_crc == sys->conf_crc &&
+	    gc->pos_scale == pos_scale) {
+		return (gc);
+	}
+	bus_geom_cache_flush(gc);
+	gc->sys = sys;
+	gc->conf_crc = sys->conf_crc;
+	gc->pos_scale = pos_scale;
+
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		if (comp->info->type == ELEC_BUS)
+			gc->n_buses++;
+	}
+	gc->buses = elec_calloc(MAX(gc->n_buses, 1), sizeof (*gc->buses));
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		bus_geom_t *geom;
+
+		if (comp->info->type != ELEC_BUS)
+			continue;
+		ASSERT3U(i, <, gc->n_buses);
+		geom = &gc->buses[i++];
+		geom->bus = comp;
+		bus_geom_build(cr, pos_scale, geom);
+	}
+
+	return (gc);
+}
+
+static void
+draw_bus_conns(cairo_t *cr, const bus_geom_t *geom, elec_draw_layer_t layer,
+    const double clip[4])
+{
+	const elec_comp_t *bus;
+
+	ASSERT(cr != NULL);
+	ASSERT(geom != NULL);
+	bus = geom->bus;
+	ASSERT3U(bus->info->type, ==, ELEC_BUS);
+	ASSERT(clip != NULL);
+
+	if (IS_NULL_VECT(bus->info->gui.pos) ||
+	    !box_in_view(clip, geom->min, geom->max)) {
+		return;
+	}
+	/* Unpowered buses have nothing to color in */
+	if (layer == ELEC_DRAW_LAYER_WIRING_SRCS &&
+	    snap_srcs(cr, bus, 0, NULL) == 0) {
+		return;
+	}
+	if (layer == ELEC_DRAW_LAYER_COMPS && bus->info->gui.invis)
+		return;
+
+	cairo_new_path(cr);
+	switch (layer) {
+	case ELEC_DRAW_LAYER_WIRING:
+		cairo_append_path(cr, geom->wires);
 		cairo_set_line_width(cr, 3);
 		cairo_stroke(cr);
-
+		break;
+	case ELEC_DRAW_LAYER_WIRING_SRCS:
 		cairo_set_line_width(cr, 2);
-		draw_src_path(cr, path, bus);
-		/*
-		 * The black dimple on the bus showing the connection
-		 */
-		if (!bus->info->gui.invis) {
-			if (bus->info->gui.sz != 0 && !bus->info->gui.virt) {
-				cairo_arc(cr, PX(bus_pos.x), PX(bus_pos.y),
-				    PX(0.4), 0, DEG2RAD(360));
-			} else if (bus->n_links > 2) {
-				cairo_arc(cr, PX(bus_pos.x), PX(bus_pos.y),
-				    PX(0.25), 0, DEG2RAD(360));
-			}
-			cairo_fill(cr);
-		}
+		stroke_src_path(cr, geom->wires, bus);
+		break;
+	case ELEC_DRAW_LAYER_COMPS:
+		cairo_append_path(cr, geom->dimples);
+		cairo_fill(cr);
+		break;
+	default:
+		VERIFY_FAIL();
 	}
 }
 
@@ -348,7 +1095,7 @@ draw_gen(cairo_t *cr, double pos_scale, const elec_comp_info_t *info)
 }
 
 static void
-draw_bus(cairo_t *cr, double pos_scale, const elec_comp_t *bus)
+draw_bus(cairo_t *cr, double pos_scale, const elec_comp_t *bus, unsigned what)
 {
 	const elec_comp_info_t *info;
 	vect2_t pos;
@@ -363,7 +1110,7 @@ draw_bus(cairo_t *cr, double pos_scale, const elec_comp_t *bus)
 
 	cairo_new_path(cr);
 
-	if (info->gui.sz != 0) {
+	if (info->gui.sz != 0 && (what & DRAW_GEOM)) {
 		cairo_path_t *path;
 
 		cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
@@ -381,7 +1128,7 @@ draw_bus(cairo_t *cr, double pos_scale, const elec_comp_t *bus)
 		cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
 	}
 
-	if (info->gui.sz != 0 && !info->gui.virt) {
+	if (info->gui.sz != 0 && !info->gui.virt && (what & DRAW_LABEL)) {
 		char name[MAX_NAME_LEN];
 		make_comp_name(info->name, name);
 		show_text_aligned(cr, PX(pos.x), PX(pos.y - info->gui.sz - 1),
@@ -392,7 +1139,7 @@ draw_bus(cairo_t *cr, double pos_scale, const elec_comp_t *bus)
 static void
 draw_cb_icon(cairo_t *cr, double pos_scale, double font_sz, vect2_t pos,
     bool fuse, bool set, bool triphase, const char *comp_name,
-    vect3_t bg_color, const elec_comp_t *comp)
+    vect3_t bg_color, const elec_comp_t *comp, unsigned what)
 {
 	double text_y_off;
 	cairo_path_t *path;
@@ -402,8 +1149,9 @@ draw_cb_icon(cairo_t *cr, double pos_scale, double font_sz, vect2_t pos,
 	ASSERT(comp_name != NULL);
 	ASSERT(comp != NULL);
 
-	make_comp_name(comp_name, name);
 	cairo_new_path(cr);
+	if (!(what & DRAW_GEOM))
+		goto label;
 
 	if (!fuse) {
 		/* Yoke on the top */
@@ -448,7 +1196,9 @@ draw_cb_icon(cairo_t *cr, double pos_scale, double font_sz, vect2_t pos,
 	cairo_new_sub_path(cr);
 	cairo_arc(cr, PX(pos.x + 1), PX(pos.y), PX(0.2), 0, DEG2RAD(360));
 	cairo_stroke(cr);
-
+label:
+	if (!(what & DRAW_LABEL))
+		return;
 	if (triphase) {
 		cairo_set_font_size(cr, round(0.75 * font_sz));
 		show_text_aligned(cr, PX(pos.x), PX(pos.y), TEXT_ALIGN_CENTER,
@@ -456,6 +1206,7 @@ draw_cb_icon(cairo_t *cr, double pos_scale, double font_sz, vect2_t pos,
 		cairo_set_font_size(cr, font_sz);
 	}
 
+	make_comp_name(comp_name, name);
 	text_y_off = (fuse ? 1.5 : 0.8);
 	show_text_aligned(cr, PX(pos.x), PX(pos.y + text_y_off),
 	    TEXT_ALIGN_CENTER, "%s", name);
@@ -463,17 +1214,18 @@ draw_cb_icon(cairo_t *cr, double pos_scale, double font_sz, vect2_t pos,
 
 static void
 draw_cb(cairo_t *cr, double pos_scale, const elec_comp_t *cb, double font_sz,
-    vect3_t bg_color)
+    vect3_t bg_color, unsigned what)
 {
 	ASSERT(cr != NULL);
 	ASSERT(cb != NULL);
 	draw_cb_icon(cr, pos_scale, font_sz, cb->info->gui.pos,
-	    cb->info->cb.fuse, !cb->ro.failed && cb->scb.cur_set,
-	    cb->info->cb.triphase, cb->info->name, bg_color, cb);
+	    cb->info->cb.fuse, !snap_cb_failed(cr, cb) && cb->scb.cur_set,
+	    cb->info->cb.triphase, cb->info->name, bg_color, cb, what);
 }
 
 static void
-draw_shunt(cairo_t *cr, double pos_scale, const elec_comp_t *shunt)
+draw_shunt(cairo_t *cr, double pos_scale, const elec_comp_t *shunt,
+    unsigned what)
 {
 	vect2_t pos;
 	cairo_path_t *path;
@@ -486,21 +1238,24 @@ draw_shunt(cairo_t *cr, double pos_scale, const elec_comp_t *shunt)
 	pos = info->gui.pos;
 
 	cairo_new_path(cr);
-	cairo_set_line_width(cr, 3);
-	cairo_move_to(cr, PX(pos.x - 2.5), PX(pos.y));
-	cairo_rel_line_to(cr, PX(1), PX(0));
-	for (int i = 0; i < 3; i++) {
-		cairo_rel_line_to(cr, PX(0.25), PX(-0.7));
-		cairo_rel_line_to(cr, PX(0.5), PX(1.4));
-		cairo_rel_line_to(cr, PX(0.25), PX(-0.7));
-	}
-	cairo_rel_line_to(cr, PX(1), PX(0));
-	path = cairo_copy_path(cr);
-	cairo_stroke(cr);
-
-	cairo_set_line_width(cr, 2);
-	draw_src_path(cr, path, shunt);
+	if (what & DRAW_GEOM) {
+		cairo_set_line_width(cr, 3);
+		cairo_move_to(cr, PX(pos.x - 2.5), PX(pos.y));
+		cairo_rel_line_to(cr, PX(1), PX(0));
+		for (int i = 0; i < 3; i++) {
+			cairo_rel_line_to(cr, PX(0.25), PX(-0.7));
+			cairo_rel_line_to(cr, PX(0.5), PX(1.4));
+			cairo_rel_line_to(cr, PX(0.25), PX(-0.7));
+		}
+		cairo_rel_line_to(cr, PX(1), PX(0));
+		path = cairo_copy_path(cr);
+		cairo_stroke(cr);
 
+		cairo_set_line_width(cr, 2);
+		draw_src_path(cr, path, shunt);
+	}
+	if (!(what & DRAW_LABEL))
+		return;
 	make_comp_name(info->name, name);
 	show_text_aligned(cr, PX(pos.x), PX(pos.y + 1.7),
 	    TEXT_ALIGN_CENTER, "%s", name);
@@ -625,7 +1380,7 @@ draw_node(cairo_t *cr, double pos_scale, vect2_t pos)
 }
 
 static void
-draw_tie(cairo_t *cr, double pos_scale, const elec_comp_t *tie)
+draw_tie(cairo_t *cr, double pos_scale, const elec_comp_t *tie, unsigned what)
 {
 	vect2_t endpt[2] = { NULL_VECT2, NULL_VECT2 };
 	vect2_t pos;
@@ -636,10 +1391,12 @@ draw_tie(cairo_t *cr, double pos_scale, const elec_comp_t *tie)
 	pos = tie->info->gui.pos;
 
 	cairo_new_path(cr);
+	if (!(what & DRAW_GEOM))
+		goto label;
 
 	cairo_set_line_width(cr, 4);
 	for (unsigned i = 0; i < tie->n_links; i++) {
-		elec_comp_t *remote_bus = tie->links[i].comp;
+		elec_comp_t *remote_bus = tie->adj[i];
 		vect2_t conn = VECT2(1e9, 1e9);
 
 		if (!tie->tie.cur_state[i])
@@ -682,7 +1439,9 @@ draw_tie(cairo_t *cr, double pos_scale, const elec_comp_t *tie)
 	cairo_set_line_width(cr, 2);
 	for (unsigned i = 0; i < tie->n_links; i++)
 		draw_node(cr, pos_scale, tie_node_pos(tie, i));
-
+label:
+	if (!(what & DRAW_LABEL))
+		return;
 	make_comp_name(tie->info->name, name);
 	if (tie->n_links == 3) {
 		show_text_aligned(cr, PX(pos.x), PX(pos.y + 1.8),
@@ -824,8 +1583,9 @@ draw_batt(cairo_t *cr, double pos_scale, const elec_comp_info_t *info,
 
 static void
 draw_label_box(cairo_t *cr, double pos_scale, double font_sz,
-    const elec_comp_info_t *info)
+    const elec_comp_info_t *info, draw_lod_t lod)
 {
+	const text_ent_t *ent;
 	cairo_text_extents_t te;
 	vect3_t color;
 	vect2_t pos, sz;
@@ -836,12 +1596,28 @@ draw_label_box(cairo_t *cr, double pos_scale, double font_sz,
 	ASSERT(info != NULL);
 	ASSERT3U(info->type, ==, ELEC_LABEL_BOX);
 
+	if (lod == LOD_BLOCK) {
+		/* Stands in for all of the components inside of the box */
+		pos = info->label_box.pos;
+		sz = info->label_box.sz;
+		color = info->gui.color;
+		cairo_rectangle(cr, PX(pos.x), PX(pos.y), PX(sz.x), PX(sz.y));
+		cairo_set_source_rgb(cr, color.x, color.y, color.z);
+		cairo_fill_preserve(cr);
+		cairo_set_source_rgb(cr, 0, 0, 0);
+		cairo_stroke(cr);
+		return;
+	}
 	cairo_save(cr);
 
 	cairo_set_font_size(cr, font_sz * info->label_box.font_scale);
 
 	make_comp_name(info->name, name);
-	cairo_text_extents(cr, name, &te);
+	ent = text_lookup(cr, name);
+	if (ent != NULL)
+		te = ent->te;
+	else
+		cairo_text_extents(cr, name, &te);
 	pos = info->label_box.pos;
 	sz = info->label_box.sz;
 	color = info->gui.color;
@@ -872,100 +1648,450 @@ draw_label_box(cairo_t *cr, double pos_scale, double font_sz,
 	cairo_fill(cr);
 
 	cairo_set_source_rgb(cr, 0, 0, 0);
-	cairo_move_to(cr, PX(pos.x + sz.x / 2) - te.width / 2,
-	    PX(pos.y) - te.height / 2 - te.y_bearing);
-	cairo_show_text(cr, name);
+	if (text_hidden(cr)) {
+		/* too small to read */
+	} else if (ent != NULL) {
+		text_show(cr, ent, PX(pos.x + sz.x / 2) - te.width / 2,
+		    PX(pos.y) - te.height / 2 - te.y_bearing);
+	} else {
+		cairo_move_to(cr, PX(pos.x + sz.x / 2) - te.width / 2,
+		    PX(pos.y) - te.height / 2 - te.y_bearing);
+		cairo_show_text(cr, name);
+	}
 
 	cairo_restore(cr);
 }
 
+/*
+ * Determines how much detail is worth drawing, given the current device
+ * transform of `cr'. Also sets up the text cache to skip any text which
+ * would end up too small to read.
+ */
+static draw_lod_t
+draw_get_lod(cairo_t *cr, double pos_scale, double font_sz)
+{
+	text_cache_t *tc = text_cache_get(cr);
+	double ux = pos_scale, uy = 0, fx = font_sz, fy = 0, unit_px;
+
+	cairo_user_to_device_distance(cr, &ux, &uy);
+	cairo_user_to_device_distance(cr, &fx, &fy);
+	unit_px = hypot(ux, uy);
+	if (tc != NULL)
+		tc->no_text = (hypot(fx, fy) < LOD_TEXT_MIN_PX);
+
+	if (unit_px < LOD_BLOCK_PX)
+		return (LOD_BLOCK);
+	if (unit_px < LOD_SIMPLE_PX)
+		return (LOD_SIMPLE);
+	return (LOD_FULL);
+}
+
+/*
+ * Returns true if the component lies inside of any label box. At
+ * LOD_BLOCK, these components are hidden under the label box block.
+ */
+static bool
+comp_in_label_box(const elec_sys_t *sys, const elec_comp_info_t *info)
+{
+	vect2_t pos = info->gui.pos;
+
+	for (size_t i = 0; i < sys->num_infos; i++) {
+		const elec_comp_info_t *box = &sys->comp_infos[i];
+
+		if (box->type != ELEC_LABEL_BOX)
+			continue;
+		if (pos.x >= box->label_box.pos.x &&
+		    pos.x <= box->label_box.pos.x + box->label_box.sz.x &&
+		    pos.y >= box->label_box.pos.y &&
+		    pos.y <= box->label_box.pos.y + box->label_box.sz.y) {
+			return (true);
+		}
+	}
+	return (false);
+}
+
+/*
+ * Simplified stand-in for the component symbols at LOD_SIMPLE. Each
+ * component becomes a box roughly the size of its symbol. Components
+ * with switchable state (breakers, ties and shunts) are drawn into the
+ * state layer and filled with the color of their first source, all
+ * others go into the static layer.
+ */
+static void
+draw_comp_simple(cairo_t *cr, double pos_scale, const elec_comp_t *comp,
+    bool stat)
+{
+	const elec_comp_info_t *info = comp->info;
+	vect2_t pos = info->gui.pos, hsz = VECT2(1.5, 1.5);
+	vect3_t color = VECT3(1, 1, 1);
+	elec_comp_t *src;
+	bool stateful = false;
+
+	switch (info->type) {
+	case ELEC_CB:
+	case ELEC_TIE:
+		stateful = true;
+		break;
+	case ELEC_SHUNT:
+		stateful = true;
+		hsz = VECT2(3, 1);
+		break;
+	case ELEC_TRU:
+	case ELEC_INV:
+	case ELEC_XFRMR:
+	case ELEC_LOAD:
+		hsz = VECT2(1.75, 1.75);
+		break;
+	case ELEC_GEN:
+	case ELEC_BATT:
+		color = info->gui.color;
+		break;
+	default:
+		break;
+	}
+	if (stateful == stat)
+		return;
+	if (stateful && snap_srcs(cr, comp, 1, &src) != 0)
+		color = src->info->gui.color;
+
+	cairo_new_path(cr);
+	cairo_rectangle(cr, PX(pos.x - hsz.x), PX(pos.y - hsz.y),
+	    PX(2 * hsz.x), PX(2 * hsz.y));
+	cairo_set_source_rgb(cr, color.x, color.y, color.z);
+	cairo_fill_preserve(cr);
+	cairo_set_source_rgb(cr, 0, 0, 0);
+	cairo_set_line_width(cr, 1);
+	cairo_stroke(cr);
+	cairo_set_line_width(cr, 2);
+}
+
+/*
+ * Draws the parts of `comp' which belong into `layer'. Must only be
+ * called for the ELEC_DRAW_LAYER_COMPS and ELEC_DRAW_LAYER_STATE layers.
+ */
+static void
+draw_comp(cairo_t *cr, double pos_scale, double font_sz,
+    const elec_comp_t *comp, elec_draw_layer_t layer, const double clip[4],
+    draw_lod_t lod)
+{
+	const elec_comp_info_t *info;
+	bool stat = (layer == ELEC_DRAW_LAYER_COMPS);
+	unsigned what = (stat ? DRAW_LABEL : DRAW_GEOM);
+
+	ASSERT(cr != NULL);
+	ASSERT(comp != NULL);
+	info = comp->info;
+	ASSERT(info != NULL);
+	ASSERT(layer == ELEC_DRAW_LAYER_COMPS ||
+	    layer == ELEC_DRAW_LAYER_STATE);
+
+	if (IS_NULL_VECT(info->gui.pos) || info->gui.invis ||
+	    !comp_in_view(clip, pos_scale, font_sz, info)) {
+		return;
+	}
+	/* Buses stay as they are, they're what holds the picture together */
+	if (lod != LOD_FULL && info->type != ELEC_BUS) {
+		draw_comp_simple(cr, pos_scale, comp, stat);
+		return;
+	}
+
+	switch (info->type) {
+	case ELEC_BUS:
+		draw_bus(cr, pos_scale, comp, what);
+		break;
+	case ELEC_GEN:
+		if (stat)
+			draw_gen(cr, pos_scale, info);
+		break;
+	case ELEC_CB:
+		draw_cb(cr, pos_scale, comp, font_sz, VECT3(1, 1, 1), what);
+		break;
+	case ELEC_SHUNT:
+		draw_shunt(cr, pos_scale, comp, what);
+		break;
+	case ELEC_TRU:
+	case ELEC_INV:
+		if (stat)
+			draw_tru_inv(cr, pos_scale, info);
+		break;
+	case ELEC_XFRMR:
+		if (stat)
+			draw_xfrmr(cr, pos_scale, info);
+		break;
+	case ELEC_TIE:
+		draw_tie(cr, pos_scale, comp, what);
+		break;
+	case ELEC_DIODE:
+		if (stat)
+			draw_diode(cr, pos_scale, comp, false);
+		break;
+	case ELEC_LOAD:
+		if (stat)
+			draw_load(cr, pos_scale, font_sz, info);
+		break;
+	case ELEC_BATT:
+		if (stat)
+			draw_batt(cr, pos_scale, info, true);
+		break;
+	case ELEC_LABEL_BOX:
+		VERIFY_FAIL();
+		break;
+	}
+}
+
 /**
- * Draws the network base image into a `cairo_t` instance. You should
- * use this before drawing any overlays (such as an open component info
- * screen drawn using libelec_draw_comp_info()).
+ * Draws a single layer of the network base image into a `cairo_t`
+ * instance. Drawing all layers in order, from ELEC_DRAW_LAYER_WIRING to
+ * ELEC_DRAW_LAYER_STATE, produces the same image as
+ * libelec_draw_layout(). The layers marked as static in
+ * elec_draw_layer_t never change after the network has been loaded, so
+ * you can render them once into an offscreen surface and then only
+ * redraw the dynamic layers on top of it on every frame. Components
+ * which lie completely outside of the current clip region of `cr' are
+ * skipped, so drawing a small part of a large network is cheap.
+ *
+ * The state shown is read out of the network in one go when the call
+ * starts, so a layer never mixes values from different worker passes.
+ * libelec_draw_layout() draws all of the layers from the same read.
+ *
+ * The level of detail drops as the view is zoomed out, based on the
+ * current transform of `cr': text too small to read is skipped, then
+ * component symbols turn into plain boxes and finally, label boxes are
+ * drawn as solid blocks hiding everything inside of them.
  * @param sys The network to be drawn.
  * @param cr The `cairo_t` instance into which the drawing will be performed.
- * @param pos_scale A scaling multiplier applied to all `GUI_POS` stanzas
- *	in the network layout configuration file. This lets you use abstract
- *	size units in the config file and then scale them up as you see fit.
- * @param font_sz Default font size to be used for all drawing. These
- *	functions never reset the font face, so whatever you set using
- *	cairo_set_font_face() will be used. The font size is only needed
- *	in order to draw suffixes and smaller font information correctly
- *	scaled to the default text size (which is used for headers, etc.)
+ * @param pos_scale Same as in libelec_draw_layout().
+ * @param font_sz Same as in libelec_draw_layout().
+ * @param layer The layer to draw.
  */
 void
-libelec_draw_layout(const elec_sys_t *sys, cairo_t *cr, double pos_scale,
-    double font_sz)
+libelec_draw_layout_layer(const elec_sys_t *sys, cairo_t *cr,
+    double pos_scale, double font_sz, elec_draw_layer_t layer)
 {
 	ASSERT(sys != NULL);
 	ASSERT(cr != NULL);
+	ASSERT3U(layer, <, ELEC_DRAW_NUM_LAYERS);
+
+	libelec_sys_load_gui(sys);
+	snap_take(cr, sys, NULL);
+	draw_layout_layer(sys, cr, pos_scale, font_sz, layer);
+	snap_release(cr);
+}
+
+/*
+ * Draws a single layer of the network from the snapshot taken by the
+ * caller, see libelec_draw_layout_layer().
+ */
+static void
+draw_layout_layer(const elec_sys_t *sys, cairo_t *cr, double pos_scale,
+    double font_sz, elec_draw_layer_t layer)
+{
+	double clip[4];
+	draw_lod_t lod;
+	text_cache_t *tc;
 
+	cairo_clip_extents(cr, &clip[0], &clip[1], &clip[2], &clip[3]);
 	cairo_set_source_rgb(cr, 0, 0, 0);
 	cairo_set_font_size(cr, font_sz);
 	cairo_set_line_width(cr, 2);
+	lod = draw_get_lod(cr, pos_scale, font_sz);
 
-	/* First draw bus connections, so all components sit on top of them */
-	for (elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
-	    comp = list_next(&sys->comps, comp)) {
-		const elec_comp_info_t *info = comp->info;
+	/* Bus connections go first, so all components sit on top of them */
+	if (layer != ELEC_DRAW_LAYER_STATE &&
+	    (layer != ELEC_DRAW_LAYER_COMPS || lod == LOD_FULL)) {
+		const bus_geom_cache_t *gc = bus_geom_cache_get(cr, sys,
+		    pos_scale);
 
-		ASSERT(info != NULL);
-		if (info->type == ELEC_BUS)
-			draw_bus_conns(cr, pos_scale, comp);
+		for (size_t i = 0; gc != NULL && i < gc->n_buses; i++) {
+			DRAW_PROBE(ELEC_BUS, draw_bus_conns(cr, &gc->buses[i],
+			    layer, clip));
+		}
+	}
+	if (layer == ELEC_DRAW_LAYER_WIRING ||
+	    layer == ELEC_DRAW_LAYER_WIRING_SRCS) {
+		goto out;
 	}
-
 	for (elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
 	    comp = list_next(&sys->comps, comp)) {
-		const elec_comp_info_t *info = comp->info;
-
-		ASSERT(info != NULL);
-		if (IS_NULL_VECT(info->gui.pos) || info->gui.invis)
+		if (lod == LOD_BLOCK && comp_in_label_box(sys, comp->info))
 			continue;
+		DRAW_PROBE(comp->info->type, draw_comp(cr, pos_scale,
+		    font_sz, comp, layer, clip, lod));
+	}
+	if (layer == ELEC_DRAW_LAYER_COMPS) {
+		for (size_t i = 0; i < sys->num_infos; i++) {
+			const elec_comp_info_t *info = &sys->comp_infos[i];
 
-		switch (info->type) {
-		case ELEC_BUS:
-			draw_bus(cr, pos_scale, comp);
-			break;
-		case ELEC_GEN:
-			draw_gen(cr, pos_scale, info);
-			break;
-		case ELEC_CB:
-			draw_cb(cr, pos_scale, comp, font_sz, VECT3(1, 1, 1));
-			break;
-		case ELEC_SHUNT:
-			draw_shunt(cr, pos_scale, comp);
-			break;
-		case ELEC_TRU:
-		case ELEC_INV:
-			draw_tru_inv(cr, pos_scale, info);
-			break;
-		case ELEC_XFRMR:
-			draw_xfrmr(cr, pos_scale, info);
-			break;
-		case ELEC_TIE:
-			draw_tie(cr, pos_scale, comp);
-			break;
-		case ELEC_DIODE:
-			draw_diode(cr, pos_scale, comp, false);
-			break;
-		case ELEC_LOAD:
-			draw_load(cr, pos_scale, font_sz, info);
-			break;
-		case ELEC_BATT:
-			draw_batt(cr, pos_scale, info, true);
-			break;
-		case ELEC_LABEL_BOX:
-			VERIFY_FAIL();
-			break;
+			if (info->type == ELEC_LABEL_BOX) {
+				DRAW_PROBE(ELEC_LABEL_BOX, draw_label_box(cr,
+				    pos_scale, font_sz, info, lod));
+			}
 		}
 	}
-	for (size_t i = 0; i < sys->num_infos; i++) {
-		const elec_comp_info_t *info = &sys->comp_infos[i];
+out:
+	/* Text drawn outside of the layout (e.g. info screens) is kept */
+	tc = cairo_get_user_data(cr, &text_cache_key);
+	if (tc != NULL)
+		tc->no_text = false;
+}
+
+/*
+ * Appends the visible state of `comp' to `hash'. Components which are
+ * always drawn the same leave the hash unchanged.
+ */
+static uint64_t
+comp_state_hash_append(uint64_t hash, const elec_comp_t *comp)
+{
+	const elec_comp_info_t *info = comp->info;
+	elec_comp_t *srcs[ELEC_MAX_SRCS];
+	size_t n_srcs;
+	bool set;
+
+	ASSERT(info != NULL);
+	if (IS_NULL_VECT(info->gui.pos))
+		return (hash);
+	switch (info->type) {
+	case ELEC_CB:
+		set = (!libelec_comp_get_failed(comp) && comp->scb.cur_set);
+		hash = crc64_append(hash, &set, sizeof (set));
+		break;
+	case ELEC_TIE:
+		hash = crc64_append(hash, comp->tie.cur_state,
+		    comp->n_links * sizeof (*comp->tie.cur_state));
+		break;
+	case ELEC_BUS:
+	case ELEC_SHUNT:
+		break;
+	default:
+		/* Stateless components are always drawn the same */
+		return (hash);
+	}
+	n_srcs = libelec_comp_get_src_list(comp, ELEC_MAX_SRCS, srcs);
+	hash = crc64_append(hash, &n_srcs, sizeof (n_srcs));
+	hash = crc64_append(hash, srcs,
+	    MIN(n_srcs, ELEC_MAX_SRCS) * sizeof (*srcs));
+
+	return (hash);
+}
+
+/**
+ * Computes a hash of all of the network state which is shown by
+ * libelec_draw_layout(). This lets your renderer skip redrawing the
+ * network when nothing visible has changed: as long as two calls to this
+ * function return the same value, the network base image would be drawn
+ * the same. Please note that this doesn't include any of the values
+ * shown by libelec_draw_comp_info().
+ * @param sys The network for which to compute the hash.
+ * @return A hash of the visible state of the network.
+ * @see libelec_draw_get_comp_state_hash()
+ */
+uint64_t
+libelec_draw_get_state_hash(const elec_sys_t *sys)
+{
+	uint64_t hash = 0;
+
+	ASSERT(sys != NULL);
+
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		hash = comp_state_hash_append(hash, comp);
+	}
+
+	return (hash);
+}
+
+/**
+ * Same as libelec_draw_get_state_hash(), but only covers the visible
+ * state of a single component. Together with
+ * libelec_draw_get_comp_bbox(), this lets your renderer only redraw the
+ * parts of a retained image of the network which have actually changed:
+ * whenever the hash of a component changes, redraw all layers of the
+ * network within the component's bounding box.
+ * @param comp The component for which to compute the hash.
+ * @return A hash of the visible state of `comp'. Components which are
+ *	always drawn the same (or not drawn at all) always return 0.
+ */
+uint64_t
+libelec_draw_get_comp_state_hash(const elec_comp_t *comp)
+{
+	ASSERT(comp != NULL);
+	return (comp_state_hash_append(0, comp));
+}
+
+/**
+ * Returns the bounding box of all the parts of the network image which
+ * depend on the state of a component (see
+ * libelec_draw_get_comp_state_hash()). For buses, this includes all of
+ * their connection lines. The bounding box is conservative and in the
+ * same coordinate space as used by libelec_draw_layout(), i.e. it must
+ * still be transformed by any scaling or translation you apply to the
+ * `cairo_t` before drawing.
+ * @param comp The component for which to get the bounding box.
+ * @param pos_scale Same as in libelec_draw_layout().
+ * @param font_sz Same as in libelec_draw_layout().
+ * @param min Filled with the top left corner of the bounding box.
+ * @param max Filled with the bottom right corner of the bounding box.
+ * @return True if the component is drawn and the bounding box has been
+ *	filled, false if the component has no position in the layout.
+ */
+bool
+libelec_draw_get_comp_bbox(const elec_comp_t *comp, double pos_scale,
+    double font_sz, vect2_t *min, vect2_t *max)
+{
+	const elec_comp_info_t *info;
 
-		if (info->type == ELEC_LABEL_BOX)
-			draw_label_box(cr, pos_scale, font_sz, info);
+	ASSERT(comp != NULL);
+	info = comp->info;
+	ASSERT(info != NULL);
+	ASSERT(min != NULL);
+	ASSERT(max != NULL);
+
+	libelec_sys_load_gui(comp->sys);
+	if (IS_NULL_VECT(info->gui.pos))
+		return (false);
+	comp_extents(pos_scale, font_sz, info, min, max);
+	if (info->type == ELEC_BUS) {
+		vect2_t bus_min, bus_max;
+
+		bus_extents(comp, &bus_min, &bus_max);
+		*min = VECT2(MIN(min->x, PX(bus_min.x)),
+		    MIN(min->y, PX(bus_min.y)));
+		*max = VECT2(MAX(max->x, PX(bus_max.x)),
+		    MAX(max->y, PX(bus_max.y)));
 	}
+
+	return (true);
+}
+
+/**
+ * Draws the network base image into a `cairo_t` instance. You should
+ * use this before drawing any overlays (such as an open component info
+ * screen drawn using libelec_draw_comp_info()).
+ * @param sys The network to be drawn.
+ * @param cr The `cairo_t` instance into which the drawing will be performed.
+ * @param pos_scale A scaling multiplier applied to all `GUI_POS` stanzas
+ *	in the network layout configuration file. This lets you use abstract
+ *	size units in the config file and then scale them up as you see fit.
+ * @param font_sz Default font size to be used for all drawing. These
+ *	functions never reset the font face, so whatever you set using
+ *	cairo_set_font_face() will be used. The font size is only needed
+ *	in order to draw suffixes and smaller font information correctly
+ *	scaled to the default text size (which is used for headers, etc.)
+ * @see libelec_draw_layout_layer()
+ */
+void
+libelec_draw_layout(const elec_sys_t *sys, cairo_t *cr, double pos_scale,
+    double font_sz)
+{
+	ASSERT(sys != NULL);
+	ASSERT(cr != NULL);
+
+	/* All layers are drawn from the same snapshot */
+	libelec_sys_load_gui(sys);
+	snap_take(cr, sys, NULL);
+	for (int layer = 0; layer < ELEC_DRAW_NUM_LAYERS; layer++)
+		draw_layout_layer(sys, cr, pos_scale, font_sz, layer);
+	snap_release(cr);
 }
 
 static void
@@ -1007,25 +2133,25 @@ draw_comp_info(const elec_comp_t *comp, cairo_t *cr, double pos_scale,
 {
 	bool ac;
 	double U_in, I_in, W_in, U_out, I_out, W_out, f;
-	elec_comp_t *srcs[ELEC_MAX_SRCS];
-	unsigned n_srcs;
+	elec_comp_t *src;
+	size_t n_srcs;
 
 	ASSERT(comp != NULL);
 	ASSERT(cr != NULL);
 
-	U_in = libelec_comp_get_in_volts(comp);
-	U_out = libelec_comp_get_out_volts(comp);
+	U_in = snap_qty(cr, comp, -1, ELEC_QTY_IN_VOLTS);
+	U_out = snap_qty(cr, comp, -1, ELEC_QTY_OUT_VOLTS);
 	ac = libelec_comp_is_AC(comp);
 	if (libelec_comp2info(comp)->type == ELEC_INV)
-		f = libelec_comp_get_out_freq(comp);
+		f = snap_qty(cr, comp, -1, ELEC_QTY_OUT_FREQ);
 	else
-		f = (ac ? libelec_comp_get_in_freq(comp) : 0);
-	I_in = libelec_comp_get_in_amps(comp);
-	I_out = libelec_comp_get_out_amps(comp);
-	W_in = libelec_comp_get_in_pwr(comp);
-	W_out = libelec_comp_get_out_pwr(comp);
-	get_srcs(comp, srcs);
-	n_srcs = count_srcs(srcs);
+		f = (ac ? snap_qty(cr, comp, -1, ELEC_QTY_IN_FREQ) : 0);
+	I_in = snap_qty(cr, comp, -1, ELEC_QTY_IN_AMPS);
+	I_out = snap_qty(cr, comp, -1, ELEC_QTY_OUT_AMPS);
+	W_in = snap_qty(cr, comp, -1, ELEC_QTY_IN_PWR);
+	W_out = snap_qty(cr, comp, -1, ELEC_QTY_OUT_PWR);
+	/* We only need the first source & the count */
+	n_srcs = snap_srcs(cr, comp, 1, &src);
 
 	if (comp->info->type != ELEC_GEN) {
 		char name[MAX_NAME_LEN];
@@ -1036,7 +2162,7 @@ draw_comp_info(const elec_comp_t *comp, cairo_t *cr, double pos_scale,
 			powered_by = "nothing";
 			break;
 		case 1:
-			make_comp_name(srcs[0]->info->name, name);
+			make_comp_name(src->info->name, name);
 			powered_by = name;
 			break;
 		default:
@@ -1173,9 +2299,9 @@ draw_scb_info(const elec_comp_t *cb, cairo_t *cr, double pos_scale,
 
 	if (cb->info->type == ELEC_CB) {
 		draw_cb(cr, pos_scale, cb, font_sz,
-		    (vect3_t){COMP_INFO_BG_RGB});
+		    (vect3_t){COMP_INFO_BG_RGB}, DRAW_ALL);
 	} else {
-		draw_shunt(cr, pos_scale, cb);
+		draw_shunt(cr, pos_scale, cb, DRAW_ALL);
 	}
 
 	y = pos.y + TEXT_OFF_Y;
@@ -1230,11 +2356,11 @@ draw_gen_info(const elec_comp_t *gen, cairo_t *cr, double pos_scale,
 	y += LINE_HEIGHT;
 
 	show_text_aligned(cr, PX(pos.x + TEXT_OFF_X), PX(y), TEXT_ALIGN_LEFT,
-	    "RPM: %.0f", gen->gen.rpm);
+	    "RPM: %.0f", libelec_gen_get_rpm(gen));
 	y += LINE_HEIGHT;
 
 	show_text_aligned(cr, PX(pos.x + TEXT_OFF_X), PX(y), TEXT_ALIGN_LEFT,
-	    "Efficiency: %.1f%%", gen->gen.eff * 100);
+	    "Efficiency: %.1f%%", libelec_comp_get_eff(gen) * 100);
 	y += LINE_HEIGHT;
 
 	draw_comp_info(gen, cr, pos_scale, font_sz,
@@ -1322,7 +2448,7 @@ draw_tie_info(const elec_comp_t *tie, cairo_t *cr, double pos_scale,
 	ASSERT3U(tie->info->type, ==, ELEC_TIE);
 
 	draw_comp_bg(cr, pos_scale, VECT2(pos.x, pos.y + 3.5), VECT2(14, 11));
-	draw_tie(cr, pos_scale, tie);
+	draw_tie(cr, pos_scale, tie, DRAW_ALL);
 
 	y = pos.y + TEXT_OFF_Y;
 
@@ -1360,7 +2486,7 @@ draw_batt_info(const elec_comp_t *batt, cairo_t *cr, double pos_scale,
 	y += LINE_HEIGHT;
 
 	show_text_aligned(cr, PX(pos.x + TEXT_OFF_X), PX(y), TEXT_ALIGN_LEFT,
-	    "Temp: %.1f C", KELVIN2C(batt->batt.T));
+	    "Temp: %.1f C", KELVIN2C(libelec_batt_get_temp(batt)));
 	y += LINE_HEIGHT;
 
 	draw_comp_info(batt, cr, pos_scale, font_sz,
@@ -1416,9 +2542,9 @@ draw_bus_info(const elec_comp_t *bus, cairo_t *cr, double pos_scale,
 	ASSERT3U(bus->info->type, ==, ELEC_BUS);
 
 	for (unsigned i = 0; i < bus->n_links; i++) {
-		ASSERT(bus->links[i].comp != NULL);
-		ASSERT(bus->links[i].comp->info != NULL);
-		if (bus->links[i].comp->info->type == ELEC_CB)
+		ASSERT(bus->adj[i] != NULL);
+		ASSERT(bus->adj[i]->info != NULL);
+		if (bus->adj[i]->info->type == ELEC_CB)
 			num_loads++;
 	}
 	height = LINE_H * (1 + ceil(num_loads / 2.0));
@@ -1427,13 +2553,13 @@ draw_bus_info(const elec_comp_t *bus, cairo_t *cr, double pos_scale,
 	make_comp_name(bus->info->name, name);
 	show_text_aligned(cr, PX(pos.x), PX(pos.y - height / 2 + 0.3 * LINE_H),
 	    TEXT_ALIGN_CENTER, "%s", name);
-	U = libelec_comp_get_in_volts(bus);
+	U = snap_qty(cr, bus, -1, ELEC_QTY_IN_VOLTS);
 	show_text_aligned(cr, PX(pos.x), PX(pos.y - height / 2 + 0.7 * LINE_H),
 	    TEXT_ALIGN_CENTER, "U: %.*fV", fixed_decimals(U, 4), U);
 	y = pos.y - height / 2 + LINE_H * 1.5;
 
 	for (unsigned i = 0; i < bus->n_links; i++) {
-		const elec_comp_t *comp = bus->links[i].comp;
+		const elec_comp_t *comp = bus->adj[i];
 		const elec_comp_info_t *info = comp->info;
 		vect2_t comp_pos;
 		double I, W;
@@ -1474,9 +2600,9 @@ draw_bus_info(const elec_comp_t *bus, cairo_t *cr, double pos_scale,
 		draw_cb_icon(cr, pos_scale, font_sz, comp_pos,
 		    info->cb.fuse, comp->scb.cur_set,
 		    info->cb.triphase, info->name,
-		    (vect3_t){COMP_INFO_BG_RGB}, comp);
-		I = libelec_comp_get_in_amps(comp);
-		W = libelec_comp_get_in_pwr(comp);
+		    (vect3_t){COMP_INFO_BG_RGB}, comp, DRAW_ALL);
+		I = snap_qty(cr, bus, i, ELEC_QTY_IN_AMPS);
+		W = snap_qty(cr, bus, i, ELEC_QTY_IN_PWR);
 		if (comp_i % 2 == 0) {
 			show_text_aligned(cr, PX(pos.x - 14.5),
 			    PX(y - 0.33 * LINE_H), TEXT_ALIGN_LEFT,
@@ -1526,6 +2652,8 @@ libelec_draw_comp_info(const elec_comp_t *comp, cairo_t *cr,
 	ASSERT(comp != NULL);
 	ASSERT(cr != NULL);
 
+	libelec_sys_load_gui(comp->sys);
+	snap_take(cr, comp->sys, comp);
 	cairo_set_source_rgb(cr, 0, 0, 0);
 	cairo_set_font_size(cr, font_sz);
 	cairo_set_line_width(cr, 2);
@@ -1564,4 +2692,5 @@ libelec_draw_comp_info(const elec_comp_t *comp, cairo_t *cr,
 	case ELEC_LABEL_BOX:
 		break;
 	}
+	snap_release(cr);
 }
@@ -19,6 +19,7 @@
  * implementations.
  *
  * @see libelec_draw_layout
+ * @see libelec_draw_layout_layer
  * @see libelec_draw_comp_info
  */
 
@@ -33,10 +34,38 @@
 extern "C" {
 #endif
 
+/**
+ * The network base image is drawn in a number of layers, stacked in the
+ * order given here. The static layers only depend on the network layout
+ * and never change once the network has been loaded, whereas the dynamic
+ * layers reflect the current state of the network.
+ * @see libelec_draw_layout_layer()
+ */
+typedef enum {
+	/** Static: black outlines of all bus connection lines. */
+	ELEC_DRAW_LAYER_WIRING,
+	/** Dynamic: colors of the powered bus connection lines. */
+	ELEC_DRAW_LAYER_WIRING_SRCS,
+	/**
+	 * Static: bus connection dimples, all stateless component
+	 * symbols, all component names and label boxes.
+	 */
+	ELEC_DRAW_LAYER_COMPS,
+	/** Dynamic: buses, circuit breakers, shunts and ties. */
+	ELEC_DRAW_LAYER_STATE,
+	ELEC_DRAW_NUM_LAYERS
+} elec_draw_layer_t;
+
 void libelec_draw_layout(const elec_sys_t *sys, cairo_t *cr, double pos_scale,
     double font_sz);
+void libelec_draw_layout_layer(const elec_sys_t *sys, cairo_t *cr,
+    double pos_scale, double font_sz, elec_draw_layer_t layer);
 void libelec_draw_comp_info(const elec_comp_t *comp, cairo_t *cr,
     double pos_scale, double font_sz, vect2_t pos);
+uint64_t libelec_draw_get_state_hash(const elec_sys_t *sys);
+uint64_t libelec_draw_get_comp_state_hash(const elec_comp_t *comp);
+bool libelec_draw_get_comp_bbox(const elec_comp_t *comp, double pos_scale,
+    double font_sz, vect2_t *min, vect2_t *max);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,231 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+/*
+ * Copyright 2023 Saso Kiselkov. All rights reserved.
+ */
+/**
+ * \file
+ * This file contains optional inline accessors for reading the published
+ * electrical state with no function call overhead. They're meant for
+ * tight loops, such as displays which read thousands of values every
+ * frame. Everything else should keep using the functions in `libelec.h`.
+ *
+ * To use them, fill in an \ref elec_fast_view_t using
+ * libelec_fast_view_init() and resolve every component you want to read
+ * into an index using libelec_fast_resolve(). Then read the values
+ * inside of a read section:
+ *```
+ * int32_t seq;
+ * do {
+ *	seq = libelec_fast_begin(&view);
+ *	for (size_t i = 0; i < n; i++)
+ *		volts[i] = libelec_fast_out_volts(&view, idx[i]);
+ * } while (libelec_fast_retry(&view, seq));
+ *```
+ * The retry loop guarantees that all the values come from the same
+ * network state, the same as with libelec_sys_read_many().
+ *
+ * Unlike the libelec_comp_get_* functions, the accessors don't check
+ * their arguments and don't apply net-recv smoothing (see
+ * libelec_net_recv_set_smoothing()). They return the quantities as last
+ * published, with the same leak compensation.
+ *
+ * @note The view is laid out according to the `LIBELEC_FLOAT_STATE`
+ *	build option, so it must be defined the same way when building
+ *	libelec and the code including this file.
+ */
+
+#ifndef	_LIBELEC_FAST_H_
+#define	_LIBELEC_FAST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <acfutils/thread.h>
+
+#include "libelec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Storage type of the electrical state, see the `LIBELEC_FLOAT_STATE`
+ * build option.
+ */
+#ifdef	LIBELEC_FLOAT_STATE
+typedef float	elec_fast_real_t;
+#else
+typedef double	elec_fast_real_t;
+#endif
+
+/**
+ * Index of a component in an \ref elec_fast_view_t, as returned by
+ * libelec_fast_resolve().
+ */
+typedef uint32_t elec_fast_idx_t;
+
+/**
+ * Direct view of the published electrical state of a network. Fill it
+ * in using libelec_fast_view_init(). The view remains valid until the
+ * electrical system is destroyed, or starts or stops receiving its
+ * state from shared memory (see libelec_enable_shm_recv()). Treat all
+ * the fields as private and only access them through the inline
+ * accessors below.
+ */
+typedef struct {
+	const elec_sys_t	*sys;
+	size_t			n_comps;
+	atomic32_t		*seq;
+	const elec_fast_real_t	*in_volts;
+	const elec_fast_real_t	*out_volts;
+	const elec_fast_real_t	*in_amps;
+	const elec_fast_real_t	*out_amps;
+	const elec_fast_real_t	*in_freq;
+	const elec_fast_real_t	*out_freq;
+	const elec_fast_real_t	*leak_factor;
+	const bool		*failed;
+	const bool		*shorted;
+} elec_fast_view_t;
+
+void libelec_fast_view_get(elec_sys_t *sys, elec_fast_view_t *view,
+    size_t real_size);
+elec_fast_idx_t libelec_fast_resolve(const elec_fast_view_t *view,
+    const elec_comp_t *comp);
+bool libelec_fast_wait(const elec_fast_view_t *view, uint64_t *t0);
+
+/**
+ * Fills in a view of the published electrical state of `sys`.
+ */
+static inline void
+libelec_fast_view_init(elec_sys_t *sys, elec_fast_view_t *view)
+{
+	libelec_fast_view_get(sys, view, sizeof (elec_fast_real_t));
+}
+
+/**
+ * Starts a read section. Pass the returned value to libelec_fast_retry()
+ * once you've read out all the values you need.
+ *
+ * If the view is of a shared memory reader (see libelec_enable_shm_recv())
+ * whose publisher stopped in the middle of an update, this gives up
+ * waiting on it after a while. The values are then unreliable, which
+ * libelec_fast_stalled() tells you, and the view must be initialized
+ * again to read the network's own state.
+ */
+static inline int32_t
+libelec_fast_begin(const elec_fast_view_t *view)
+{
+	uint64_t t0 = 0;
+
+	for (;;) {
+		int32_t seq = atomic_add_32(view->seq, 0);
+
+		if ((seq & 1) == 0 || !libelec_fast_wait(view, &t0))
+			return (seq);
+	}
+}
+
+/**
+ * @return True if the read section started by libelec_fast_begin(),
+ *	which returned `seq`, was abandoned due to a stalled shared memory
+ *	publisher.
+ */
+static inline bool
+libelec_fast_stalled(int32_t seq)
+{
+	return ((seq & 1) != 0);
+}
+
+/**
+ * Ends a read section.
+ * @return True if the state was modified while it was being read and
+ *	the read section must be repeated to get consistent values.
+ */
+static inline bool
+libelec_fast_retry(const elec_fast_view_t *view, int32_t seq)
+{
+	return (atomic_add_32(view->seq, 0) != seq);
+}
+
+/** @see libelec_comp_get_in_volts() */
+static inline double
+libelec_fast_in_volts(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->in_volts[idx]);
+}
+
+/** @see libelec_comp_get_out_volts() */
+static inline double
+libelec_fast_out_volts(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->out_volts[idx]);
+}
+
+/** @see libelec_comp_get_in_amps() */
+static inline double
+libelec_fast_in_amps(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->in_amps[idx] * (1 - (double)view->leak_factor[idx]));
+}
+
+/** @see libelec_comp_get_out_amps() */
+static inline double
+libelec_fast_out_amps(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->out_amps[idx] * (1 - (double)view->leak_factor[idx]));
+}
+
+/** @see libelec_comp_get_in_pwr() */
+static inline double
+libelec_fast_in_pwr(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return ((double)view->in_volts[idx] * view->in_amps[idx] *
+	    (1 - (double)view->leak_factor[idx]));
+}
+
+/** @see libelec_comp_get_out_pwr() */
+static inline double
+libelec_fast_out_pwr(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return ((double)view->out_volts[idx] * view->out_amps[idx] *
+	    (1 - (double)view->leak_factor[idx]));
+}
+
+/** @see libelec_comp_get_in_freq() */
+static inline double
+libelec_fast_in_freq(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->in_freq[idx]);
+}
+
+/** @see libelec_comp_get_out_freq() */
+static inline double
+libelec_fast_out_freq(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->out_freq[idx]);
+}
+
+/** @see libelec_comp_get_failed() */
+static inline bool
+libelec_fast_failed(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->failed[idx]);
+}
+
+/** @see libelec_comp_get_shorted() */
+static inline bool
+libelec_fast_shorted(const elec_fast_view_t *view, elec_fast_idx_t idx)
+{
+	return (view->shorted[idx]);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _LIBELEC_FAST_H_ */
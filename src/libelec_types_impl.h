@@ -10,9 +10,16 @@
 #ifndef	__LIBELEC_TYPES_IMPL_H__
 #define	__LIBELEC_TYPES_IMPL_H__
 
+#if	defined(LIBELEC_WITH_DRS_ARRAYS) && !defined(LIBELEC_WITH_DRS)
+#error	"LIBELEC_WITH_DRS_ARRAYS requires LIBELEC_WITH_DRS"
+#endif
+
+#include <stdarg.h>
+
 #ifdef	XPLANE
 #include <acfutils/dr.h>
 #endif
+#include <acfutils/helpers.h>
 #include <acfutils/htbl.h>
 #include <acfutils/list.h>
 #include <acfutils/worker.h>
@@ -36,6 +43,9 @@ extern "C" {
 	ALIGN_ATTR(16) int	__serialize_start_marker[1]
 #define	LIBELEC_SER_END_MARKER	\
 	int	__serialize_end_marker[1]
+#define	LIBELEC_SER_LEN(data) \
+	(((uintptr_t)&(data)->__serialize_end_marker) - \
+	((uintptr_t)&(data)->__serialize_start_marker))
 #define	LIBELEC_SERIALIZE_DATA_V(data, ser, key, ...) \
 	conf_set_data_v((ser), (key), &(data)->__serialize_start_marker, \
 	    ((uintptr_t)&(data)->__serialize_end_marker) - \
@@ -59,14 +69,836 @@ extern "C" {
 	} while (0)
 
 
+/*
+ * Electrical state of a single component. This is only used as an
+ * interchange format for serialization and network updates. The live
+ * state is kept in an elec_state_t in the elec_sys_t.
+ */
+typedef struct {
+	double		in_volts;
+	double		out_volts;
+	double		in_amps;
+	double		out_amps;
+	double		short_amps;
+	double		in_pwr;			/* Watts */
+	double		out_pwr;		/* Watts */
+	double		in_freq;		/* Hz */
+	double		out_freq;		/* Hz */
+	bool		failed;
+	/*
+	 * Shorted components leak a lot of their energy out
+	 * to the environment and so we must avoid returning
+	 * the leakage to in libelec_comp_get_xxx. Other
+	 * parts of the system depend on those being the
+	 * actual useful work being done by the component.
+	 */
+	bool		shorted;
+	double		leak_factor;
+} elec_comp_state_t;
+
+/*
+ * Serialized form of a component's `rw' and `ro' state.
+ */
+typedef struct {
+	LIBELEC_SER_START_MARKER;
+	elec_comp_state_t	rw, ro;
+	LIBELEC_SER_END_MARKER;
+} elec_comp_ser_t;
+
+/*
+ * Storage type of the quantities in elec_state_t. Building with
+ * LIBELEC_FLOAT_STATE halves the size of the bulk state, which is
+ * worth it for large batches of instances and for network and shared
+ * memory mirrors. The solver keeps computing in double precision and
+ * the public API keeps returning doubles, only the stored results are
+ * rounded.
+ */
+#ifdef	LIBELEC_FLOAT_STATE
+typedef float	elec_real_t;
+#else
+typedef double	elec_real_t;
+#endif
+
+/*
+ * Electrical state of all components in the network, stored as a
+ * structure of arrays indexed by the components' `comp_idx'. All the
+ * quantity arrays share a single allocation (`f64'), as do the bool
+ * arrays (`flags'), so the worker can reset and transfer the state
+ * of the entire network using only a few memset/memcpy calls.
+ */
+typedef struct {
+	/* Quantities that get zeroed at the start of every worker pass */
+	elec_real_t	*in_volts;
+	elec_real_t	*out_volts;
+	elec_real_t	*in_amps;
+	elec_real_t	*out_amps;
+	elec_real_t	*short_amps;
+	elec_real_t	*in_pwr;		/* Watts */
+	elec_real_t	*out_pwr;		/* Watts */
+	elec_real_t	*in_freq;		/* Hz */
+	elec_real_t	*out_freq;		/* Hz */
+	/* Quantities which persist between worker passes */
+	elec_real_t	*leak_factor;
+	bool		*failed;
+	bool		*shorted;		/* see elec_comp_state_t */
+
+	elec_real_t	*f64;
+	bool		*flags;
+} elec_state_t;
+
+#ifdef	LIBELEC_WITH_SHM
+/*
+ * Header of a shared memory segment published by libelec_enable_shm_send.
+ * It is followed by the publisher's `ro' state: STATE_NUM_F64 arrays of
+ * elec_real_t and then 2 arrays of bools, each `stride' entries long,
+ * laid out the same as in elec_state_t. Next comes an array of `stride'
+ * bools holding the set state of every breaker, and finally, aligned
+ * to 8 bytes, SHM_MAX_CLIENTS command rings (see elec_shm_ring_t).
+ */
+typedef struct {
+	char		magic[8];	/* SHM_MAGIC, no NUL */
+	uint32_t	version;	/* SHM_VERSION */
+	uint32_t	stride;		/* MAX(number of components, 1) */
+	uint64_t	conf_crc;
+	/*
+	 * Generation counter. The publisher makes it odd while it is
+	 * updating the state, same as elec_sys_t->ro_seq.
+	 */
+	atomic32_t	seq;
+	uint32_t	pub_pid;	/* publisher's process, 0 if unknown */
+	/* see elec_stamp_t */
+	uint64_t	tick;
+	uint64_t	sim_time_us;
+	uint64_t	pub_time_us;
+} elec_shm_hdr_t;
+
+#define	SHM_MAX_CLIENTS		16	/* command rings per segment */
+#define	SHM_RING_LEN		256	/* commands per ring */
+
+typedef enum {
+	SHM_CMD_FAILED,		/* libelec_comp_set_failed */
+	SHM_CMD_SHORTED,	/* libelec_comp_set_shorted */
+	SHM_CMD_CB,		/* libelec_cb_set */
+	SHM_CMD_TIE,		/* state of tie port `port' */
+	SHM_CMD_INPUT,		/* libelec_comp_set_input */
+	SHM_CMD_CLEAR_INPUT,	/* libelec_comp_clear_input */
+	SHM_CMD_GEN_RPM,	/* libelec_gen_set_rpm */
+	SHM_CMD_BATT_TEMP	/* libelec_batt_set_temp */
+} elec_shm_cmd_type_t;
+
+/*
+ * A setter call of a shared memory reader, forwarded to the publisher.
+ */
+typedef struct {
+	uint32_t	type;		/* elec_shm_cmd_type_t */
+	uint32_t	comp_idx;
+	uint32_t	port;		/* SHM_CMD_TIE only */
+	uint32_t	pad;
+	double		val;		/* bools are 0 or 1 */
+} elec_shm_cmd_t;
+
+/*
+ * Command queue of a single shared memory reader. Each reader claims a
+ * ring of its own, so every ring has only one producer (the reader)
+ * and one consumer (the publisher's worker), which only ever advance
+ * `head' and `tail' respectively. Both are free-running counters, so
+ * the ring holds `head - tail' commands. The reader writes a batch of
+ * commands and then advances `head' over all of them at once, so the
+ * publisher never applies a partial batch (e.g. half of a tie's ports).
+ */
+typedef struct {
+	atomic32_t	owner;		/* see shm_ring_claim() */
+	atomic32_t	head;
+	atomic32_t	tail;
+	uint32_t	pad;
+	elec_shm_cmd_t	cmds[SHM_RING_LEN];
+} elec_shm_ring_t;
+#endif	/* defined(LIBELEC_WITH_SHM) */
+
+#ifdef	LIBELEC_WITH_WS
+/*
+ * Wire format of the WebSocket gateway (see libelec_enable_ws_gateway).
+ * Every message is a binary WebSocket message, starting with this
+ * header, followed by `n' entries of a type depending on `type'. All
+ * fields are in little-endian byte order.
+ */
+#define	WS_MSG_LAYOUT		1	/* ws_layout_ent_t */
+#define	WS_MSG_KEY		2	/* ws_rec_t, all components */
+#define	WS_MSG_DELTA		3	/* ws_rec_t, changed components */
+
+typedef struct {
+	uint8_t		type;		/* WS_MSG_* */
+	uint8_t		version;	/* WS_VERSION */
+	uint16_t	pad;
+	uint32_t	n;
+	uint64_t	conf_crc;
+} ws_msg_hdr_t;
+
+/*
+ * Static description of a component, sent once per client in a single
+ * WS_MSG_LAYOUT message listing all components in comp_idx order. The
+ * fixed part is followed by the `name_len' bytes of the component's
+ * name (without a NUL), and then by `n_links' uint32_t comp_idx values
+ * of the components it connects to. For ties, bit `i' of the `ties'
+ * field of the component's ws_rec_t is the state of link `i'.
+ */
+#define	WS_LAYOUT_VIRT		(1 << 0)	/* gui.virt */
+#define	WS_LAYOUT_INVIS		(1 << 1)	/* gui.invis */
+
+typedef struct {
+	float		pos[2];		/* gui.pos, NaN if not drawn */
+	float		sz;		/* gui.sz */
+	float		color[3];	/* gui.color */
+	int16_t		rot;		/* gui.rot, degrees */
+	uint8_t		type;		/* elec_comp_type_t */
+	uint8_t		flags;		/* WS_LAYOUT_* */
+	uint16_t	name_len;
+	uint16_t	n_links;
+} ws_layout_ent_t;
+
+/*
+ * Quantized state of a component, as carried by WS_MSG_KEY (every
+ * component) and WS_MSG_DELTA (only the components whose record
+ * changed since the previous frame).
+ */
+#define	WS_FLAG_FAILED		(1 << 0)
+#define	WS_FLAG_SHORTED		(1 << 1)
+#define	WS_FLAG_CLOSED		(1 << 2)	/* closed CB or shunt */
+
+typedef struct {
+	uint32_t	idx;		/* comp_idx */
+	uint16_t	in_volts;	/* 0.1 V */
+	uint16_t	out_volts;	/* 0.1 V */
+	uint16_t	in_amps;	/* 0.1 A */
+	uint16_t	out_amps;	/* 0.1 A */
+	uint16_t	freq;		/* out_freq, 0.1 Hz */
+	uint16_t	flags;		/* WS_FLAG_* */
+	uint16_t	ties;		/* tied links of a tie, see above */
+	uint16_t	pad;
+} ws_rec_t;
+
+#define	WS_MAX_REQ		4096	/* handshake & client message bytes */
+
+typedef struct {
+	int		fd;
+	bool		open;		/* handshake done */
+	bool		synced;		/* received a keyframe */
+	uint64_t	accept_t;	/* microclock() at accept */
+	uint8_t		in[WS_MAX_REQ];
+	size_t		in_len;
+	uint8_t		*out;		/* unsent bytes */
+	size_t		out_len;
+	size_t		out_cap;
+	list_node_t	node;
+} ws_client_t;
+#endif	/* defined(LIBELEC_WITH_WS) */
+
+/*
+ * Publication stamps of a state snapshot, see elec_state_age_t. The
+ * times are in microseconds, wall clock times as per lacf_microtime().
+ */
+typedef struct {
+	uint64_t	tick;
+	uint64_t	sim_time_us;
+	uint64_t	pub_time_us;
+	uint64_t	recv_time_us;
+} elec_stamp_t;
+
+/*
+ * A helper thread of the parallel network solver, see elec_sys_t.
+ */
+typedef struct {
+	elec_sys_t	*sys;
+	thread_t	thread;
+	uint64_t	pass;		/* protected by par.lock */
+} elec_par_thr_t;
+
+/*
+ * A helper thread of a shared scheduler, see elec_sched_t.
+ */
+typedef struct {
+	elec_sched_t	*sched;
+	thread_t	thread;
+	uint64_t	tick;		/* protected by sched->pool.lock */
+} elec_sched_thr_t;
+
+/*
+ * A shared scheduler, see libelec_sched_new(). A single worker thread
+ * wakes up at a fixed interval and runs a pass of every registered
+ * system which is due. With helper threads, the systems are handed out
+ * to the worker and helpers the same way libelec_sys_step_batch() does.
+ */
+struct elec_sched_s {
+	worker_t		worker;
+	uint64_t		intval;		/* us, immutable */
+	/*
+	 * Protected by `lock'. The worker holds this for the entire tick,
+	 * so once a system has been removed, none of its passes can still
+	 * be running.
+	 */
+	mutex_t			lock;
+	elec_sys_t		**systems;
+	size_t			n_systems;
+	struct {
+		unsigned		n_threads;	/* immutable */
+		elec_sched_thr_t	*threads;
+		/* protected by `lock' */
+		mutex_t			lock;
+		condvar_t		work_cv;
+		condvar_t		done_cv;
+		bool			shutdown;
+		uint64_t		tick;
+		unsigned		n_running;
+		size_t			next_sys;
+		uint64_t		now;
+	} pool;
+};
+
+typedef struct {
+	elec_comp_t		*load;	/* upstream side */
+	elec_comp_t		*gen;	/* downstream side */
+} elec_part_bnd_t;
+
+/*
+ * A set of partitions of one network, see libelec_part_new(). The
+ * boundaries are only modified and exchanged by the caller, so no
+ * locking is needed.
+ */
+struct elec_part_s {
+	elec_part_bnd_t		*bnds;
+	size_t			n_bnds;
+};
+
+typedef struct {
+	unsigned		comp_idx;
+	elec_fault_type_t	type;
+} elec_sweep_fault_t;
+
+typedef struct {
+	elec_sweep_pred_t	pred;		/* NULL: comp_idx is powered */
+	void			*userinfo;
+	unsigned		comp_idx;
+} elec_sweep_pred_info_t;
+
+/*
+ * A fault-injection sweep, see libelec_sweep_new(). Only modified by
+ * the caller, except for the result rows, each of which is written by
+ * the one thread evaluating its case in libelec_sweep_run().
+ */
+struct elec_sweep_s {
+	const elec_sys_t	*proto;
+	elec_sweep_setup_cb_t	setup;
+	void			*userinfo;
+
+	elec_sweep_fault_t	*faults;
+	size_t			n_faults;
+	elec_sweep_pred_info_t	*preds;
+	size_t			n_preds;
+
+	/* Results of the last run */
+	size_t			n_cases;
+	size_t			stride;		/* words per matrix row */
+	uint64_t		*matrix;	/* n_cases x stride */
+	bool			*pruned;	/* n_cases */
+	size_t			*case_faults;	/* n_cases x 2 */
+	unsigned		*case_n_faults;	/* n_cases */
+};
+
+/*
+ * An asynchronous network construction, see libelec_new_async(). `sys'
+ * and `done' are set by the loader thread under `lock' as the last
+ * thing it does.
+ */
+struct elec_loader_s {
+	char		*filename;
+	thread_t	thr;
+	mutex_t		lock;
+	bool		done;
+	elec_sys_t	*sys;		/* NULL if loading failed */
+};
+
+/*
+ * A time-indexed table of load demands, see libelec_load_profile_load().
+ * Immutable once loaded, so it can be shared between systems. The
+ * `times' and `vals' arrays either point into the mapped file (`map')
+ * or into the heap buffer `buf'.
+ */
+struct elec_load_profile_s {
+	char		*filename;
+	size_t		n_loads;
+	char		**names;	/* n_loads */
+	size_t		n_rows;
+	const double	*times;		/* n_rows, strictly increasing */
+	const float	*vals;		/* n_rows x n_loads, row-major */
+	void		*buf;
+	void		*map;
+	size_t		map_sz;
+};
+
+/*
+ * Replay of an input capture, see libelec_replay_open(). The slot
+ * layout tables are our own, as the capture needn't have been made by
+ * a sender of lockstep mirroring.
+ */
+struct elec_replay_s {
+	elec_sys_t	*sys;
+	char		*path;
+	FILE		*fp;
+	unsigned	n_slots;
+	unsigned	*comp_slot;
+	unsigned	*slot_comp;
+	elec_cap_ent_t	*ents;		/* n_slots */
+	uint32_t	tick;		/* next pass to replay */
+	size_t		n_diverged;
+	bool		done;		/* end of capture or error */
+};
+
+/*
+ * State of a xoshiro256** pseudo-random number generator. Every system
+ * has its own, so random fluctuations in one system don't depend on
+ * what any other code in the process is drawing.
+ */
+typedef struct {
+	uint64_t	s[4];
+	bool		has_spare;
+	double		spare;		/* second normal sample of a pair */
+} elec_rng_t;
+
+typedef enum {
+	ELEC_CMD_BATT_CHG_REL,	/* sets batt.chg_rel, clears batt.rechg_W */
+	ELEC_CMD_GEN_TGT_VOLTS,	/* sets gen.tgt_volts */
+	ELEC_CMD_GEN_TGT_FREQ,	/* sets gen.tgt_freq */
+	/* The rest are only queued by batches, see elec_batch_t */
+	ELEC_CMD_FAILED,	/* libelec_comp_set_failed */
+	ELEC_CMD_SHORTED,	/* libelec_comp_set_shorted */
+	ELEC_CMD_CB,		/* libelec_cb_set */
+	ELEC_CMD_TIE		/* sets tie.cur_state from `tie_state' */
+} elec_cmd_type_t;
+
+/*
+ * A single queued setter call, applied by the worker at the start of
+ * its next pass.
+ */
+typedef struct {
+	elec_cmd_type_t	type;
+	elec_comp_t	*comp;
+	double		val;
+	bool		*tie_state;	/* ELEC_CMD_TIE, n_links entries */
+	list_node_t	node;
+} elec_cmd_t;
+
+/*
+ * Switching & failure changes recorded by libelec_batch_*(). Committing
+ * the batch moves all of its commands onto the system's command queue
+ * in one go, so the worker applies them all at the start of the same
+ * pass (see cmdq_drain()).
+ */
+struct elec_batch_s {
+	elec_sys_t	*sys;
+	list_t		cmds;		/* list of elec_cmd_t */
+};
+
+/* A frozen subnetwork, see libelec_subnet_freeze() */
+typedef struct elec_freeze_s elec_freeze_t;
+/* A subnetwork eligible for reduction, see libelec_sys_set_auto_reduce() */
+typedef struct elec_reduce_cand_s elec_reduce_cand_t;
+
+#define	ELEC_NUM_COMP_TYPES	(ELEC_LABEL_BOX + 1)
+
+/*
+ * Number of tie & breaker configurations for which each plan remembers
+ * the set of steps reached by the load integration pass.
+ */
+#define	REACH_CACHE_SIZE	4
+
+/* Number of quantities exposed by the array datarefs */
+#define	DRS_ARR_NUM_QUANTS	6
+
+/*
+ * Solver profile of a single component, see libelec_sys_set_profiling().
+ * During a pass, a component's entry is only ever touched by the thread
+ * solving the source group the component belongs to.
+ */
+typedef struct {
+	uint64_t		paint_visits;
+	uint64_t		integ_visits;
+	uint64_t		cb_ns;
+	unsigned		max_depth;
+	unsigned		max_srcs;
+	/* sources which painted into the component in pass `pass' */
+	uint64_t		pass;
+	unsigned		n_srcs;
+	const elec_comp_t	*last_src;
+} elec_prof_comp_t;
+
+/*
+ * A conducting element between two nodes of the nodal solver (see
+ * libelec_sys_set_solver()). Breakers, shunts and diodes join the two
+ * buses they connect, whereas each bus link of a tie joins the bus to
+ * the tie's own star node. `pos_*' are the element's entries in the
+ * conductance matrix, or NODAL_NONE if it doesn't join two nodes.
+ */
+typedef struct {
+	elec_comp_t	*comp;
+	unsigned	a, b;		/* node indices */
+	unsigned	link;		/* ties: the bus link */
+	unsigned	pos_a, pos_b, pos_ab;
+	bool		fwd;		/* diodes: conducting */
+	double		G;		/* this pass, 0 if open */
+	double		amps;		/* from `a' to `b' */
+} elec_nodal_edge_t;
+
+typedef enum {
+	NODAL_SRC_OFF,
+	NODAL_SRC_ON,
+	NODAL_SRC_CHG			/* charging battery */
+} elec_nodal_mode_t;
+
+/*
+ * A Norton-equivalent source of the nodal solver. Converters are also
+ * a sink on their input node, drawing `in_amps'.
+ */
+typedef struct {
+	elec_comp_t		*comp;
+	unsigned		node;		/* output node */
+	unsigned		in_node;	/* converters only */
+	elec_nodal_mode_t	mode;
+	double			emf;
+	double			G;
+	double			amps;		/* output, or charging */
+	double			in_amps;
+	unsigned		next;		/* next source in island */
+} elec_nodal_src_t;
+
+/*
+ * State of the nodal solver. The structure of the network never
+ * changes, so every element always has its place in the conductance
+ * matrix, even while it's open. That way, the fill-reducing ordering
+ * and the symbolic factorization only need to be computed once, and a
+ * numeric refactorization is only needed when a conductance changes.
+ * The matrix is symmetric positive definite, so it is factored as
+ * LDL^T. `A*' is its upper triangle in permuted order, `L*' & `D' the
+ * factorization, all in compressed-column form.
+ */
+typedef struct {
+	unsigned		n_nodes;
+	unsigned		*node;		/* by comp_idx */
+	elec_comp_t		**node_comp;	/* bus or tie of each node */
+	unsigned		*diag;		/* node -> pos of A(i,i) */
+	elec_nodal_edge_t	*edges;
+	unsigned		n_edges;
+	elec_nodal_src_t	*srcs;
+	unsigned		n_srcs;
+	double			G_sw;		/* closed switch conductance */
+	unsigned		*perm;		/* new -> old node */
+	unsigned		*iperm;		/* old -> new node */
+	unsigned		*Ap, *Ai;
+	double			*Ax, *Ax_fact;
+	unsigned		*Lp, *Li, *parent, *lnz, *flag, *pattern;
+	double			*Lx, *D, *Y;
+	bool			factored;
+	/* per node */
+	double			*V, *b, *sink, *inflow, *freq;
+	unsigned		*uf, *src_head;
+	bool			*powered;
+	/* carried over to the next pass, by load index */
+	double			*load_amps;
+} elec_nodal_t;
+
+/*
+ * Component name index, an open-addressed hash table of the positions
+ * of the infos in their array, keyed by the CRC64 of their names. See
+ * names_create().
+ */
+typedef struct {
+	elec_comp_info_t	*infos;
+	uint64_t		*keys;
+	uint32_t		*slots;		/* info index + 1, 0 if free */
+	size_t			mask;
+} elec_names_t;
+
+/*
+ * GUI stanzas of a network definition, see defs_gui_load(). The solver
+ * never needs them, so infos_parse() only checks their syntax and
+ * stashes them here as lines of "<def_idx> <stanza words>", leaving the
+ * `gui' fields of the infos to be filled in once something draws the
+ * network.
+ */
+typedef struct {
+	char		*src;
+	size_t		len;
+	size_t		cap;
+	bool		loaded;		/* protected by elec_defs_t.lock */
+} elec_gui_src_t;
+
+/*
+ * The parsed network definition. This is immutable once parsed, so it
+ * is shared between a system and all of the instances stamped out of
+ * it using libelec_new_instance(). The last system to let go of it
+ * frees it.
+ */
+typedef struct {
+	mutex_t			lock;
+	unsigned		refcnt;		/* protected by lock */
+	elec_comp_info_t	*comp_infos;
+	size_t			num_infos;
+	/* backing store of comp_infos, if loaded from an image */
+	void			*comp_infos_img;
+	elec_names_t		names;
+	elec_gui_src_t		gui;
+	/*
+	 * Set once the definition is known to pass all load-time checks,
+	 * which can then be skipped for further systems using it.
+	 */
+	bool			validated;
+} elec_defs_t;
+
+typedef struct {
+	const elec_real_t *value;	/* points into elec_sys_t->ro */
+	const elec_real_t *mult;	/* multiplies `value' if not NULL */
+	const elec_real_t *leak_factor;	/* NULL if not leak-compensated */
+} elec_query_ent_t;
+
+/* Input changes tracked by each stage of the latency probe */
+#define	LAT_MAX_PENDING	64
+
+#define	LOGQ_LEN	64	/* queued worker messages, power of 2 */
+#define	LOGQ_MSG_LEN	256
+
+/* A worker log message, queued for the log flusher (see WLOG) */
+typedef struct {
+	const char	*file;
+	int		line;
+	char		msg[LOGQ_MSG_LEN];
+} logq_ent_t;
+
+/*
+ * Rate limiting state of a single WLOG call site. It's shared by all
+ * networks and threads, so it's only updated using atomics.
+ */
+typedef struct {
+	atomic64_t	window;		/* current window number */
+	atomic32_t	n;		/* messages in the current window */
+	atomic32_t	suppressed;	/* not logged in the last windows */
+} logq_site_t;
+
+/* Number of buckets each windowed statistics window is split into */
+#define	WSTATS_NUM_BKTS	10
+
+/*
+ * A bucket of windowed statistics, covering 1/WSTATS_NUM_BKTS-th of
+ * the window. An empty bucket has `t' == 0.
+ */
+typedef struct {
+	double		min;
+	double		max;
+	double		sum;	/* integral of the value over `t' */
+	double		t;	/* seconds of samples in the bucket */
+} wstats_bkt_t;
+
+/*
+ * Windowed statistics of one quantity of a component, see
+ * libelec_comp_set_wstats(). For every window, `bkts[win][cur[win]]'
+ * is the bucket being filled and `closed[win]' is the combination of
+ * all the other (completed) buckets, which only needs to be rebuilt
+ * when the current bucket is completed.
+ */
+typedef struct {
+	uint32_t	key;	/* comp_idx * (ELEC_QTY_OUT_FREQ + 1) + qty */
+	elec_query_ent_t ent;
+	unsigned	cur[ELEC_NUM_WSTATS_WINS];
+	wstats_bkt_t	closed[ELEC_NUM_WSTATS_WINS];
+	wstats_bkt_t	bkts[ELEC_NUM_WSTATS_WINS][WSTATS_NUM_BKTS];
+	elec_wstats_t	ro[ELEC_NUM_WSTATS_WINS];
+} wstats_ent_t;
+
+/*
+ * A coupling port, see libelec_sys_exchange_ports().
+ */
+typedef struct {
+	elec_comp_t		*comp;
+	const elec_port_info_t	*info;
+	elec_query_ent_t	ent;		/* output ports only */
+} elec_port_t;
+
+/*
+ * Run-time state of the relay logic driving `comp', see logic_update().
+ */
+typedef struct {
+	elec_comp_t		*comp;
+	const elec_logic_info_t	*info;
+	bool			init;		/* `out' has been applied */
+	bool			out;
+	double			t;		/* time `out' has been stale */
+} elec_logic_t;
+
+#ifdef	LIBELEC_WITH_LIBSWITCH
+typedef enum {
+	CB_SW_FAILED,	/* switch failed, leave the breaker alone */
+	CB_SW_POPPED,
+	CB_SW_SET
+} elec_cb_sw_state_t;
+#endif
+
 struct elec_sys_s {
 	bool		started;
 	worker_t	worker;
 	mutex_t		worker_interlock;
+	/*
+	 * Scheduling options of the worker thread, see
+	 * libelec_sys_set_worker_opts(). The worker thread applies them to
+	 * itself at the start of its next pass after they were changed.
+	 */
+	struct {
+		mutex_t			lock;
+		/* protected by `lock' */
+		elec_worker_opts_t	opts;
+		bool			dirty;
+	} worker_opts;
+	/*
+	 * Wakeup pacing of the worker thread, see worker_wake_pace(). Only
+	 * accessed by the worker thread (or after it has exited).
+	 */
+	struct {
+		uint64_t	deadline;	/* next pass, 0 if none */
+#if	IBM
+		HANDLE		timer;		/* high-resolution timer */
+#endif
+	} wake;
 
 	mutex_t		paused_lock;
 	bool		paused;		/* protected by paused_lock */
+	/*
+	 * While paused, the worker thread is parked (its interval is set
+	 * to 0, so it sleeps until woken up). On unparking, `resync_clock'
+	 * tells it to restart its clock, rather than simulate the time it
+	 * spent parked. Both are protected by paused_lock.
+	 */
+	bool		parked;
+	bool		resync_clock;
+	/*
+	 * See libelec_sys_set_accel_mode(). Only changed from the main
+	 * thread, while holding paused_lock. `accel_substep' is the
+	 * resulting sub-step limit of the current pass in seconds (0 if
+	 * none), which is only accessed by the thread running the passes.
+	 */
+	elec_accel_mode_t accel_mode;
+	double		accel_substep;
+	/*
+	 * Set while libelec_sys_settle() runs its passes, to make them
+	 * skip straight to the end of the network's transients. Only
+	 * accessed by the thread running the passes.
+	 */
+	bool		settling;
 	double		time_factor;	/* only accessed from main thread */
+	/*
+	 * Shared scheduler driving this system instead of `worker', see
+	 * libelec_sys_set_sched(). Alternatively, `host_tick' is set if
+	 * the host application drives the system (libelec_sys_tick()).
+	 * Both are only changed while stopped. `sched_intval' holds the
+	 * interval at which the system wants to run (protected by
+	 * paused_lock). With its own worker, the worker's interval can
+	 * differ from it in high-resolution wakeup mode.
+	 */
+	elec_sched_t	*sched;
+	bool		host_tick;
+	uint64_t	sched_intval;
+	/*
+	 * Early worker wakeups on switching & failure inputs, see
+	 * libelec_sys_set_input_wake(). `min_intval' is only changed
+	 * while stopped, the rest is protected by paused_lock.
+	 */
+	struct {
+		uint64_t	min_intval;	/* us, 0 if disabled */
+		uint64_t	last;		/* microclock() of last wake */
+		bool		woken;		/* next pass is an early one */
+	} input_wake;
+	/*
+	 * Nominal worker interval in us. Only set and read by the host's
+	 * thread, including in libelec_sys_settle() and
+	 * libelec_sys_fast_forward(), which run on stopped networks.
+	 */
+	uint64_t	exec_intval;
+	/*
+	 * Maximum size of the steps into which the stiff integrations
+	 * (load input capacitance, battery charge and CB heating) split
+	 * each pass, see libelec_sys_set_substep(). Zero means these are
+	 * integrated in a single step. Protected by worker_interlock.
+	 */
+	double		substep;
+	/*
+	 * Per-type default update rate divisors, see
+	 * libelec_sys_set_rate_div(). Only changed while stopped.
+	 * `rate_tick' counts the non-settling passes, which the
+	 * components with a divisor use to pick the passes on which
+	 * they are updated. Protected by worker_interlock.
+	 */
+	unsigned	rate_div[ELEC_NUM_COMP_TYPES];
+	uint64_t	rate_tick;
+	elec_rng_t	rng;		/* protected by worker_interlock */
+	/*
+	 * See libelec_sys_set_lazy_pwr(). When set, the worker doesn't
+	 * maintain the in_pwr & out_pwr state arrays. Protected by
+	 * worker_interlock.
+	 */
+	bool		lazy_pwr;
+	/*
+	 * Time budget watchdog, see libelec_sys_set_overrun_policy().
+	 * `policy' is protected by worker_interlock and `data' by
+	 * stats.lock. The rest is only accessed by the thread running
+	 * the passes.
+	 */
+	struct {
+		unsigned		policy;
+		uint64_t		budget_us;	/* 0 = no budget */
+		double			nominal_d_t;
+		bool			overran;	/* previous pass */
+		bool			degraded;	/* current pass */
+		elec_overrun_stats_t	data;
+	} overrun;
+	/*
+	 * Sampled invariant checks, see libelec_sys_set_inv_checks().
+	 * `intval', `prob' & `fatal' are protected by worker_interlock
+	 * and `data' by stats.lock. The rest is only accessed by the
+	 * thread running the passes.
+	 */
+	struct {
+		unsigned		intval;		/* 0 = never */
+		double			prob;
+		bool			fatal;
+		unsigned		ctr;
+		elec_rng_t		rng;
+		elec_inv_stats_t	data;
+	} inv;
+	/*
+	 * Input slots, see libelec_comp_set_input(). Users write into the
+	 * `user' set, which the worker copies into its own `wk' set at the
+	 * start of a pass if anything has changed. Both sets are indexed
+	 * by `comp_idx'.
+	 */
+	struct {
+		mutex_t		lock;
+		/* protected by `lock' */
+		bool		dirty;
+		double		*user;
+		bool		*user_used;
+		/* only accessed from the worker */
+		double		*wk;
+		bool		*wk_used;
+	} inputs;
+	/*
+	 * Setter commands queued for the worker, see cmdq_push(). `lock'
+	 * is only held to append to or splice off the list, never across
+	 * a pass, so queueing a command never waits on the worker. The
+	 * separate generator is used for the random draws of setters,
+	 * which thus don't need the worker's own generator.
+	 */
+	struct {
+		mutex_t		lock;
+		/* protected by `lock' */
+		list_t		cmds;		/* list of elec_cmd_t */
+		elec_rng_t	rng;
+	} cmdq;
 	uint64_t	prev_clock;
 #ifdef	XPLANE
 	double		prev_sim_time;
@@ -79,48 +911,978 @@ struct elec_sys_s {
 #endif	/* defined(XPLANE) */
 
 	char		*conf_filename;
+	/* see libelec_new_from_buffer(), `conf_filename' is just a name */
+	bool		conf_in_mem;
 	uint64_t	conf_crc;
 
-	avl_tree_t	info2comp;
-	avl_tree_t	name2comp;
-
+	/*
+	 * The `user_cbs' tree is modified while holding both the
+	 * worker_interlock and user_cbs_lock. The worker only ever uses
+	 * the `user_cbs_tab' snapshot of it (see user_cbs_publish()).
+	 */
 	mutex_t		user_cbs_lock;
 	avl_tree_t	user_cbs;
+	struct user_cb_tab_s	*user_cbs_tab;
+	/*
+	 * Solver stages, see libelec_sys_add_stage(). Only modified
+	 * while holding the worker_interlock, so the worker can run them
+	 * without any further locking.
+	 */
+	struct {
+		struct {
+			elec_stage_cb_t	cb;
+			void		*userinfo;
+		}		*stages;
+		size_t		n;
+	} stages[ELEC_NUM_STAGES];
+	size_t		n_stages;	/* total over all points */
+	/*
+	 * Component watches, see libelec_watch_add(). At the end of every
+	 * pass, the worker checks the watches and pushes any changes into
+	 * the `events' ring. The worker is the only producer and the
+	 * caller of libelec_sys_poll_events() the only consumer, so the
+	 * ring itself doesn't need a lock.
+	 */
+	struct {
+		mutex_t		lock;
+		list_t		watches;	/* protected by `lock' */
+		elec_event_t	*events;	/* set once, under `lock' */
+		atomic32_t	head;		/* written by the worker */
+		atomic32_t	tail;		/* written by the consumer */
+		atomic32_t	dropped;	/* written by the worker */
+		int32_t		dropped_seen;	/* consumer-only */
+	} watch;
+	/*
+	 * System-wide event log, see libelec_sys_set_event_log(). At the
+	 * end of every pass, the worker compares the state of all tracked
+	 * components (breakers, ties & sources) to their last logged
+	 * state in `prev' and pushes any changes into the `ents' ring,
+	 * which works just like the `watch' events ring.
+	 */
+	struct {
+		/* protected by worker_interlock */
+		bool		enabled;
+		uint64_t	tick;		/* counts all passes */
+		elec_comp_t	**comps;
+		uint64_t	*prev;
+		size_t		n_comps;
+		elec_log_ent_t	*ents;		/* set once */
+		atomic32_t	head;		/* written by the worker */
+		atomic32_t	tail;		/* written by the consumer */
+		atomic32_t	dropped;	/* written by the worker */
+		int32_t		dropped_seen;	/* consumer-only */
+	} evlog;
+	/*
+	 * Log messages which the worker emits during a pass (see WLOG).
+	 * Rather than logging them directly, which can take a while (e.g.
+	 * synchronous file I/O on Windows), the worker formats them into
+	 * `ents' and a flusher thread writes them out. The flusher runs
+	 * while the network is started.
+	 */
+	struct {
+		logq_ent_t	*ents;
+		atomic32_t	head;		/* written by the worker */
+		atomic32_t	tail;		/* written by the flusher */
+		atomic32_t	dropped;	/* written by the worker */
+		/* only accessed by libelec_sys_start/stop */
+		bool		thr_valid;
+		thread_t	thr;
+		mutex_t		lock;
+		condvar_t	cv;
+		bool		stop;		/* protected by `lock' */
+	} logq;
+
+	/*
+	 * Partition boundary components, see libelec_comp_set_boundary().
+	 * Protected by worker_interlock.
+	 */
+	struct {
+		elec_comp_t	**comps;
+		size_t		n;
+	} bnd;
+	/*
+	 * Load profile playback, see libelec_sys_set_load_profile().
+	 * Protected by worker_interlock. `cursor' is the row at or just
+	 * before the playback time `t', so advancing it is a sequential
+	 * scan over the profile's rows.
+	 */
+	struct {
+		const elec_load_profile_t	*prof;
+		elec_comp_t			**loads;	/* n_loads */
+		double				t;
+		size_t				cursor;
+	} lprof;
 
 	list_t		comps;
 	elec_comp_t	**comps_array;		/* length list_count(&comps) */
+	/*
+	 * Backing storage of the components and their links. Rather than
+	 * allocating these piecemeal, they're carved out of a few flat
+	 * slabs, laid out in comp_idx order. The slabs are sized in
+	 * libelec_new() and compile_plans() and only freed when the
+	 * system is destroyed. The parts of the components which the
+	 * solver doesn't need live in the separate `cold' slabs, to keep
+	 * the solver's working set small.
+	 */
+	struct {
+		elec_comp_t	*comps;		/* num_infos */
+		struct elec_link_s *links;	/* links of all comps */
+		elec_comp_t	**adj;		/* neighbours, as `links' */
+		size_t		n_links;
+		bool		*tie_states;	/* cur_state+wk_state of ties */
+		size_t		n_tie_states;
+		elec_comp_t	**srcs;		/* link & comp source arrays */
+		size_t		n_srcs;
+		double		*out_amps;	/* link out_amps */
+		size_t		n_out_amps;
+		elec_comp_t	**by_type;	/* backs by_type[].comps */
+		struct elec_comp_cold_s *cold;	/* num_infos */
+		elec_comp_t	**srcs_ext;	/* srcs_ext & srcs_up_ext */
+		size_t		n_srcs_ext;
+		uint64_t	*src_masks;	/* src_mask bitsets */
+		size_t		src_mask_words;	/* per component */
+	} mem;
 	list_t		gens_batts;
-	list_t		ties;
+	/*
+	 * Components of every type, indexed by elec_comp_type_t. Each
+	 * array is in list order, so that worker phases which only act
+	 * on a few component types don't need to walk the whole list.
+	 */
+	struct {
+		elec_comp_t	**comps;
+		size_t		n;
+	} by_type[ELEC_NUM_COMP_TYPES];
+	/*
+	 * Dense per-load columns used by loads_demand_update(), in the
+	 * order of by_type[ELEC_LOAD]. The configuration columns are set
+	 * up once at init, the rest only hold the state of the current
+	 * pass.
+	 */
+	struct {
+		double		*min_volts;
+		bool		*stab;
+		double		*volts;		/* net input voltage */
+		double		*demand;	/* Watts or Amps */
+		double		*short_div;	/* 1 - leak_factor if shorted */
+		bool		*failed;	/* failed & not shorted */
+		double		*amps;		/* resulting load current */
+	} loads;
+#ifdef	LIBELEC_WITH_DRS_ARRAYS
+	/* Array datarefs, see drs_arr_create() */
+	struct {
+		dr_t	quants[DRS_ARR_NUM_QUANTS];
+		dr_t	names_dr;
+		char	*names;
+	} drs_arr;
+#endif	/* defined(LIBELEC_WITH_DRS_ARRAYS) */
+#ifdef	LIBELEC_WITH_LIBSWITCH
+	/*
+	 * Circuit breakers bound to a libswitch switch, gathered by
+	 * libelec_create_cb_switches(). network_reset() polls all of the
+	 * switches into `state' in one tight loop before applying the
+	 * results to the breakers. `prefix' and `anim_rate' are kept for
+	 * libelec_reload(), which creates switches for any new breakers.
+	 */
+	struct {
+		size_t		n;
+		elec_comp_t	**comps;
+		switch_t	**sws;
+		elec_cb_sw_state_t *state;
+		char		*prefix;
+		float		anim_rate;
+	} cb_sw;
+#endif	/* defined(LIBELEC_WITH_LIBSWITCH) */
 
-	elec_comp_info_t	*comp_infos;	/* immutable after parse */
+	elec_defs_t		*defs;
+	/* shortcuts to defs->comp_infos & defs->num_infos */
+	elec_comp_info_t	*comp_infos;
 	size_t			num_infos;
+	unsigned		num_srcs;	/* see elec_comp_t::src_idx */
+
+	/*
+	 * Writers of `ro' hold rw_ro_lock and make `ro_seq' odd while
+	 * they are modifying it. Readers don't take the lock, but instead
+	 * retry if `ro_seq' was odd or changed while they were reading.
+	 */
+	mutex_t			rw_ro_lock;
+	atomic32_t		ro_seq;
+	elec_state_t		rw;	/* only accessed from the worker */
+	elec_state_t		ro;
+	/*
+	 * Energy counters in Joules since libelec_new(), laid out as the
+	 * input energy of all components followed by their output energy.
+	 * The worker adds up `rw' and publishes it to `ro' along with the
+	 * rest of the electrical state (see network_state_xfer()).
+	 */
+	struct {
+		double		*rw;
+		double		*ro;
+	} energy;
+	/*
+	 * State digests, see libelec_sys_set_digest(). Written by the
+	 * worker along with `ro', so they're read the same way.
+	 */
+	struct {
+		double		quantum;	/* 0 when disabled */
+		uint64_t	*comps;		/* by comp_idx */
+		uint64_t	sys;
+	} digest;
+	/*
+	 * Change generations, see libelec_sys_set_change_eps(). Written by
+	 * the worker in network_state_xfer(). `gen' and `gens' are
+	 * published along with `ro', so they're read the same way. The
+	 * change list links all components in the order of their last
+	 * change, most recent first, and is protected by rw_ro_lock.
+	 * `ref' and `sw' hold the state each component had at its last
+	 * change and are only accessed from the worker.
+	 */
+	struct {
+		double		eps;		/* 0 when disabled */
+		uint64_t	gen;
+		uint64_t	*gens;		/* by comp_idx */
+		double		*ref;		/* CHG_NUM_QTYS per comp */
+		uint64_t	*sw;		/* flags & switch states */
+		unsigned	*next;		/* change list, by comp_idx */
+		unsigned	*prev;
+		unsigned	head;
+	} chg;
+	/*
+	 * Windowed statistics, see libelec_comp_set_wstats(), sorted by
+	 * `key'. The worker updates them in network_state_xfer(). All
+	 * access is protected by rw_ro_lock.
+	 */
+	struct {
+		wstats_ent_t	*ents;
+		size_t		n_ents;
+		size_t		cap;
+	} wstats;
+	/*
+	 * Bus islands, see libelec_comp_get_island(). The worker rebuilds
+	 * `rw' in network_reset() when it picks up tie & breaker states
+	 * which differ from `topo', the states `rw' was built for. `ro'
+	 * is published along with the rest of the state, so it matches
+	 * the switch states the published pass was solved with.
+	 */
+	struct {
+		uint64_t	*topo;
+		uint64_t	*topo_tmp;
+		size_t		topo_words;
+		bool		valid;		/* `topo' has been filled in */
+		bool		changed;	/* `rw' differs from `ro' */
+		unsigned	*uf;		/* islands_build() scratch */
+		unsigned	*rw;		/* by comp_idx */
+		unsigned	*ro;		/* by comp_idx */
+	} islands;
+	/*
+	 * Publication stamps, see libelec_sys_get_state_age(). `wk' is
+	 * advanced by the worker at the start of every pass, `ro' is
+	 * published along with the rest of the `ro' state. Network
+	 * readers set `ro' from the headers of the frames they receive.
+	 */
+	struct {
+		elec_stamp_t	wk;
+		elec_stamp_t	ro;
+	} stamp;
+	/*
+	 * Coupling ports of all components, in component index order.
+	 * Immutable once the network has been loaded.
+	 */
+	struct {
+		elec_port_t	*ports;
+		size_t		n;
+	} ports;
+	/*
+	 * Component tags, see libelec_tag_get_stats(), numbered in
+	 * alphabetical order. `members' holds a bitset of the components
+	 * (by comp_idx) carrying each tag, and `comps' lists the same
+	 * components, with those of tag `i' at comps[start[i]] up to
+	 * comps[start[i + 1]]. `tagged' lists all components carrying any
+	 * tag. All of these are immutable once the network has been
+	 * loaded. The state bitsets (by comp_idx) and the power sums are
+	 * refreshed in tags_update() and are protected by the rw_ro_lock
+	 * & ro_seq.
+	 */
+	struct {
+		const char	**names;
+		size_t		n;
+		size_t		words;		/* per bitset */
+		uint64_t	*members;	/* n * words */
+		unsigned	*comps;
+		unsigned	*start;		/* n + 1 */
+		unsigned	*tagged;
+		size_t		n_tagged;
+		uint64_t	*powered;
+		uint64_t	*failed;
+		uint64_t	*shorted;
+		double		*in_pwr;	/* by tag */
+	} tags;
+	/*
+	 * Incremental evaluation state, only accessed with worker_interlock
+	 * held. When enabled, the worker skips re-solving the network if
+	 * none of the inputs have changed by more than `epsilon' since the
+	 * last full solve.
+	 */
+	struct {
+		bool		enabled;
+		bool		valid;		/* inputs hold a full solve */
+		double		epsilon;	/* relative */
+		unsigned	n_skipped;
+		bool		*topo;		/* discrete inputs */
+		size_t		topo_len;
+		double		*inputs;	/* INCR_INPUTS per component */
+		double		*src_save;	/* see network_clear, always */
+		double		*src_solved;	/* see network_incr_record */
+	} incr;
+	/*
+	 * Cold & dark fast path state, see network_dark_pass(). The
+	 * switching & failure setters bump `input_gen' whenever they
+	 * change anything (see input_changed()). The rest is only
+	 * accessed with worker_interlock held.
+	 */
+	struct {
+		atomic64_t	input_gen;
+		uint64_t	gen;		/* input_gen of last full pass */
+		bool		valid;		/* last full pass left us dark */
+		double		*srcs;		/* source volts & freqs */
+	} dark;
+	/*
+	 * Parallel network solving state. The sources are split into
+	 * groups, whose traversal plans (given the current tie & breaker
+	 * states) cannot reach any of the same components. The groups are
+	 * then handed out to the solver threads, with each group being
+	 * painted and integrated in the same order as the serial solver
+	 * would, so the results don't depend on the number of threads.
+	 */
+	struct {
+		/* protected by worker_interlock */
+		unsigned	n_threads;
+		elec_par_thr_t	*threads;
+		/* protected by `lock' */
+		mutex_t		lock;
+		condvar_t	work_cv;
+		condvar_t	done_cv;
+		bool		shutdown;
+		uint64_t	pass;
+		unsigned	n_running;
+		unsigned	next_group;
+		double		d_t;
+		/* only accessed from the worker, or with worker_interlock */
+		bool		groups_valid;
+		bool		*topo;		/* tie & breaker states */
+		size_t		topo_len;
+		unsigned	n_roots;
+		elec_comp_t	**roots;	/* batteries & gens, by group */
+		unsigned	*group_start;	/* n_groups + 1 roots indices */
+		unsigned	n_groups;
+		unsigned	*uf;		/* union-find, per root */
+		unsigned	*owner;		/* scratch, per component */
+	} par;
+	/*
+	 * Callback prefetch pool, see libelec_sys_set_cb_threads(). Before
+	 * the sources and loads are updated, the worker gathers the
+	 * concurrent-safe callbacks it's about to call and evaluates them
+	 * on the pool threads (helping out itself), so the solver only
+	 * picks up the results.
+	 */
+	struct {
+		/* protected by worker_interlock */
+		unsigned	n_threads;
+		elec_par_thr_t	*threads;
+		/* only accessed from the worker */
+		elec_comp_t	**comps;
+		unsigned	n_comps;
+		/* protected by `lock' */
+		mutex_t		lock;
+		condvar_t	work_cv;
+		condvar_t	done_cv;
+		bool		shutdown;
+		uint64_t	pass;
+		unsigned	n_running;
+		unsigned	next;
+	} cbq;
+	/*
+	 * Runtime statistics, see libelec_sys_get_stats(). While a pass
+	 * is running, the worker accumulates its samples in the per-pass
+	 * fields and only folds them into `data' once the pass is done.
+	 */
+	struct {
+		/* protected by worker_interlock */
+		bool		enabled;
+		/* protected by `lock' */
+		mutex_t		lock;
+		elec_stats_t	data;
+		/* only accessed from the worker */
+		uint64_t	phase_ns[ELEC_NUM_PHASES];
+		unsigned	phase_mask;	/* phases which ran */
+		uint64_t	rpm_cb_ns;
+		uint64_t	temp_cb_ns;
+		/* wakeup jitter of this pass in seconds, NAN if none */
+		double		jitter;
+		/* worker scheduling error in seconds, NAN if none */
+		double		wake_err;
+		/* value of the thread's allocation counter at pass start */
+		uint64_t	allocs_start;
+		/* also updated by the solver threads */
+		atomic64_t	load_cb_ns;
+		atomic32_t	paint_visits;
+		atomic32_t	integ_visits;
+	} stats;
+	/*
+	 * Latency probe, see libelec_sys_set_lat_probe(). Input changes
+	 * queue their microclock() timestamps up in `pending', which the
+	 * worker moves to `inflight' at the start of the pass picking
+	 * them up. Once the pass is published, they move on to `unsent'
+	 * in net-send mode, tagged with the net_send.tick of the pass,
+	 * until the sender thread has sent the frame of that tick.
+	 * Timestamps beyond LAT_MAX_PENDING per stage are dropped.
+	 */
+	struct {
+		bool		active;
+		mutex_t		lock;
+		/* protected by `lock' */
+		elec_lat_stats_t data;
+		uint64_t	pending[LAT_MAX_PENDING];
+		unsigned	n_pending;
+		uint64_t	unsent[LAT_MAX_PENDING];
+		uint32_t	unsent_tick[LAT_MAX_PENDING];
+		unsigned	n_unsent;
+		/* only accessed from the worker */
+		uint64_t	inflight[LAT_MAX_PENDING];
+		unsigned	n_inflight;
+	} lat;
+	/*
+	 * Tie & breaker configuration cache, see reach_update(). `topo'
+	 * holds the current switch states packed into bits, `cfgs' the
+	 * last REACH_CACHE_SIZE distinct configurations seen. Each one
+	 * gets a new `gen' when it is (re)assigned, so plans can tell
+	 * whether their elec_plan_reach_t entries are still current.
+	 * Only written by the worker while holding worker_interlock,
+	 * except for `link_gen', which is bumped by the painting pass
+	 * every time a link slot gets painted for the first time.
+	 */
+	struct {
+		uint64_t	*topo;
+		size_t		topo_words;
+		struct {
+			uint64_t	*topo;
+			uint64_t	gen;
+			uint64_t	last_used;
+		} cfgs[REACH_CACHE_SIZE];
+		unsigned	cur;		/* index into `cfgs' */
+		uint64_t	next_gen;
+		uint64_t	tick;
+		atomic64_t	link_gen;
+	} reach;
+	/*
+	 * Per-component solver profile, see libelec_sys_set_profiling().
+	 * Protected by worker_interlock. `comps' is indexed by comp_idx
+	 * and allocated the first time profiling is enabled.
+	 */
+	struct {
+		bool			enabled;
+		uint64_t		n_passes;
+		elec_prof_comp_t	*comps;
+	} prof;
+	/*
+	 * Solver backend, see libelec_sys_set_solver(). Protected by
+	 * worker_interlock. `nodal' is built the first time the nodal
+	 * solver runs.
+	 */
+	elec_solver_t		solver;
+	elec_nodal_t		*nodal;
+	/*
+	 * Asynchronous serialization, see libelec_serialize_async(). The
+	 * worker captures the serializable state into `buf' at the end of
+	 * a pass, after which `thr' encodes it into `ser' off-thread.
+	 */
+	struct {
+		mutex_t		lock;
+		condvar_t	cv;
+		/* protected by `lock' */
+		bool		busy;		/* request outstanding */
+		bool		pending;	/* waiting for capture */
+		/* only accessed by the requesting and encoding threads */
+		bool		thr_valid;
+		thread_t	thr;
+		void		*buf;
+		size_t		len;
+		conf_t		*ser;
+		char		*prefix;
+		elec_ser_done_cb_t	done_cb;
+		void		*userinfo;
+	} ser_async;
+	/*
+	 * Persistent state file, see libelec_enable_persist(). Protected
+	 * by worker_interlock. `map' is NULL while persistence is off.
+	 */
+	struct {
+		void		*map;
+		size_t		map_sz;
+		size_t		slot_sz;	/* incl. the persist_slot_t */
+		size_t		data_sz;
+		unsigned	intval;
+		unsigned	ctr;
+		unsigned	cur;		/* latest snapshot slot */
+		uint64_t	gen;
+		char		*filename;
+	} persist;
+	/*
+	 * Named state presets, see libelec_sys_save_preset(). `lock' is
+	 * taken before worker_interlock when applying a preset.
+	 */
+	struct {
+		mutex_t		lock;
+		list_t		list;		/* elec_preset_t, by `lock' */
+	} presets;
+	/*
+	 * Frozen subnetworks, see libelec_subnet_freeze(). Protected by
+	 * worker_interlock. `thawed' is set while some components still
+	 * have their `thawed' flag set.
+	 */
+	struct {
+		list_t		subnets;	/* elec_freeze_t */
+		bool		thawed;
+	} freeze;
+	/*
+	 * Automatic model reduction, see libelec_sys_set_auto_reduce().
+	 * `seen' is set by the getters (see COMP_OBSERVE) and cleared by
+	 * the worker on every scan, so racing writers can only ever store
+	 * the same value. `pinned' is set for good by libelec_fast_resolve().
+	 * Everything else is protected by worker_interlock.
+	 */
+	struct {
+		unsigned		idle;		/* passes, 0 = off */
+		bool			*seen;		/* by comp_idx */
+		bool			*pinned;	/* by comp_idx */
+		bool			*obs;		/* scan scratch */
+		elec_reduce_cand_t	*cands;		/* largest first */
+		unsigned		n_cands;
+		unsigned		ctr;		/* since last scan */
+		unsigned		n_comps;	/* reduced away */
+	} reduce;
+	/*
+	 * Load-shedding engine, see shed_update(). Only accessed by the
+	 * worker. `cbs' holds the breakers with a SHED_PRIO, sorted by
+	 * ascending priority number, and `load' the power each of them
+	 * passed when it was last shed. The remaining arrays are indexed
+	 * by src_idx.
+	 */
+	struct {
+		elec_comp_t	**cbs;
+		double		*load;
+		size_t		n_cbs;
+		double		*hold;		/* secs until the next action */
+		double		*over;		/* secs spent over the limit */
+		double		*pwr;		/* scratch */
+		bool		*blocked;	/* scratch */
+		bool		*acted;		/* scratch */
+		bool		busy;		/* some timer is running */
+	} shed;
+	/*
+	 * Relay logic (LOGIC stanzas), see logic_update(). Only accessed
+	 * by the worker.
+	 */
+	struct {
+		elec_logic_t	*logics;
+		size_t		n;
+		bool		busy;		/* a delay timer is running */
+	} logic;
+	/*
+	 * State history recorder, see libelec_sys_set_history(). At the
+	 * end of every pass, the worker appends the pass's snapshot
+	 * records (as produced by ser_capture) to `ring'. Every
+	 * HIST_KEY_INTVAL-th entry is a full keyframe, the ones in
+	 * between only hold the bytes which changed since the previous
+	 * entry. The entries are stored back-to-back, oldest at `tail',
+	 * wrapping around to the start of the ring at `wrap'. The ring
+	 * always starts with a keyframe. Protected by worker_interlock.
+	 */
+	struct {
+		double		max_age;	/* seconds, 0 = disabled */
+		size_t		rec_len;	/* length of a full record */
+		uint8_t		*prev;		/* last recorded record */
+		uint8_t		*cur;		/* capture scratch */
+		uint8_t		*enc;		/* delta encoding scratch */
+		uint8_t		*ring;
+		size_t		cap;
+		size_t		head;
+		size_t		tail;
+		size_t		wrap;
+		bool		wrapped;
+		size_t		newest;		/* offset of newest entry */
+		size_t		n_ents;
+		unsigned	since_key;
+		double		t;		/* sim time of newest entry */
+		/* set by libelec_sys_history_seek(), see hist_record */
+		bool		seek_valid;
+		size_t		seek_ent;
+		size_t		seek_n_ents;
+		unsigned	seek_since_key;
+	} hist;
+	/*
+	 * Event tracer, see libelec_trace_start(). It's allocated along
+	 * with the network, so that checking whether tracing is active
+	 * only costs a pointer dereference.
+	 */
+	struct elec_tracer_s	*tracer;
+	/*
+	 * Telemetry recorder, see libelec_rec_start(). At the end of every
+	 * pass, the worker appends a record of `n_cols' doubles to `ring'
+	 * (the sim time, followed by ELEC_REC_NUM_QUANTS values for each
+	 * component in `comps'). The worker is the only producer and the
+	 * writer thread `thr' the only consumer, so the ring itself
+	 * doesn't need a lock. The writer drains the ring periodically
+	 * and appends the records to the log file. ELEC_REC_MEMORY
+	 * recordings skip the ring and the worker appends the records to
+	 * the in-memory columns `mem_t' and `mem_vals' directly.
+	 */
+	struct {
+		/* protected by worker_interlock */
+		bool		active;
+		/* set up before `active' is set, constant while recording */
+		elec_comp_t	**comps;
+		size_t		n_comps;
+		size_t		n_cols;
+		elec_rec_fmt_t	fmt;
+		size_t		rotate_bytes;
+		char		*path;
+		double		*ring;
+		/* only accessed by the worker */
+		double		t;
+		atomic32_t	head;		/* written by the worker */
+		atomic32_t	tail;		/* written by the writer */
+		/* written by the worker, or the writer after a write error */
+		atomic32_t	dropped;
+		/* written by the writer, or the worker with ELEC_REC_MEMORY */
+		atomic32_t	n_recs;
+		/* only accessed by the caller of libelec_rec_start/stop */
+		bool		thr_valid;
+		thread_t	thr;
+		mutex_t		lock;
+		condvar_t	cv;
+		bool		stop;		/* protected by `lock' */
+		/* only accessed by the writer */
+		FILE		*fp;
+		unsigned	file_seq;
+		size_t		file_bytes;
+		float		*fbuf;
+		bool		write_err;	/* latched, stops writing */
+		/* only accessed by the worker */
+		double		*mem_t;
+		float		*mem_vals;	/* column-major */
+		size_t		mem_rows;
+		size_t		mem_cap;	/* rows */
+		/*
+		 * Finished ELEC_REC_MEMORY recording, waiting for
+		 * libelec_rec_take_table(). Only accessed by the caller
+		 * of libelec_rec_start/stop.
+		 */
+		elec_table_t	*table;
+	} rec;
+	/*
+	 * Input capture, see libelec_capture_start(). While `active', every
+	 * pass records its inputs into `cur' (see STEP_CAPTURE) and at the
+	 * end of the pass appends the slots differing from `prev' to `buf'.
+	 * The writer thread `thr' swaps `buf' for its own `wbuf' under
+	 * `lock' and writes it out, so the worker never waits for the disk
+	 * and, unlike the telemetry recorder, never drops a pass.
+	 */
+	struct {
+		/* protected by worker_interlock */
+		bool		active;
+		bool		replay;		/* an elec_replay_t is open */
+		/* set up before `active' is set, constant while capturing */
+		unsigned	n_slots;
+		unsigned	*comp_slot;
+		/* only accessed by the worker */
+		double		*cur;
+		double		*prev;
+		uint32_t	tick;
+		atomic32_t	n_passes;	/* written by the worker */
+		/* protected by `lock' */
+		uint8_t		*buf;
+		size_t		buf_len;
+		size_t		buf_cap;
+		bool		stop;
+		/* only accessed by the writer */
+		FILE		*fp;
+		uint8_t		*wbuf;
+		size_t		wbuf_cap;
+		bool		write_err;
+		atomic64_t	n_bytes;	/* written by the writer */
+		/* only accessed by the caller of libelec_capture_start/stop */
+		bool		thr_valid;
+		thread_t	thr;
+		mutex_t		lock;
+		condvar_t	cv;
+	} cap;
 #ifdef	LIBELEC_WITH_NETLINK
 	struct {
 		bool		active;
 		/* protected by worker_interlock */
 		htbl_t		conns;		/* list of net_conn_t's */
 		list_t		conns_list;
-		/* only accessed from worker thread */
-		unsigned	xmit_ctr;
+		list_t		groups;		/* net_group_t's */
+		net_rep_topo_t	*topo;		/* built on first NET_REQ_TOPO */
+		size_t		topo_sz;
+		/*
+		 * NET_DB_NUM deadbands per component type, or NULL if
+		 * none were set up (see libelec_net_send_set_deadband).
+		 */
+		net_deadband_t	*deadband;
+		/*
+		 * While any lockstep mirrors are connected, every pass
+		 * records its inputs into `step_cur' (see STEP_CAPTURE).
+		 * Only the slots differing from `step_prev' are sent.
+		 * `capture' is latched by network_reset(), so a mirror
+		 * showing up after a pass isn't sent its unrecorded inputs.
+		 */
+		unsigned	n_mirrors;
+		bool		capture;
+		netlink_conn_id_t *mirror_ids;	/* n_mirrors long */
+		unsigned	n_slots;
+		unsigned	*comp_slot;	/* first slot of each comp */
+		double		*step_cur;
+		double		*step_prev;
+		net_rep_step_t	*step;		/* room for all slots */
+		/* tick of the last frame, only used by the sender thread */
+		uint32_t	last_tick;
+		/*
+		 * Performance reports, see NET_REQ_STATS. `n_subs' and
+		 * `owned' (we enabled the worker statistics for the
+		 * subscribers) are protected by worker_interlock, the
+		 * rest is only used by the sender thread.
+		 */
+		struct {
+			unsigned	n_subs;
+			bool		owned;
+			uint64_t	sent_t;		/* microclock() */
+			uint64_t	bytes_sent;
+			uint64_t	frames_sent;
+		} stats;
+		/*
+		 * Datagram side channel (see NET_REQ_UDP). `active' is
+		 * protected by worker_interlock, the socket is only used
+		 * by the sender thread.
+		 */
+		struct {
+			bool		active;
+			int		fd;
+		} udp;
+		/* only written from worker thread */
+		uint32_t	tick;
+		uint64_t	sim_time_us;
+		uint64_t	pub_time_us;
 		netlink_proto_t	proto;
+		/*
+		 * Component data is encoded and sent by a separate sender
+		 * thread (see net_send_thread), so the worker never waits
+		 * on network I/O. The worker merely publishes the tick &
+		 * simulation time of every pass here.
+		 */
+		struct {
+			thread_t	thr;
+			mutex_t		lock;
+			condvar_t	cv;
+			/* protected by `lock' */
+			bool		stop;
+			bool		pending;
+			bool		busy;	/* sending a frame */
+			uint32_t	tick;
+			uint64_t	sim_time_us;
+			uint64_t	pub_time_us;
+		} thr;
 	} net_send;
 	struct {
 		bool		active;
+		/*
+		 * Components wanted by the getters, one byte each. The
+		 * getters set these without any locking & bump `want_gen',
+		 * the worker then batches the changes up into at most one
+		 * subscription request every NET_SUB_INTVAL_US.
+		 */
+		volatile uint8_t *want;
+		atomic32_t	want_gen;
+		/* The rest is protected by worker_interlock */
+		int32_t		want_gen_sent;
+		uint64_t	sub_sent_t;	/* microclock() */
+		uint8_t		*rates;		/* elec_net_rate_t's */
+		bool		rates_used;
+		/* elec_net_field_t masks, 0 meaning all of them */
+		uint8_t		*fields;
+		bool		fields_used;
+		/* What the senders were last told, see send_net_recv_map */
 		uint8_t		*map;
-		bool		map_dirty;
+		uint8_t		*sent_rates;
+		uint8_t		*sent_fields;
+		net_req_sub_t	*sub;		/* room for all components */
 		netlink_proto_t	proto;
+		/*
+		 * Receive-side smoothing. When a new value arrives, the
+		 * getters glide to it from the value they were returning
+		 * at that point (`interp_from', laid out like ro.f64),
+		 * starting at local time `interp_t0' and taking as long
+		 * as the sender took between the component's last two
+		 * updates (`interp_dur'). Protected like the ro state.
+		 */
+		bool		smooth;
+		elec_real_t	*interp_from;
+		uint64_t	*interp_sim_t;	/* sender time of last update */
+		uint64_t	*interp_t0;	/* microclock() */
+		uint32_t	*interp_dur;	/* microseconds */
+		/*
+		 * Staging area into which incoming component updates are
+		 * decoded before being published, see
+		 * handle_net_rep_comps(). Laid out like the rw/ro state,
+		 * but indexed by record number, with `stage_idx' holding
+		 * the component index of each record. Only accessed from
+		 * the netlink receive callback.
+		 */
+		elec_state_t	stage;
+		unsigned	*stage_idx;
+		/*
+		 * Datagram side channel (see NET_REQ_UDP). Everything but
+		 * `active', `token' and the wakeup pipe is owned by the
+		 * receive thread (see net_udp_recv_thread()), which has
+		 * its own staging area. `ticks' holds the tick of the last
+		 * datagram applied for every chunk, `max_chunks' long.
+		 */
+		struct {
+			bool		active;
+			uint64_t	token;
+			int		fd;
+			int		wake_fd[2];	/* stops the thread */
+			thread_t	thr;
+			uint32_t	addr;		/* network byte order */
+			uint16_t	port;		/* network byte order */
+			elec_state_t	stage;
+			unsigned	*stage_idx;
+			uint32_t	*ticks;
+			bool		*ticks_valid;
+			unsigned	max_chunks;
+		} udp;
+		/*
+		 * Remote performance reports (see NET_REQ_STATS). `sub'
+		 * is protected by worker_interlock, the last report by
+		 * `lock'.
+		 */
+		struct {
+			bool		sub;
+			mutex_t		lock;
+			bool		valid;
+			elec_net_stats_t data;
+		} stats;
 	} net_recv;
+	struct {
+		bool		active;
+		/* protected by worker_interlock */
+		bool		synced;
+		uint32_t	tick;		/* next pass expected */
+		uint64_t	sync_req_t;	/* microclock() */
+		unsigned	n_slots;
+		unsigned	*comp_slot;	/* see step_slots_init() */
+		unsigned	*slot_comp;
+		netlink_proto_t	proto;
+	} net_mirror;
+	/*
+	 * Boundary exchange with the other partitions of the network, see
+	 * libelec_enable_net_part(). When the network is also a sender,
+	 * the exchange runs over its connections, so `proto' is unused.
+	 */
+	struct {
+		bool		active;
+		netlink_proto_t	proto;
+		net_bnd_t	*msg;		/* room for all boundaries */
+	} net_part;
+	/*
+	 * Multiplexer the network's sender or receiver is attached to (see
+	 * libelec_net_mux_add()), or NULL if it has its own netlink
+	 * protocol handler.
+	 */
+	struct {
+		struct elec_net_mux_s	*mux;
+		uint32_t		id;
+	} net_mux;
 #endif	/* defined(LIBELEC_WITH_NETLINK) */
+#ifdef	LIBELEC_WITH_SHM
+	/*
+	 * Shared memory publishing. A publisher copies its `ro' state
+	 * into the segment after every worker pass. A reader instead
+	 * points its `ro' arrays straight into the segment (keeping its
+	 * own ones in `saved_ro') and uses the segment's `seq' in place
+	 * of `ro_seq'. It sends its setter calls to the publisher through
+	 * the command ring it claimed (`ring', NULL if none was free),
+	 * which `ring_lock' serializes the reader's threads on. If the
+	 * publisher stops in the middle of a write, the reader is left
+	 * `stalled' on its own state (see shm_recv_stall()).
+	 */
+	struct {
+		elec_shm_hdr_t	*hdr;		/* NULL if inactive */
+		size_t		sz;
+		bool		recv;
+		char		*name;
+		void		*handle;	/* only used on Windows */
+		elec_state_t	saved_ro;
+		elec_shm_ring_t	*ring;
+		mutex_t		ring_lock;
+		bool		ring_full;	/* logged a dropped command */
+		bool		stalled;
+	} shm;
+#endif	/* defined(LIBELEC_WITH_SHM) */
+#ifdef	LIBELEC_WITH_WS
+	/*
+	 * WebSocket gateway. Everything but `active' and the wakeup
+	 * pipe is owned by the gateway thread. Every frame is encoded
+	 * once into `frame' and the same bytes are then queued to all
+	 * clients. `prev' holds the records sent in the last frame.
+	 */
+	struct {
+		bool		active;
+		int		listen_fd;
+		int		wake_fd[2];	/* pipe stopping the thread */
+		thread_t	thr;
+		list_t		clients;	/* ws_client_t's */
+		uint8_t		*layout;	/* WS_HDR_ROOM + message */
+		const uint8_t	*layout_frame;	/* within `layout' */
+		size_t		layout_frame_sz;
+		ws_rec_t	*cur;		/* by comp_idx */
+		ws_rec_t	*prev;		/* by comp_idx */
+		uint8_t		*frame;		/* WS_HDR_ROOM + message */
+	} ws;
+#endif	/* defined(LIBELEC_WITH_WS) */
 };
 
+/*
+ * A piecewise-linear curve, which remembers the segment it was last
+ * evaluated in. Curve inputs change only a little from one worker pass
+ * to the next, so curve_eval() nearly always finds its segment on the
+ * first try, instead of having to search the curve from the start.
+ */
+typedef struct {
+	const vect2_t	*pts;
+	unsigned	n_pts;
+	unsigned	seg;
+} elec_curve_t;
+
 typedef struct {
 	LIBELEC_SER_START_MARKER;
 	double		prev_amps;
 	double		chg_rel;
 	double		rechg_W;
 	LIBELEC_SER_END_MARKER;
-	mutex_t		lock;
-	double		T;		/* Kelvin, protected by `lock` above */
+	atomic64_t	T;		/* Kelvin, see atomic_get_f64() */
+	double		rechg_W_solved;	/* rechg_W of last full solve */
+	elec_curve_t	temp_curve;
+	elec_curve_t	chg_volt_curve;
+	/* Memoized pow(I_rel, 1.45) of the last battery voltage update */
+	double		I_rel;
+	double		I_rel_pow;
+	/*
+	 * Discharge (in Amp-seconds) and recharge (in Joules) accumulated
+	 * over the passes skipped due to the battery's rate divisor.
+	 */
+	double		skip_As;
+	double		skip_rechg_J;
 } elec_batt_t;
 
 typedef struct {
@@ -129,9 +1891,17 @@ typedef struct {
 	double		max_stab_U;
 	double		min_stab_f;
 	double		max_stab_f;
-	double		eff;
+	atomic64_t	eff;		/* see atomic_get_f64() */
+	elec_curve_t	eff_curve;
+	atomic64_t	rpm;		/* see atomic_get_f64() */
+	/*
+	 * Partition boundary source, see libelec_comp_set_boundary().
+	 * Protected by `lock`.
+	 */
 	mutex_t		lock;
-	double		rpm;		/* protected by `lock` above */
+	bool		bnd;
+	double		bnd_volts;
+	double		bnd_freq;
 	LIBELEC_SER_START_MARKER;
 	double		tgt_volts;
 	double		tgt_freq;
@@ -146,10 +1916,12 @@ typedef struct {
 	double		prev_amps;
 	double		regul;
 	double		eff;
+	elec_curve_t	eff_curve;
 } elec_tru_t;
 
 typedef struct {
 	double		eff;
+	elec_curve_t	eff_curve;
 } elec_xfrmr_t;
 
 typedef struct {
@@ -161,20 +1933,54 @@ typedef struct {
 	LIBELEC_SER_END_MARKER;
 	/* Change of input capacitor charge */
 	double		incap_d_Q;
-
+	/* Last demand computed by network_load_integrate_load */
+	double		demand;
+	/* Demand has been evaluated in this pass */
 	bool		seen;
+	/*
+	 * Last value returned by the load callback, which is reused on
+	 * the passes skipped due to the load's rate divisor. Only valid
+	 * while `cb_demand_valid' is set.
+	 */
+	double		cb_demand;
+	bool		cb_demand_valid;
+	/*
+	 * Demand caching, see libelec_load_set_demand_cache(). While
+	 * `cb_cache' is set, `cb_demand' is reused until the load gets
+	 * invalidated, i.e. `cb_inval' moves on from the value it had
+	 * when the callback was last called (`cb_inval_seen'), or the
+	 * value gets older than `cb_max_age' seconds (0 for no limit).
+	 * `cb_demand_us' is the simulation time of that call.
+	 */
+	bool		cb_cache;
+	double		cb_max_age;
+	uint64_t	cb_demand_us;
+	atomic32_t	cb_inval;
+	int32_t		cb_inval_seen;
+	/*
+	 * Per-member state of a load group (info->load.n_members != 0),
+	 * protected by `members_lock'. `member_on' holds 1 for working
+	 * members and 0 for failed ones, so the group's demand is simply
+	 * the dot product of the two arrays.
+	 */
+	mutex_t		members_lock;
+	double		*member_demand;
+	double		*member_on;
 } elec_load_t;
 
 typedef enum {
     SCB_POP_REASON_OC,
     SCB_POP_REASON_USER,
     SCB_POP_REASON_EXT,
+    SCB_POP_REASON_SHED,
 } elec_scb_pop_reason_t;
 
 typedef struct {
 	elec_scb_pop_reason_t	reason;
 	time_t			when;
 	double			current;	// Amps
+	/* bumped after every pop, so the event log catches them all */
+	atomic32_t		seq;
 } elec_scb_pop_t;
 
 typedef struct {
@@ -205,64 +2011,253 @@ typedef struct {
 	bool		*wk_state;
 } elec_tie_t;
 
-typedef struct {
-	elec_comp_t		*comp;
-	double			out_amps[ELEC_MAX_SRCS];
-	elec_comp_t		*srcs[ELEC_MAX_SRCS];
+/*
+ * Runtime state of a link between two components. The topology itself
+ * is kept apart from this, in elec_comp_t::adj, so that walks of the
+ * network graph only touch the dense neighbour arrays.
+ */
+typedef struct elec_link_s {
+	/*
+	 * Per-source state of the link. Rather than reserving room for
+	 * every source in the network, the link only holds a slot for
+	 * each source which can reach it through one of the traversal
+	 * plans. The slots are sorted by src_idx and are assigned in
+	 * compile_plans(), with each plan step remembering the slots it
+	 * uses, so no lookups are needed at runtime.
+	 */
+	unsigned		n_slots;
+	elec_comp_t		**slot_srcs;	/* owner of each slot */
+	double			*out_amps;
+	elec_comp_t		**srcs;
 } elec_link_t;
 
+/*
+ * A single step in a compiled traversal plan. Each step represents
+ * one hop of the network walk from `upstream' (the component of the
+ * `parent' step) into `comp'.
+ */
+typedef struct {
+	elec_comp_t	*comp;
+	/*
+	 * The component that is acting as the power source for this
+	 * step. This is either the battery/generator at the root of the
+	 * plan, or the nearest TRU, inverter or transformer upstream.
+	 */
+	elec_comp_t	*src;
+	unsigned	parent;		/* index of the parent step */
+	unsigned	up_link;	/* comp->links[] index of upstream */
+	unsigned	down_link;	/* upstream->links[] index of comp */
+	unsigned	up_slot;	/* comp->links[up_link] slot of src */
+	unsigned	down_slot;	/* upstream->links[down_link] slot */
+	unsigned	skip;		/* first step past our subtree */
+	unsigned	depth;
+} elec_plan_step_t;
+
+/*
+ * The steps of a plan reached by the load integration pass under one
+ * switch configuration. The set only depends on the states of the ties
+ * and breakers, the steps cut off by the painting pass (see `dup' in
+ * elec_plan_t) and on which link slots have ever been painted, so it
+ * is reused for as long as all three stay the same.
+ */
+typedef struct {
+	uint64_t		cfg_gen;	/* see elec_sys_t::reach */
+	uint64_t		link_gen;
+	unsigned		*dups;
+	unsigned		n_dup;
+	/* step index << 1, plus 1 if the step is powered, in post-order */
+	unsigned		*steps;
+	unsigned		n_steps;
+	/* PLAN_STEP_* state of every step, only kept for `spec' plans */
+	uint8_t			*state;
+} elec_plan_reach_t;
+
+struct elec_plan_s;
+
+/*
+ * Specialized version of a single plan, generated for a specific
+ * network by `libelec_bench cgen' and compiled into libelec using the
+ * LIBELEC_SPEC_SOLVER macro. It only gets used for a plan with exactly
+ * the same steps as the one it was generated from (see plan_sig()).
+ * Both functions return the number of steps visited. Plans deemed too
+ * large to benefit from specialization have both set to NULL.
+ */
+typedef struct {
+	const char	*root;		/* name of the battery or generator */
+	uint64_t	sig;		/* plan_sig() of the plan */
+	unsigned	(*paint)(struct elec_plan_s *plan);
+	unsigned	(*integ)(struct elec_plan_s *plan,
+	    const uint8_t *state, double d_t);
+} elec_spec_plan_t;
+
+/*
+ * Compiled traversal plan for a single battery or generator. This is
+ * constructed once in libelec_new() and contains a flattened version
+ * of the depth-first network walk, covering every path along which the
+ * source can potentially deliver power. The network painting and load
+ * integration passes then only need to loop over these steps, skipping
+ * subtrees, which are currently cut off by a tie, breaker or diode.
+ */
+typedef struct elec_plan_s {
+	elec_plan_step_t	*steps;		/* in pre-order */
+	unsigned		*post;		/* step indices in post-order */
+	unsigned		n_steps;
+	unsigned		n_post;
+	unsigned		cap;
+	/* Per-pass scratch space, only accessed from the worker thread */
+	uint8_t			*state;
+	double			*amps;
+	/*
+	 * Steps which the painting pass cut off, because their component
+	 * had already been reached from the same source along another
+	 * path. The integration pass must not feed current through them.
+	 */
+	bool			*dup;
+	unsigned		*dups;		/* indices of the `dup' steps */
+	unsigned		n_dup;
+	unsigned		max_depth;	/* of any step */
+	/*
+	 * Scratch space of libelec_comp_trace(), with one entry per
+	 * depth level. Protected by the worker_interlock.
+	 */
+	unsigned		*trace_step;
+	unsigned		*trace_node;
+	double			*trace_W;
+	double			*trace_W_loads;
+	/* by elec_sys_t::reach.cfgs index */
+	elec_plan_reach_t	reach[REACH_CACHE_SIZE];
+	const elec_spec_plan_t	*spec;		/* can be NULL */
+} elec_plan_t;
+
+/*
+ * Precompiled bulk state query, see libelec_query_new().
+ */
+struct elec_query_s {
+	elec_sys_t		*sys;
+	elec_query_ent_t	*ents;
+	size_t			n_ents;
+	size_t			cap;
+	/* Components to register for reception when in net_recv mode */
+	elec_comp_t		**comps;
+};
+
+/*
+ * Columnar data export, see libelec_state_table_new() and
+ * libelec_rec_take_table(). The table owns the column and row names,
+ * as well as the column storage in `blocks'.
+ */
+struct elec_table_s {
+	elec_table_layout_t	layout;
+	elec_col_t		*cols;
+	char			**col_names;
+	char			**row_names;
+	void			*blocks[2];
+	/* state tables only, reads the values into blocks[0] */
+	elec_query_t		*query;
+};
+
+/*
+ * The parts of a component which are only used by the public API and
+ * for bookkeeping. The solver doesn't touch these, so they're kept out
+ * of elec_comp_t in the elec_sys_t::mem.cold slab, at the component's
+ * comp_idx (see COLD()).
+ */
+typedef struct elec_comp_cold_s {
+	/*
+	 * Version of `srcs' for external consumers, which is only
+	 * updated after a network integration pass. This avoids e.g.
+	 * blinking when the `srcs' array gets reset during the
+	 * integration pass. Written under the system's rw_ro_lock &
+	 * ro_seq (see elec_sys_t). `src_mask' holds the same sources
+	 * as a bitset indexed by src_idx, for libelec_comp_has_src().
+	 * `srcs_up_ext' is the published copy of `srcs_up'.
+	 */
+	elec_comp_t		**srcs_ext;
+	elec_comp_t		**srcs_up_ext;
+	unsigned		n_srcs_ext;
+	uint64_t		*src_mask;
+#if	defined(LIBELEC_WITH_DRS) && !defined(LIBELEC_WITH_DRS_ARRAYS)
+	struct {
+		dr_t	in_volts;
+		dr_t	out_volts;
+		dr_t	in_amps;
+		dr_t	out_amps;
+		dr_t	in_pwr;
+		dr_t	out_pwr;
+	} drs;
+#endif	/* defined(LIBELEC_WITH_DRS) */
+} elec_comp_cold_t;
+
+/*
+ * A component, as seen by the solver. Everything the solver doesn't
+ * need lives in elec_comp_cold_t instead.
+ */
 struct elec_comp_s {
 	elec_sys_t		*sys;
 	elec_comp_info_t	*info;
 
 	/*
-	 * Bitmask that gets checked by the network state integrator
-	 * and reset in network_reset. This is used to prevent double-
-	 * accounting of buses.
+	 * The component's links and the neighbouring component across each
+	 * of them. Both live in the slabs in elec_sys_t::mem, where the
+	 * links of all components are laid out back to back in component
+	 * index order, so `adj' is the component's row of the network's
+	 * adjacency, in compressed sparse row form.
 	 */
-	uint64_t		integ_mask;
 	elec_link_t		*links;
+	elec_comp_t		**adj;
 	unsigned		n_links;
 	unsigned		src_idx;
 	unsigned		comp_idx;
-
-	mutex_t			rw_ro_lock;
-
-	LIBELEC_SER_START_MARKER;
-	struct {
-		double		in_volts;
-		double		out_volts;
-		double		in_amps;
-		double		out_amps;
-		double		short_amps;
-		double		in_pwr;			/* Watts */
-		double		out_pwr;		/* Watts */
-		double		in_freq;		/* Hz */
-		double		out_freq;		/* Hz */
-		bool		failed;
-		/*
-		 * Shorted components leak a lot of their energy out
-		 * to the environment and so we must avoid returning
-		 * the leakage to in libelec_comp_get_xxx. Other
-		 * parts of the system depend on those being the
-		 * actual useful work being done by the component.
-		 */
-		bool		shorted;
-		double		leak_factor;
-	} rw, ro;
-	LIBELEC_SER_END_MARKER;
+	elec_plan_t		*plan;		/* only for batteries & gens */
+	/*
+	 * Effective update rate divisor (see rate_skip()) and the time
+	 * accumulated over the passes skipped because of it.
+	 */
+	unsigned		rate_div;
+	double			rate_d_t;
+	/*
+	 * Callback prefetching, see libelec_comp_set_cb_concurrent().
+	 * While `cb_pre' is set, `cb_pre_val' holds the result of the
+	 * component's user callback for the current pass, evaluated ahead
+	 * of time on the callback pool (see cb_prefetch()), and `cb_pre_ns'
+	 * the time the callback took, if it was being timed.
+	 */
+	bool			cb_mt;
+	bool			cb_pre;
+	double			cb_pre_val;
+	uint64_t		cb_pre_ns;
 
 	double			src_int_cond_total; /* Conductance, abstract */
-	uint64_t		src_mask;
-	elec_comp_t		*srcs[ELEC_MAX_SRCS];
+	/*
+	 * Sources feeding the component during the current pass. The
+	 * array is sized in compile_plans() to the number of plan steps
+	 * visiting the component, which bounds how often it can be
+	 * painted in a single pass. `srcs_up' runs parallel to `srcs'
+	 * and holds the upstream neighbour through which each source
+	 * reached the component (NULL if the nodal solver filled in the
+	 * entry), see libelec_comp_get_feed_path().
+	 */
+	elec_comp_t		**srcs;
+	elec_comp_t		**srcs_up;
 	unsigned		n_srcs;
+	unsigned		max_srcs;
 	/*
-	 * Version for external consumers, which is only updated after a
-	 * network integration pass. This avoids e.g. blinking when the
-	 * when `srcs' array gets reset during the integration pass.
-	 * Protected by rw_ro_lock.
+	 * The plan root currently painting the component and the first
+	 * `srcs' entry it added. Every root paints its whole plan before
+	 * the next one starts, so srcs[paint_first..n_srcs) are the ones
+	 * which reached the component from `paint_root'.
 	 */
-	elec_comp_t		*srcs_ext[ELEC_MAX_SRCS];
+	const elec_comp_t	*paint_root;
+	unsigned		paint_first;
+	/*
+	 * Subnetwork freezing, see libelec_subnet_freeze(). Protected by
+	 * worker_interlock. `freeze' is set on the root bus of a frozen
+	 * subnetwork and `frozen' on all the components below it, while
+	 * `thawed' marks them for the first pass after they're thawed.
+	 */
+	elec_freeze_t		*freeze;
+	bool			frozen;
+	bool			thawed;
 
 	union {
 		elec_batt_t	batt;
@@ -274,24 +2269,46 @@ struct elec_comp_s {
 		elec_tie_t	tie;
 	};
 
-#ifdef	LIBELEC_WITH_DRS
-	struct {
-		dr_t	in_volts;
-		dr_t	out_volts;
-		dr_t	in_amps;
-		dr_t	out_amps;
-		dr_t	in_pwr;
-		dr_t	out_pwr;
-	} drs;
-#endif	/* defined(LIBELEC_WITH_DRS) */
-
 	list_node_t		comps_node;
 	list_node_t		gens_batts_node;
-	list_node_t		ties_node;
-	avl_node_t		info2comp_node;
-	avl_node_t		name2comp_node;
 };
 
+/*
+ * Heap allocation wrappers used throughout libelec in place of the
+ * libacfutils safe_* functions, which route all allocations through the
+ * allocator set using libelec_set_allocator(). Memory obtained from
+ * these must only ever be released using elec_free() and vice versa.
+ * Allocation failures are fatal, so these never return NULL.
+ */
+void *elec_malloc(size_t sz);
+void *elec_calloc(size_t n, size_t sz);
+void *elec_realloc(void *ptr, size_t sz);
+char *elec_strdup(const char *str);
+char *elec_vsprintf_alloc(const char *fmt, va_list ap);
+char *elec_sprintf_alloc(PRINTF_FORMAT(const char *fmt), ...)
+    PRINTF_ATTR(1);
+void elec_free(void *ptr);
+/* Same as libacfutils' ZERO_FREE() and ZERO_FREE_N() */
+#define	ELEC_ZERO_FREE(ptr) \
+	do { \
+		NOT_TYPE_ASSERT(ptr, void *); \
+		NOT_TYPE_ASSERT(ptr, char *); \
+		if ((ptr) != NULL) \
+			memset((ptr), 0, sizeof (*(ptr))); \
+		elec_free(ptr); \
+	} while (0)
+#define	ELEC_ZERO_FREE_N(ptr, num) \
+	do { \
+		NOT_TYPE_ASSERT(ptr, void *); \
+		if ((ptr) != NULL) \
+			memset((ptr), 0, sizeof (*(ptr)) * (num)); \
+		elec_free(ptr); \
+	} while (0)
+
+size_t elec_draw_read_state(const elec_sys_t *sys, const elec_query_t *query,
+    double *values, bool *cb_failed, unsigned *srcs_start,
+    elec_comp_t **srcs, size_t srcs_cap);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -14,9 +14,12 @@
 
 #include <acfutils/delay_line.h>
 #include <acfutils/list.h>
+#include <acfutils/thread.h>
 
 #include <netlink.h>
 
+#include "libelec.h"
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -25,15 +28,132 @@ extern "C" {
 #error	"Building this file requires netlink support"
 #endif
 
+struct net_comp_data_s;
+struct net_rep_comps_s;
+struct net_rep_packed_s;
+
+/*
+ * Connections with identical subscriptions (same components at the
+ * same rate classes) share a group, so that every frame is encoded
+ * only once and then sent to all of the group's members. The group
+ * holds everything needed for the encoding, including the delta state
+ * of the frames, so all members always receive identical frames.
+ */
 typedef struct {
 	netlink_conn_id_t	conn_id;
+	bool			zlib_ok;
+	bool			pack_ok;
+	bool			udp;	/* send datagrams instead */
+	uint32_t		udp_addr;	/* network byte order */
+	uint16_t		udp_port;	/* network byte order */
+} net_dest_t;
+
+typedef enum {
+	NET_MIRROR_NONE,	/* regular client */
+	NET_MIRROR_PENDING,	/* mirror waiting for NET_REP_SYNC */
+	NET_MIRROR_SYNCED	/* mirror receiving NET_REP_STEP */
+} net_mirror_state_t;
+
+typedef struct net_group_s {
 	uint8_t			*map;	/* NETMAPSZ bytes */
+	uint8_t			*rates;	/* elec_net_rate_t per component */
+	uint8_t			*fields;	/* elec_net_field_t masks */
+	uint64_t		map_crc;	/* crc64 of `map' */
 	unsigned		num_active;
+	/*
+	 * Dense list of the component indices set in `map', with
+	 * `num_active' entries, plus the reply buffer sized to match.
+	 * The list is grouped by rate class, fastest first, with the
+	 * entries of class `i' ending at index rate_end[i] (see
+	 * net_rate_order).
+	 */
+	uint32_t		*active;
+	unsigned		rate_end[ELEC_NET_NUM_RATES];
+	struct net_rep_comps_s	*rep;
+	struct net_rep_packed_s	*packed;	/* see NET_VER_PACK_OK */
+	/*
+	 * Last transmitted record of every entry in `active'. Delta
+	 * frames only carry the records which differ from these.
+	 * `keyframe_ctr' counts down the transmits to the next full
+	 * frame, with 0 meaning the next frame is a keyframe.
+	 */
+	struct net_comp_data_s	*sent;
+	unsigned		keyframe_ctr;
+	/*
+	 * Tick at which every entry in `sent' was transmitted, so that
+	 * records held back by a deadband are refreshed periodically
+	 * (see NET_DEADBAND_REFRESH).
+	 */
+	uint32_t		*sent_tick;
+	/*
+	 * One flag per NET_UDP_CHUNK_RECS entries of `active', set when
+	 * any record of the chunk changed since its last datagram.
+	 */
+	bool			*udp_dirty;
+	/*
+	 * Held by every member, as well as while sending, since
+	 * sending can kill members.
+	 */
+	unsigned		refcnt;
+	list_t			conns;		/* member net_conn_t's */
+	list_node_t		node;	/* net_send.groups node */
+} net_group_t;
+
+typedef struct {
+	netlink_conn_id_t	conn_id;
+	/* The subscription as requested by the client */
+	uint8_t			*map;	/* NETMAPSZ bytes */
+	uint8_t			*rates;	/* elec_net_rate_t per component */
+	uint8_t			*fields;	/* elec_net_field_t masks */
+	bool			zlib_ok;	/* sent NET_VER_ZLIB_OK */
+	bool			pack_ok;	/* sent NET_VER_PACK_OK */
+	net_mirror_state_t	mirror;
+	bool			part;	/* sent NET_REQ_BND */
+	/*
+	 * Datagram side channel, see NET_REQ_UDP. `udp_addr' and
+	 * `udp_port' (network byte order) are where the last hello
+	 * carrying `udp_token' came from, at microclock() `udp_seen_t'.
+	 * `udp' is latched by every frame, so that switching between
+	 * netlink & datagrams forces a keyframe.
+	 */
+	uint64_t		udp_token;
+	uint32_t		udp_addr;
+	uint16_t		udp_port;
+	uint64_t		udp_seen_t;
+	bool			udp;
+	bool			stats;	/* sent NET_REQ_STATS */
+	net_group_t		*group;
 	delay_line_t		kill_delay;
 	list_node_t		node;	/* net_send.conns_list node */
+	list_node_t		group_node;	/* net_group_t.conns node */
 } net_conn_t;
 
+/*
+ * The `version' field of every message carries LIBELEC_NET_VERSION in
+ * its low bits (NET_VER_MASK), plus these flags:
+ *
+ * NET_VER_ZLIB: the message is compressed. The bytes following the
+ *	net_req_t/net_rep_t header are a zlib stream holding the complete
+ *	original message, including its own uncompressed header.
+ * NET_VER_ZLIB_OK: set by receivers in their requests to let the
+ *	sender know that they accept compressed replies.
+ * NET_VER_PACK_OK: set by receivers in their requests to let the
+ *	sender know that they accept NET_REP_COMPS_PACKED instead of
+ *	NET_REP_COMPS and NET_REP_COMPS_DELTA.
+ */
+#define	NET_VER_MASK		0x0fff
+#define	NET_VER_ZLIB		0x8000
+#define	NET_VER_ZLIB_OK		0x4000
+#define	NET_VER_PACK_OK		0x2000
+
 #define	NET_REQ_MAP		0x0001	/* net_req_map_t */
+#define	NET_REQ_SUB		0x0002	/* net_req_sub_t */
+#define	NET_REQ_TOPO		0x0003	/* net_req_t */
+#define	NET_REQ_SYNC		0x0004	/* net_req_t */
+#define	NET_REQ_BND		0x0005	/* net_bnd_t */
+#define	NET_REQ_UDP		0x0006	/* net_req_udp_t */
+#define	NET_REQ_STATS		0x0007	/* net_req_stats_t */
+#define	NET_REQ_MUX		0x0008	/* net_mux_t */
 
 typedef struct {
 	uint16_t		version;
@@ -44,23 +164,118 @@ typedef struct {
 	uint16_t		version;
 	uint16_t		req;
 	uint64_t		conf_crc;
+	/*
+	 * NETMAPSZ bytes of subscription bitmap. These can optionally
+	 * be followed by one elec_net_rate_t byte per component, giving
+	 * the rate class of each subscription. Without them, all
+	 * subscriptions use ELEC_NET_RATE_NORMAL. The rates can in turn
+	 * be followed by one elec_net_field_t mask byte per component,
+	 * selecting the quantities to send (0 meaning all of them).
+	 * Without them, all quantities are sent. The sender transmits
+	 * the quantities left out as zero, so they don't take up any
+	 * room in NET_REP_COMPS_PACKED replies and changes to them don't
+	 * cause any delta frames.
+	 */
 	uint8_t			map[0];	/* variable length */
 } net_req_map_t;
 
+/*
+ * Incremental subscription change, see net_req_sub_t. Instead of an
+ * elec_net_rate_t, `rate' can also be NET_SUB_REMOVE to unsubscribe.
+ * `fields' is the elec_net_field_t mask, see net_req_map_t.
+ */
+#define	NET_SUB_REMOVE		0xff
+
+typedef struct {
+	uint32_t		idx;		/* component index */
+	uint8_t			rate;
+	uint8_t			fields;
+	uint8_t			pad[2];
+} net_sub_ent_t;
+
+/*
+ * Applies `n_ents' subscription changes on top of the client's current
+ * map. Receivers send these instead of a full net_req_map_t when only
+ * a few components changed since their last request.
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		req;
+	uint32_t		n_ents;
+	uint64_t		conf_crc;
+	net_sub_ent_t		ents[0];	/* variable length */
+} net_req_sub_t;
+
+/*
+ * Asks the sender to stream component data to this connection over
+ * the datagram side channel (see libelec_enable_net_send_udp()). The
+ * sender can't tell which netlink connection a datagram came from, so
+ * the receiver picks a random `token' and repeats it in the hellos it
+ * sends to the sender's UDP port. A token of 0 turns the side channel
+ * off again.
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		req;
+	uint32_t		pad;
+	uint64_t		token;
+} net_req_udp_t;
+
+/*
+ * Subscribes to (`on' != 0) or unsubscribes from the sender's
+ * NET_REP_STATS reports.
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		req;
+	uint32_t		on;
+} net_req_stats_t;
+
 enum {
     LIBELEC_NET_FLAG_FAILED =	1 << 0,
     LIBELEC_NET_FLAG_SHORTED =	1 << 1
 };
 
+/*
+ * NET_REP_COMPS is a keyframe, carrying all components subscribed to
+ * by the client. NET_REP_COMPS_DELTA uses the same layout, but only
+ * carries the components whose quantized data changed since the
+ * previous frame. Keyframes are sent periodically and after every map
+ * change, so that a receiver can always resynchronize.
+ */
 #define	NET_REP_COMPS		0x0001		/* net_rep_comps_t */
+#define	NET_REP_COMPS_DELTA	0x0002		/* net_rep_comps_t */
+#define	NET_REP_TOPO		0x0003		/* net_rep_topo_t */
+#define	NET_REP_STEP		0x0004		/* net_rep_step_t */
+#define	NET_REP_SYNC		0x0005		/* net_rep_sync_t */
+#define	NET_REP_BND		0x0006		/* net_bnd_t */
+#define	NET_REP_COMPS_PACKED	0x0007		/* net_rep_packed_t */
+#define	NET_REP_STATS		0x0008		/* net_rep_stats_t */
+#define	NET_REP_MUX		0x0009		/* net_mux_t */
 
 typedef struct {
 	uint16_t		version;
 	uint16_t		rep;
 } net_rep_t;
 
+/*
+ * Number of analog quantities in a net_comp_data_t, which can each have
+ * a deadband (see libelec_net_send_set_deadband()), in the bit order of
+ * elec_net_field_t.
+ */
+#define	NET_DB_NUM	7
+
+/*
+ * Deadband of a single quantity. `abs' is in the quantized units of
+ * net_comp_data_t, `rel' is a fraction of the last transmitted value.
+ */
 typedef struct {
-	uint16_t		idx;		/* component index */
+	double			abs;
+	double			rel;
+} net_deadband_t;
+
+typedef struct net_comp_data_s {
+	uint32_t		idx;		/* component index */
 	uint16_t		flags;		/* LIBELEC_NET_FLAG_* mask */
 	uint16_t		in_volts;	/* 0.05 V */
 	uint16_t		out_volts;	/* 0.05 V */
@@ -71,14 +286,294 @@ typedef struct {
 	uint16_t		leak_factor;	/* 1/10000th */
 } net_comp_data_t;
 
-typedef struct {
+typedef struct net_rep_comps_s {
 	uint16_t		version;
 	uint16_t		rep;
+	uint32_t		tick;		/* sender's worker pass count */
 	uint64_t		conf_crc;
-	uint16_t		n_comps;
+	uint64_t		sim_time_us;	/* sender's simulation time */
+	uint64_t		pub_time_us;	/* sender's wall clock */
+	uint32_t		n_comps;
 	net_comp_data_t		comps[0];	/* variable length */
 } net_rep_comps_t;
 
+/*
+ * Compact encoding of the records of a NET_REP_COMPS(_DELTA) frame.
+ * Every record starts with a varint (LEB128) mask of NET_PACK_* bits,
+ * followed by varints of the fields flagged in the mask, in the order
+ * of the bits. Fields which are zero (such as all the quantities of an
+ * unpowered component, the frequencies of DC components or the leak
+ * factor of a component which isn't shorted) are left out. Records
+ * come in subscription order, so the component index is implicitly
+ * one past that of the previous record (starting at 0). Only when it
+ * isn't does the record carry NET_PACK_IDX, with the zigzag-encoded
+ * difference from the implicit index.
+ */
+#define	NET_PACK_IN_VOLTS	(1 << 0)
+#define	NET_PACK_OUT_VOLTS	(1 << 1)
+#define	NET_PACK_IN_AMPS	(1 << 2)
+#define	NET_PACK_OUT_AMPS	(1 << 3)
+#define	NET_PACK_IN_FREQ	(1 << 4)
+#define	NET_PACK_OUT_FREQ	(1 << 5)
+#define	NET_PACK_LEAK		(1 << 6)
+#define	NET_PACK_FAILED		(1 << 7)
+#define	NET_PACK_SHORTED	(1 << 8)
+#define	NET_PACK_IDX		(1 << 9)
+/* mask (2 bytes), index (4 bytes) and 7 uint16 fields (3 bytes each) */
+#define	NET_PACK_REC_MAX	27
+
+typedef struct net_rep_packed_s {
+	uint16_t		version;
+	uint16_t		rep;
+	uint32_t		tick;		/* sender's worker pass count */
+	uint64_t		conf_crc;
+	uint64_t		sim_time_us;	/* sender's simulation time */
+	uint64_t		pub_time_us;	/* sender's wall clock */
+	uint32_t		n_comps;
+	uint8_t			data[0];	/* variable length */
+} net_rep_packed_t;
+
+/*
+ * Reply to NET_REQ_TOPO, carrying the sender's network definition as a
+ * precompiled image (see libelec_write_image()). Clients use this to
+ * set up their network without needing the definition file.
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		rep;
+	uint32_t		img_sz;
+	uint64_t		conf_crc;
+	uint8_t			img[0];		/* variable length */
+} net_rep_topo_t;
+
+/*
+ * Lockstep mirroring (see libelec_enable_net_mirror()). Rather than
+ * component states, mirrors receive the inputs of every worker pass
+ * of the sender and run the pass themselves. The inputs are kept in
+ * numbered slots, whose layout only depends on the network definition
+ * (see step_slots_init()), so both sides agree on it.
+ */
+typedef struct {
+	uint32_t		slot;
+	uint32_t		pad;
+	double			value;
+} net_step_ent_t;
+
+/*
+ * Carries the slots which changed for worker pass `tick', along with
+ * the pass' time step and substep limit. Every NET_STEP_CRC_INTVAL
+ * passes, `state_crc' holds a CRC of the sender's state after the
+ * pass, so mirrors can detect divergence (otherwise it's 0).
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		rep;
+	uint32_t		tick;
+	uint64_t		conf_crc;
+	double			d_t;
+	double			substep;	/* accel_substep */
+	uint64_t		state_crc;
+	uint32_t		n_ents;
+	uint32_t		pad;
+	net_step_ent_t		ents[0];	/* variable length */
+} net_rep_step_t;
+
+/*
+ * Reply to NET_REQ_SYNC, which (re)starts a mirror. `data' holds a
+ * state snapshot (see libelec_snapshot_save()) of `snap_sz' bytes,
+ * taken after worker pass `tick', padded to 8 bytes and followed by
+ * all `n_slots' slot values.
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		rep;
+	uint32_t		tick;
+	uint64_t		conf_crc;
+	uint64_t		rng_s[4];	/* see elec_rng_t */
+	double			rng_spare;
+	uint32_t		rng_has_spare;
+	uint32_t		snap_sz;
+	uint32_t		n_slots;
+	uint32_t		pad;
+	uint8_t			data[0];	/* variable length */
+} net_rep_sync_t;
+
+/*
+ * Boundary values exchanged between the partitions of a network (see
+ * libelec_enable_net_part()). Each boundary is identified by the CRC64
+ * of its components' name, which must be the same in both partitions.
+ * The upstream side (a load) sends NET_BND_VOLTS entries with its
+ * input voltage and frequency, the downstream side (a generator)
+ * sends NET_BND_AMPS entries with its output current in `a'.
+ */
+#define	NET_BND_VOLTS		0
+#define	NET_BND_AMPS		1
+
+typedef struct {
+	uint64_t		id;
+	uint32_t		kind;	/* NET_BND_* */
+	uint32_t		pad;
+	double			a;	/* volts or amps */
+	double			b;	/* frequency */
+} net_bnd_ent_t;
+
+/*
+ * Sent as NET_REQ_BND by network clients and as NET_REP_BND by the
+ * network sender after each of their worker passes.
+ */
+typedef struct {
+	uint16_t		version;
+	uint16_t		req;	/* NET_REQ_BND or NET_REP_BND */
+	uint32_t		n_ents;
+	net_bnd_ent_t		ents[0];	/* variable length */
+} net_bnd_t;
+
+/*
+ * Datagrams of the UDP side channel. Receivers send a NET_UDP_HELLO
+ * every NET_UDP_HELLO_INTVAL_US to the sender's UDP port, which tells
+ * the sender where to send the NET_UDP_COMPS datagrams of the netlink
+ * connection which sent the same token in its NET_REQ_UDP. Once the
+ * hellos stop for NET_UDP_TIMEOUT_US, the sender goes back to sending
+ * regular frames over netlink.
+ *
+ * The subscribed components of a group (net_group_t.active) are split
+ * into chunks of NET_UDP_CHUNK_RECS records, each small enough not to
+ * get fragmented. Every NET_UDP_COMPS datagram carries the latest
+ * records of all components of one chunk, so it doesn't depend on any
+ * datagram before it. A chunk is sent whenever any of its records
+ * changed, as well as on keyframes. The receiver drops any datagram
+ * whose `tick' isn't newer than that of the last datagram it applied
+ * for the same chunk, so that late & duplicated datagrams can't roll
+ * the state back. Lost datagrams are simply superseded by later ones.
+ */
+#define	NET_UDP_MAGIC		0x4c455544u	/* 'LEUD' */
+#define	NET_UDP_HELLO		0x0001		/* net_udp_hello_t */
+#define	NET_UDP_COMPS		0x0002		/* net_udp_comps_t */
+#define	NET_UDP_CHUNK_RECS	56
+#define	NET_UDP_HELLO_INTVAL_US	1000000
+#define	NET_UDP_TIMEOUT_US	5000000
+
+typedef struct {
+	uint32_t		magic;		/* NET_UDP_MAGIC */
+	uint16_t		version;	/* LIBELEC_NET_VERSION */
+	uint16_t		type;		/* NET_UDP_HELLO */
+	uint64_t		token;		/* see net_req_udp_t */
+	uint64_t		conf_crc;
+} net_udp_hello_t;
+
+typedef struct {
+	uint32_t		magic;		/* NET_UDP_MAGIC */
+	uint16_t		version;	/* LIBELEC_NET_VERSION */
+	uint16_t		type;		/* NET_UDP_COMPS */
+	uint32_t		tick;		/* sender's worker pass count */
+	/* MAX_COMPS components take more than UINT16_MAX chunks */
+	uint32_t		chunk;
+	uint32_t		n_chunks;
+	uint32_t		n_comps;	/* <= NET_UDP_CHUNK_RECS */
+	uint64_t		conf_crc;
+	uint64_t		sim_time_us;	/* sender's simulation time */
+	uint64_t		pub_time_us;	/* sender's wall clock */
+	net_comp_data_t		comps[0];	/* variable length */
+} net_udp_comps_t;
+
+#define	NET_UDP_DGRAM_MAX	(sizeof (net_udp_comps_t) + \
+    NET_UDP_CHUNK_RECS * sizeof (net_comp_data_t))
+
+/*
+ * Performance report of the sender, sent every NET_STATS_INTVAL_US to
+ * the connections which subscribed to it using NET_REQ_STATS. While
+ * anybody is subscribed, the sender collects its worker statistics
+ * even if the host application hasn't enabled them. `stats' and
+ * `overruns' are laid out like the public structures, the receiver
+ * only accepts reports with the same number of phases & jitter
+ * buckets as its own. `bytes_sent' and `frames_sent' count the
+ * component data frames (and datagrams) since the sender was enabled.
+ */
+#define	NET_STATS_INTVAL_US	1000000
+
+typedef struct {
+	uint16_t		version;
+	uint16_t		rep;
+	uint16_t		n_phases;	/* ELEC_NUM_PHASES */
+	uint16_t		n_jitter_buckets; /* ELEC_NUM_JITTER_BUCKETS */
+	uint64_t		time_us;	/* sender's wall clock */
+	elec_stats_t		stats;
+	elec_overrun_stats_t	overruns;
+	uint32_t		n_clients;
+	uint32_t		n_groups;
+	uint64_t		bytes_sent;
+	uint64_t		frames_sent;
+} net_rep_stats_t;
+
+/*
+ * Multiplexed messages of several networks sharing a connection (see
+ * libelec_net_mux_new()). A net_mux_t carries `n_ents' complete
+ * messages, each preceded by a net_mux_ent_t naming the network it
+ * belongs to and padded to NET_MUX_ALIGN bytes. Receivers send their
+ * requests as NET_REQ_MUX with a single entry. Senders batch up all
+ * the messages their networks have for a connection into a single
+ * NET_REP_MUX per transmit.
+ */
+#define	NET_MUX_ALIGN		8
+#define	NET_MUX_LINGER_US	10000	/* max. batching delay */
+#define	NET_MUX_PAD(sz)		\
+	(((sz) + NET_MUX_ALIGN - 1) & ~((size_t)NET_MUX_ALIGN - 1))
+
+typedef struct {
+	uint16_t		version;
+	uint16_t		req;	/* NET_REQ_MUX or NET_REP_MUX */
+	uint32_t		n_ents;
+} net_mux_t;
+
+typedef struct {
+	uint32_t		sys_id;	/* see libelec_net_mux_add() */
+	uint32_t		sz;	/* of the message, without padding */
+} net_mux_ent_t;
+
+/*
+ * A message of a sender's network, queued up in its multiplexer for
+ * the next batch to `conn_id'.
+ */
+typedef struct {
+	netlink_conn_id_t	conn_id;
+	uint32_t		sys_id;
+	uint32_t		sz;
+	list_node_t		node;	/* elec_net_mux_t.queue node */
+	uint8_t			data[0];	/* variable length */
+} net_mux_msg_t;
+
+typedef struct {
+	elec_sys_t		*sys;
+	uint32_t		id;
+	bool			sender;
+	bool			done;	/* sent a frame since the last batch */
+} net_mux_member_t;
+
+/*
+ * Shared netlink protocol handler of several network senders and/or
+ * receivers. Everything is protected by `lock', which is never held
+ * while calling into the networks. Dispatching a message to a network
+ * instead bumps `n_dispatch', which libelec_net_mux_remove() waits
+ * out before the network can go away.
+ */
+struct elec_net_mux_s {
+	netlink_proto_t		proto;
+	mutex_t			lock;
+	condvar_t		cv;
+	net_mux_member_t	*members;
+	unsigned		n_members;
+	unsigned		n_senders;
+	unsigned		n_done;
+	unsigned		n_dispatch;
+	/* conns which have sent us a NET_REQ_MUX, the rest get no batches */
+	netlink_conn_id_t	*conns;
+	unsigned		n_conns;
+	list_t			queue;		/* net_mux_msg_t's */
+	uint64_t		queue_t;	/* microclock() of the oldest */
+	bool			stop;
+	thread_t		thr;
+};
+
 #ifdef	__cplusplus
 }
 #endif
@@ -19,12 +19,135 @@
 
 #define	WIN_WIDTH	900	/* px */
 #define	WIN_HEIGHT	600	/* px */
+/*
+ * We only render a new frame when something visible has changed. These
+ * control how often we check for changes, normally and while the user is
+ * dragging the view around.
+ */
 #define	WIN_FPS		20
 #define	WIN_FPS_FAST	30
+/*
+ * Margin around the window, as a fraction of the window size, which is
+ * rasterized into the static layer caches. This lets the user pan around
+ * a bit before the caches need to be regenerated.
+ */
+#define	CACHE_MARGIN	0.5
+/*
+ * While the user is panning or zooming, we only show scaled copies of
+ * the last full rendering, see preview_paint(). Once the view has been
+ * left alone for this long (in microseconds), it's rendered in full.
+ */
+#define	PREVIEW_DELAY	100000
+/*
+ * Hit-testing grid cell size in layout units and the maximum number of
+ * cells along either axis. Past that, the cells just grow larger.
+ */
+#define	GRID_CELL_SZ	8
+#define	GRID_MAX_CELLS	1024
+/*
+ * Past this many separate dirty rectangles, it's cheaper to just redraw
+ * the whole retained image. The margin (in pixels) is added around every
+ * dirty rectangle to cover the antialiasing of lines at its edges.
+ */
+#define	DIRTY_MAX_RECTS	64
+#define	DIRTY_MARGIN	2
+/*
+ * Images larger than this many pixels are split into horizontal bands,
+ * which are rasterized in parallel by the tile threads (see
+ * libelec_vis_set_render_threads()). Every thread gets a few bands, so
+ * a band crowded with components doesn't hold up all the others.
+ */
+#define	TILE_MIN_PIXELS		(512 * 512)
+#define	TILES_PER_THREAD	2
+
+/*
+ * Uniform grid over the hit boxes of all clickable components, which
+ * lets hit_test() only look at the handful of components near the
+ * cursor. The components overlapping cell `i' are stored in
+ * `comps[cell_start[i]]' through `comps[cell_start[i + 1] - 1]', in the
+ * same order as they appear in the network.
+ */
+typedef struct {
+	vect2_t			min;
+	double			cell_sz;
+	unsigned		nx, ny;
+	unsigned		*cell_start;
+	const elec_comp_t	**comps;
+} vis_grid_t;
+
+/*
+ * Area of the layout covered by a static layer image, in pixels at
+ * zoom level `zoom', relative to the layout origin.
+ */
+typedef struct {
+	double			zoom;
+	int			x, y, w, h;
+} vis_cache_geom_t;
+
+typedef struct {
+	struct libelec_vis_s	*vis;
+	elec_draw_layer_t	layer;
+} vis_layer_ref_t;
+
+/*
+ * Horizontal band of an image rendered by tiles_render(). The band's
+ * image has its device offset set, so drawing into `cr' works exactly
+ * like drawing into the whole image, except that everything outside of
+ * the band is clipped away (and thus skipped by the layer culling).
+ * `cr' is kept around, so the drawing caches attached to it survive.
+ */
+typedef struct {
+	cairo_surface_t		*img;
+	cairo_t			*cr;
+	int			y, h;
+} vis_tile_t;
+
+/*
+ * The bands covering an image of `w' x `h' pixels. Only ever touched
+ * by the owning render thread, or by the tile threads while it waits
+ * in tiles_render().
+ */
+typedef struct {
+	unsigned		n_tiles;
+	vis_tile_t		*tiles;
+	int			w, h;
+} vis_tiles_t;
+
+/*
+ * Draws the whole image into `cr', see tiles_render().
+ */
+typedef void (*vis_tile_draw_t)(struct libelec_vis_s *vis, cairo_t *cr,
+    const void *arg);
+
+typedef struct {
+	struct libelec_vis_s	*vis;
+	thread_t		thread;
+	uint64_t		job;		/* protected by tile.lock */
+} vis_tile_thr_t;
+
+/*
+ * Window-sized image retained between frames, holding either the
+ * entire view (cairo backend) or a single dynamic layer (GL backend).
+ * After a pan or zoom, the image is redrawn completely. Otherwise, only
+ * the bounding boxes of the components whose visible state has changed
+ * are redrawn, see retained_update(). `hashes' holds the visible state
+ * hash of every component as of the last redraw, in network order.
+ * `cr' is kept around, so the drawing caches attached to it survive
+ * from frame to frame. Only ever touched by the owning render thread.
+ */
+typedef struct {
+	cairo_surface_t		*img;
+	cairo_t			*cr;
+	double			zoom;
+	int			org_x, org_y;
+	uint64_t		*hashes;
+	vis_tiles_t		tiles;
+} vis_retained_t;
 
 struct libelec_vis_s {
 	const elec_sys_t	*sys;
-	mt_cairo_render_t	*mtcr;
+	libelec_vis_backend_t	backend;
+	mt_cairo_render_t	*mtcr;		/* cairo backend only */
 	XPLMWindowID		win;
 	double			pos_scale;
 	double			font_sz;
@@ -32,12 +155,92 @@ struct libelec_vis_s {
 	vect2_t			offset;
 	vect2_t			mouse_down;
 	vect2_t			mouse_prev;
+	vis_grid_t		grid;
+	/*
+	 * Only accessed from the main thread. `dirty' is set whenever the
+	 * view has moved, zoomed or changed highlight, and `state_hash'
+	 * holds libelec_draw_get_state_hash() as of the last render.
+	 * `interact_t' is the microclock() time of the last pan or zoom,
+	 * and `refine' is set while the last frame was only a preview.
+	 */
+	bool			dirty;
+	bool			dragging;
+	bool			refine;
+	uint64_t		state_hash;
+	uint64_t		interact_t;
 
 	mutex_t			lock;
 	const elec_comp_t	*highlight;
 	const elec_comp_t	*selected;
+	/* Written on the main thread, the renderers read it under `lock' */
+	bool			preview;
 
 	XPLMFlightLoopID	floop;
+	/*
+	 * Offscreen copies of the static drawing layers. These are only
+	 * ever touched from the render thread and are redrawn whenever the
+	 * zoom level changes, or the view is panned outside of the cached
+	 * area. `x', `y', `w' and `h' define the area of the layout covered
+	 * by `img', in pixels at the cached zoom level, relative to the
+	 * layout origin.
+	 */
+	struct {
+		cairo_surface_t	*img[ELEC_DRAW_NUM_LAYERS];
+		double		zoom;
+		int		x, y, w, h;
+		vis_tiles_t	tiles;
+	} cache;
+	vis_retained_t		retained;	/* cairo backend only */
+	/*
+	 * Offscreen visualizers only (see libelec_vis_new_offscreen()).
+	 * The caller's texture into which the view was last rendered and
+	 * its size, so that as long as these stay the same, only the
+	 * parts of the view which have changed need to be uploaded.
+	 */
+	struct {
+		GLuint		id;
+		int		w, h;
+	} tex;
+	/*
+	 * GL backend state. Every layer has its own renderer. The dynamic
+	 * layers are window-sized and drawn with a transparent background.
+	 * The static layers cover the cached area, which is decided on the
+	 * main thread in `want'. Each static layer renderer records the
+	 * area it has actually rendered in `have', which is what the GPU
+	 * composites until the next rendering is done (both protected by
+	 * `lock'). While zooming, the old static images are simply scaled
+	 * until the new ones are ready.
+	 */
+	struct {
+		mt_cairo_render_t	*mtcr[ELEC_DRAW_NUM_LAYERS];
+		vis_layer_ref_t		refs[ELEC_DRAW_NUM_LAYERS];
+		vis_cache_geom_t	want;
+		vis_cache_geom_t	have[ELEC_DRAW_NUM_LAYERS];
+		/* owned by the layer renderers */
+		vis_retained_t		retained[ELEC_DRAW_NUM_LAYERS];
+		vis_tiles_t		tiles[ELEC_DRAW_NUM_LAYERS];
+	} gl;
+	/*
+	 * Tile rendering threads, see tiles_render(). The render threads
+	 * of the various layers take turns at using them, by holding
+	 * `job_lock' for the duration of a job. `n_threads' and `threads'
+	 * are protected by `job_lock', the job state by `lock'.
+	 */
+	struct {
+		mutex_t			job_lock;
+		unsigned		n_threads;
+		vis_tile_thr_t		*threads;
+		mutex_t			lock;
+		condvar_t		work_cv;
+		condvar_t		done_cv;
+		bool			shutdown;
+		uint64_t		job;
+		unsigned		n_running;
+		unsigned		next_tile;
+		vis_tiles_t		*tiles;
+		vis_tile_draw_t		draw;
+		const void		*arg;
+	} tile;
 #ifdef	LIBELEC_VIS_WITH_WIN_KEEPER
 	win_keeper_t		*wk;
 	char			*wk_name;
@@ -95,28 +298,152 @@ cursor_coords_xlate(libelec_vis_t *vis, int x, int y)
 	return (mouse);
 }
 
+static bool
+comp_hit_box(const elec_comp_t *comp, vect2_t *min, vect2_t *max)
+{
+	vect2_t pos, sz;
+
+	ASSERT(comp != NULL);
+	ASSERT(min != NULL);
+	ASSERT(max != NULL);
+
+	pos = comp->info->gui.pos;
+	if (IS_NULL_VECT(pos) || comp->info->gui.virt ||
+	    comp->info->gui.invis) {
+		return (false);
+	}
+	sz = comp_info2sz(comp->info);
+	if (IS_NULL_VECT(sz))
+		return (false);
+	*min = VECT2(pos.x - sz.x / 2, pos.y - sz.y / 2);
+	*max = VECT2(pos.x + sz.x / 2, pos.y + sz.y / 2);
+
+	return (true);
+}
+
+static void
+grid_cell_range(const vis_grid_t *grid, vect2_t min, vect2_t max,
+    unsigned x[2], unsigned y[2])
+{
+	ASSERT(grid != NULL);
+
+	x[0] = clampi((min.x - grid->min.x) / grid->cell_sz, 0, grid->nx - 1);
+	x[1] = clampi((max.x - grid->min.x) / grid->cell_sz, 0, grid->nx - 1);
+	y[0] = clampi((min.y - grid->min.y) / grid->cell_sz, 0, grid->ny - 1);
+	y[1] = clampi((max.y - grid->min.y) / grid->cell_sz, 0, grid->ny - 1);
+}
+
+/*
+ * Builds the hit-testing grid. The network layout is static, so this
+ * only needs to happen once, when the visualizer is created.
+ */
+static void
+grid_build(vis_grid_t *grid, const elec_sys_t *sys)
+{
+	vect2_t min = VECT2(INFINITY, INFINITY);
+	vect2_t max = VECT2(-INFINITY, -INFINITY);
+	unsigned n_cells, *fill;
+
+	ASSERT(grid != NULL);
+	ASSERT(sys != NULL);
+
+	for (const elec_comp_t *comp = list_head(&sys->comps); comp != NULL;
+	    comp = list_next(&sys->comps, comp)) {
+		vect2_t cmin, cmax;
+
+		if (comp_hit_box(comp, &cmin, &cmax)) {
+			min = VECT2(MIN(min.x, cmin.x), MIN(min.y, cmin.y));
+			max = VECT2(MAX(max.x, cmax.x), MAX(max.y, cmax.y));
+		}
+	}
+	if (min.x > max.x) {
+		/* Nothing clickable, leave the grid empty */
+		min = max = ZERO_VECT2;
+	}
+	grid->min = min;
+	grid->cell_sz = MAX(GRID_CELL_SZ, MAX(max.x - min.x,
+	    max.y - min.y) / GRID_MAX_CELLS);
+	grid->nx = (max.x - min.x) / grid->cell_sz + 1;
+	grid->ny = (max.y - min.y) / grid->cell_sz + 1;
+	n_cells = grid->nx * grid->ny;
+	grid->cell_start = elec_calloc(n_cells + 1,
+	    sizeof (*grid->cell_start));
+	fill = elec_calloc(n_cells, sizeof (*fill));
+	/*
+	 * The first pass counts the components in each cell, the second
+	 * pass fills them in.
+	 */
+	for (int pass = 0; pass < 2; pass++) {
+		for (const elec_comp_t *comp = list_head(&sys->comps);
+		    comp != NULL; comp = list_next(&sys->comps, comp)) {
+			vect2_t cmin, cmax;
+			unsigned x[2], y[2];
+
+			if (!comp_hit_box(comp, &cmin, &cmax))
+				continue;
+			grid_cell_range(grid, cmin, cmax, x, y);
+			for (unsigned j = y[0]; j <= y[1]; j++) {
+				for (unsigned i = x[0]; i <= x[1]; i++) {
+					unsigned cell = j * grid->nx + i;
+
+					if (pass == 0) {
+						grid->cell_start[cell + 1]++;
+						continue;
+					}
+					grid->comps[grid->cell_start[cell] +
+					    fill[cell]++] = comp;
+				}
+			}
+		}
+		if (pass == 0) {
+			for (unsigned i = 0; i < n_cells; i++) {
+				grid->cell_start[i + 1] +=
+				    grid->cell_start[i];
+			}
+			grid->comps = elec_calloc(MAX(
+			    grid->cell_start[n_cells], 1),
+			    sizeof (*grid->comps));
+		}
+	}
+	elec_free(fill);
+}
+
+static void
+grid_free(vis_grid_t *grid)
+{
+	ASSERT(grid != NULL);
+	elec_free(grid->cell_start);
+	elec_free(grid->comps);
+	memset(grid, 0, sizeof (*grid));
+}
+
 static const elec_comp_t *
 hit_test(libelec_vis_t *vis, int x, int y)
 {
+	const vis_grid_t *grid;
 	vect2_t mouse;
+	unsigned cx, cy, cell;
+
 	ASSERT(vis != NULL);
+	grid = &vis->grid;
 
 	mouse = cursor_coords_xlate(vis, x, y);
-
-	for (const elec_comp_t *comp = list_head(&vis->sys->comps);
-	    comp != NULL; comp = list_next(&vis->sys->comps, comp)) {
-		vect2_t pos, sz;
-
-		pos = comp->info->gui.pos;
-		if (IS_NULL_VECT(pos) || comp->info->gui.virt ||
-		    comp->info->gui.invis) {
-			continue;
-		}
-		sz = comp_info2sz(comp->info);
-		if (mouse.x >= pos.x - sz.x / 2 &&
-		    mouse.x < pos.x + sz.x / 2 &&
-		    mouse.y >= pos.y - sz.y / 2 &&
-		    mouse.y < pos.y + sz.y / 2) {
+	if (mouse.x < grid->min.x || mouse.y < grid->min.y)
+		return (NULL);
+	cx = (mouse.x - grid->min.x) / grid->cell_sz;
+	cy = (mouse.y - grid->min.y) / grid->cell_sz;
+	if (cx >= grid->nx || cy >= grid->ny)
+		return (NULL);
+	cell = cy * grid->nx + cx;
+
+	for (unsigned i = grid->cell_start[cell];
+	    i < grid->cell_start[cell + 1]; i++) {
+		const elec_comp_t *comp = grid->comps[i];
+		vect2_t min, max;
+
+		VERIFY(comp_hit_box(comp, &min, &max));
+		if (mouse.x >= min.x && mouse.x < max.x &&
+		    mouse.y >= min.y && mouse.y < max.y) {
 			return (comp);
 		}
 	}
@@ -166,46 +493,874 @@ draw_selected(cairo_t *cr, libelec_vis_t *vis)
 	mutex_exit(&vis->lock);
 }
 
+static bool
+layer_is_static(elec_draw_layer_t layer)
+{
+	return (layer == ELEC_DRAW_LAYER_WIRING ||
+	    layer == ELEC_DRAW_LAYER_COMPS);
+}
+
 static void
-render_cb(cairo_t *cr, unsigned w, unsigned h, void *userinfo)
+select_font(cairo_t *cr)
+{
+	ASSERT(cr != NULL);
+	cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL,
+	    CAIRO_FONT_WEIGHT_NORMAL);
+}
+
+static void
+tiles_free(vis_tiles_t *tiles)
+{
+	ASSERT(tiles != NULL);
+
+	for (unsigned i = 0; i < tiles->n_tiles; i++) {
+		cairo_destroy(tiles->tiles[i].cr);
+		cairo_surface_destroy(tiles->tiles[i].img);
+	}
+	ELEC_ZERO_FREE_N(tiles->tiles, tiles->n_tiles);
+	memset(tiles, 0, sizeof (*tiles));
+}
+
+/*
+ * Splits an image of `w' x `h' pixels into `n_tiles' bands of roughly
+ * equal height, unless that's how it is already split up.
+ */
+static void
+tiles_setup(vis_tiles_t *tiles, int w, int h, unsigned n_tiles)
+{
+	ASSERT(tiles != NULL);
+	ASSERT3S(w, >, 0);
+	ASSERT3S(h, >=, (int)n_tiles);
+	ASSERT(n_tiles != 0);
+
+	if (tiles->w == w && tiles->h == h && tiles->n_tiles == n_tiles)
+		return;
+	tiles_free(tiles);
+	tiles->tiles = elec_calloc(n_tiles, sizeof (*tiles->tiles));
+	tiles->n_tiles = n_tiles;
+	tiles->w = w;
+	tiles->h = h;
+	for (unsigned i = 0; i < n_tiles; i++) {
+		vis_tile_t *tile = &tiles->tiles[i];
+
+		tile->y = (int)(((uint64_t)h * i) / n_tiles);
+		tile->h = (int)(((uint64_t)h * (i + 1)) / n_tiles) - tile->y;
+		tile->img = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+		    w, tile->h);
+		cairo_surface_set_device_offset(tile->img, 0, -tile->y);
+		tile->cr = cairo_create(tile->img);
+	}
+}
+
+/*
+ * Keeps picking up unrendered bands of the current job until there are
+ * none left. This is run by the tile threads, as well as the render
+ * thread which submitted the job.
+ */
+static void
+tiles_run(libelec_vis_t *vis)
 {
+	ASSERT(vis != NULL);
+
+	for (;;) {
+		unsigned i;
+		vis_tile_t *tile;
+
+		mutex_enter(&vis->tile.lock);
+		i = vis->tile.next_tile++;
+		mutex_exit(&vis->tile.lock);
+
+		if (i >= vis->tile.tiles->n_tiles)
+			break;
+		tile = &vis->tile.tiles->tiles[i];
+		cairo_save(tile->cr);
+		cairo_set_operator(tile->cr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(tile->cr);
+		cairo_set_operator(tile->cr, CAIRO_OPERATOR_OVER);
+		select_font(tile->cr);
+		vis->tile.draw(vis, tile->cr, vis->tile.arg);
+		cairo_restore(tile->cr);
+		cairo_surface_flush(tile->img);
+	}
+}
+
+static void
+tile_thread(void *userinfo)
+{
+	vis_tile_thr_t *thr;
 	libelec_vis_t *vis;
 
-	ASSERT(cr != NULL);
-	UNUSED(w);
-	UNUSED(h);
 	ASSERT(userinfo != NULL);
-	vis = userinfo;
+	thr = userinfo;
+	vis = thr->vis;
+	thread_set_name("elec_vis_tile");
+
+	mutex_enter(&vis->tile.lock);
+	for (;;) {
+		while (!vis->tile.shutdown && thr->job == vis->tile.job)
+			cv_wait(&vis->tile.work_cv, &vis->tile.lock);
+		if (vis->tile.shutdown)
+			break;
+		thr->job = vis->tile.job;
+		mutex_exit(&vis->tile.lock);
+
+		tiles_run(vis);
+
+		mutex_enter(&vis->tile.lock);
+		ASSERT(vis->tile.n_running != 0);
+		vis->tile.n_running--;
+		if (vis->tile.n_running == 0)
+			cv_broadcast(&vis->tile.done_cv);
+	}
+	mutex_exit(&vis->tile.lock);
+}
 
-	cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL,
-	    CAIRO_FONT_WEIGHT_NORMAL);
+static void
+tile_threads_fini(libelec_vis_t *vis)
+{
+	ASSERT(vis != NULL);
+	ASSERT_MUTEX_HELD(&vis->tile.job_lock);
+
+	if (vis->tile.threads == NULL)
+		return;
+	mutex_enter(&vis->tile.lock);
+	vis->tile.shutdown = true;
+	cv_broadcast(&vis->tile.work_cv);
+	mutex_exit(&vis->tile.lock);
+	for (unsigned i = 0; i < vis->tile.n_threads; i++)
+		thread_join(&vis->tile.threads[i].thread);
+	ELEC_ZERO_FREE_N(vis->tile.threads, vis->tile.n_threads);
+	vis->tile.n_threads = 0;
+	vis->tile.shutdown = false;
+}
+
+/*
+ * Renders an image of `w' x `h' pixels into `cr', by calling `draw' to
+ * draw the whole image. Large images are split into bands, which are
+ * rasterized in parallel by the tile threads into the images held in
+ * `tiles', and then copied into `cr' (replacing its previous contents).
+ * Otherwise, `draw' is simply called on `cr' directly.
+ */
+static void
+tiles_render(libelec_vis_t *vis, vis_tiles_t *tiles, cairo_t *cr, int w,
+    int h, vis_tile_draw_t draw, const void *arg)
+{
+	unsigned n_tiles;
 
+	ASSERT(vis != NULL);
+	ASSERT(tiles != NULL);
+	ASSERT(cr != NULL);
+	ASSERT(draw != NULL);
+
+	mutex_enter(&vis->tile.job_lock);
+	n_tiles = MIN((vis->tile.n_threads + 1) * TILES_PER_THREAD,
+	    (unsigned)MAX(h, 1));
+	if (vis->tile.n_threads == 0 || (int64_t)w * h < TILE_MIN_PIXELS) {
+		mutex_exit(&vis->tile.job_lock);
+		tiles_free(tiles);
+		cairo_save(cr);
+		select_font(cr);
+		draw(vis, cr, arg);
+		cairo_restore(cr);
+		return;
+	}
+	tiles_setup(tiles, w, h, n_tiles);
+
+	mutex_enter(&vis->tile.lock);
+	vis->tile.tiles = tiles;
+	vis->tile.draw = draw;
+	vis->tile.arg = arg;
+	vis->tile.next_tile = 0;
+	vis->tile.n_running = vis->tile.n_threads;
+	vis->tile.job++;
+	cv_broadcast(&vis->tile.work_cv);
+	mutex_exit(&vis->tile.lock);
+
+	tiles_run(vis);
+
+	mutex_enter(&vis->tile.lock);
+	while (vis->tile.n_running != 0)
+		cv_wait(&vis->tile.done_cv, &vis->tile.lock);
+	vis->tile.tiles = NULL;
+	vis->tile.draw = NULL;
+	vis->tile.arg = NULL;
+	mutex_exit(&vis->tile.lock);
+	mutex_exit(&vis->tile.job_lock);
+
+	cairo_save(cr);
 	cairo_identity_matrix(cr);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	for (unsigned i = 0; i < tiles->n_tiles; i++) {
+		const vis_tile_t *tile = &tiles->tiles[i];
+
+		cairo_set_source_surface(cr, tile->img, 0, 0);
+		cairo_rectangle(cr, 0, tile->y, w, tile->h);
+		cairo_fill(cr);
+	}
+	cairo_restore(cr);
+}
+
+static void
+cache_free(libelec_vis_t *vis)
+{
+	ASSERT(vis != NULL);
+
+	for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+		if (vis->cache.img[i] != NULL) {
+			cairo_surface_destroy(vis->cache.img[i]);
+			vis->cache.img[i] = NULL;
+		}
+	}
+	tiles_free(&vis->cache.tiles);
+	vis->cache.zoom = 0;
+}
+
+static void
+cache_draw(libelec_vis_t *vis, cairo_t *cr, const void *arg)
+{
+	const elec_draw_layer_t *layer;
 
-	cairo_translate(cr, w / 2, h / 2);
-	cairo_translate(cr, vis->offset.x, vis->offset.y);
+	ASSERT(vis != NULL);
+	ASSERT(cr != NULL);
+	ASSERT(arg != NULL);
+	layer = arg;
+
+	cairo_identity_matrix(cr);
+	cairo_translate(cr, -vis->cache.x, -vis->cache.y);
 	cairo_scale(cr, vis->zoom, vis->zoom);
+	libelec_draw_layout_layer(vis->sys, cr, vis->pos_scale,
+	    vis->font_sz, *layer);
+}
+
+/*
+ * Makes sure the cached static layers cover the visible part of the
+ * layout at the current zoom level. `org_x' and `org_y' are the window
+ * coordinates of the layout origin.
+ */
+static void
+cache_update(libelec_vis_t *vis, unsigned w, unsigned h, int org_x, int org_y)
+{
+	int view_x = -org_x, view_y = -org_y;
+	int margin_x = w * CACHE_MARGIN, margin_y = h * CACHE_MARGIN;
+
+	ASSERT(vis != NULL);
+
+	if (vis->cache.zoom == vis->zoom &&
+	    view_x >= vis->cache.x && view_y >= vis->cache.y &&
+	    view_x + (int)w <= vis->cache.x + vis->cache.w &&
+	    view_y + (int)h <= vis->cache.y + vis->cache.h) {
+		return;
+	}
+	vis->cache.zoom = vis->zoom;
+	vis->cache.x = view_x - margin_x;
+	vis->cache.y = view_y - margin_y;
+	vis->cache.w = w + 2 * margin_x;
+	vis->cache.h = h + 2 * margin_y;
+
+	for (elec_draw_layer_t i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+		cairo_t *cr;
+
+		if (!layer_is_static(i))
+			continue;
+		if (vis->cache.img[i] != NULL)
+			cairo_surface_destroy(vis->cache.img[i]);
+		vis->cache.img[i] = cairo_image_surface_create(
+		    CAIRO_FORMAT_ARGB32, vis->cache.w, vis->cache.h);
+		cr = cairo_create(vis->cache.img[i]);
+		tiles_render(vis, &vis->cache.tiles, cr, vis->cache.w,
+		    vis->cache.h, cache_draw, &i);
+		cairo_destroy(cr);
+	}
+}
+
+static void
+retained_free(vis_retained_t *rt)
+{
+	ASSERT(rt != NULL);
+
+	if (rt->cr != NULL)
+		cairo_destroy(rt->cr);
+	if (rt->img != NULL)
+		cairo_surface_destroy(rt->img);
+	elec_free(rt->hashes);
+	tiles_free(&rt->tiles);
+	memset(rt, 0, sizeof (*rt));
+}
+
+/*
+ * Draws the contents of a retained image into `cr', which has been
+ * clipped to the area to be redrawn. With `layer' < 0, this is the
+ * entire view, otherwise just the given dynamic layer.
+ */
+static void
+retained_draw(libelec_vis_t *vis, cairo_t *cr, int layer, int org_x,
+    int org_y)
+{
+	ASSERT(vis != NULL);
+	ASSERT(cr != NULL);
+
+	cairo_identity_matrix(cr);
+	if (layer >= 0) {
+		cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(cr);
+		cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+		cairo_translate(cr, org_x, org_y);
+		cairo_scale(cr, vis->zoom, vis->zoom);
+		libelec_draw_layout_layer(vis->sys, cr, vis->pos_scale,
+		    vis->font_sz, layer);
+		return;
+	}
 	cairo_set_source_rgb(cr, 1, 1, 1);
 	cairo_paint(cr);
-	libelec_draw_layout(vis->sys, cr, vis->pos_scale, vis->font_sz);
+	for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+		cairo_identity_matrix(cr);
+		if (layer_is_static(i)) {
+			cairo_set_source_surface(cr, vis->cache.img[i],
+			    org_x + vis->cache.x, org_y + vis->cache.y);
+			cairo_paint(cr);
+		} else {
+			cairo_translate(cr, org_x, org_y);
+			cairo_scale(cr, vis->zoom, vis->zoom);
+			libelec_draw_layout_layer(vis->sys, cr,
+			    vis->pos_scale, vis->font_sz, i);
+		}
+	}
+}
+
+typedef struct {
+	int	layer;
+	int	org_x, org_y;
+} vis_retained_args_t;
+
+static void
+retained_draw_tile(libelec_vis_t *vis, cairo_t *cr, const void *arg)
+{
+	const vis_retained_args_t *args;
+
+	ASSERT(arg != NULL);
+	args = arg;
+	retained_draw(vis, cr, args->layer, args->org_x, args->org_y);
+}
+
+/*
+ * Brings a retained image up to date, see vis_retained_t. `org_x' and
+ * `org_y' are the window coordinates of the layout origin. See
+ * retained_draw() for `layer'. If `changed' isn't NULL, the parts of
+ * the image which have been redrawn are added to it.
+ */
+static void
+retained_update(libelec_vis_t *vis, vis_retained_t *rt, unsigned w,
+    unsigned h, int org_x, int org_y, int layer, cairo_region_t *changed)
+{
+	cairo_region_t *dirty;
+	unsigned i = 0;
+	int n_rects;
+	bool full;
+
+	ASSERT(vis != NULL);
+	ASSERT(rt != NULL);
+
+	if (rt->img == NULL ||
+	    cairo_image_surface_get_width(rt->img) != (int)w ||
+	    cairo_image_surface_get_height(rt->img) != (int)h) {
+		retained_free(rt);
+		rt->img = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+		    w, h);
+		rt->cr = cairo_create(rt->img);
+		rt->hashes = elec_calloc(MAX(libelec_get_num_comps(vis->sys),
+		    1), sizeof (*rt->hashes));
+	}
+	full = (rt->zoom != vis->zoom || rt->org_x != org_x ||
+	    rt->org_y != org_y);
+	dirty = cairo_region_create();
+	for (const elec_comp_t *comp = list_head(&vis->sys->comps);
+	    comp != NULL; comp = list_next(&vis->sys->comps, comp), i++) {
+		uint64_t hash = libelec_draw_get_comp_state_hash(comp);
+		vect2_t min, max;
+		cairo_rectangle_int_t rect;
+
+		if (hash == rt->hashes[i])
+			continue;
+		rt->hashes[i] = hash;
+		if (full || !libelec_draw_get_comp_bbox(comp, vis->pos_scale,
+		    vis->font_sz, &min, &max)) {
+			continue;
+		}
+		rect.x = floor(org_x + min.x * vis->zoom) - DIRTY_MARGIN;
+		rect.y = floor(org_y + min.y * vis->zoom) - DIRTY_MARGIN;
+		rect.width = ceil(org_x + max.x * vis->zoom) + DIRTY_MARGIN -
+		    rect.x;
+		rect.height = ceil(org_y + max.y * vis->zoom) + DIRTY_MARGIN -
+		    rect.y;
+		cairo_region_union_rectangle(dirty, &rect);
+	}
+	n_rects = cairo_region_num_rectangles(dirty);
+	if (!full && n_rects == 0) {
+		cairo_region_destroy(dirty);
+		return;
+	}
+	if (!full && n_rects <= DIRTY_MAX_RECTS) {
+		cairo_save(rt->cr);
+		for (int j = 0; j < n_rects; j++) {
+			cairo_rectangle_int_t rect;
+
+			cairo_region_get_rectangle(dirty, j, &rect);
+			cairo_rectangle(rt->cr, rect.x, rect.y, rect.width,
+			    rect.height);
+		}
+		cairo_clip(rt->cr);
+		select_font(rt->cr);
+		retained_draw(vis, rt->cr, layer, org_x, org_y);
+		cairo_restore(rt->cr);
+		if (changed != NULL)
+			cairo_region_union(changed, dirty);
+	} else {
+		vis_retained_args_t args = {
+		    .layer = layer, .org_x = org_x, .org_y = org_y
+		};
+		tiles_render(vis, &rt->tiles, rt->cr, w, h, retained_draw_tile,
+		    &args);
+		if (changed != NULL) {
+			cairo_rectangle_int_t all = { 0, 0, w, h };
+
+			cairo_region_union_rectangle(changed, &all);
+		}
+	}
+	cairo_region_destroy(dirty);
+
+	rt->zoom = vis->zoom;
+	rt->org_x = org_x;
+	rt->org_y = org_y;
+}
+
+/*
+ * Copies a retained image into the output of a renderer.
+ */
+static void
+retained_paint(cairo_t *cr, const vis_retained_t *rt)
+{
+	ASSERT(cr != NULL);
+	ASSERT(rt != NULL);
+	ASSERT(rt->img != NULL);
+
+	cairo_identity_matrix(cr);
+	cairo_set_source_surface(cr, rt->img, 0, 0);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	cairo_paint(cr);
+	cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+}
+
+/*
+ * Paints a preview of the view from the images of the last full
+ * rendering, scaled and moved to the current zoom level and position.
+ * This costs about as much as retained_paint(), no matter how large the
+ * network is, so it's what we show while the view is being panned or
+ * zoomed. With `cached' set, the parts of the view which weren't
+ * visible before are filled in from the cached static layers, otherwise
+ * they're left transparent.
+ * @return False if there is no previous rendering to work with, in
+ *	which case the caller must render the view in full.
+ */
+static bool
+preview_paint(libelec_vis_t *vis, cairo_t *cr, const vis_retained_t *rt,
+    unsigned w, unsigned h, int org_x, int org_y, bool cached)
+{
+	double scale;
+
+	ASSERT(vis != NULL);
+	ASSERT(cr != NULL);
+	ASSERT(rt != NULL);
+
+	if (rt->img == NULL || rt->zoom == 0 ||
+	    cairo_image_surface_get_width(rt->img) != (int)w ||
+	    cairo_image_surface_get_height(rt->img) != (int)h ||
+	    (cached && vis->cache.zoom == 0)) {
+		return (false);
+	}
+	cairo_identity_matrix(cr);
+	if (cached) {
+		cairo_set_source_rgb(cr, 1, 1, 1);
+		cairo_paint(cr);
+		scale = vis->zoom / vis->cache.zoom;
+		for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+			if (!layer_is_static(i))
+				continue;
+			cairo_save(cr);
+			cairo_translate(cr, org_x, org_y);
+			cairo_scale(cr, scale, scale);
+			cairo_set_source_surface(cr, vis->cache.img[i],
+			    vis->cache.x, vis->cache.y);
+			cairo_pattern_set_filter(cairo_get_source(cr),
+			    CAIRO_FILTER_FAST);
+			cairo_paint(cr);
+			cairo_restore(cr);
+		}
+	} else {
+		cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(cr);
+		cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+	}
+	scale = vis->zoom / rt->zoom;
+	cairo_save(cr);
+	cairo_translate(cr, org_x, org_y);
+	cairo_scale(cr, scale, scale);
+	cairo_set_source_surface(cr, rt->img, -rt->org_x, -rt->org_y);
+	cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_FAST);
+	cairo_rectangle(cr, -rt->org_x, -rt->org_y, w, h);
+	cairo_fill(cr);
+	cairo_restore(cr);
+
+	return (true);
+}
+
+static bool
+preview_get(libelec_vis_t *vis)
+{
+	bool preview;
+
+	ASSERT(vis != NULL);
+	mutex_enter(&vis->lock);
+	preview = vis->preview;
+	mutex_exit(&vis->lock);
+
+	return (preview);
+}
+
+static void
+render_cb(cairo_t *cr, unsigned w, unsigned h, void *userinfo)
+{
+	libelec_vis_t *vis;
+	int org_x, org_y;
+
+	ASSERT(cr != NULL);
+	ASSERT(userinfo != NULL);
+	vis = userinfo;
+	/*
+	 * The layout origin is snapped to whole pixels, so that the cached
+	 * static layers line up exactly with the dynamic layers drawn
+	 * directly on top of them.
+	 */
+	org_x = round(w / 2 + vis->offset.x);
+	org_y = round(h / 2 + vis->offset.y);
+	if (!preview_get(vis) || !preview_paint(vis, cr, &vis->retained,
+	    w, h, org_x, org_y, true)) {
+		cache_update(vis, w, h, org_x, org_y);
+		retained_update(vis, &vis->retained, w, h, org_x, org_y, -1,
+		    NULL);
+		retained_paint(cr, &vis->retained);
+	}
+	select_font(cr);
+	cairo_identity_matrix(cr);
+	cairo_translate(cr, org_x, org_y);
+	cairo_scale(cr, vis->zoom, vis->zoom);
 
 	draw_highlight(cr, vis);
 	draw_selected(cr, vis);
 }
 
+static void
+fini_cb(cairo_t *cr, void *userinfo)
+{
+	libelec_vis_t *vis;
+
+	UNUSED(cr);
+	ASSERT(userinfo != NULL);
+	vis = userinfo;
+	cache_free(vis);
+	retained_free(&vis->retained);
+}
+
+typedef struct {
+	elec_draw_layer_t	layer;
+	vis_cache_geom_t	want;
+} vis_static_args_t;
+
+static void
+gl_static_draw(libelec_vis_t *vis, cairo_t *cr, const void *arg)
+{
+	const vis_static_args_t *args;
+
+	ASSERT(vis != NULL);
+	ASSERT(cr != NULL);
+	ASSERT(arg != NULL);
+	args = arg;
+
+	cairo_identity_matrix(cr);
+	if (args->layer == ELEC_DRAW_LAYER_WIRING) {
+		/* The bottom layer provides the background */
+		cairo_set_source_rgb(cr, 1, 1, 1);
+		cairo_paint(cr);
+	} else {
+		cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(cr);
+		cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+	}
+	cairo_translate(cr, -args->want.x, -args->want.y);
+	cairo_scale(cr, args->want.zoom, args->want.zoom);
+	libelec_draw_layout_layer(vis->sys, cr, vis->pos_scale, vis->font_sz,
+	    args->layer);
+}
+
+static void
+gl_static_render_cb(cairo_t *cr, unsigned w, unsigned h, void *userinfo)
+{
+	const vis_layer_ref_t *ref;
+	libelec_vis_t *vis;
+	vis_cache_geom_t want;
+	vis_static_args_t args;
+
+	ASSERT(cr != NULL);
+	ASSERT(userinfo != NULL);
+	ref = userinfo;
+	vis = ref->vis;
+
+	mutex_enter(&vis->lock);
+	want = vis->gl.want;
+	mutex_exit(&vis->lock);
+	/* The renderer is recreated whenever the cached area resizes */
+	if (want.zoom == 0 || want.w != (int)w || want.h != (int)h)
+		return;
+
+	args.layer = ref->layer;
+	args.want = want;
+	tiles_render(vis, &vis->gl.tiles[ref->layer], cr, w, h,
+	    gl_static_draw, &args);
+
+	mutex_enter(&vis->lock);
+	vis->gl.have[ref->layer] = want;
+	mutex_exit(&vis->lock);
+}
+
+static void
+gl_dyn_render_cb(cairo_t *cr, unsigned w, unsigned h, void *userinfo)
+{
+	const vis_layer_ref_t *ref;
+	libelec_vis_t *vis;
+	int org_x, org_y;
+
+	ASSERT(cr != NULL);
+	ASSERT(userinfo != NULL);
+	ref = userinfo;
+	vis = ref->vis;
+	/* Must line up with the static layers, see render_cb() */
+	org_x = round(w / 2 + vis->offset.x);
+	org_y = round(h / 2 + vis->offset.y);
+
+	if (!preview_get(vis) || !preview_paint(vis, cr,
+	    &vis->gl.retained[ref->layer], w, h, org_x, org_y, false)) {
+		retained_update(vis, &vis->gl.retained[ref->layer], w, h,
+		    org_x, org_y, ref->layer, NULL);
+		retained_paint(cr, &vis->gl.retained[ref->layer]);
+	}
+	select_font(cr);
+	if (ref->layer == ELEC_DRAW_NUM_LAYERS - 1) {
+		cairo_translate(cr, org_x, org_y);
+		cairo_scale(cr, vis->zoom, vis->zoom);
+		draw_highlight(cr, vis);
+		draw_selected(cr, vis);
+	}
+}
+
+static void
+gl_fini_cb(cairo_t *cr, void *userinfo)
+{
+	const vis_layer_ref_t *ref;
+
+	UNUSED(cr);
+	ASSERT(userinfo != NULL);
+	ref = userinfo;
+	retained_free(&ref->vis->gl.retained[ref->layer]);
+	tiles_free(&ref->vis->gl.tiles[ref->layer]);
+}
+
+static void
+gl_fini(libelec_vis_t *vis)
+{
+	ASSERT(vis != NULL);
+
+	for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+		if (vis->gl.mtcr[i] != NULL) {
+			mt_cairo_render_fini(vis->gl.mtcr[i]);
+			vis->gl.mtcr[i] = NULL;
+		}
+	}
+	mutex_enter(&vis->lock);
+	memset(&vis->gl.want, 0, sizeof (vis->gl.want));
+	memset(vis->gl.have, 0, sizeof (vis->gl.have));
+	mutex_exit(&vis->lock);
+}
+
+/*
+ * GL backend counterpart of cache_update(), run on the main thread.
+ * Kicks off a new rendering of the static layers if the cached area
+ * doesn't cover the window at the current zoom level.
+ */
+static void
+gl_cache_update(libelec_vis_t *vis)
+{
+	int left, top, right, bottom, w, h, org_x, org_y, view_x, view_y;
+	vis_cache_geom_t want;
+
+	ASSERT(vis != NULL);
+
+	XPLMGetWindowGeometry(vis->win, &left, &top, &right, &bottom);
+	w = right - left;
+	h = top - bottom;
+	org_x = round(w / 2 + vis->offset.x);
+	org_y = round(h / 2 + vis->offset.y);
+	view_x = -org_x;
+	view_y = -org_y;
+
+	want = vis->gl.want;
+	if (want.zoom == vis->zoom &&
+	    view_x >= want.x && view_y >= want.y &&
+	    view_x + w <= want.x + want.w && view_y + h <= want.y + want.h) {
+		return;
+	}
+	want.zoom = vis->zoom;
+	want.x = view_x - w * CACHE_MARGIN;
+	want.y = view_y - h * CACHE_MARGIN;
+	want.w = w + 2 * (int)(w * CACHE_MARGIN);
+	want.h = h + 2 * (int)(h * CACHE_MARGIN);
+	mutex_enter(&vis->lock);
+	vis->gl.want = want;
+	mutex_exit(&vis->lock);
+
+	for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+		if (!layer_is_static(i))
+			continue;
+		if (vis->gl.mtcr[i] != NULL &&
+		    (mt_cairo_render_get_width(vis->gl.mtcr[i]) !=
+		    (unsigned)want.w ||
+		    mt_cairo_render_get_height(vis->gl.mtcr[i]) !=
+		    (unsigned)want.h)) {
+			mt_cairo_render_fini(vis->gl.mtcr[i]);
+			vis->gl.mtcr[i] = NULL;
+			mutex_enter(&vis->lock);
+			memset(&vis->gl.have[i], 0, sizeof (vis->gl.have[i]));
+			mutex_exit(&vis->lock);
+		}
+		if (vis->gl.mtcr[i] == NULL) {
+			vis->gl.mtcr[i] = mt_cairo_render_init(want.w, want.h,
+			    0, NULL, gl_static_render_cb, gl_fini_cb,
+			    &vis->gl.refs[i]);
+		}
+		mt_cairo_render_once(vis->gl.mtcr[i]);
+	}
+}
+
+/*
+ * Composites the visible part of a static layer image, scaled from the
+ * zoom level it was rendered at to the current one.
+ */
+static void
+gl_draw_static(libelec_vis_t *vis, elec_draw_layer_t layer, int left,
+    int bottom, int w, int h)
+{
+	vis_cache_geom_t have;
+	double scale, x0, y0, x1, y1, cx0, cy0, cx1, cy1;
+	int org_x, org_y;
+
+	ASSERT(vis != NULL);
+
+	if (vis->gl.mtcr[layer] == NULL)
+		return;
+	mutex_enter(&vis->lock);
+	have = vis->gl.have[layer];
+	mutex_exit(&vis->lock);
+	if (have.zoom == 0)
+		return;
+
+	org_x = round(w / 2 + vis->offset.x);
+	org_y = round(h / 2 + vis->offset.y);
+	scale = vis->zoom / have.zoom;
+	/* Window rectangle of the image, with Y pointing down */
+	x0 = org_x + have.x * scale;
+	y0 = org_y + have.y * scale;
+	x1 = x0 + have.w * scale;
+	y1 = y0 + have.h * scale;
+	cx0 = MAX(x0, 0);
+	cy0 = MAX(y0, 0);
+	cx1 = MIN(x1, w);
+	cy1 = MIN(y1, h);
+	if (cx1 <= cx0 || cy1 <= cy0)
+		return;
+	mt_cairo_render_draw_subrect(vis->gl.mtcr[layer],
+	    VECT2((cx0 - x0) / scale, (cy0 - y0) / scale),
+	    VECT2((cx1 - cx0) / scale, (cy1 - cy0) / scale),
+	    VECT2(left + cx0, bottom + (h - cy1)), VECT2(cx1 - cx0, cy1 - cy0));
+}
+
 static void
 recreate_mtcr(libelec_vis_t *vis)
 {
 	int left, top, right, bottom;
 
 	ASSERT(vis != NULL);
+	ASSERT(vis->win != NULL);
+	XPLMGetWindowGeometry(vis->win, &left, &top, &right, &bottom);
 
+	if (vis->backend == LIBELEC_VIS_BACKEND_GL) {
+		/* The static layers follow in gl_cache_update() */
+		for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+			if (layer_is_static(i))
+				continue;
+			if (vis->gl.mtcr[i] != NULL)
+				mt_cairo_render_fini(vis->gl.mtcr[i]);
+			vis->gl.mtcr[i] = mt_cairo_render_init(right - left,
+			    top - bottom, 0, NULL, gl_dyn_render_cb,
+			    gl_fini_cb, &vis->gl.refs[i]);
+		}
+		gl_cache_update(vis);
+		vis->dirty = true;
+		return;
+	}
 	if (vis->mtcr != NULL)
 		mt_cairo_render_fini(vis->mtcr);
-	ASSERT(vis->win != NULL);
-	XPLMGetWindowGeometry(vis->win, &left, &top, &right, &bottom);
-	vis->mtcr = mt_cairo_render_init(right - left, top - bottom, WIN_FPS,
-	    NULL, render_cb, NULL, vis);
+	/* Frames are only rendered on demand from vis_floop_cb */
+	vis->mtcr = mt_cairo_render_init(right - left, top - bottom, 0,
+	    NULL, render_cb, fini_cb, vis);
+	vis->dirty = true;
+}
+
+/*
+ * Renders a new frame of the dynamic parts of the view (or the entire
+ * view with the cairo backend).
+ */
+static void
+render_once(libelec_vis_t *vis, bool wait)
+{
+	ASSERT(vis != NULL);
+
+	if (vis->backend == LIBELEC_VIS_BACKEND_GL) {
+		/* gl_draw_static() scales the old images while previewing */
+		if (!vis->preview)
+			gl_cache_update(vis);
+		for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+			if (layer_is_static(i))
+				continue;
+			if (wait)
+				mt_cairo_render_once_wait(vis->gl.mtcr[i]);
+			else
+				mt_cairo_render_once(vis->gl.mtcr[i]);
+		}
+	} else if (wait) {
+		mt_cairo_render_once_wait(vis->mtcr);
+	} else {
+		mt_cairo_render_once(vis->mtcr);
+	}
+}
+
+static void
+renderers_fini(libelec_vis_t *vis)
+{
+	ASSERT(vis != NULL);
+
+	if (vis->mtcr != NULL) {
+		mt_cairo_render_fini(vis->mtcr);
+		vis->mtcr = NULL;
+	}
+	gl_fini(vis);
 }
 
 static int
@@ -230,18 +1385,18 @@ win_click(XPLMWindowID win, int x, int y, XPLMMouseStatus mouse, void *refcon)
 	vis->offset = vect2_add(vis->offset, off);
 	vis->mouse_prev = VECT2(x_rel, y_rel);
 
-	/* Increase rendering rate while dragging */
-	if (mouse == xplm_MouseDown || mouse == xplm_MouseDrag) {
-		if (mt_cairo_render_get_fps(vis->mtcr) != WIN_FPS_FAST)
-			mt_cairo_render_set_fps(vis->mtcr, WIN_FPS_FAST);
-	} else {
-		mt_cairo_render_set_fps(vis->mtcr, WIN_FPS);
+	if (!IS_ZERO_VECT2(off)) {
+		vis->dirty = true;
+		vis->interact_t = microclock();
 	}
+	/* Increase rendering rate while dragging */
+	vis->dragging = (mouse == xplm_MouseDown || mouse == xplm_MouseDrag);
 	if (mouse == xplm_MouseUp &&
 	    vect2_abs(vect2_sub(vis->mouse_down, vis->mouse_prev)) < 4) {
 		mutex_enter(&vis->lock);
 		vis->selected = hit_test(vis, x, y);
 		mutex_exit(&vis->lock);
+		vis->dirty = true;
 	}
 
 	return (1);
@@ -284,6 +1439,8 @@ win_wheel(XPLMWindowID win, int x, int y, int wheel, int clicks, void *refcon)
 		vis->zoom /= 1.25;
 		vis->offset = vect2_scmul(vis->offset, 1.0 / 1.25);
 	}
+	vis->dirty = true;
+	vis->interact_t = microclock();
 
 	return (1);
 }
@@ -301,6 +1458,25 @@ win_draw(XPLMWindowID win, void *refcon)
 	XPLMGetWindowGeometry(vis->win, &left, &top, &right, &bottom);
 	w = right - left;
 	h = top - bottom;
+	if (vis->backend == LIBELEC_VIS_BACKEND_GL) {
+		mt_cairo_render_t *top_mtcr =
+		    vis->gl.mtcr[ELEC_DRAW_NUM_LAYERS - 1];
+
+		ASSERT(top_mtcr != NULL);
+		if (w != (int)mt_cairo_render_get_width(top_mtcr) ||
+		    h != (int)mt_cairo_render_get_height(top_mtcr)) {
+			recreate_mtcr(vis);
+		}
+		for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+			if (layer_is_static(i)) {
+				gl_draw_static(vis, i, left, bottom, w, h);
+			} else {
+				mt_cairo_render_draw(vis->gl.mtcr[i],
+				    VECT2(left, bottom), VECT2(w, h));
+			}
+		}
+		return;
+	}
 	ASSERT(vis->mtcr != NULL);
 	if (w != (int)mt_cairo_render_get_width(vis->mtcr) ||
 	    h != (int)mt_cairo_render_get_height(vis->mtcr)) {
@@ -313,14 +1489,19 @@ static XPLMCursorStatus
 win_cursor(XPLMWindowID win, int x, int y, void *refcon)
 {
 	libelec_vis_t *vis;
+	const elec_comp_t *highlight;
 
 	ASSERT(win != NULL);
 	ASSERT(refcon != NULL);
 	vis = refcon;
 
-	mutex_enter(&vis->lock);
-	vis->highlight = hit_test(vis, x, y);
-	mutex_exit(&vis->lock);
+	highlight = hit_test(vis, x, y);
+	if (highlight != vis->highlight) {
+		mutex_enter(&vis->lock);
+		vis->highlight = highlight;
+		mutex_exit(&vis->lock);
+		vis->dirty = true;
+	}
 
 	return (xplm_CursorArrow);
 }
@@ -330,20 +1511,70 @@ vis_floop_cb(UNUSED_ATTR float unused1, UNUSED_ATTR float unused2,
     UNUSED_ATTR int unused3, void *refcon)
 {
 	libelec_vis_t *vis;
+	uint64_t hash;
+	bool preview;
 
 	ASSERT(refcon != NULL);
 	vis = refcon;
 
-	if (!libelec_vis_is_open(vis) && vis->mtcr != NULL) {
-		mt_cairo_render_fini(vis->mtcr);
-		vis->mtcr = NULL;
+	if (!libelec_vis_is_open(vis)) {
+		renderers_fini(vis);
 		/*
 		 * Stop the flight loop callback, we will reschedule it
 		 * again when the window is re-opened.
 		 */
 		return (0);
 	}
-	return (-1);
+	/*
+	 * An open component info screen shows live values, so we keep it
+	 * updating at the normal rate. Otherwise, we only render when the
+	 * view or the visible state of the network has changed, so a
+	 * parked window costs next to nothing. While the view is being
+	 * panned or zoomed, we only render previews and follow up with a
+	 * full rendering once the view has settled.
+	 */
+	hash = libelec_draw_get_state_hash(vis->sys);
+	preview = (microclock() - vis->interact_t < PREVIEW_DELAY);
+	if (vis->dirty || hash != vis->state_hash || vis->selected != NULL ||
+	    (vis->refine && !preview)) {
+		vis->dirty = false;
+		vis->state_hash = hash;
+		vis->refine = preview;
+		mutex_enter(&vis->lock);
+		vis->preview = preview;
+		mutex_exit(&vis->lock);
+		render_once(vis, false);
+	}
+	return (1.0 / (vis->dragging ? WIN_FPS_FAST : WIN_FPS));
+}
+
+/*
+ * Allocates and initializes the parts of a visualizer common to the
+ * windowed and offscreen ones.
+ */
+static libelec_vis_t *
+vis_alloc(const elec_sys_t *sys, double pos_scale, double font_sz)
+{
+	libelec_vis_t *vis = elec_calloc(1, sizeof (*vis));
+
+	ASSERT(sys != NULL);
+
+	libelec_sys_load_gui(sys);
+	vis->sys = sys;
+	for (int i = 0; i < ELEC_DRAW_NUM_LAYERS; i++) {
+		vis->gl.refs[i].vis = vis;
+		vis->gl.refs[i].layer = i;
+	}
+	vis->pos_scale = pos_scale;
+	vis->font_sz = font_sz;
+	vis->zoom = 1;
+	mutex_init(&vis->lock);
+	mutex_init(&vis->tile.job_lock);
+	mutex_init(&vis->tile.lock);
+	cv_init(&vis->tile.work_cv);
+	cv_init(&vis->tile.done_cv);
+
+	return (vis);
 }
 
 /**
@@ -369,7 +1600,23 @@ vis_floop_cb(UNUSED_ATTR float unused1, UNUSED_ATTR float unused2,
 libelec_vis_t *
 libelec_vis_new(const elec_sys_t *sys, double pos_scale, double font_sz)
 {
-	libelec_vis_t *vis = safe_calloc(1, sizeof (*vis));
+	return (libelec_vis_new_backend(sys, pos_scale, font_sz,
+	    LIBELEC_VIS_BACKEND_CAIRO));
+}
+
+/**
+ * Same as libelec_vis_new(), but lets you choose the rendering backend.
+ * On large displays showing large networks, \ref LIBELEC_VIS_BACKEND_GL
+ * saves most of the CPU rasterization and texture upload bandwidth of
+ * the default \ref LIBELEC_VIS_BACKEND_CAIRO, particularly while the
+ * user is panning around, at the cost of a few more textures in VRAM.
+ * @see libelec_vis_backend_t
+ */
+libelec_vis_t *
+libelec_vis_new_backend(const elec_sys_t *sys, double pos_scale,
+    double font_sz, libelec_vis_backend_t backend)
+{
+	libelec_vis_t *vis = vis_alloc(sys, pos_scale, font_sz);
 	XPLMCreateWindow_t cr = {
 	    .structSize = sizeof (cr),
 	    .left = 100,
@@ -391,15 +1638,10 @@ libelec_vis_new(const elec_sys_t *sys, double pos_scale, double font_sz)
 	    .refcon = vis
 	};
 
-	ASSERT(sys != NULL);
-
-	vis->sys = sys;
+	vis->backend = backend;
 	vis->win = XPLMCreateWindowEx(&cr);
 	ASSERT(vis->win != NULL);
-	vis->pos_scale = pos_scale;
-	vis->font_sz = font_sz;
-	vis->zoom = 1;
-	mutex_init(&vis->lock);
+	grid_build(&vis->grid, sys);
 	vis->floop = XPLMCreateFlightLoop(&floop);
 
 	XPLMSetWindowTitle(vis->win, "Electrical Network");
@@ -423,17 +1665,29 @@ libelec_vis_destroy(libelec_vis_t *vis)
 	if (vis->wk != NULL) {
 		ASSERT(vis->wk_name != NULL);
 		win_keeper_unregister(vis->wk, vis->wk_name, vis->wk_inst);
-		free(vis->wk_name);
+		elec_free(vis->wk_name);
 	}
 #endif	/* defined(LIBELEC_VIS_WITH_WIN_KEEPER) */
 
-	if (vis->mtcr != NULL)
-		mt_cairo_render_fini(vis->mtcr);
+	renderers_fini(vis);
+	/* Offscreen visualizers keep their images outside of a renderer */
+	cache_free(vis);
+	retained_free(&vis->retained);
+	mutex_enter(&vis->tile.job_lock);
+	tile_threads_fini(vis);
+	mutex_exit(&vis->tile.job_lock);
+	mutex_destroy(&vis->tile.job_lock);
+	mutex_destroy(&vis->tile.lock);
+	cv_destroy(&vis->tile.work_cv);
+	cv_destroy(&vis->tile.done_cv);
+	grid_free(&vis->grid);
 	mutex_destroy(&vis->lock);
-	XPLMDestroyWindow(vis->win);
-	XPLMDestroyFlightLoop(vis->floop);
+	if (vis->win != NULL) {
+		XPLMDestroyWindow(vis->win);
+		XPLMDestroyFlightLoop(vis->floop);
+	}
 
-	ZERO_FREE(vis);
+	ELEC_ZERO_FREE(vis);
 }
 
 #ifdef	LIBELEC_VIS_WITH_WIN_KEEPER
@@ -449,7 +1703,7 @@ libelec_vis_set_win_keeper(libelec_vis_t *vis, win_keeper_t *wk,
 	if (vis->wk != NULL) {
 		ASSERT(vis->wk_name != NULL);
 		win_keeper_unregister(vis->wk, vis->wk_name, vis->wk_inst);
-		free(vis->wk_name);
+		elec_free(vis->wk_name);
 		vis->wk = NULL;
 		vis->wk_name = NULL;
 		vis->wk_inst = 0;
@@ -457,7 +1711,7 @@ libelec_vis_set_win_keeper(libelec_vis_t *vis, win_keeper_t *wk,
 	if (wk != NULL) {
 		ASSERT(win_name != NULL);
 		vis->wk = wk;
-		vis->wk_name = safe_strdup(win_name);
+		vis->wk_name = elec_strdup(win_name);
 		vis->wk_inst = inst;
 	}
 }
@@ -476,6 +1730,7 @@ libelec_vis_set_offset(libelec_vis_t *vis, vect2_t offset)
 {
 	ASSERT(vis != NULL);
 	vis->offset = offset;
+	vis->dirty = true;
 }
 
 /**
@@ -488,6 +1743,213 @@ libelec_vis_get_offset(const libelec_vis_t *vis)
 	return (vis->offset);
 }
 
+/**
+ * Sets the zoom level of the view. Initially this is 1, which draws the
+ * network at the size given by `pos_scale` and `font_sz` (see
+ * libelec_vis_new()). The user can change the zoom level of a window
+ * using the mouse wheel, so this is mostly useful for offscreen
+ * visualizers (see libelec_vis_new_offscreen()). Please note that the
+ * panning offset is in pixels, so it isn't scaled along.
+ * @param zoom The zoom level to set. Must be greater than zero.
+ */
+void
+libelec_vis_set_zoom(libelec_vis_t *vis, double zoom)
+{
+	ASSERT(vis != NULL);
+	ASSERT3F(zoom, >, 0);
+	vis->zoom = zoom;
+	vis->dirty = true;
+}
+
+/**
+ * @return The current zoom level of the view.
+ */
+double
+libelec_vis_get_zoom(const libelec_vis_t *vis)
+{
+	ASSERT(vis != NULL);
+	return (vis->zoom);
+}
+
+/**
+ * Creates a visualizer without a window, which renders the network
+ * into a GL texture owned by the caller, see libelec_vis_render_tex().
+ * This is meant for showing the network on your own displays, such as
+ * synoptic pages in a glass cockpit. It uses the same caching as the
+ * visualizer window: the static layers are only rasterized when the
+ * zoom level changes, or the view is panned far away, and otherwise
+ * only the components whose visible state has changed are redrawn and
+ * uploaded. Select the part of the network to show using
+ * libelec_vis_set_offset() and libelec_vis_set_zoom(). You can also
+ * use libelec_vis_set_render_threads() to speed up full redraws.
+ *
+ * Since the visualizer has no window, you must not call
+ * libelec_vis_open(), libelec_vis_close(), libelec_vis_is_open() or
+ * libelec_vis_get_win() on it. Destroy it using libelec_vis_destroy().
+ * @param sys Same as in libelec_vis_new().
+ * @param pos_scale Same as in libelec_vis_new().
+ * @param font_sz Same as in libelec_vis_new().
+ */
+libelec_vis_t *
+libelec_vis_new_offscreen(const elec_sys_t *sys, double pos_scale,
+    double font_sz)
+{
+	return (vis_alloc(sys, pos_scale, font_sz));
+}
+
+/*
+ * Uploads the `w' x `h' pixel rectangle at `x', `y' of `img' into the
+ * same spot of the currently bound texture. Cairo's ARGB32 is BGRA in
+ * memory on all the little-endian platforms we run on.
+ */
+static void
+tex_upload(cairo_surface_t *img, int x, int y, int w, int h)
+{
+	const uint8_t *data;
+	int stride;
+
+	ASSERT(img != NULL);
+
+	data = cairo_image_surface_get_data(img);
+	stride = cairo_image_surface_get_stride(img);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_BGRA,
+	    GL_UNSIGNED_BYTE, data + (size_t)y * stride + (size_t)x * 4);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+/**
+ * Brings the view of an offscreen visualizer (see
+ * libelec_vis_new_offscreen()) in a GL texture up to date. Only the
+ * parts of the view which have changed since the last call are redrawn
+ * and uploaded, unless the texture, its size, the zoom level or the
+ * panning offset have changed since then, in which case the whole view
+ * is. If you want to render into a framebuffer, attach the texture to
+ * it. You must call this from the thread owning the GL context in
+ * which `tex` lives. It draws on that thread, so if a single full
+ * redraw takes too long, consider libelec_vis_set_render_threads().
+ *
+ * @param tex The texture to render into. Its storage is (re)allocated
+ *	as an RGBA texture of `w` x `h` texels without mipmaps (with
+ *	linear filtering) whenever the texture or its size change, so
+ *	you only need to create the texture name using glGenTextures().
+ *	The contents are alpha-premultiplied and
+ *	the first row of the texture is the top of the view, so flip the
+ *	texture coordinates vertically when drawing it.
+ * @param w Width of the view in pixels.
+ * @param h Height of the view in pixels.
+ * @return True if any part of the texture has been updated, false if
+ *	nothing visible has changed since the last call.
+ */
+bool
+libelec_vis_render_tex(libelec_vis_t *vis, GLuint tex, unsigned w,
+    unsigned h)
+{
+	cairo_region_t *changed;
+	int org_x, org_y, n_rects;
+	GLint old_tex;
+	bool full;
+
+	ASSERT(vis != NULL);
+	ASSERT3P(vis->win, ==, NULL);
+	ASSERT(tex != 0);
+	ASSERT(w != 0);
+	ASSERT(h != 0);
+
+	/* Same as in render_cb() */
+	org_x = round(w / 2 + vis->offset.x);
+	org_y = round(h / 2 + vis->offset.y);
+	cache_update(vis, w, h, org_x, org_y);
+	changed = cairo_region_create();
+	retained_update(vis, &vis->retained, w, h, org_x, org_y, -1,
+	    changed);
+	full = (vis->tex.id != tex || vis->tex.w != (int)w ||
+	    vis->tex.h != (int)h);
+	n_rects = cairo_region_num_rectangles(changed);
+	if (!full && n_rects == 0) {
+		cairo_region_destroy(changed);
+		return (false);
+	}
+	cairo_surface_flush(vis->retained.img);
+
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &old_tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	if (full) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_BGRA,
+		    GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		    GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+		    GL_LINEAR);
+		tex_upload(vis->retained.img, 0, 0, w, h);
+		vis->tex.id = tex;
+		vis->tex.w = w;
+		vis->tex.h = h;
+	} else {
+		cairo_rectangle_int_t all = { 0, 0, w, h };
+
+		/* Dirty rectangles have margins, which may stick out */
+		cairo_region_intersect_rectangle(changed, &all);
+		n_rects = cairo_region_num_rectangles(changed);
+		for (int i = 0; i < n_rects; i++) {
+			cairo_rectangle_int_t rect;
+
+			cairo_region_get_rectangle(changed, i, &rect);
+			tex_upload(vis->retained.img, rect.x, rect.y,
+			    rect.width, rect.height);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, old_tex);
+	cairo_region_destroy(changed);
+
+	return (true);
+}
+
+/**
+ * Sets the number of helper threads used to rasterize the view. Large
+ * images (such as the static layer caches, or a full redraw of a big
+ * window) are split into horizontal bands, which are then rendered in
+ * parallel by the helper threads and the renderer thread itself, each
+ * band only drawing the components which overlap it. This can be
+ * called at any time, including while the window is open.
+ *
+ * @param n_threads The number of helper threads to spawn in addition
+ *	to the renderer threads. The default is 0, which renders every
+ *	image on its renderer thread.
+ */
+void
+libelec_vis_set_render_threads(libelec_vis_t *vis, unsigned n_threads)
+{
+	ASSERT(vis != NULL);
+
+	mutex_enter(&vis->tile.job_lock);
+	tile_threads_fini(vis);
+	if (n_threads != 0) {
+		vis->tile.threads = elec_calloc(n_threads,
+		    sizeof (*vis->tile.threads));
+		for (unsigned i = 0; i < n_threads; i++) {
+			vis_tile_thr_t *thr = &vis->tile.threads[i];
+
+			thr->vis = vis;
+			thr->job = vis->tile.job;
+			VERIFY(thread_create(&thr->thread, tile_thread, thr));
+		}
+		vis->tile.n_threads = n_threads;
+	}
+	mutex_exit(&vis->tile.job_lock);
+}
+
+/**
+ * @return The number of helper threads used to rasterize the view.
+ * @see libelec_vis_set_render_threads()
+ */
+unsigned
+libelec_vis_get_render_threads(const libelec_vis_t *vis)
+{
+	ASSERT(vis != NULL);
+	return (vis->tile.n_threads);
+}
+
 /**
  * @return True if the visualizer window is open, false if it isn't.
  */
@@ -511,8 +1973,14 @@ libelec_vis_open(libelec_vis_t *vis)
 	ASSERT(vis->win != NULL);
 
 	if (!XPLMGetWindowIsVisible(vis->win)) {
+		mutex_enter(&vis->lock);
+		vis->preview = false;
+		mutex_exit(&vis->lock);
+		vis->refine = false;
 		recreate_mtcr(vis);
-		mt_cairo_render_once_wait(vis->mtcr);
+		vis->state_hash = libelec_draw_get_state_hash(vis->sys);
+		render_once(vis, true);
+		vis->dirty = false;
 		XPLMSetWindowIsVisible(vis->win, true);
 		XPLMScheduleFlightLoop(vis->floop, -1, true);
 	}
@@ -19,6 +19,10 @@
  * libelec_vis_open() if it was closed by the user (use
  * libelec_vis_is_open() to check).
  *
+ * To show the network on your own displays instead of in a window,
+ * create an offscreen visualizer using libelec_vis_new_offscreen() and
+ * render it into a texture of your own using libelec_vis_render_tex().
+ *
  * @note If you plan on running libelec in a simulator other than X-Plane,
  * or outside of a simulator entirely, you can still use the same
  * visualizations by using the functions from `libelec_drawing.h` and
@@ -51,8 +55,28 @@ extern "C" {
 
 typedef struct libelec_vis_s libelec_vis_t;
 
+/**
+ * Rendering backend of the visualizer, see libelec_vis_new_backend().
+ */
+typedef enum {
+	/**
+	 * The whole window is composited in software by cairo and
+	 * uploaded as a single texture on every frame.
+	 */
+	LIBELEC_VIS_BACKEND_CAIRO,
+	/**
+	 * Every drawing layer is kept in its own texture, which the GPU
+	 * composites, scales and pans. The static layers are only
+	 * rasterized when the zoom level changes, or the view is panned
+	 * far away, and are never re-uploaded otherwise.
+	 */
+	LIBELEC_VIS_BACKEND_GL
+} libelec_vis_backend_t;
+
 libelec_vis_t *libelec_vis_new(const elec_sys_t *sys, double pos_scale,
     double font_sz);
+libelec_vis_t *libelec_vis_new_backend(const elec_sys_t *sys,
+    double pos_scale, double font_sz, libelec_vis_backend_t backend);
 void libelec_vis_destroy(libelec_vis_t *vis);
 #ifdef	LIBELEC_VIS_WITH_WIN_KEEPER
 void libelec_vis_set_win_keeper(libelec_vis_t *vis, win_keeper_t *wk,
@@ -67,6 +91,16 @@ XPLMWindowID libelec_vis_get_win(const libelec_vis_t *vis);
 
 void libelec_vis_set_offset(libelec_vis_t *vis, vect2_t offset);
 vect2_t libelec_vis_get_offset(const libelec_vis_t *vis);
+void libelec_vis_set_zoom(libelec_vis_t *vis, double zoom);
+double libelec_vis_get_zoom(const libelec_vis_t *vis);
+
+libelec_vis_t *libelec_vis_new_offscreen(const elec_sys_t *sys,
+    double pos_scale, double font_sz);
+bool libelec_vis_render_tex(libelec_vis_t *vis, GLuint tex, unsigned w,
+    unsigned h);
+
+void libelec_vis_set_render_threads(libelec_vis_t *vis, unsigned n_threads);
+unsigned libelec_vis_get_render_threads(const libelec_vis_t *vis);
 
 #ifdef __cplusplus
 }